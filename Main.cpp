@@ -1,5 +1,10 @@
-﻿#include <iostream>
+﻿#include <algorithm>
+#include <cfloat>
+#include <functional>
+#include <iterator>
+#include <iostream>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,13 +15,14 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
-#include "Vertex.hpp"
-#include "Shader.hpp"
 #include "Camera.hpp"
-#include "TextureManager.hpp"
-#include "PointLight.hpp"
-#include "Mesh.hpp"
+#include "TextureStreamer.hpp"
+#include "TextureCache.hpp"
+#include "Scene.hpp"
 #include "Model.hpp"
+#include "GeometryPool.hpp"
+#include "Profiler.hpp"
+#include "ProgramCache.hpp"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -37,110 +43,124 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-TextureManager textureManager;
+void initImGui(GLFWwindow* window)
+{
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init();
+    ImGui::StyleColorsDark();
+}
 
-void renderCubes(Shader& shader, unsigned int vao, const std::vector<glm::vec3>& positions, const glm::mat4& projection, const glm::mat4& view, float currentFrameTime)
+#if PROFILER_ENABLED
+// one row per nesting depth, zones laid out over [startMs, startMs + durationMs] across the window width
+void renderFlameGraph(const std::vector<Profiler::Zone>& zones, double startMs, double durationMs)
 {
-    shader.use();
-    shader.setFloat("time", currentFrameTime);
-    shader.setVec3("viewPos", camera.Position);
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
-
-    textureManager.activate(GL_TEXTURE0, textureManager.get("diffuse"));
-    textureManager.activate(GL_TEXTURE1, textureManager.get("specular"));
-    textureManager.activate(GL_TEXTURE2, textureManager.get("emission"));
-
-    glBindVertexArray(vao);
-    for (std::size_t i = 0; i < positions.size(); ++i)
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+
+    std::uint32_t depth = 0;
+    for (const Profiler::Zone& zone : zones)
     {
-        glm::mat4 trs =
-            glm::translate(glm::mat4(1.0f), positions[i]) *
-            glm::rotate(glm::mat4(1.0f), glm::radians(0.0f), glm::vec3(0.0f, 0.0f, 1.0f)) *
-            glm::scale(glm::mat4(1.0f), glm::vec3(1.0f));
+        depth = std::max(depth, zone.depth + 1);
+    }
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+    const float scale = durationMs > 0.0 ? width / static_cast<float>(durationMs) : 0.0f;
+
+    for (const Profiler::Zone& zone : zones)
+    {
+        ImVec2 min(origin.x + static_cast<float>(zone.startMs - startMs) * scale, origin.y + zone.depth * rowHeight);
+        ImVec2 max(std::max(min.x + static_cast<float>(zone.durationMs) * scale, min.x + 1.0f), min.y + rowHeight - 1.0f);
+
+        // colour from the name so a zone keeps it from frame to frame
+        std::size_t hash = std::hash<std::string>()(zone.name);
+        ImU32 color = IM_COL32(96 + hash % 128, 96 + (hash >> 8) % 128, 96 + (hash >> 16) % 128, 255);
 
-        shader.setMat4("model", trs);
+        drawList->AddRectFilled(min, max, color);
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(0, 0, 0, 255), zone.name);
+        drawList->PopClipRect();
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        if (ImGui::IsMouseHoveringRect(min, max))
+        {
+            ImGui::SetTooltip("%s: %.3f ms", zone.name, zone.durationMs);
+        }
     }
-    glBindVertexArray(0);
+
+    ImGui::Dummy(ImVec2(width, std::max(depth, 1u) * rowHeight));
 }
+#endif
 
-void updatePointLights(Shader& shader, std::vector<PointLight>& pointLights)
+void renderProfiler()
 {
-    shader.use();
+    ImGui::Begin("Profiler");
 
-    for (std::size_t i = 0; i < pointLights.size(); ++i)
+#if PROFILER_ENABLED
+    const std::deque<Profiler::Frame>& history = Profiler::shared().getHistory();
+    if (history.empty())
     {
-        std::string number = std::to_string(i);
-        std::string prefix = "pointLights[" + number + "]";
-
-        shader.setVec3(prefix + ".position", pointLights[i].position);
-        shader.setVec3(prefix + ".ambient", pointLights[i].color * 0.1f);
-        shader.setVec3(prefix + ".diffuse", pointLights[i].color);
-        shader.setVec3(prefix + ".specular", pointLights[i].color);
-        shader.setFloat(prefix + ".constant", pointLights[i].constant);
-        shader.setFloat(prefix + ".linear", pointLights[i].linear);
-        shader.setFloat(prefix + ".quadratic", pointLights[i].quadratic);
+        ImGui::Text("Waiting for the first frames...");
+        ImGui::End();
+        return;
     }
-}
 
-void updateSpotlight(Shader& shader)
-{
-    shader.use();
-    shader.setVec3("spotLight.position", camera.Position);
-    shader.setVec3("spotLight.direction", camera.Front);
-    shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-    shader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-    shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-    shader.setFloat("spotLight.constant", 1.0f);
-    shader.setFloat("spotLight.linear", 0.09f);
-    shader.setFloat("spotLight.quadratic", 0.032f);
-    shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-    shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-}
+    std::vector<float> cpuTimes;
+    std::vector<float> gpuTimes;
+    for (const Profiler::Frame& frame : history)
+    {
+        cpuTimes.push_back(static_cast<float>(frame.cpuMs));
+        gpuTimes.push_back(static_cast<float>(frame.gpuMs));
+    }
 
-void updateDirLight(Shader& shader)
-{
-    shader.use();
-    shader.setVec3("directionalLight.direction", -0.2f, -1.0f, -0.3f);
-    shader.setVec3("directionalLight.ambient", 0.0f, 0.0f, 0.0f);
-    shader.setVec3("directionalLight.diffuse", 0.05f, 0.05f, 0.05f);
-    shader.setVec3("directionalLight.specular", 0.2f, 0.2f, 0.2f);
-}
+    const Profiler::Frame& frame = history.back();
 
-void renderPointLights(Shader& shader, unsigned int vao, const std::vector<PointLight>& lights, const glm::mat4& projection, const glm::mat4& view)
-{
-    shader.use();
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
+    std::string cpuOverlay = std::to_string(frame.cpuMs) + " ms";
+    std::string gpuOverlay = frame.gpuValid ? std::to_string(frame.gpuMs) + " ms" : "dropped";
+    ImGui::PlotLines("CPU", cpuTimes.data(), static_cast<int>(cpuTimes.size()), 0, cpuOverlay.c_str(), 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+    ImGui::PlotLines("GPU", gpuTimes.data(), static_cast<int>(gpuTimes.size()), 0, gpuOverlay.c_str(), 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+
+    // the overlay only follows the GL thread, worker zones are in the trace
+    std::vector<Profiler::Zone> cpuZones;
+    std::copy_if(frame.cpuZones.begin(), frame.cpuZones.end(), std::back_inserter(cpuZones), [](const Profiler::Zone& zone) { return zone.thread == 0; });
 
-    glBindVertexArray(vao);
-    for (std::size_t i = 0; i < lights.size(); ++i)
+    ImGui::Separator();
+    ImGui::Text("Frame %llu CPU", static_cast<unsigned long long>(frame.index));
+    renderFlameGraph(cpuZones, frame.startMs, frame.cpuMs);
+
+    if (!frame.gpuZones.empty())
     {
-        glm::mat4 trs =
-            glm::translate(glm::mat4(1.0f), lights[i].position) *
-            glm::rotate(glm::mat4(1.0f), glm::radians(0.0f), glm::vec3(0.0f, 0.0f, 1.0f)) *
-            glm::scale(glm::mat4(1.0f), glm::vec3(0.2f));
+        double gpuStartMs = frame.gpuZones.front().startMs;
+        for (const Profiler::Zone& zone : frame.gpuZones)
+        {
+            gpuStartMs = std::min(gpuStartMs, zone.startMs);
+        }
 
-        shader.setMat4("model", trs);
+        ImGui::Text("Frame %llu GPU", static_cast<unsigned long long>(frame.index));
+        renderFlameGraph(frame.gpuZones, gpuStartMs, frame.gpuMs);
+    }
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    ImGui::Separator();
+    if (ImGui::Button("Export Chrome trace"))
+    {
+        if (Profiler::shared().exportChromeTrace("profile_trace.json"))
+        {
+            std::cout << "Wrote profile_trace.json (" << history.size() << " frames)" << std::endl;
+        }
     }
-    glBindVertexArray(0);
-}
+#else
+    ImGui::Text("Profiler zones are compiled out of this build, define PROFILER_FORCE_ENABLE to keep them");
+#endif
 
-void initImGui(GLFWwindow* window)
-{
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init();
-    ImGui::StyleColorsDark();
+    ImGui::End();
 }
 
-void renderImGui(std::vector<PointLight>& pointLights)
+void renderImGui(Scene& scene)
 {
+    std::vector<PointLight>& pointLights = scene.getPointLights();
+    Scene::Settings& settings = scene.getSettings();
+
     {
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -163,7 +183,161 @@ void renderImGui(std::vector<PointLight>& pointLights)
             ImGui::PopID();
         }
 
+        if (ImGui::CollapsingHeader("Render Path"))
+        {
+            int renderPath = settings.deferredShading ? 1 : 0;
+            ImGui::RadioButton("Forward", &renderPath, 0);
+            ImGui::SameLine();
+            ImGui::RadioButton("Deferred", &renderPath, 1);
+            settings.deferredShading = renderPath == 1;
+
+            ImGui::Checkbox("Spotlight", &settings.spotLight);
+            ImGui::Checkbox("Per-light material fetch (old)", &settings.perLightMaterialFetch);
+
+            ImGui::SliderInt("Extra lights", &settings.extraLights, 0, 10000);
+            ImGui::Text("Frame time: %.3f ms (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+            const DeferredRenderer::Stats& stats = scene.getDeferredRenderer().getStats();
+            ImGui::Text("Light volumes: %zu", stats.lightVolumes);
+            ImGui::Text("G-buffer memory: %.2f MB", stats.gBufferMemory / (1024.0 * 1024.0));
+        }
+
+        if (ImGui::CollapsingHeader("Clustered Lighting"))
+        {
+            ImGui::Checkbox("Enabled", &settings.clusteredLighting);
+
+            const LightClusters& lightClusters = scene.getLightClusters();
+            const LightClusters::Stats& stats = lightClusters.getStats();
+            ImGui::Text("Binning: %.3f ms (%zu lights)", stats.binningMs, stats.lights);
+            ImGui::Text("Light indices: %zu", stats.lightIndices);
+            ImGui::Text("Occupied clusters: %zu / %zu", stats.occupiedClusters, lightClusters.getClusterCount());
+            ImGui::Text("Max lights per cluster: %zu", stats.maxLightsPerCluster);
+        }
+
+        if (ImGui::CollapsingHeader("Culling"))
+        {
+            ImGui::Checkbox("Frustum culling", &settings.frustumCulling);
+            ImGui::SliderInt("Extra cubes", &settings.extraCubes, 0, 100000);
+
+            const CullStats& cubeCullStats = scene.getCubeCullStats();
+            ImGui::Text("Cubes visible: %zu / %zu", cubeCullStats.visible, cubeCullStats.objects);
+            ImGui::Text("Nodes visited: %zu", cubeCullStats.nodesVisited);
+            ImGui::Text("Boxes tested: %zu", cubeCullStats.boxesTested);
+            ImGui::Text("Cull time: %.4f ms", cubeCullStats.cullMs);
+        }
+
+        if (ImGui::CollapsingHeader("Scene Graph"))
+        {
+            ImGui::Checkbox("Animate cubes", &settings.animateCubes);
+
+            const SceneGraph::Stats& stats = scene.getSceneGraph().getStats();
+            ImGui::Text("Nodes: %zu", stats.nodes);
+            ImGui::Text("Updated: %zu (%zu subtrees, %zu tasks)", stats.nodesUpdated, stats.dirtyRoots, stats.tasks);
+            ImGui::Text("Update time: %.4f ms", stats.updateMs);
+        }
+
+        if (ImGui::CollapsingHeader("Shadows"))
+        {
+            ImGui::Checkbox("Shadow maps (forward only)", &settings.shadows);
+            ImGui::SliderInt("Refresh budget", &settings.shadowRefreshBudget, 0, 16);
+
+            const ShadowMaps& shadowMaps = scene.getShadowMaps();
+            const ShadowMaps::Stats& stats = shadowMaps.getStats();
+            ImGui::Text("Maps: %zu, stale: %zu, refreshed: %zu", stats.maps, stats.stale, stats.refreshed);
+            ImGui::Text("Depth passes: %zu", stats.passes);
+            ImGui::Text("Refresh: %.4f ms", stats.refreshMs);
+            ImGui::Text("Shadow map memory: %.2f MB", shadowMaps.getGpuMemoryUsage() / (1024.0 * 1024.0));
+        }
+
+        if (ImGui::CollapsingHeader("Render Queue"))
+        {
+            ImGui::Checkbox("Cull and record on worker threads", &settings.parallelRecording);
+
+            const RenderQueue::Stats& stats = scene.getRenderQueue().getStats();
+            ImGui::Text("Commands: %zu (%zu draw calls)", stats.commands, scene.getDrawCalls());
+            ImGui::Text("Sort: %.4f ms", stats.sortMs);
+            ImGui::Text("Command buffers: %zu, record %.4f ms, replay %.4f ms", stats.commandBuffers, stats.recordMs, stats.replayMs);
+            ImGui::Text("Binds issued: %zu, skipped: %zu", stats.getBindsIssued(), stats.getBindsSkipped());
+            ImGui::Text("Programs: %zu / %zu skipped", stats.programBinds, stats.programBindsSkipped);
+            ImGui::Text("Textures: %zu / %zu skipped", stats.textureBinds, stats.textureBindsSkipped);
+            ImGui::Text("Vertex arrays: %zu / %zu skipped", stats.vaoBinds, stats.vaoBindsSkipped);
+        }
+
+        if (ImGui::CollapsingHeader("Uniform Cache"))
+        {
+            const UniformCacheStats& stats = scene.getLitShader().getUniformCacheStats();
+            ImGui::Text("Hits: %llu", stats.hits);
+            ImGui::Text("Misses: %llu", stats.misses);
+        }
+
+        if (ImGui::CollapsingHeader("Shader Variants"))
+        {
+            const ShaderVariantCache& litShaders = scene.getLitShaders();
+            const ShaderVariantCache::Stats& stats = litShaders.getStats();
+            ImGui::Text("Lookups: %zu, compiled: %zu", stats.lookups, stats.compiles);
+
+            for (const std::string& name : litShaders.getVariantNames())
+            {
+                ImGui::BulletText("%s", name.empty() ? "(no defines)" : name.c_str());
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Texture Streaming"))
+        {
+            const TextureStreamer::Stats stats = TextureStreamer::shared().getStats();
+            ImGui::Text("Pending decodes: %zu", stats.pendingDecodes);
+            ImGui::Text("Pending uploads: %zu", stats.pendingUploads);
+            ImGui::Text("Uploaded last frame: %zu bytes", stats.bytesUploadedLastFrame);
+            ImGui::Text("Completed: %zu", stats.texturesCompleted);
+            ImGui::Text("Block compressed: %zu (%zu from cache)", stats.texturesCompressed, stats.compressedCacheHits);
+            ImGui::Text("Duplicates shared: %zu", stats.duplicatesShared);
+            ImGui::Text("Texture memory: %.2f MB (uncompressed %.2f MB)", stats.textureMemory / (1024.0 * 1024.0), stats.uncompressedTextureMemory / (1024.0 * 1024.0));
+        }
+
+        if (ImGui::CollapsingHeader("Texture Cache"))
+        {
+            const TextureCache::Stats& stats = TextureCache::shared().getStats();
+            ImGui::Text("Path hits: %zu", stats.pathHits);
+            ImGui::Text("Content hits: %zu", stats.contentHits);
+            ImGui::Text("Misses: %zu", stats.misses);
+            ImGui::Text("Textures: %zu (%zu references)", stats.textures, stats.references);
+            ImGui::Text("Bytes saved: %zu", stats.bytesSaved);
+        }
+
+        if (ImGui::CollapsingHeader("Geometry Pool"))
+        {
+            GeometryPool& pool = GeometryPool::shared();
+            const GeometryPool::Stats stats = pool.getStats();
+            ImGui::Text("Meshes: %zu", stats.allocations);
+            ImGui::Text("Vertex memory: %.2f / %.2f MB", stats.vertexBytesUsed / (1024.0 * 1024.0), stats.vertexBytes / (1024.0 * 1024.0));
+            ImGui::Text("Index memory: %.2f / %.2f MB", stats.indexBytesUsed / (1024.0 * 1024.0), stats.indexBytes / (1024.0 * 1024.0));
+            ImGui::Text("Free ranges: %zu", stats.freeRanges);
+            ImGui::Text("Grows: %zu, compactions: %zu", stats.grows, stats.compactions);
+            ImGui::Text("Multi-draws: %zu (%zu meshes, %s)", stats.multiDraws, stats.meshesDrawn, stats.indirect ? "indirect" : "base vertex");
+
+            bool indirect = pool.isIndirectEnabled();
+            if (ImGui::Checkbox("Indirect draws when available", &indirect))
+            {
+                pool.setIndirectEnabled(indirect);
+            }
+
+            if (ImGui::Button("Compact"))
+            {
+                pool.compact();
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Light Buffer"))
+        {
+            const LightUniformBuffer::UploadStats& stats = scene.getLightBuffer().getLastUploadStats();
+            ImGui::Text("Ranges uploaded: %u", stats.ranges);
+            ImGui::Text("Bytes uploaded: %zu", stats.bytes);
+        }
+
         ImGui::End();
+
+        renderProfiler();
+
         ImGui::EndFrame();
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -202,152 +376,57 @@ int main()
         return -1;
     }
 
-    stbi_set_flip_vertically_on_load(true);
-
-    Shader litShader("resources/shaders/vert_lit.glsl", "resources/shaders/frag_lit.glsl");
-    litShader.use();
-    litShader.setInt("material.diffuse", 0);
-    litShader.setInt("material.specular", 1);
-    litShader.setInt("material.emission", 2);
-    litShader.setFloat("material.shininess", 64.0f);
+    initImGui(window);
 
-    Shader unlitShader("resources/shaders/vert_unlit.glsl", "resources/shaders/frag_unlit.glsl");
+    {
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
-    textureManager.load("resources/textures/container2.png", "diffuse");
-    textureManager.load("resources/textures/container2_specular.png", "specular");
-    textureManager.load("resources/textures/matrix.jpg", "emission");
+        // scoped so its GL objects are gone before the texture caches and the context
+        Scene scene(framebufferWidth, framebufferHeight);
+        ProgramCache::shared().printReport();
 
-    std::vector<Vertex> cubeVertices
-    {
-        // back face
-        { { -0.5f, -0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 0.0f, 0.0f } },
-        { {  0.5f, -0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 1.0f, 0.0f } },
-        { {  0.5f,  0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 1.0f, 1.0f } },
-        { {  0.5f,  0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 1.0f, 1.0f } },
-        { { -0.5f,  0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 0.0f, 1.0f } },
-        { { -0.5f, -0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 0.0f, 0.0f } },
-
-        // front face
-        { { -0.5f, -0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 0.0f, 0.0f } },
-        { {  0.5f, -0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 1.0f, 0.0f } },
-        { {  0.5f,  0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 1.0f, 1.0f } },
-        { {  0.5f,  0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 1.0f, 1.0f } },
-        { { -0.5f,  0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 0.0f, 1.0f } },
-        { { -0.5f, -0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 0.0f, 0.0f } },
-
-        // left face
-        { { -0.5f,  0.5f,  0.5f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
-        { { -0.5f,  0.5f, -0.5f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
-        { { -0.5f, -0.5f, -0.5f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
-        { { -0.5f, -0.5f, -0.5f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
-        { { -0.5f, -0.5f,  0.5f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
-        { { -0.5f,  0.5f,  0.5f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
-
-        // right face
-        { { 0.5f,  0.5f,  0.5f }, { 1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
-        { { 0.5f,  0.5f, -0.5f }, { 1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
-        { { 0.5f, -0.5f, -0.5f }, { 1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
-        { { 0.5f, -0.5f, -0.5f }, { 1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
-        { { 0.5f, -0.5f,  0.5f }, { 1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
-        { { 0.5f,  0.5f,  0.5f }, { 1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
-
-        // bottom face
-        { { -0.5f, -0.5f, -0.5f }, { 0.0f, -1.0f,  0.0f }, { 0.0f, 0.0f } },
-        { {  0.5f, -0.5f, -0.5f }, { 0.0f, -1.0f,  0.0f }, { 1.0f, 0.0f } },
-        { {  0.5f, -0.5f,  0.5f }, { 0.0f, -1.0f,  0.0f }, { 1.0f, 1.0f } },
-        { {  0.5f, -0.5f,  0.5f }, { 0.0f, -1.0f,  0.0f }, { 1.0f, 1.0f } },
-        { { -0.5f, -0.5f,  0.5f }, { 0.0f, -1.0f,  0.0f }, { 0.0f, 1.0f } },
-        { { -0.5f, -0.5f, -0.5f }, { 0.0f, -1.0f,  0.0f }, { 0.0f, 0.0f } },
-
-        // top face
-        { { -0.5f,  0.5f, -0.5f }, { 0.0f,  1.0f,  0.0f }, { 0.0f, 0.0f } },
-        { {  0.5f,  0.5f, -0.5f }, { 0.0f,  1.0f,  0.0f }, { 1.0f, 0.0f } },
-        { {  0.5f,  0.5f,  0.5f }, { 0.0f,  1.0f,  0.0f }, { 1.0f, 1.0f } },
-        { {  0.5f,  0.5f,  0.5f }, { 0.0f,  1.0f,  0.0f }, { 1.0f, 1.0f } },
-        { { -0.5f,  0.5f,  0.5f }, { 0.0f,  1.0f,  0.0f }, { 0.0f, 1.0f } },
-        { { -0.5f,  0.5f, -0.5f }, { 0.0f,  1.0f,  0.0f }, { 0.0f, 0.0f } }
-    };
-
-    std::vector<glm::vec3> cubePositions {
-        { 0.0f, -10.0f, 0.0f },
-        { 2.0f, -5.0f, -15.0f },
-        { -1.5f, -12.2f, -2.5f },
-        { -3.8f, -12.0f, -12.3f },
-        { 2.4f, -10.4f, -3.5f },
-        { -1.7f, -7.0f, -7.5f },
-        { 1.3f, -12.0f, -2.5f },
-        { 1.5f, -8.0f, -2.5f },
-        { 1.5f, -12.2f, -1.5f },
-        { -1.3f, -11.0f, -1.5f }
-    };
-
-    std::vector<PointLight> pointLights {
-        { { 0.7f, 0.2f, 2.0f }, { 0.1f, 0.1f, 0.1f } },
-        { { 2.3f, -3.3f, -4.0f }, { 0.1f, 0.1f, 0.1f } },
-        { { -4.0f, 2.0f, -12.0f }, { 0.1f, 0.1f, 0.1f } },
-        { { 0.0f, 0.0f, -3.0f }, { 0.3f, 0.1f, 0.1f } }
-    };
-
-    unsigned int cubeVbo, cubeVao;
-    glGenVertexArrays(1, &cubeVao);
-    glGenBuffers(1, &cubeVbo);
-        glBindVertexArray(cubeVao);
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * cubeVertices.size(), cubeVertices.data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    unsigned int lightCubeVao;
-    glGenVertexArrays(1, &lightCubeVao);
-        glBindVertexArray(lightCubeVao);
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVbo);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    //Model backpackModel("resources/models/backpack.obj");
-
-    glEnable(GL_DEPTH_TEST);
+        //Model backpackModel("resources/models/backpack.obj");
 
-    initImGui(window);
-    while (!glfwWindowShouldClose(window))
-    {
-        const float currentFrameTime = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrameTime - lastFrame;
-        lastFrame = currentFrameTime;
+        while (!glfwWindowShouldClose(window))
+        {
+            PROFILE_FRAME();
+            GeometryPool::shared().resetDrawStats();
 
-        processInput(window);
+            const float currentFrameTime = static_cast<float>(glfwGetTime());
+            deltaTime = currentFrameTime - lastFrame;
+            lastFrame = currentFrameTime;
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            processInput(window);
 
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
+            // finish streaming textures a slice at a time so new assets never stall a frame
+            {
+                PROFILE_ZONE("Texture streaming");
+                PROFILE_GPU_ZONE("Texture streaming");
+                TextureStreamer::shared().update();
+            }
 
-        // update light props
-        updateDirLight(litShader);
-        updatePointLights(litShader, pointLights);
-        updateSpotlight(litShader);
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            scene.render(camera, (float)SCR_WIDTH / (float)SCR_HEIGHT, currentFrameTime, 0, framebufferWidth, framebufferHeight);
 
-        // render scene
-        renderCubes(litShader, cubeVao, cubePositions, projection, view, currentFrameTime);
-        renderPointLights(unlitShader, lightCubeVao, pointLights, projection, view);
-        renderImGui(pointLights);
+            {
+                PROFILE_ZONE("ImGui");
+                PROFILE_GPU_ZONE("ImGui");
+                renderImGui(scene);
+            }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            {
+                PROFILE_ZONE("Swap buffers");
+                glfwSwapBuffers(window);
+            }
+            glfwPollEvents();
+        }
     }
 
-    glDeleteVertexArrays(1, &cubeVao);
-    glDeleteVertexArrays(1, &lightCubeVao);
-    glDeleteBuffers(1, &cubeVbo);
+    TextureCache::shared().clear();
+    TextureStreamer::shared().release();
+    GeometryPool::shared().release();
+    Profiler::shared().release();
 
     glfwTerminate();
     return 0;
@@ -0,0 +1,94 @@
+#include "CameraPath.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool CameraPath::load(const std::string& filePath)
+{
+    std::ifstream file(filePath);
+    if (!file)
+    {
+        std::cout << "ERROR::CAMERA_PATH::FILE_NOT_READ: " << filePath << std::endl;
+        return false;
+    }
+
+    _keys.clear();
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        std::size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+
+        std::istringstream stream(line);
+        Key key { 0.0f, glm::vec3(0.0f), 0.0f, 0.0f, 45.0f };
+        if (!(stream >> key.time))
+        {
+            // blank or comment only
+            continue;
+        }
+
+        if (!(stream >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch))
+        {
+            std::cout << "ERROR::CAMERA_PATH::MALFORMED_KEY: " << filePath << ":" << lineNumber << std::endl;
+            return false;
+        }
+        stream >> key.zoom;
+
+        if (!_keys.empty() && key.time < _keys.back().time)
+        {
+            std::cout << "ERROR::CAMERA_PATH::KEYS_NOT_SORTED: " << filePath << ":" << lineNumber << std::endl;
+            return false;
+        }
+
+        _keys.push_back(key);
+    }
+
+    if (_keys.empty())
+    {
+        std::cout << "ERROR::CAMERA_PATH::NO_KEYS: " << filePath << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool CameraPath::empty() const
+{
+    return _keys.empty();
+}
+
+float CameraPath::getDuration() const
+{
+    return _keys.empty() ? 0.0f : _keys.back().time - _keys.front().time;
+}
+
+void CameraPath::apply(float time, Camera& camera) const
+{
+    if (_keys.empty())
+    {
+        return;
+    }
+
+    time += _keys.front().time;
+
+    std::size_t next = 0;
+    while (next < _keys.size() && _keys[next].time <= time)
+    {
+        ++next;
+    }
+
+    const Key& from = _keys[next == 0 ? 0 : next - 1];
+    const Key& to = _keys[next == _keys.size() ? next - 1 : next];
+
+    float span = to.time - from.time;
+    float t = span > 0.0f ? (time - from.time) / span : 0.0f;
+
+    camera.Position = glm::mix(from.position, to.position, t);
+    camera.Zoom = glm::mix(from.zoom, to.zoom, t);
+    camera.SetRotation(glm::mix(from.yaw, to.yaw, t), glm::mix(from.pitch, to.pitch, t));
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Camera.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// keyframed camera for scripted runs, read from a text file with one key per line:
+//   time x y z yaw pitch [zoom]
+// times are in seconds and ascending, '#' starts a comment
+class CameraPath
+{
+public:
+    bool load(const std::string& filePath);
+
+    bool empty() const;
+    float getDuration() const;
+
+    // interpolates linearly between the surrounding keys, clamped to the first and last one
+    void apply(float time, Camera& camera) const;
+
+private:
+    struct Key
+    {
+        float time;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+        float zoom;
+    };
+
+    std::vector<Key> _keys;
+};
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "CpuBench.hpp"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    struct Check
+    {
+        const char* name;
+        bool (*run)();
+    };
+
+    const Check Checks[] =
+    {
+        { "light_block_layout", &CpuBench::checkLightBlockLayout },
+        { "light_binning", &CpuBench::checkLightBinning },
+        { "bvh_partitions", &CpuBench::checkBvhPartitions }
+    };
+
+    // runs the named check (or all of them), the exit code is what ctest looks at
+    int runChecks(const char* name)
+    {
+        bool found = false;
+        bool passed = true;
+        for (const Check& check : Checks)
+        {
+            if (name != nullptr && std::strcmp(name, check.name) != 0)
+            {
+                continue;
+            }
+
+            bool result = check.run();
+            std::cout << (result ? "PASS " : "FAIL ") << check.name << std::endl;
+            passed &= result;
+            found = true;
+        }
+
+        if (!found)
+        {
+            std::cout << "ERROR::CHECK::UNKNOWN: " << name << std::endl;
+            return 1;
+        }
+
+        return passed ? 0 : 1;
+    }
+}
+
+// usage: OpenGL_Lighting_cpubench [name], runs every benchmark when no name is given
+//        OpenGL_Lighting_cpubench --check [name], runs the correctness checks instead
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--check") == 0)
+    {
+        return runChecks(argc > 2 ? argv[2] : nullptr);
+    }
+
+    struct Benchmark
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const Benchmark benchmarks[] =
+    {
+        { "light_binning", &CpuBench::runLightBinning },
+        { "frustum_culling", &CpuBench::runFrustumCulling },
+        { "mesh_lod", &CpuBench::runMeshLod },
+        { "mesh_optimize", &CpuBench::runMeshOptimize },
+        { "scene_graph", &CpuBench::runSceneGraph }
+    };
+
+    bool found = false;
+    for (const Benchmark& benchmark : benchmarks)
+    {
+        if (argc > 1 && std::strcmp(argv[1], benchmark.name) != 0)
+        {
+            continue;
+        }
+
+        std::cout << "== " << benchmark.name << " ==" << std::endl;
+        benchmark.run();
+        found = true;
+    }
+
+    if (!found)
+    {
+        std::cout << "ERROR::BENCH::UNKNOWN: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// CPU microbenchmarks for the parts of the renderer that don't need a GL context
+namespace CpuBench
+{
+    // median wall time of one call in milliseconds, after a few warm up runs
+    template <typename F>
+    double measureMs(F&& body, int iterations = 50, int warmup = 3)
+    {
+        for (int i = 0; i < warmup; ++i)
+        {
+            body();
+        }
+
+        std::vector<double> samples(iterations);
+        for (double& sample : samples)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            sample = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::nth_element(samples.begin(), samples.begin() + iterations / 2, samples.end());
+        return samples[iterations / 2];
+    }
+
+    void runLightBinning();
+    void runFrustumCulling();
+    void runMeshLod();
+    void runMeshOptimize();
+    void runSceneGraph();
+
+    // correctness checks, run with --check. they print what's wrong and return false on failure
+    bool checkLightBlockLayout();
+    bool checkLightBinning();
+    bool checkBvhPartitions();
+}
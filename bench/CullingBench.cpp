@@ -0,0 +1,151 @@
+#include "CpuBench.hpp"
+#include "Bvh.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    // boxes of 0.5-5 units scattered through a 1000 unit cube around the origin
+    std::vector<BoundingBox> makeBoxes(std::size_t count)
+    {
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> size(0.25f, 2.5f);
+
+        std::vector<BoundingBox> boxes(count);
+        for (BoundingBox& box : boxes)
+        {
+            glm::vec3 center(position(random), position(random), position(random));
+            glm::vec3 extent(size(random), size(random), size(random));
+            box = BoundingBox { center - extent, center + extent };
+        }
+
+        return boxes;
+    }
+}
+
+void CpuBench::runFrustumCulling()
+{
+    const std::size_t objectCount = 100000;
+    std::vector<BoundingBox> boxes = makeBoxes(objectCount);
+
+    Bvh bvh;
+    double buildMs = measureMs([&]() { bvh.build(boxes); }, 5, 1);
+    std::printf("%zu objects, %zu nodes, build %.2f ms\n", objectCount, bvh.getNodeCount(), buildMs);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+
+    struct View
+    {
+        const char* name;
+        glm::vec3 eye;
+        glm::vec3 target;
+    };
+
+    // from barely anything to most of the scene in view
+    const View views[] =
+    {
+        { "outside, looking away", glm::vec3(0.0f, 0.0f, 600.0f), glm::vec3(0.0f, 0.0f, 1200.0f) },
+        { "inside, looking along z", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+        { "corner, looking across", glm::vec3(-500.0f, -500.0f, 500.0f), glm::vec3(0.0f, 0.0f, 0.0f) },
+        { "outside, facing the scene", glm::vec3(0.0f, 0.0f, 1100.0f), glm::vec3(0.0f, 0.0f, 0.0f) }
+    };
+
+    std::printf("%-26s %10s %12s %12s %10s %12s\n", "view", "visible", "bvh ms", "brute ms", "speedup", "nodes");
+
+    std::vector<std::uint32_t> visible;
+    std::vector<std::uint32_t> reference;
+
+    for (const View& view : views)
+    {
+        Frustum frustum = Frustum::fromMatrix(projection * glm::lookAt(view.eye, view.target, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        CullStats stats;
+        double bvhMs = measureMs([&]() { stats = bvh.cull(frustum, visible); });
+
+        // what the renderer did before: every box through the scalar test
+        double bruteMs = measureMs([&]()
+        {
+            reference.clear();
+            for (std::size_t i = 0; i < boxes.size(); ++i)
+            {
+                if (frustum.intersects(boxes[i]))
+                {
+                    reference.push_back(static_cast<std::uint32_t>(i));
+                }
+            }
+        });
+
+        // the bvh reports objects in tree order, the brute force pass in index order
+        std::vector<std::uint32_t> sortedVisible = visible;
+        std::sort(sortedVisible.begin(), sortedVisible.end());
+        std::sort(reference.begin(), reference.end());
+
+        if (sortedVisible != reference)
+        {
+            auto mismatch = std::mismatch(sortedVisible.begin(), sortedVisible.end(), reference.begin(), reference.end());
+            std::size_t position = static_cast<std::size_t>(mismatch.first - sortedVisible.begin());
+            std::printf("ERROR::BENCH::CULL_MISMATCH: bvh %zu, brute force %zu, first difference at %zu (bvh %lld, brute force %lld)\n",
+                sortedVisible.size(), reference.size(), position,
+                mismatch.first != sortedVisible.end() ? static_cast<long long>(*mismatch.first) : -1ll,
+                mismatch.second != reference.end() ? static_cast<long long>(*mismatch.second) : -1ll);
+        }
+
+        std::printf("%-26s %10zu %12.3f %12.3f %9.1fx %12zu\n", view.name, stats.visible, bvhMs, bruteMs, bruteMs / bvhMs, stats.nodesVisited);
+    }
+}
+
+bool CpuBench::checkBvhPartitions()
+{
+    bool valid = true;
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+    Frustum frustum = Frustum::fromMatrix(projection * glm::lookAt(glm::vec3(-500.0f, -500.0f, 500.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    std::vector<std::uint32_t> visible;
+    std::vector<std::uint32_t> partitioned;
+    std::vector<std::int32_t> roots;
+
+    // the small ones have objects right below the root, the big one splits past the requested count
+    for (std::size_t objectCount : { 1, 5, 17, 1000, 100000 })
+    {
+        Bvh bvh;
+        bvh.build(makeBoxes(objectCount));
+        CullStats whole = bvh.cull(frustum, visible);
+        std::sort(visible.begin(), visible.end());
+
+        for (std::size_t count : { 1, 3, 16, 64 })
+        {
+            bvh.split(count, roots);
+
+            // a tree this deep always has enough inner nodes
+            if (objectCount >= 1000 && roots.size() < count)
+            {
+                std::printf("ERROR::BENCH::PARTITION_COUNT: %zu objects split into %zu subtrees, %zu asked for\n", objectCount, roots.size(), count);
+                valid = false;
+            }
+
+            partitioned.clear();
+            std::size_t visibleCount = 0;
+            for (std::int32_t root : roots)
+            {
+                visibleCount += bvh.cull(frustum, root, partitioned).visible;
+            }
+            std::sort(partitioned.begin(), partitioned.end());
+
+            bool unique = std::adjacent_find(partitioned.begin(), partitioned.end()) == partitioned.end();
+            if (partitioned != visible || visibleCount != whole.visible || !unique)
+            {
+                std::printf("ERROR::BENCH::PARTITION_MISMATCH: %zu objects in %zu subtrees, %zu visible (reported %zu), whole tree %zu\n",
+                    objectCount, roots.size(), partitioned.size(), visibleCount, visible.size());
+                valid = false;
+            }
+        }
+    }
+
+    return valid;
+}
\ No newline at end of file
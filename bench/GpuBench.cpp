@@ -0,0 +1,781 @@
+#include "HeadlessContext.hpp"
+#include "CameraPath.hpp"
+#include "Scene.hpp"
+#include "TextureStreamer.hpp"
+#include "TextureCache.hpp"
+#include "Profiler.hpp"
+#include "GeometryPool.hpp"
+#include "ProgramCache.hpp"
+#include "Model.hpp"
+#include "MeshCache.hpp"
+#include "RenderQueue.hpp"
+#include "ThreadPool.hpp"
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        int width { 1280 };
+        int height { 720 };
+        int frames { 600 };
+        int warmupFrames { 30 };
+
+        std::string cameraPath { "resources/camera_paths/flythrough.campath" };
+        std::string output { "bench_results.json" };
+
+        // reference images, every dumpEvery-th recorded frame goes to dumpDirectory as a PNG
+        std::string dumpDirectory;
+        int dumpEvery { 0 };
+
+        // Chrome trace of the profiler zones, empty for none
+        std::string tracePath;
+
+        // compile every program from source, for measuring a cold start
+        bool programCache { true };
+
+        // records the path with the per-light material fetch first, then the normal run, and compares their gpu times
+        bool compareMaterialFetch { false };
+
+        // loaded once without and once with its mesh cache before the scene, empty for none
+        std::string modelPath;
+
+        // draws pushed through a render queue of their own, recorded on the GL thread and on the pool. 0 skips the case
+        int queueCommands { 4096 };
+
+        Scene::Settings scene;
+    };
+
+    struct FrameSample
+    {
+        float time;
+        double cpuMs;
+        double gpuMs;
+        std::size_t drawCalls;
+        bool dumped;
+    };
+
+    // the two loads of --model
+    struct ModelLoad
+    {
+        double coldMs { 0.0 };
+        double warmMs { 0.0 };
+        bool warmFromCache { false };
+    };
+
+    // the render queue case, times are medians of one execute() of all the draws
+    struct QueueRecording
+    {
+        std::size_t commandBuffers { 0 };
+        double serialRecordMs { 0.0 };
+        double parallelRecordMs { 0.0 };
+        double serialReplayMs { 0.0 };
+        double parallelReplayMs { 0.0 };
+    };
+
+    struct Summary
+    {
+        double mean { 0.0 };
+        double min { 0.0 };
+        double p50 { 0.0 };
+        double p90 { 0.0 };
+        double p95 { 0.0 };
+        double p99 { 0.0 };
+        double max { 0.0 };
+    };
+
+    void printUsage()
+    {
+        std::cout <<
+            "usage: OpenGL_Lighting_bench [options]\n"
+            "  --width N --height N     offscreen resolution (1280x720)\n"
+            "  --frames N               recorded frames (600)\n"
+            "  --warmup N               frames rendered before recording (30)\n"
+            "  --path FILE              camera path, see resources/camera_paths\n"
+            "  --output FILE            JSON results (bench_results.json)\n"
+            "  --dump-dir DIR           write reference images into DIR\n"
+            "  --dump-every N           image of every Nth recorded frame (needs --dump-dir)\n"
+            "  --trace FILE             Chrome trace of the last recorded frames (profiler builds only)\n"
+            "  --deferred               deferred instead of forward shading\n"
+            "  --no-clustered           forward path without clustered lights\n"
+            "  --no-culling             draw every cube\n"
+            "  --no-spotlight           camera spotlight off (and compiled out of the lit shader)\n"
+            "  --animate-cubes          spin the cubes through the scene graph\n"
+            "  --no-shadows             shadow maps off (and compiled out of the lit shader)\n"
+            "  --shadow-budget N        stale shadow maps redrawn per frame (4)\n"
+            "  --serial-record          cull, pack and record the render queue on the GL thread\n"
+            "  --per-light-fetch        old forward lighting model, material sampled by every light\n"
+            "  --compare-fetch          record the path with --per-light-fetch and without, print both gpu times\n"
+            "  --no-program-cache       compile shaders from source instead of loading cached binaries\n"
+            "  --model FILE             time loading FILE with a cold and with a warm mesh cache\n"
+            "  --queue-commands N       draws for the serial vs parallel render queue recording case, 0 skips it (4096)\n"
+            "  --extra-lights N         generated point lights (1000)\n"
+            "  --extra-cubes N          generated cubes on top of the ten placed ones (0)" << std::endl;
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (argument == "--width" && hasValue) { options.width = std::atoi(argv[++i]); }
+            else if (argument == "--height" && hasValue) { options.height = std::atoi(argv[++i]); }
+            else if (argument == "--frames" && hasValue) { options.frames = std::atoi(argv[++i]); }
+            else if (argument == "--warmup" && hasValue) { options.warmupFrames = std::atoi(argv[++i]); }
+            else if (argument == "--path" && hasValue) { options.cameraPath = argv[++i]; }
+            else if (argument == "--output" && hasValue) { options.output = argv[++i]; }
+            else if (argument == "--dump-dir" && hasValue) { options.dumpDirectory = argv[++i]; }
+            else if (argument == "--dump-every" && hasValue) { options.dumpEvery = std::atoi(argv[++i]); }
+            else if (argument == "--trace" && hasValue) { options.tracePath = argv[++i]; }
+            else if (argument == "--model" && hasValue) { options.modelPath = argv[++i]; }
+            else if (argument == "--queue-commands" && hasValue) { options.queueCommands = std::atoi(argv[++i]); }
+            else if (argument == "--extra-lights" && hasValue) { options.scene.extraLights = std::atoi(argv[++i]); }
+            else if (argument == "--extra-cubes" && hasValue) { options.scene.extraCubes = std::atoi(argv[++i]); }
+            else if (argument == "--shadow-budget" && hasValue) { options.scene.shadowRefreshBudget = std::atoi(argv[++i]); }
+            else if (argument == "--deferred") { options.scene.deferredShading = true; }
+            else if (argument == "--no-clustered") { options.scene.clusteredLighting = false; }
+            else if (argument == "--no-culling") { options.scene.frustumCulling = false; }
+            else if (argument == "--no-spotlight") { options.scene.spotLight = false; }
+            else if (argument == "--animate-cubes") { options.scene.animateCubes = true; }
+            else if (argument == "--no-shadows") { options.scene.shadows = false; }
+            else if (argument == "--serial-record") { options.scene.parallelRecording = false; }
+            else if (argument == "--per-light-fetch") { options.scene.perLightMaterialFetch = true; }
+            else if (argument == "--compare-fetch") { options.compareMaterialFetch = true; }
+            else if (argument == "--no-program-cache") { options.programCache = false; }
+            else
+            {
+                std::cout << "ERROR::BENCH::UNKNOWN_OPTION: " << argument << std::endl;
+                return false;
+            }
+        }
+
+        if (options.width <= 0 || options.height <= 0 || options.frames <= 0 || options.warmupFrames < 0 || options.scene.extraLights < 0 || options.scene.extraCubes < 0 || options.scene.shadowRefreshBudget < 0 || options.queueCommands < 0)
+        {
+            std::cout << "ERROR::BENCH::INVALID_OPTION_VALUE" << std::endl;
+            return false;
+        }
+
+        if (options.dumpEvery > 0 && options.dumpDirectory.empty())
+        {
+            std::cout << "ERROR::BENCH::DUMP_EVERY_WITHOUT_DUMP_DIR" << std::endl;
+            return false;
+        }
+
+        // the material fetch only exists in the forward lit shader
+        if (options.compareMaterialFetch && options.scene.deferredShading)
+        {
+            std::cout << "ERROR::BENCH::COMPARE_FETCH_NEEDS_FORWARD" << std::endl;
+            return false;
+        }
+
+        if (!options.tracePath.empty() && !PROFILER_ENABLED)
+        {
+            std::cout << "ERROR::BENCH::PROFILER_COMPILED_OUT" << std::endl;
+            return false;
+        }
+
+        if (!options.dumpDirectory.empty() && options.dumpEvery <= 0)
+        {
+            options.dumpEvery = std::max(1, options.frames / 10);
+        }
+
+        return true;
+    }
+
+    // color + depth/stencil, the depth format matches the G-buffer's so the deferred path can blit into it
+    struct OffscreenTarget
+    {
+        GlFramebuffer fbo;
+        GlRenderbuffer color;
+        GlRenderbuffer depth;
+    };
+
+    bool createTarget(OffscreenTarget& target, int width, int height)
+    {
+        target.fbo = GlFramebuffer::create();
+        target.color = GlRenderbuffer::create();
+        target.depth = GlRenderbuffer::create();
+
+        glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (!complete)
+        {
+            std::cout << "ERROR::BENCH::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        }
+        return complete;
+    }
+
+    // the context goes away before the target would go out of scope
+    void destroyTarget(OffscreenTarget& target)
+    {
+        target = {};
+    }
+
+    bool dumpImage(const OffscreenTarget& target, int width, int height, const std::string& filePath)
+    {
+        std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * 4);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target.fbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+        // GL rows start at the bottom
+        stbi_flip_vertically_on_write(1);
+        if (!stbi_write_png(filePath.c_str(), width, height, 4, pixels.data(), width * 4))
+        {
+            std::cout << "ERROR::BENCH::IMAGE_NOT_WRITTEN: " << filePath << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // nearest rank percentiles
+    Summary summarize(std::vector<double> samples)
+    {
+        Summary summary;
+        if (samples.empty())
+        {
+            return summary;
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        auto percentile = [&samples](double p)
+        {
+            std::size_t rank = static_cast<std::size_t>(std::ceil(p * samples.size()));
+            return samples[std::min(samples.size() - 1, rank == 0 ? 0 : rank - 1)];
+        };
+
+        double sum = 0.0;
+        for (double sample : samples)
+        {
+            sum += sample;
+        }
+
+        summary.mean = sum / samples.size();
+        summary.min = samples.front();
+        summary.p50 = percentile(0.50);
+        summary.p90 = percentile(0.90);
+        summary.p95 = percentile(0.95);
+        summary.p99 = percentile(0.99);
+        summary.max = samples.back();
+        return summary;
+    }
+
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\') { escaped += '\\'; }
+            if (static_cast<unsigned char>(c) >= 0x20) { escaped += c; }
+        }
+        return escaped;
+    }
+
+    void writeSummary(std::ostream& out, const char* name, const Summary& summary, const char* separator)
+    {
+        out << "    \"" << name << "\": { \"mean\": " << summary.mean << ", \"min\": " << summary.min
+            << ", \"p50\": " << summary.p50 << ", \"p90\": " << summary.p90 << ", \"p95\": " << summary.p95
+            << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " }" << separator << "\n";
+    }
+
+    // cold start: no mesh cache on disk, so the import runs and writes one. warm start: the same file again, served from that cache.
+    // the model is dropped in between, the texture cache lets go of its textures with it
+    bool measureModelLoad(const std::string& filePath, ModelLoad& load)
+    {
+        std::error_code error;
+        std::filesystem::remove(MeshCache(filePath, 0).getCachePath(), error);
+
+        {
+            Model model(filePath);
+            load.coldMs = model.getLoadTimeMs();
+
+            if (model.wasLoadedFromCache())
+            {
+                std::cout << "ERROR::BENCH::MESH_CACHE_NOT_REMOVED: " << filePath << std::endl;
+                return false;
+            }
+        }
+
+        {
+            Model model(filePath);
+            load.warmMs = model.getLoadTimeMs();
+            load.warmFromCache = model.wasLoadedFromCache();
+        }
+
+        TextureStreamer::shared().flush();
+        return true;
+    }
+
+    double median(std::vector<double> values)
+    {
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        return values[values.size() / 2];
+    }
+
+    // the scene's passes are a handful of instanced draws, far too few for the queue to record on the pool. this pushes
+    // enough single draws through it to take the parallel path, checks that the partitions replay exactly what one buffer
+    // recorded on the GL thread would, and times both into the bound framebuffer
+    bool measureQueueRecording(std::size_t commandCount, QueueRecording& result)
+    {
+        constexpr std::size_t ShaderCount = 2;
+        constexpr std::size_t VaoCount = 4;
+        constexpr std::size_t TextureCount = 8;
+        constexpr int Repetitions = 20;
+
+        // the same program twice is still two programs to bind
+        std::vector<std::unique_ptr<Shader>> shaders;
+        for (std::size_t i = 0; i < ShaderCount; ++i)
+        {
+            shaders.push_back(std::make_unique<Shader>("resources/shaders/vert_unlit.glsl", "resources/shaders/frag_unlit.glsl"));
+            shaders.back()->use();
+            shaders.back()->setMat4("view", glm::mat4(1.0f));
+            shaders.back()->setMat4("projection", glm::mat4(1.0f));
+        }
+
+        // nothing attached, the draws only have to be valid, not visible
+        std::vector<GlVertexArray> vaos(VaoCount);
+        for (GlVertexArray& vao : vaos)
+        {
+            vao = GlVertexArray::create();
+        }
+
+        std::vector<GlTexture> textures(TextureCount);
+        for (GlTexture& texture : textures)
+        {
+            texture = GlTexture::create();
+        }
+
+        std::vector<glm::mat4> models(commandCount);
+
+        // state changes every few draws, like a scene of many small objects sharing a few materials
+        RenderQueue queue;
+        for (std::size_t i = 0; i < commandCount; ++i)
+        {
+            models[i] = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i % 64), static_cast<float>(i / 64), 0.0f));
+
+            DrawCommand command;
+            command.shader = shaders[i % ShaderCount].get();
+            command.vao = vaos[(i / 3) % VaoCount];
+            command.count = 3;
+            command.model = &models[i];
+
+            RenderMaterial material;
+            material.textures[0] = textures[i % 5];
+            material.textures[1] = textures[5 + (i / 7) % 3];
+
+            queue.submit(RenderPass::Opaque, command, material, static_cast<float>(i % 97));
+        }
+
+        auto recordDraws = [&](ThreadPool* pool, std::vector<CommandBuffer::ReplayedDraw>& draws)
+        {
+            queue.setThreadPool(pool);
+            queue.sort();
+
+            std::size_t bufferCount = queue.record();
+            for (std::size_t i = 0; i < bufferCount; ++i)
+            {
+                queue.getCommandBuffer(i).appendReplayedDraws(draws);
+            }
+
+            return queue.getStats();
+        };
+
+        std::vector<CommandBuffer::ReplayedDraw> serialDraws, parallelDraws;
+        RenderQueue::Stats serial = recordDraws(nullptr, serialDraws);
+        RenderQueue::Stats parallel = recordDraws(&ThreadPool::shared(), parallelDraws);
+
+        if (parallel.commandBuffers < 2)
+        {
+            std::cout << "ERROR::BENCH::QUEUE_NOT_PARALLEL: " << commandCount << " draws recorded into " << parallel.commandBuffers << " buffer" << std::endl;
+            return false;
+        }
+
+        // every partition binds its first draw's state again, that's all the parallel recording may add
+        std::size_t rebinds = (parallel.commandBuffers - 1) * (2 + RenderMaterial::MaxTextures);
+        bool sameBinds =
+            serial.drawCalls == parallel.drawCalls &&
+            serial.programBinds + serial.programBindsSkipped == parallel.programBinds + parallel.programBindsSkipped &&
+            serial.textureBinds + serial.textureBindsSkipped == parallel.textureBinds + parallel.textureBindsSkipped &&
+            serial.vaoBinds + serial.vaoBindsSkipped == parallel.vaoBinds + parallel.vaoBindsSkipped &&
+            parallel.getBindsIssued() >= serial.getBindsIssued() &&
+            parallel.getBindsIssued() - serial.getBindsIssued() <= rebinds;
+
+        if (serialDraws != parallelDraws || !sameBinds)
+        {
+            std::cout << "ERROR::BENCH::QUEUE_RECORDING_MISMATCH: " << serialDraws.size() << " serial draws, " << parallelDraws.size() << " parallel draws, "
+                << serial.getBindsIssued() << " vs " << parallel.getBindsIssued() << " binds issued" << std::endl;
+            return false;
+        }
+
+        auto measure = [&](ThreadPool* pool, double& recordMs, double& replayMs)
+        {
+            queue.setThreadPool(pool);
+
+            std::vector<double> record, replay;
+            for (int i = 0; i < Repetitions; ++i)
+            {
+                queue.sort();
+                queue.execute();
+                record.push_back(queue.getStats().recordMs);
+                replay.push_back(queue.getStats().replayMs);
+            }
+            glFinish();
+
+            recordMs = median(record);
+            replayMs = median(replay);
+        };
+
+        measure(nullptr, result.serialRecordMs, result.serialReplayMs);
+        measure(&ThreadPool::shared(), result.parallelRecordMs, result.parallelReplayMs);
+        result.commandBuffers = parallel.commandBuffers;
+
+        return true;
+    }
+
+    // baselineGpu is the per-light fetch run of --compare-fetch, modelLoad the loads of --model,
+    // queueRecording the render queue case, null otherwise
+    bool writeResults(const Options& options, const std::vector<FrameSample>& samples, const Summary& cpu, const Summary& gpu, const Summary& drawCalls, const Summary* baselineGpu,
+        const ModelLoad* modelLoad, const QueueRecording* queueRecording)
+    {
+        std::ofstream out(options.output);
+        if (!out)
+        {
+            std::cout << "ERROR::BENCH::RESULTS_NOT_WRITTEN: " << options.output << std::endl;
+            return false;
+        }
+
+        const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+        out.setf(std::ios::fixed);
+        out.precision(4);
+
+        out << "{\n";
+        out << "  \"config\": {\n";
+        out << "    \"width\": " << options.width << ",\n";
+        out << "    \"height\": " << options.height << ",\n";
+        out << "    \"frames\": " << options.frames << ",\n";
+        out << "    \"warmup_frames\": " << options.warmupFrames << ",\n";
+        out << "    \"camera_path\": \"" << escapeJson(options.cameraPath) << "\",\n";
+        out << "    \"render_path\": \"" << (options.scene.deferredShading ? "deferred" : options.scene.clusteredLighting ? "forward_clustered" : "forward") << "\",\n";
+        out << "    \"frustum_culling\": " << (options.scene.frustumCulling ? "true" : "false") << ",\n";
+        out << "    \"spot_light\": " << (options.scene.spotLight ? "true" : "false") << ",\n";
+        out << "    \"animate_cubes\": " << (options.scene.animateCubes ? "true" : "false") << ",\n";
+        out << "    \"shadows\": " << (options.scene.shadows && !options.scene.deferredShading ? "true" : "false") << ",\n";
+        out << "    \"shadow_budget\": " << options.scene.shadowRefreshBudget << ",\n";
+        out << "    \"parallel_recording\": " << (options.scene.parallelRecording ? "true" : "false") << ",\n";
+        out << "    \"material_fetch\": \"" << (options.scene.perLightMaterialFetch ? "per_light" : "once") << "\",\n";
+        out << "    \"extra_lights\": " << options.scene.extraLights << ",\n";
+        out << "    \"extra_cubes\": " << options.scene.extraCubes << "\n";
+        out << "  },\n";
+        out << "  \"device\": { \"renderer\": \"" << escapeJson(renderer ? renderer : "") << "\", \"version\": \"" << escapeJson(version ? version : "") << "\" },\n";
+        out << "  \"summary\": {\n";
+        writeSummary(out, "cpu_ms", cpu, ",");
+        writeSummary(out, "gpu_ms", gpu, ",");
+        writeSummary(out, "draw_calls", drawCalls, "");
+        out << "  },\n";
+        if (baselineGpu)
+        {
+            out << "  \"per_light_fetch\": {\n";
+            writeSummary(out, "gpu_ms", *baselineGpu, "");
+            out << "  },\n";
+        }
+        if (modelLoad)
+        {
+            out << "  \"model_load\": { \"path\": \"" << escapeJson(options.modelPath) << "\", \"cold_ms\": " << modelLoad->coldMs
+                << ", \"warm_ms\": " << modelLoad->warmMs << ", \"warm_from_cache\": " << (modelLoad->warmFromCache ? "true" : "false") << " },\n";
+        }
+        if (queueRecording)
+        {
+            out << "  \"render_queue\": { \"commands\": " << options.queueCommands << ", \"command_buffers\": " << queueRecording->commandBuffers
+                << ", \"serial_record_ms\": " << queueRecording->serialRecordMs << ", \"parallel_record_ms\": " << queueRecording->parallelRecordMs
+                << ", \"serial_replay_ms\": " << queueRecording->serialReplayMs << ", \"parallel_replay_ms\": " << queueRecording->parallelReplayMs << " },\n";
+        }
+        out << "  \"frames\": [\n";
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            const FrameSample& sample = samples[i];
+            out << "    { \"frame\": " << i << ", \"time\": " << sample.time << ", \"cpu_ms\": " << sample.cpuMs << ", \"gpu_ms\": " << sample.gpuMs
+                << ", \"draw_calls\": " << sample.drawCalls << ", \"image\": " << (sample.dumped ? "true" : "false") << " }" << (i + 1 < samples.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+
+        return true;
+    }
+
+    int run(const Options& options)
+    {
+        CameraPath path;
+        if (!path.load(options.cameraPath))
+        {
+            return 1;
+        }
+
+        if (!options.dumpDirectory.empty())
+        {
+            std::error_code error;
+            std::filesystem::create_directories(options.dumpDirectory, error);
+        }
+
+        OffscreenTarget target;
+        if (!createTarget(target, options.width, options.height))
+        {
+            return 1;
+        }
+
+        std::vector<FrameSample> samples;
+        samples.reserve(options.frames);
+
+        std::vector<FrameSample> baselineSamples;
+
+        ProgramCache::shared().setEnabled(options.programCache);
+
+        ModelLoad modelLoad;
+        if (!options.modelPath.empty() && !measureModelLoad(options.modelPath, modelLoad))
+        {
+            destroyTarget(target);
+            return 1;
+        }
+
+        QueueRecording queueRecording;
+        if (options.queueCommands > 0)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+            glViewport(0, 0, options.width, options.height);
+
+            bool measured = measureQueueRecording(static_cast<std::size_t>(options.queueCommands), queueRecording);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            if (!measured)
+            {
+                destroyTarget(target);
+                return 1;
+            }
+        }
+
+        {
+            Scene scene(options.width, options.height);
+            scene.getSettings() = options.scene;
+            ProgramCache::shared().printReport();
+
+            Camera camera;
+            float aspectRatio = static_cast<float>(options.width) / static_cast<float>(options.height);
+
+            // the whole path is spread over the recorded frames, so a run always covers the same views
+            auto frameTime = [&](int frame)
+            {
+                return options.frames > 1 ? path.getDuration() * frame / (options.frames - 1) : 0.0f;
+            };
+
+            glViewport(0, 0, options.width, options.height);
+
+            // textures stream in behind placeholders, timing frames before they've landed would measure the placeholders
+            TextureStreamer::shared().flush();
+
+            auto record = [&](std::vector<FrameSample>& recorded, bool mainRun)
+            {
+                // the warmup also compiles the lit variant the settings ask for
+                for (int frame = 0; frame < options.warmupFrames; ++frame)
+                {
+                    path.apply(frameTime(0), camera);
+                    scene.render(camera, aspectRatio, frameTime(0), target.fbo, options.width, options.height);
+                }
+                glFinish();
+
+                // one timer per frame, only read back once everything was submitted so the run never waits on the GPU
+                std::vector<unsigned int> queries(options.frames);
+                glGenQueries(options.frames, queries.data());
+
+                for (int frame = 0; frame < options.frames; ++frame)
+                {
+                    float time = frameTime(frame);
+
+                    // zones stay idle until the first frame boundary, so plain runs don't pay for the timestamp queries
+                    if (mainRun && !options.tracePath.empty())
+                    {
+                        PROFILE_FRAME();
+                    }
+
+                    auto start = std::chrono::steady_clock::now();
+                    glBeginQuery(GL_TIME_ELAPSED, queries[frame]);
+
+                    TextureStreamer::shared().update();
+                    path.apply(time, camera);
+                    scene.render(camera, aspectRatio, time, target.fbo, options.width, options.height);
+
+                    glEndQuery(GL_TIME_ELAPSED);
+                    double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                    // the readback stalls, it comes after the timings so only the next frame's cpu time is affected
+                    bool dumped = false;
+                    if (mainRun && options.dumpEvery > 0 && frame % options.dumpEvery == 0)
+                    {
+                        char fileName[32];
+                        std::snprintf(fileName, sizeof(fileName), "frame_%05d.png", frame);
+                        dumped = dumpImage(target, options.width, options.height, (std::filesystem::path(options.dumpDirectory) / fileName).string());
+                    }
+
+                    recorded.push_back({ time, cpuMs, 0.0, scene.getDrawCalls(), dumped });
+                }
+
+                for (int frame = 0; frame < options.frames; ++frame)
+                {
+                    GLuint64 elapsed = 0;
+                    glGetQueryObjectui64v(queries[frame], GL_QUERY_RESULT, &elapsed);
+                    recorded[frame].gpuMs = static_cast<double>(elapsed) / 1000000.0;
+                }
+                glDeleteQueries(options.frames, queries.data());
+            };
+
+            // same scene, same path and the same warm caches, only the lit shader variant differs
+            if (options.compareMaterialFetch)
+            {
+                baselineSamples.reserve(options.frames);
+
+                scene.getSettings().perLightMaterialFetch = true;
+                record(baselineSamples, false);
+                scene.getSettings().perLightMaterialFetch = false;
+            }
+
+            record(samples, true);
+
+            // everything finished above, one more frame boundary moves the last frames into the history
+            if (!options.tracePath.empty())
+            {
+                PROFILE_FRAME();
+            }
+        }
+
+        destroyTarget(target);
+
+        TextureCache::shared().clear();
+        TextureStreamer::shared().release();
+        GeometryPool::shared().release();
+        Profiler::shared().release();
+
+        if (!options.tracePath.empty() && !Profiler::shared().exportChromeTrace(options.tracePath))
+        {
+            return 1;
+        }
+
+        std::vector<double> cpuMs, gpuMs, drawCalls;
+        for (const FrameSample& sample : samples)
+        {
+            cpuMs.push_back(sample.cpuMs);
+            gpuMs.push_back(sample.gpuMs);
+            drawCalls.push_back(static_cast<double>(sample.drawCalls));
+        }
+
+        Summary cpu = summarize(cpuMs);
+        Summary gpu = summarize(gpuMs);
+
+        Summary baselineGpu;
+        if (!baselineSamples.empty())
+        {
+            std::vector<double> baselineGpuMs;
+            for (const FrameSample& sample : baselineSamples)
+            {
+                baselineGpuMs.push_back(sample.gpuMs);
+            }
+
+            baselineGpu = summarize(baselineGpuMs);
+        }
+
+        if (!writeResults(options, samples, cpu, gpu, summarize(drawCalls), baselineSamples.empty() ? nullptr : &baselineGpu,
+            options.modelPath.empty() ? nullptr : &modelLoad, options.queueCommands > 0 ? &queueRecording : nullptr))
+        {
+            return 1;
+        }
+
+        std::printf("%d frames at %dx%d\n", options.frames, options.width, options.height);
+        std::printf("cpu ms: mean %.3f  p50 %.3f  p95 %.3f  p99 %.3f\n", cpu.mean, cpu.p50, cpu.p95, cpu.p99);
+        std::printf("gpu ms: mean %.3f  p50 %.3f  p95 %.3f  p99 %.3f\n", gpu.mean, gpu.p50, gpu.p95, gpu.p99);
+        if (!baselineSamples.empty())
+        {
+            std::printf("gpu ms with per-light fetch: mean %.3f  p50 %.3f  p95 %.3f  p99 %.3f  (single fetch %+.1f%% mean)\n",
+                baselineGpu.mean, baselineGpu.p50, baselineGpu.p95, baselineGpu.p99, baselineGpu.mean > 0.0 ? (gpu.mean / baselineGpu.mean - 1.0) * 100.0 : 0.0);
+        }
+        if (!options.modelPath.empty())
+        {
+            std::printf("model load ms: cold %.3f  warm %.3f%s\n", modelLoad.coldMs, modelLoad.warmMs, modelLoad.warmFromCache ? "" : "  (warm load missed the mesh cache)");
+        }
+        if (options.queueCommands > 0)
+        {
+            std::printf("render queue, %d draws: record ms serial %.3f  parallel %.3f (%zu buffers), replay ms serial %.3f  parallel %.3f\n", options.queueCommands,
+                queueRecording.serialRecordMs, queueRecording.parallelRecordMs, queueRecording.commandBuffers, queueRecording.serialReplayMs, queueRecording.parallelReplayMs);
+        }
+        std::printf("results written to %s\n", options.output.c_str());
+
+        return 0;
+    }
+}
+
+// renders the scene offscreen along a camera path and writes per-frame timings as JSON, see printUsage()
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0)
+        {
+            printUsage();
+            return 0;
+        }
+    }
+
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    HeadlessContext context;
+    if (!context.isValid())
+    {
+        return 1;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return 1;
+    }
+
+    return run(options);
+}
\ No newline at end of file
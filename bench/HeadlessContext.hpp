@@ -0,0 +1,23 @@
+#pragma once
+
+// OpenGL 3.3 core context without a window, made current on construction.
+// uses EGL's surfaceless platform when it's there (Mesa, including llvmpipe), so no display server is needed
+class HeadlessContext
+{
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    bool isValid() const;
+
+    // loader for glad
+    static void* getProcAddress(const char* name);
+
+private:
+    // EGLDisplay and EGLContext, kept opaque so EGL headers stay out of here
+    void* _display { nullptr };
+    void* _context { nullptr };
+};
\ No newline at end of file
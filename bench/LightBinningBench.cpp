@@ -0,0 +1,115 @@
+#include "CpuBench.hpp"
+#include "LightClusters.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    // lights spread through the visible part of the frustum, radii in the same range as the editor's extra lights
+    std::vector<PointLight> makeLights(std::size_t count)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<PointLight> lights(count);
+        for (PointLight& light : lights)
+        {
+            float depth = 1.0f + unit(random) * 60.0f;
+            light.position = glm::vec3((unit(random) * 2.0f - 1.0f) * depth * 0.6f, (unit(random) * 2.0f - 1.0f) * depth * 0.35f, -depth);
+            light.color = glm::vec3(unit(random), unit(random), unit(random)) * 0.15f;
+            light.linear = 0.7f;
+            light.quadratic = 1.8f;
+        }
+
+        return lights;
+    }
+
+    // lights without any falloff reach every cluster, with a tile count that isn't a multiple of the SIMD width
+    bool checkNoFalloff(const LightClusters::Config& config, ThreadPool* pool)
+    {
+        LightClusters clusters(config);
+        clusters.setThreadPool(pool);
+        clusters.setProjection(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+
+        std::vector<PointLight> lights(2);
+        for (PointLight& light : lights)
+        {
+            light.color = glm::vec3(1.0f);
+            light.constant = 1.0f;
+            light.linear = 0.0f;
+            light.quadratic = 0.0f;
+        }
+        lights[0].position = glm::vec3(2.0f, -1.0f, -10.0f);
+        lights[1].position = glm::vec3(0.0f, 0.0f, 5.0f);
+
+        clusters.bin(lights, glm::mat4(1.0f));
+
+        const std::vector<std::uint32_t>& ranges = clusters.getClusterRanges();
+        const std::vector<std::uint32_t>& indices = clusters.getLightIndices();
+        std::size_t clusterCount = clusters.getClusterCount();
+
+        if (clusters.getStats().lightIndices != clusterCount * lights.size())
+        {
+            std::printf("ERROR::CHECK::LIGHT_BINNING_COUNT: %dx%dx%d, %zu light/cluster pairs, expected %zu\n",
+                config.tilesX, config.tilesY, config.depthSlices, clusters.getStats().lightIndices, clusterCount * lights.size());
+            return false;
+        }
+
+        for (std::size_t cluster = 0; cluster < clusterCount; ++cluster)
+        {
+            std::uint32_t offset = ranges[cluster * 2];
+            std::uint32_t count = ranges[cluster * 2 + 1];
+            if (count != 2 || indices[offset] != 0 || indices[offset + 1] != 1)
+            {
+                std::printf("ERROR::CHECK::LIGHT_BINNING_CLUSTER: %dx%dx%d, cluster %zu has %u lights, expected both\n",
+                    config.tilesX, config.tilesY, config.depthSlices, cluster, count);
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+void CpuBench::runLightBinning()
+{
+    LightClusters clusters;
+    clusters.setProjection(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+
+    const glm::mat4 view(1.0f);
+
+    std::printf("%8s %14s %14s %10s %12s %10s\n", "lights", "1 thread ms", "pool ms", "speedup", "indices", "max/cluster");
+
+    for (std::size_t count : { 100, 1000, 2000, 5000, 10000, 20000 })
+    {
+        std::vector<PointLight> lights = makeLights(count);
+
+        clusters.setThreadPool(nullptr);
+        double single = measureMs([&]() { clusters.bin(lights, view); });
+
+        clusters.setThreadPool(&ThreadPool::shared());
+        double pooled = measureMs([&]() { clusters.bin(lights, view); });
+
+        const LightClusters::Stats& stats = clusters.getStats();
+        std::printf("%8zu %14.3f %14.3f %9.2fx %12zu %10zu\n", count, single, pooled, single / pooled, stats.lightIndices, stats.maxLightsPerCluster);
+    }
+
+    std::printf("pool threads: %zu (+ caller)\n", ThreadPool::shared().getThreadCount());
+}
+
+bool CpuBench::checkLightBinning()
+{
+    bool valid = true;
+
+    for (const LightClusters::Config& config : { LightClusters::Config{ 15, 9, 24 }, LightClusters::Config{ 6, 5, 8 }, LightClusters::Config{ 16, 9, 24 } })
+    {
+        valid &= checkNoFalloff(config, nullptr);
+        valid &= checkNoFalloff(config, &ThreadPool::shared());
+    }
+
+    return valid;
+}
@@ -0,0 +1,232 @@
+#include "CpuBench.hpp"
+#include "LightBlock.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    struct ExpectedMember
+    {
+        const char* name;
+        std::size_t offset;
+    };
+
+    // worked out by hand from the std140 rules: vec3 aligns to 16 but only takes 12 bytes, so a float can
+    // fill the gap behind it; structs and struct array elements round up to 16.
+    // directionalLight 0..64, spotLight 64..160, pointLights[] from 160 with a stride of 80.
+    const ExpectedMember ExpectedMembers[] =
+    {
+        { "directionalLight.direction", 0 },
+        { "directionalLight.ambient", 16 },
+        { "directionalLight.diffuse", 32 },
+        { "directionalLight.specular", 48 },
+        { "spotLight.position", 64 },
+        { "spotLight.direction", 80 },
+        { "spotLight.cutOff", 92 },
+        { "spotLight.outerCutOff", 96 },
+        { "spotLight.constant", 100 },
+        { "spotLight.linear", 104 },
+        { "spotLight.quadratic", 108 },
+        { "spotLight.ambient", 112 },
+        { "spotLight.diffuse", 128 },
+        { "spotLight.specular", 144 },
+        { "pointLights[0].position", 160 },
+        { "pointLights[0].constant", 172 },
+        { "pointLights[0].linear", 176 },
+        { "pointLights[0].quadratic", 180 },
+        { "pointLights[0].ambient", 192 },
+        { "pointLights[0].diffuse", 208 },
+        { "pointLights[0].specular", 224 },
+        { "pointLights[1].position", 240 },
+        { "pointLights[1].constant", 252 },
+        { "pointLights[1].linear", 256 },
+        { "pointLights[1].quadratic", 260 },
+        { "pointLights[1].ambient", 272 },
+        { "pointLights[1].diffuse", 288 },
+        { "pointLights[1].specular", 304 }
+    };
+
+    constexpr std::size_t ExpectedBlockSize = 320;
+
+    float readFloat(const std::vector<unsigned char>& data, std::size_t offset)
+    {
+        float value = 0.0f;
+        std::memcpy(&value, data.data() + offset, sizeof(float));
+        return value;
+    }
+
+    bool expectFloat(const std::vector<unsigned char>& data, std::size_t offset, float expected, const char* what)
+    {
+        float value = readFloat(data, offset);
+        if (value != expected)
+        {
+            std::printf("ERROR::CHECK::LIGHT_BLOCK_VALUE: %s at %zu is %g, expected %g\n", what, offset, value, expected);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool expectVec3(const std::vector<unsigned char>& data, std::size_t offset, const glm::vec3& expected, const char* what)
+    {
+        return expectFloat(data, offset, expected.x, what) &
+            expectFloat(data, offset + 4, expected.y, what) &
+            expectFloat(data, offset + 8, expected.z, what);
+    }
+
+    bool expectPadding(const std::vector<unsigned char>& data, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            if (data[i] != 0)
+            {
+                std::printf("ERROR::CHECK::LIGHT_BLOCK_PADDING: byte %zu is %d\n", i, data[i]);
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+bool CpuBench::checkLightBlockLayout()
+{
+    bool valid = true;
+
+    // the basic std140 rules the block layout is built from
+    valid &= Std140Layout::arrayStride(Std140Type::Float) == 16;
+    valid &= Std140Layout::arrayStride(Std140Type::Vec3) == 16;
+    valid &= Std140Layout::arrayStride(Std140Type::Mat4) == 64;
+
+    Std140Layout scalars;
+    scalars.add(Std140Type::Float);
+    std::size_t arrayOffset = scalars.addArray(Std140Type::Float, 3);
+    std::size_t afterArray = scalars.add(Std140Type::Float);
+    valid &= arrayOffset == 16 && afterArray == 64;
+
+    if (!valid)
+    {
+        std::printf("ERROR::CHECK::STD140_ARRAY_STRIDE: scalar arrays are not 16 byte strided\n");
+    }
+
+    LightBlock block(2);
+    const std::vector<unsigned char>& data = block.getData();
+
+    if (data.size() != ExpectedBlockSize)
+    {
+        std::printf("ERROR::CHECK::LIGHT_BLOCK_SIZE: %zu bytes, expected %zu\n", data.size(), ExpectedBlockSize);
+        valid = false;
+    }
+
+    std::vector<LightBlock::Member> members = block.getMembers();
+    std::size_t expectedCount = sizeof(ExpectedMembers) / sizeof(ExpectedMembers[0]);
+    if (members.size() != expectedCount)
+    {
+        std::printf("ERROR::CHECK::LIGHT_BLOCK_MEMBERS: %zu members, expected %zu\n", members.size(), expectedCount);
+        return false;
+    }
+
+    for (std::size_t i = 0; i < expectedCount; ++i)
+    {
+        if (members[i].name != ExpectedMembers[i].name || members[i].offset != ExpectedMembers[i].offset)
+        {
+            std::printf("ERROR::CHECK::LIGHT_BLOCK_OFFSET: %s at %zu, expected %s at %zu\n",
+                members[i].name.c_str(), members[i].offset, ExpectedMembers[i].name, ExpectedMembers[i].offset);
+            valid = false;
+        }
+    }
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    DirectionalLight directional;
+    directional.direction = glm::vec3(1.0f, 2.0f, 3.0f);
+    directional.ambient = glm::vec3(4.0f, 5.0f, 6.0f);
+    directional.diffuse = glm::vec3(7.0f, 8.0f, 9.0f);
+    directional.specular = glm::vec3(10.0f, 11.0f, 12.0f);
+
+    SpotLight spot;
+    spot.position = glm::vec3(13.0f, 14.0f, 15.0f);
+    spot.direction = glm::vec3(16.0f, 17.0f, 18.0f);
+    spot.cutOff = 19.0f;
+    spot.outerCutOff = 20.0f;
+    spot.constant = 21.0f;
+    spot.linear = 22.0f;
+    spot.quadratic = 23.0f;
+    spot.ambient = glm::vec3(24.0f, 25.0f, 26.0f);
+    spot.diffuse = glm::vec3(27.0f, 28.0f, 29.0f);
+    spot.specular = glm::vec3(30.0f, 31.0f, 32.0f);
+
+    PointLight point;
+    point.position = glm::vec3(33.0f, 34.0f, 35.0f);
+    point.color = glm::vec3(10.0f, 20.0f, 30.0f);
+    point.constant = 36.0f;
+    point.linear = 37.0f;
+    point.quadratic = 38.0f;
+
+    block.setDirectionalLight(directional);
+    block.setSpotLight(spot);
+    block.setPointLight(1, point);
+
+    valid &= expectVec3(data, 0, directional.direction, "directionalLight.direction");
+    valid &= expectVec3(data, 16, directional.ambient, "directionalLight.ambient");
+    valid &= expectVec3(data, 32, directional.diffuse, "directionalLight.diffuse");
+    valid &= expectVec3(data, 48, directional.specular, "directionalLight.specular");
+
+    valid &= expectVec3(data, 64, spot.position, "spotLight.position");
+    valid &= expectVec3(data, 80, spot.direction, "spotLight.direction");
+    valid &= expectFloat(data, 92, spot.cutOff, "spotLight.cutOff");
+    valid &= expectFloat(data, 96, spot.outerCutOff, "spotLight.outerCutOff");
+    valid &= expectFloat(data, 100, spot.constant, "spotLight.constant");
+    valid &= expectFloat(data, 104, spot.linear, "spotLight.linear");
+    valid &= expectFloat(data, 108, spot.quadratic, "spotLight.quadratic");
+    valid &= expectVec3(data, 112, spot.ambient, "spotLight.ambient");
+    valid &= expectVec3(data, 128, spot.diffuse, "spotLight.diffuse");
+    valid &= expectVec3(data, 144, spot.specular, "spotLight.specular");
+
+    valid &= expectVec3(data, 240, point.position, "pointLights[1].position");
+    valid &= expectFloat(data, 252, point.constant, "pointLights[1].constant");
+    valid &= expectFloat(data, 256, point.linear, "pointLights[1].linear");
+    valid &= expectFloat(data, 260, point.quadratic, "pointLights[1].quadratic");
+    valid &= expectVec3(data, 272, point.color * 0.1f, "pointLights[1].ambient");
+    valid &= expectVec3(data, 288, point.color, "pointLights[1].diffuse");
+    valid &= expectVec3(data, 304, point.color, "pointLights[1].specular");
+
+    // the fourth component of every vec3 and the tail of every struct stay zero
+    valid &= expectPadding(data, 12, 16) & expectPadding(data, 60, 64);
+    valid &= expectPadding(data, 124, 128) & expectPadding(data, 156, 160);
+    valid &= expectPadding(data, 264, 272) & expectPadding(data, 284, 288) & expectPadding(data, 316, 320);
+
+    // nothing was taken since the constructor, so the whole block is dirty and goes out as one merged range
+    std::vector<LightBlock::Range> ranges;
+    block.takeDirtyRanges(ranges);
+    if (ranges.size() != 1 || ranges[0].offset != 0 || ranges[0].size != ExpectedBlockSize)
+    {
+        std::printf("ERROR::CHECK::LIGHT_BLOCK_DIRTY: expected a single range over the whole block\n");
+        valid = false;
+    }
+
+    // setting an unchanged light doesn't dirty it
+    block.setPointLight(1, point);
+    block.setSpotLight(spot);
+    block.takeDirtyRanges(ranges);
+    if (!ranges.empty())
+    {
+        std::printf("ERROR::CHECK::LIGHT_BLOCK_DIRTY: unchanged lights were marked dirty\n");
+        valid = false;
+    }
+
+    point.linear = 0.5f;
+    block.setPointLight(1, point);
+    block.takeDirtyRanges(ranges);
+    if (ranges.size() != 1 || ranges[0].offset != 240 || ranges[0].size != 80)
+    {
+        std::printf("ERROR::CHECK::LIGHT_BLOCK_DIRTY: expected a single range 240..320\n");
+        valid = false;
+    }
+
+    return valid;
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "CpuBench.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+    // uv sphere with a duplicated seam column, like an imported textured mesh
+    void makeSphere(std::size_t rings, std::size_t segments, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        const float pi = 3.14159265f;
+
+        for (std::size_t ring = 0; ring <= rings; ++ring)
+        {
+            float v = static_cast<float>(ring) / rings;
+            for (std::size_t segment = 0; segment <= segments; ++segment)
+            {
+                float u = static_cast<float>(segment) / segments;
+
+                // a little noise so the flat regions aren't trivially collapsible
+                float radius = 1.0f + 0.02f * std::sin(u * 40.0f) * std::sin(v * 30.0f);
+
+                Vertex vertex;
+                vertex.Normal = glm::vec3(std::sin(v * pi) * std::cos(u * 2.0f * pi), std::cos(v * pi), std::sin(v * pi) * std::sin(u * 2.0f * pi));
+                vertex.Position = vertex.Normal * radius;
+                vertex.TexCoords = glm::vec2(u, v);
+                vertices.push_back(vertex);
+            }
+        }
+
+        for (std::size_t ring = 0; ring < rings; ++ring)
+        {
+            for (std::size_t segment = 0; segment < segments; ++segment)
+            {
+                unsigned int a = static_cast<unsigned int>(ring * (segments + 1) + segment);
+                unsigned int b = a + static_cast<unsigned int>(segments + 1);
+
+                indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+    }
+}
+
+void CpuBench::runMeshLod()
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> baseIndices;
+    makeSphere(256, 512, vertices, baseIndices);
+
+    LodSettings settings;
+    settings.maxLevels = 6;
+
+    std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods;
+    double buildMs = measureMs([&]()
+    {
+        indices = baseIndices;
+        lods = MeshSimplifier::buildLodChain(vertices.data(), vertices.size(), indices, settings);
+    }, 3, 1);
+
+    std::printf("%zu vertices, %zu triangles, chain built in %.1f ms\n", vertices.size(), baseIndices.size() / 3, buildMs);
+    std::printf("%-6s %12s %10s %12s\n", "level", "triangles", "ratio", "error");
+    for (std::size_t i = 0; i < lods.size(); ++i)
+    {
+        std::printf("%-6zu %12u %9.1f%% %12.5f\n", i, lods[i].indexCount / 3, 100.0f * lods[i].indexCount / lods[0].indexCount, lods[i].error);
+    }
+
+    // camera pulled back from 2 to 200 radii and pushed in again at 720p / 45 degrees,
+    // triangles submitted with the chain against always drawing level 0
+    float scale = MeshSimplifier::getProjectionScale(glm::radians(45.0f), 720.0f);
+    LodSelection selection;
+
+    std::size_t level = 0;
+    std::size_t switches = 0;
+    double drawn = 0.0;
+    double full = 0.0;
+    const int steps = 2000;
+    for (int step = 0; step < steps; ++step)
+    {
+        float t = static_cast<float>(step) / (steps - 1);
+        float distance = 2.0f + 198.0f * (t < 0.5f ? t * 2.0f : (1.0f - t) * 2.0f);
+
+        std::size_t next = MeshSimplifier::selectLod(lods.data(), lods.size(), level, distance, scale, selection);
+        switches += next != level;
+        level = next;
+
+        drawn += lods[level].indexCount / 3;
+        full += lods[0].indexCount / 3;
+    }
+
+    std::printf("distance sweep: %.1f%% of the full resolution triangles, %zu level switches (%.0f%% hysteresis)\n",
+        100.0 * drawn / full, switches, selection.hysteresis * 100.0f);
+
+    // jitter by 1% around the distance where level 3 reaches the error threshold, the case hysteresis exists for
+    float threshold = lods[std::min<std::size_t>(3, lods.size() - 1)].error * scale / selection.pixelError;
+
+    selection.hysteresis = 0.0f;
+    level = 0;
+    switches = 0;
+    for (int step = 0; step < steps; ++step)
+    {
+        float distance = threshold * (1.0f + 0.01f * std::sin(step * 0.7f));
+        std::size_t next = MeshSimplifier::selectLod(lods.data(), lods.size(), level, distance, scale, selection);
+        switches += next != level;
+        level = next;
+    }
+
+    std::size_t withoutHysteresis = switches;
+    selection.hysteresis = 0.25f;
+    switches = 0;
+    for (int step = 0; step < steps; ++step)
+    {
+        float distance = threshold * (1.0f + 0.01f * std::sin(step * 0.7f));
+        std::size_t next = MeshSimplifier::selectLod(lods.data(), lods.size(), level, distance, scale, selection);
+        switches += next != level;
+        level = next;
+    }
+
+    std::printf("jitter around %.1f radii: %zu switches without hysteresis, %zu with\n", threshold, withoutHysteresis, switches);
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "CpuBench.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    // a torus hides parts of itself from most directions, so the triangle order changes its overdraw
+    void makeTorus(std::size_t rings, std::size_t segments, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        const float pi = 3.14159265f;
+        const float majorRadius = 1.0f;
+        const float minorRadius = 0.4f;
+
+        for (std::size_t ring = 0; ring < rings; ++ring)
+        {
+            float u = 2.0f * pi * ring / rings;
+            for (std::size_t segment = 0; segment < segments; ++segment)
+            {
+                float v = 2.0f * pi * segment / segments;
+
+                glm::vec3 center(std::cos(u) * majorRadius, 0.0f, std::sin(u) * majorRadius);
+
+                Vertex vertex;
+                vertex.Normal = glm::vec3(std::cos(u) * std::cos(v), std::sin(v), std::sin(u) * std::cos(v));
+                vertex.Position = center + vertex.Normal * minorRadius;
+                vertex.TexCoords = glm::vec2(static_cast<float>(ring) / rings, static_cast<float>(segment) / segments);
+                vertices.push_back(vertex);
+            }
+        }
+
+        for (std::size_t ring = 0; ring < rings; ++ring)
+        {
+            for (std::size_t segment = 0; segment < segments; ++segment)
+            {
+                unsigned int a = static_cast<unsigned int>(ring * segments + segment);
+                unsigned int b = static_cast<unsigned int>(((ring + 1) % rings) * segments + segment);
+                unsigned int c = static_cast<unsigned int>(ring * segments + (segment + 1) % segments);
+                unsigned int d = static_cast<unsigned int>(((ring + 1) % rings) * segments + (segment + 1) % segments);
+
+                indices.insert(indices.end(), { a, c, b, c, d, b });
+            }
+        }
+    }
+
+    // what an exporter without any optimization tends to produce: triangles and vertices in no useful order
+    void shuffle(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        std::mt19937 random(7);
+
+        std::vector<unsigned int> remap(vertices.size());
+        for (std::size_t i = 0; i < remap.size(); ++i)
+        {
+            remap[i] = static_cast<unsigned int>(i);
+        }
+        std::shuffle(remap.begin(), remap.end(), random);
+
+        std::vector<Vertex> shuffled(vertices.size());
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+        {
+            shuffled[remap[i]] = vertices[i];
+        }
+        vertices.swap(shuffled);
+
+        std::size_t triangleCount = indices.size() / 3;
+        std::vector<std::size_t> order(triangleCount);
+        for (std::size_t i = 0; i < triangleCount; ++i)
+        {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), random);
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+        for (std::size_t triangle : order)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                result.push_back(remap[indices[triangle * 3 + j]]);
+            }
+        }
+        indices.swap(result);
+    }
+
+    // mean distance in bytes between consecutively fetched new vertices, a proxy for how well fetch hits memory in order
+    double fetchStride(const std::vector<unsigned int>& indices, std::size_t vertexCount)
+    {
+        std::vector<bool> fetched(vertexCount, false);
+        double distance = 0.0;
+        std::size_t count = 0;
+        long long previous = 0;
+
+        for (unsigned int index : indices)
+        {
+            if (!fetched[index])
+            {
+                fetched[index] = true;
+                distance += std::abs(static_cast<long long>(index) - previous) * static_cast<double>(sizeof(Vertex));
+                previous = index;
+                count++;
+            }
+        }
+
+        return count > 0 ? distance / count : 0.0;
+    }
+
+    void printRow(const char* name, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, std::uint32_t cacheSize, double ms)
+    {
+        VertexCacheStats cache = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize);
+        OverdrawStats overdraw = MeshOptimizer::analyzeOverdraw(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+        std::printf("%-16s %8.3f %8.3f %10.3f %14.0f %10.2f\n", name, cache.getAcmr(), cache.getAtvr(), overdraw.getOverdraw(), fetchStride(indices, vertices.size()), ms);
+    }
+}
+
+void CpuBench::runMeshOptimize()
+{
+    std::vector<Vertex> gridVertices;
+    std::vector<unsigned int> gridIndices;
+    makeTorus(256, 128, gridVertices, gridIndices);
+
+    std::vector<Vertex> shuffledVertices = gridVertices;
+    std::vector<unsigned int> shuffledIndices = gridIndices;
+    shuffle(shuffledVertices, shuffledIndices);
+
+    MeshOptimizeSettings settings;
+
+    std::printf("%zu vertices, %zu triangles, %u entry FIFO cache\n", gridVertices.size(), gridIndices.size() / 3, settings.cacheSize);
+    std::printf("%-16s %8s %8s %10s %14s %10s\n", "order", "acmr", "atvr", "overdraw", "fetch stride", "ms");
+    printRow("grid", gridVertices, gridIndices, settings.cacheSize, 0.0);
+    printRow("shuffled", shuffledVertices, shuffledIndices, settings.cacheSize, 0.0);
+
+    // each pass timed on its own, starting from the shuffled mesh
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+
+    double cacheMs = measureMs([&]()
+    {
+        indices = shuffledIndices;
+        MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), shuffledVertices.size(), settings.cacheSize);
+    }, 5, 1);
+    printRow("vertex cache", shuffledVertices, indices, settings.cacheSize, cacheMs);
+
+    std::vector<unsigned int> cacheIndices = indices;
+    double overdrawMs = measureMs([&]()
+    {
+        indices = cacheIndices;
+        MeshOptimizer::optimizeOverdraw(shuffledVertices.data(), shuffledVertices.size(), indices.data(), indices.size(), settings.cacheSize, settings.overdrawThreshold);
+    }, 5, 1);
+    printRow("+ overdraw", shuffledVertices, indices, settings.cacheSize, overdrawMs);
+
+    std::vector<unsigned int> overdrawIndices = indices;
+    double fetchMs = measureMs([&]()
+    {
+        vertices = shuffledVertices;
+        indices = overdrawIndices;
+        MeshOptimizer::optimizeVertexFetch(vertices, indices.data(), indices.size());
+    }, 5, 1);
+    printRow("+ vertex fetch", vertices, indices, settings.cacheSize, fetchMs);
+
+    // the overdraw threshold trades cache efficiency for freedom to sort
+    std::printf("%-16s %8s %10s\n", "threshold", "acmr", "overdraw");
+    for (float threshold : { 1.0f, 1.05f, 1.2f, 1.5f })
+    {
+        indices = cacheIndices;
+        MeshOptimizer::optimizeOverdraw(shuffledVertices.data(), shuffledVertices.size(), indices.data(), indices.size(), settings.cacheSize, threshold);
+
+        VertexCacheStats cache = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), shuffledVertices.size(), settings.cacheSize);
+        OverdrawStats overdraw = MeshOptimizer::analyzeOverdraw(shuffledVertices.data(), shuffledVertices.size(), indices.data(), indices.size());
+        std::printf("%-16.2f %8.3f %10.3f\n", threshold, cache.getAcmr(), overdraw.getOverdraw());
+    }
+}
\ No newline at end of file
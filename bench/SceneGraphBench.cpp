@@ -0,0 +1,121 @@
+#include "CpuBench.hpp"
+#include "SceneGraph.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace
+{
+    // roots with two levels below them, like a city of vehicles with wheels and props on them
+    void buildGraph(SceneGraph& graph, std::size_t rootCount, std::size_t fanout, std::vector<SceneNode>& roots, std::vector<SceneNode>& leaves)
+    {
+        graph.reserve(rootCount * (1 + fanout + fanout * fanout));
+
+        for (std::size_t i = 0; i < rootCount; ++i)
+        {
+            SceneNode root = graph.createNode();
+            graph.setPosition(root, glm::vec3(static_cast<float>(i % 16) * 10.0f, 0.0f, static_cast<float>(i / 16) * 10.0f));
+            roots.push_back(root);
+
+            for (std::size_t j = 0; j < fanout; ++j)
+            {
+                SceneNode child = graph.createNode(root);
+                graph.setPosition(child, glm::vec3(static_cast<float>(j), 1.0f, 0.0f));
+
+                for (std::size_t k = 0; k < fanout; ++k)
+                {
+                    SceneNode leaf = graph.createNode(child);
+                    graph.setPosition(leaf, glm::vec3(0.0f, 0.0f, static_cast<float>(k) * 0.5f));
+                    graph.setScale(leaf, glm::vec3(0.25f));
+                    leaves.push_back(leaf);
+                }
+            }
+        }
+
+        graph.update();
+    }
+
+    void printRow(const char* name, const SceneGraph& graph, double ms)
+    {
+        const SceneGraph::Stats& stats = graph.getStats();
+        std::printf("%-22s %10zu %10zu %6zu %10.3f\n", name, stats.dirtyRoots, stats.nodesUpdated, stats.tasks, ms);
+    }
+}
+
+void CpuBench::runSceneGraph()
+{
+    SceneGraph graph;
+    std::vector<SceneNode> roots;
+    std::vector<SceneNode> leaves;
+    buildGraph(graph, 256, 16, roots, leaves);
+
+    std::printf("%zu nodes, %zu roots, %zu leaves, %zu worker threads\n", graph.size(), roots.size(), leaves.size(), ThreadPool::shared().getThreadCount());
+    std::printf("%-22s %10s %10s %6s %10s\n", "frame", "subtrees", "updated", "tasks", "ms");
+
+    // every case changes its transforms and updates inside the timed call, like a frame would
+    float angle = 0.0f;
+    auto run = [&](const char* name, const std::function<void()>& animate)
+    {
+        double ms = CpuBench::measureMs([&]()
+        {
+            angle += 0.01f;
+            animate();
+            graph.update();
+        });
+        printRow(name, graph, ms);
+    };
+
+    run("static", []() {});
+
+    run("1% of the leaves", [&]()
+    {
+        for (std::size_t i = 0; i < leaves.size(); i += 100)
+        {
+            graph.setRotation(leaves[i], glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+    });
+
+    run("one root", [&]()
+    {
+        graph.setPosition(roots[0], glm::vec3(angle, 0.0f, 0.0f));
+    });
+
+    run("10% of the roots", [&]()
+    {
+        for (std::size_t i = 0; i < roots.size(); i += 10)
+        {
+            graph.setRotation(roots[i], glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+    });
+
+    run("every root", [&]()
+    {
+        for (SceneNode root : roots)
+        {
+            graph.setRotation(root, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+    });
+
+    // what recomputing the whole graph every frame costs, and the same on the calling thread only
+    run("every node", [&]()
+    {
+        for (SceneNode node = 0; node < graph.size(); ++node)
+        {
+            graph.setPosition(node, graph.getPosition(node));
+        }
+    });
+
+    graph.setThreadPool(nullptr);
+    run("every root, 1 thread", [&]()
+    {
+        for (SceneNode root : roots)
+        {
+            graph.setRotation(root, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+    });
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <limits>
+
+// axis aligned box, starts out empty (min > max) and grows with expand()
+struct BoundingBox
+{
+    glm::vec3 min { std::numeric_limits<float>::max() };
+    glm::vec3 max { -std::numeric_limits<float>::max() };
+
+    bool isValid() const
+    {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    void expand(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const BoundingBox& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    glm::vec3 getCenter() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    // box around the transformed box, built from the center/extent instead of 8 corners
+    BoundingBox transformed(const glm::mat4& matrix) const
+    {
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+        glm::vec3 extent = (max - min) * 0.5f;
+
+        glm::vec3 newExtent(0.0f);
+        for (int column = 0; column < 3; ++column)
+        {
+            newExtent += glm::abs(glm::vec3(matrix[column])) * extent[column];
+        }
+
+        return BoundingBox { center - newExtent, center + newExtent };
+    }
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct CullStats
+{
+    std::size_t objects { 0 };
+    std::size_t visible { 0 };
+
+    std::size_t nodesVisited { 0 };
+
+    // boxes that went through the plane tests (4 per SIMD batch)
+    std::size_t boxesTested { 0 };
+
+    double cullMs { 0.0 };
+};
+
+// 4-wide bounding volume hierarchy over a fixed set of object boxes.
+// every node stores the bounds of its (up to) four children side by side, so a frustum test checks all four
+// at once with SSE; a child is either another node or a single object. subtrees fully inside the frustum
+// are accepted without testing anything below them.
+class Bvh
+{
+public:
+    // indices passed to cull() refer to positions in this vector
+    void build(const std::vector<BoundingBox>& bounds);
+
+    // appends the index of every object whose box intersects the frustum (visible is cleared first)
+    CullStats cull(const Frustum& frustum, std::vector<std::uint32_t>& visible) const;
+
+    // roots of disjoint subtrees that hold every object between them, split a level at a time until there are at least
+    // count of them (fewer when the tree runs out of inner nodes to split)
+    void split(std::size_t count, std::vector<std::int32_t>& roots) const;
+
+    // cull() over the objects below one of those roots, so the subtrees can be culled on separate threads.
+    // visible is appended to and the stats only count this subtree (objects stays 0)
+    CullStats cull(const Frustum& frustum, std::int32_t root, std::vector<std::uint32_t>& visible) const;
+
+    std::size_t getObjectCount() const;
+    std::size_t getNodeCount() const;
+    const BoundingBox& getBounds() const;
+
+private:
+    struct Node
+    {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+
+        // >= 0 node index, < 0 object (-1 - object index)
+        std::int32_t children[4];
+
+        // bit per used child slot
+        std::uint32_t childMask;
+    };
+
+    std::vector<Node> _nodes;
+    std::size_t _objectCount { 0 };
+    BoundingBox _bounds;
+
+private:
+    std::int32_t buildNode(const std::vector<BoundingBox>& bounds, std::vector<std::uint32_t>& objects, std::size_t begin, std::size_t end);
+    void collectAll(std::int32_t child, std::vector<std::uint32_t>& visible) const;
+};
@@ -37,6 +37,9 @@ public:
     void ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch = true);
     void ProcessMouseScroll(float yoffset);
 
+    // absolute orientation in degrees, for scripted cameras
+    void SetRotation(float yaw, float pitch);
+
 private:
     void updateCameraVectors();
 };
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "GlHandle.hpp"
+#include "LightClusters.hpp"
+#include "Shader.hpp"
+
+// GPU side of clustered forward shading: the binned lights from LightClusters in three texture buffers
+// (GL 3.3 has no storage buffers, buffer textures are the core way to hand the shader arrays of any size).
+//   clusterLights       rgba32f, LightClusters::LightTexels texels per light
+//   clusterRanges       rg32ui, offset/count into clusterLightIndices per cluster
+//   clusterLightIndices r32ui
+class ClusteredLightBuffer
+{
+public:
+    ClusteredLightBuffer();
+
+    ClusteredLightBuffer(const ClusteredLightBuffer&) = delete;
+    ClusteredLightBuffer& operator=(const ClusteredLightBuffer&) = delete;
+
+    // buffers are orphaned and refilled every call, the sizes change with the light count anyway
+    void upload(const LightClusters& clusters);
+
+    // binds the three buffer textures to firstTextureUnit..+2 and sets the samplers and grid uniforms.
+    // viewportWidth/Height have to match the framebuffer the clusters are looked up from (gl_FragCoord)
+    void bind(const Shader& shader, unsigned int firstTextureUnit, int viewportWidth, int viewportHeight) const;
+
+    std::size_t getGpuMemoryUsage() const;
+
+private:
+    struct BufferTexture
+    {
+        GlBuffer buffer;
+        GlTexture texture;
+        std::size_t size { 0 };
+    };
+
+    BufferTexture _lights;
+    BufferTexture _ranges;
+    BufferTexture _indices;
+
+    LightClusters::Config _config {};
+    float _depthScale { 0.0f };
+    float _depthBias { 0.0f };
+    float _nearPlane { 0.0f };
+    float _farPlane { 0.0f };
+
+private:
+    void create(BufferTexture& target, unsigned int internalFormat);
+    void fill(BufferTexture& target, const void* data, std::size_t size);
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Shader.hpp"
+#include "GeometryPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// what one draw call needs once its state is bound, same meaning as the fields of DrawCommand
+struct DrawParameters
+{
+    // 0 draws with glDrawArrays, otherwise the type of the vao's element buffer
+    unsigned int indexType { 0 };
+
+    std::uint32_t count { 0 };
+    std::uint32_t instanceCount { 1 };
+
+    std::size_t indexOffset { 0 };
+    std::int32_t baseVertex { 0 };
+
+    // a multi-draw instead, it has to stay alive until replay()
+    const MultiDrawBatch* batch { nullptr };
+
+    bool operator==(const DrawParameters& other) const
+    {
+        return indexType == other.indexType && count == other.count && instanceCount == other.instanceCount &&
+            indexOffset == other.indexOffset && baseVertex == other.baseVertex && batch == other.batch;
+    }
+};
+
+// draw work written down instead of issued: program, vertex array and texture binds, uniform values and draw
+// parameters. recording never touches GL, so any thread can fill a buffer; replay() issues the calls and belongs
+// to the thread that owns the context. binds that wouldn't change anything since the last one recorded into the
+// same buffer are dropped right away, a buffer assumes nothing about the state it's replayed into.
+class CommandBuffer
+{
+public:
+    // texture units whose binding is tracked, binds to higher units are always recorded
+    static constexpr std::size_t TrackedTextureUnits = 16;
+
+    // one draw of replay() and the state it's issued with: what's bound by then and the uniforms set since the draw before
+    struct ReplayedDraw
+    {
+        const Shader* shader { nullptr };
+        unsigned int vao { 0 };
+        std::array<unsigned int, TrackedTextureUnits> textures {};
+
+        std::vector<const char*> uniformNames;
+        std::vector<float> uniformValues;
+
+        DrawParameters parameters;
+
+        bool operator==(const ReplayedDraw& other) const
+        {
+            return shader == other.shader && vao == other.vao && textures == other.textures &&
+                uniformNames == other.uniformNames && uniformValues == other.uniformValues && parameters == other.parameters;
+        }
+    };
+
+    // counted while recording, so they're known before replay()
+    struct Stats
+    {
+        std::size_t drawCalls { 0 };
+        std::size_t uniforms { 0 };
+
+        std::size_t programBinds { 0 };
+        std::size_t textureBinds { 0 };
+        std::size_t vaoBinds { 0 };
+
+        std::size_t programBindsSkipped { 0 };
+        std::size_t textureBindsSkipped { 0 };
+        std::size_t vaoBindsSkipped { 0 };
+    };
+
+    // forgets the commands and the bound state, keeps the memory
+    void clear();
+
+    void bindProgram(const Shader& shader);
+    void bindVertexArray(unsigned int vao);
+
+    // a 2D texture, unit counts from 0 like GL_TEXTURE0
+    void bindTexture(unsigned int unit, unsigned int texture);
+
+    // the value is copied, the name is only kept as a pointer and has to outlive replay() (a string literal).
+    // set on the program bound last, uniforms recorded before any bindProgram() are dropped
+    void setUniform(const char* name, int value);
+    void setUniform(const char* name, float value);
+    void setUniform(const char* name, const glm::vec3& value);
+    void setUniform(const char* name, const glm::vec4& value);
+    void setUniform(const char* name, const glm::mat3& value);
+    void setUniform(const char* name, const glm::mat4& value);
+
+    void draw(const DrawParameters& parameters);
+
+    // issues everything in recording order. GL thread only, leaves vao 0 and texture unit 0 active
+    void replay() const;
+
+    // appends the draws replay() would issue, without GL. the buffer is taken to be replayed right after the one that
+    // produced the last of draws, so two recordings of the same draws can be checked against each other
+    void appendReplayedDraws(std::vector<ReplayedDraw>& draws) const;
+
+    std::size_t size() const;
+    bool empty() const;
+
+    const Stats& getStats() const;
+
+private:
+    enum class CommandType : std::uint8_t
+    {
+        BindProgram,
+        BindVertexArray,
+        BindTexture,
+        SetUniform,
+        Draw
+    };
+
+    enum class UniformType : std::uint8_t
+    {
+        Int,
+        Float,
+        Vec3,
+        Vec4,
+        Mat3,
+        Mat4
+    };
+
+    struct Command
+    {
+        CommandType type;
+        UniformType uniformType { UniformType::Int };
+
+        // texture unit, offset of the uniform value in _payload or index into _draws
+        std::uint32_t argument { 0 };
+
+        // vao or texture name
+        unsigned int object { 0 };
+
+        const Shader* shader { nullptr };
+        const char* name { nullptr };
+    };
+
+    std::vector<Command> _commands;
+
+    // uniform values back to back, ints are stored bit for bit
+    std::vector<float> _payload;
+    std::vector<DrawParameters> _draws;
+
+    // what the recorded commands have bound so far, nothing at the start of a buffer
+    const Shader* _boundShader { nullptr };
+    unsigned int _boundVao { 0 };
+    std::array<unsigned int, TrackedTextureUnits> _boundTextures {};
+
+    Stats _stats;
+
+private:
+    void recordUniform(const char* name, UniformType type, const float* values, std::size_t count);
+    void replayUniform(const Shader& shader, const Command& command) const;
+    static std::size_t uniformSize(UniformType type);
+    void replayDraw(const DrawParameters& parameters) const;
+};
\ No newline at end of file
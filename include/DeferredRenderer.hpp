@@ -0,0 +1,74 @@
+#pragma once
+
+#include "GBuffer.hpp"
+#include "GlHandle.hpp"
+#include "PointLight.hpp"
+#include "Shader.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// deferred alternative to frag_lit.glsl.
+// the scene is drawn once into the G-buffer, then the directional and spot light of LightBlock are applied
+// in a fullscreen pass and every point light is drawn as a sphere scaled to its attenuation radius, so a
+// light only costs the pixels it can reach and hidden fragments are never lit at all.
+class DeferredRenderer
+{
+public:
+    struct Stats
+    {
+        std::size_t lightVolumes { 0 };
+        std::size_t gBufferMemory { 0 };
+        std::size_t drawCalls { 0 };
+    };
+
+    DeferredRenderer(int width, int height, unsigned int lightBlockBinding);
+
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+    // vert_lit_instanced.glsl + frag_gbuffer.glsl, the material uniforms are set up by the caller like for the lit shader
+    Shader& getGeometryShader();
+
+    // binds and clears the G-buffer, following draws with the geometry shader end up in it
+    void beginGeometryPass(int width, int height);
+
+    // lights the G-buffer into targetFramebuffer and copies the depth over,
+    // so forward passes after this one (light cubes, ImGui) still depth test against the scene
+    void renderLighting(const std::vector<PointLight>& pointLights, const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos, unsigned int targetFramebuffer = 0);
+
+    const Stats& getStats() const;
+
+private:
+    // per-instance attributes of vert_deferred_point.glsl
+    struct LightVolume
+    {
+        glm::vec4 positionRadius;
+        glm::vec4 colorConstant;
+        glm::vec2 linearQuadratic;
+    };
+
+    GBuffer _gBuffer;
+
+    Shader _geometryShader;
+    Shader _directionalShader;
+    Shader _pointShader;
+
+    GlVertexArray _fullscreenVao;
+
+    GlVertexArray _sphereVao;
+    GlBuffer _sphereVbo;
+    GlBuffer _sphereEbo;
+    unsigned int _sphereIndexCount { 0 };
+
+    GlBuffer _volumeVbo;
+    std::vector<LightVolume> _volumes;
+
+    Stats _stats;
+
+private:
+    void createSphere(int rings, int segments);
+    void createVolumeBuffer();
+    void uploadVolumes(const std::vector<PointLight>& pointLights);
+};
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+struct DirectionalLight
+{
+    glm::vec3 direction{ -0.2f, -1.0f, -0.3f };
+
+    glm::vec3 ambient{ 0.0f };
+    glm::vec3 diffuse{ 0.05f };
+    glm::vec3 specular{ 0.2f };
+};
+
+inline bool operator==(const DirectionalLight& lhs, const DirectionalLight& rhs)
+{
+    return lhs.direction == rhs.direction &&
+        lhs.ambient == rhs.ambient && lhs.diffuse == rhs.diffuse && lhs.specular == rhs.specular;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a, used to key the on-disk caches by file content
+namespace FileHash
+{
+    std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t seed = 14695981039346656037ull);
+
+    // hash of the whole file content, 0 when the file can't be read
+    std::uint64_t hashFile(const std::string& path);
+}
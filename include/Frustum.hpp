@@ -0,0 +1,19 @@
+#pragma once
+
+#include "BoundingBox.hpp"
+
+#include <glm/glm.hpp>
+
+// six planes (ax + by + cz + d >= 0 inside) in whatever space the matrix maps from:
+// projection * view gives world space planes, projection * view * model gives model space ones
+struct Frustum
+{
+    enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    glm::vec4 planes[PlaneCount];
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    // scalar reference test, the BVH does the same thing four boxes at a time
+    bool intersects(const BoundingBox& box) const;
+};
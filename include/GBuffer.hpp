@@ -0,0 +1,65 @@
+#pragma once
+
+#include "GlHandle.hpp"
+
+#include <cstddef>
+
+// framebuffer the deferred geometry pass renders into: one texture per surface attribute plus depth/stencil.
+// attachment i is written by "layout (location = i) out" in frag_gbuffer.glsl.
+class GBuffer
+{
+public:
+    enum Attachment
+    {
+        // rgba32f world position, w = 1 where geometry was drawn
+        Position,
+
+        // rgba16f world normal
+        Normal,
+
+        // rgba8 diffuse color
+        Albedo,
+
+        // rgba8 specular color, shininess / 256 in alpha
+        Specular,
+
+        // rgba8 masked emission
+        Emission,
+
+        AttachmentCount
+    };
+
+    GBuffer(int width, int height);
+
+    GBuffer(const GBuffer&) = delete;
+    GBuffer& operator=(const GBuffer&) = delete;
+
+    // reallocates the attachments, does nothing if the size didn't change
+    void resize(int width, int height);
+
+    // binds the framebuffer and clears every attachment
+    void bindForWriting() const;
+
+    // attachment i goes to texture unit firstUnit + i
+    void bindTextures(unsigned int firstUnit) const;
+
+    // copies the depth buffer into another framebuffer of the same size (0 = default framebuffer),
+    // forward passes after the lighting then depth test against the deferred geometry
+    void blitDepth(unsigned int targetFramebuffer) const;
+
+    int getWidth() const;
+    int getHeight() const;
+    std::size_t getGpuMemoryUsage() const;
+
+private:
+    GlFramebuffer _fbo;
+    GlTexture _textures[AttachmentCount];
+    GlRenderbuffer _depthStencil;
+
+    int _width { 0 };
+    int _height { 0 };
+
+private:
+    void create();
+    void destroy();
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "GlHandle.hpp"
+#include "VertexFormat.hpp"
+#include "RangeAllocator.hpp"
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// where a pooled mesh currently lives, only valid until the next allocate()/compact() (either may move it)
+struct GeometryRange
+{
+    unsigned int vao { 0 };
+    unsigned int indexType { 0 };
+    std::uint32_t indexCount { 0 };
+
+    // bytes into the element buffer and vertices into the vertex buffer(s)
+    std::size_t indexOffset { 0 };
+    std::int32_t baseVertex { 0 };
+};
+
+// meshes of one arena and index type drawn by a single multi-draw call, the caller binds the vao
+struct MultiDrawBatch
+{
+    unsigned int vao { 0 };
+    unsigned int indexType { 0 };
+
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+
+    void add(const GeometryRange& range);
+    void clear();
+    bool empty() const;
+    std::size_t size() const;
+};
+
+// every pooled mesh of a vertex format shares one VAO, one vertex buffer (plus a skin stream for skinned
+// compact meshes) and one element buffer. a mesh only owns a vertex range and an index range in them, so
+// meshes of the same format are drawn without switching buffers and can be batched into glMultiDraw* calls.
+// freed ranges are merged right away; when an allocation doesn't fit, the arena is first compacted
+// (live ranges copied together on the GPU) and only grown if that still isn't enough.
+class GeometryPool
+{
+public:
+    using Handle = std::uint32_t;
+    static constexpr Handle InvalidHandle = 0xFFFFFFFFu;
+
+    struct Stats
+    {
+        std::size_t allocations { 0 };
+
+        std::size_t vertexBytes { 0 };
+        std::size_t vertexBytesUsed { 0 };
+        std::size_t indexBytes { 0 };
+        std::size_t indexBytesUsed { 0 };
+
+        // free ranges over all arenas, 1 per arena means nothing is fragmented
+        std::size_t freeRanges { 0 };
+
+        std::size_t grows { 0 };
+        std::size_t compactions { 0 };
+
+        // multi-draw calls and the meshes they covered since the last resetDrawStats()
+        std::size_t multiDraws { 0 };
+        std::size_t meshesDrawn { 0 };
+        bool indirect { false };
+    };
+
+    GeometryPool() = default;
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // process wide pool used by Mesh
+    static GeometryPool& shared();
+
+    // copies the streams into the arena of the (layout, skinned) format. vertices are CompactVertex for the
+    // compact layouts and Vertex for the full one, skinVertices (SkinVertex) only for skinned compact meshes.
+    // indices are GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, local to the mesh (the base vertex is added when drawing)
+    Handle allocate(VertexLayout layout, bool skinned, const void* vertices, const void* skinVertices, std::size_t vertexCount, const void* indices, std::size_t indexCount, unsigned int indexType);
+    void free(Handle handle);
+
+    GeometryRange getRange(Handle handle) const;
+
+    // bytes the allocation takes in the vertex, skin and element buffers
+    std::size_t getMemoryUsage(Handle handle) const;
+
+    // packs every arena that has holes and shrinks the ones that are mostly empty (after unloading models)
+    void compact();
+
+    // glMultiDrawElementsIndirect on GL 4.3+, glMultiDrawElementsBaseVertex otherwise
+    void draw(const MultiDrawBatch& batch);
+
+    // off: always glMultiDrawElementsBaseVertex, for comparing the two
+    void setIndirectEnabled(bool enabled);
+    bool isIndirectEnabled() const;
+
+    Stats getStats() const;
+    void resetDrawStats();
+
+    // frees the GL objects, has to happen while the context is still alive. handles become invalid
+    void release();
+
+private:
+    // full, then compact half/unorm uvs each without and with a skin stream
+    static constexpr std::size_t ArenaCount = 5;
+
+    // first buffer sizes, arenas double from there
+    static constexpr std::size_t InitialVertices = 64 * 1024;
+    static constexpr std::size_t InitialIndexBytes = 1024 * 1024;
+
+    struct Arena
+    {
+        VertexLayout layout { VertexLayout::Full };
+        bool skinned { false };
+        std::size_t vertexStride { 0 };
+
+        GlVertexArray vao;
+        GlBuffer vbo;
+        GlBuffer skinVbo;
+        GlBuffer ebo;
+
+        // in vertices and in bytes
+        RangeAllocator vertices;
+        RangeAllocator indices;
+    };
+
+    struct Allocation
+    {
+        std::uint32_t arena { 0 };
+        bool live { false };
+
+        std::size_t vertexOffset { 0 };
+        std::size_t vertexCount { 0 };
+
+        std::size_t indexOffset { 0 };
+        std::size_t indexBytes { 0 };
+        std::uint32_t indexCount { 0 };
+        unsigned int indexType { 0 };
+    };
+
+    // matches the layout glMultiDrawElementsIndirect reads
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    std::array<Arena, ArenaCount> _arenas;
+    std::vector<Allocation> _allocations;
+    std::vector<Handle> _freeHandles;
+
+    GlBuffer _indirectBuffer;
+    std::size_t _indirectCapacity { 0 };
+    std::size_t _indirectCursor { 0 };
+    std::vector<DrawElementsIndirectCommand> _indirectCommands;
+
+    // GL_MAJOR/MINOR_VERSION are queried lazily on the first draw
+    bool _capabilitiesQueried { false };
+    bool _indirectSupported { false };
+    bool _indirectEnabled { true };
+
+    Stats _stats;
+
+private:
+    static std::size_t getArenaIndex(VertexLayout layout, bool skinned);
+
+    void createArena(Arena& arena, VertexLayout layout, bool skinned);
+
+    // moves every live range of the arena into fresh buffers of the given size, packed from offset 0
+    void rebuild(std::uint32_t arenaIndex, std::size_t vertexCapacity, std::size_t indexCapacity);
+    void setupAttributes(const Arena& arena) const;
+
+    void drawIndirect(const MultiDrawBatch& batch);
+};
+
+// owns one allocation in the shared pool and frees it when it goes away, the pool's counterpart of GlHandle
+class GeometryAllocation
+{
+public:
+    GeometryAllocation() = default;
+
+    explicit GeometryAllocation(GeometryPool::Handle handle) :
+        _handle{ handle }
+    {
+    }
+
+    ~GeometryAllocation()
+    {
+        reset();
+    }
+
+    GeometryAllocation(const GeometryAllocation&) = delete;
+    GeometryAllocation& operator=(const GeometryAllocation&) = delete;
+
+    GeometryAllocation(GeometryAllocation&& other) noexcept :
+        _handle{ other._handle }
+    {
+        other._handle = GeometryPool::InvalidHandle;
+    }
+
+    GeometryAllocation& operator=(GeometryAllocation&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            _handle = other._handle;
+            other._handle = GeometryPool::InvalidHandle;
+        }
+
+        return *this;
+    }
+
+    GeometryPool::Handle get() const
+    {
+        return _handle;
+    }
+
+    void reset()
+    {
+        if (_handle != GeometryPool::InvalidHandle)
+        {
+            GeometryPool::shared().free(_handle);
+            _handle = GeometryPool::InvalidHandle;
+        }
+    }
+
+private:
+    GeometryPool::Handle _handle { GeometryPool::InvalidHandle };
+};
\ No newline at end of file
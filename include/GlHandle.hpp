@@ -0,0 +1,125 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// owns one GL object name and deletes it when it goes away. move-only, so an object can't be deleted twice
+// or outlive the last owner by accident. converts to the plain name so it can go straight into gl* calls.
+// the context still has to be current whenever a non-empty handle is destroyed or reset, that's why the
+// singletons reset theirs in release() before the context goes away.
+template <typename Traits>
+class GlHandle
+{
+public:
+    GlHandle() = default;
+
+    explicit GlHandle(unsigned int id) :
+        _id{ id }
+    {
+    }
+
+    ~GlHandle()
+    {
+        reset();
+    }
+
+    GlHandle(const GlHandle&) = delete;
+    GlHandle& operator=(const GlHandle&) = delete;
+
+    GlHandle(GlHandle&& other) noexcept :
+        _id{ other._id }
+    {
+        other._id = 0;
+    }
+
+    GlHandle& operator=(GlHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            _id = other._id;
+            other._id = 0;
+        }
+
+        return *this;
+    }
+
+    // a fresh object, only for the kinds that don't need any parameters to be created
+    static GlHandle create()
+    {
+        return GlHandle(Traits::create());
+    }
+
+    unsigned int get() const
+    {
+        return _id;
+    }
+
+    operator unsigned int() const
+    {
+        return _id;
+    }
+
+    // deletes the object (if any) and takes over id
+    void reset(unsigned int id = 0)
+    {
+        if (_id != 0)
+        {
+            Traits::destroy(_id);
+        }
+
+        _id = id;
+    }
+
+private:
+    unsigned int _id { 0 };
+};
+
+struct GlBufferTraits
+{
+    static unsigned int create() { unsigned int id = 0; glGenBuffers(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteBuffers(1, &id); }
+};
+
+struct GlVertexArrayTraits
+{
+    static unsigned int create() { unsigned int id = 0; glGenVertexArrays(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteVertexArrays(1, &id); }
+};
+
+struct GlTextureTraits
+{
+    static unsigned int create() { unsigned int id = 0; glGenTextures(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteTextures(1, &id); }
+};
+
+struct GlFramebufferTraits
+{
+    static unsigned int create() { unsigned int id = 0; glGenFramebuffers(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteFramebuffers(1, &id); }
+};
+
+struct GlRenderbufferTraits
+{
+    static unsigned int create() { unsigned int id = 0; glGenRenderbuffers(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteRenderbuffers(1, &id); }
+};
+
+struct GlProgramTraits
+{
+    static unsigned int create() { return glCreateProgram(); }
+    static void destroy(unsigned int id) { glDeleteProgram(id); }
+};
+
+// created with glCreateShader(type), there's no create() for these
+struct GlShaderTraits
+{
+    static void destroy(unsigned int id) { glDeleteShader(id); }
+};
+
+using GlBuffer = GlHandle<GlBufferTraits>;
+using GlVertexArray = GlHandle<GlVertexArrayTraits>;
+using GlTexture = GlHandle<GlTextureTraits>;
+using GlFramebuffer = GlHandle<GlFramebufferTraits>;
+using GlRenderbuffer = GlHandle<GlRenderbufferTraits>;
+using GlProgram = GlHandle<GlProgramTraits>;
+using GlShader = GlHandle<GlShaderTraits>;
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "GlHandle.hpp"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+};
+
+// per-instance model/normal matrices kept in a VBO next to the mesh data.
+// matrices are only rebuilt and re-uploaded for instances whose transform actually changed.
+// setTransform() may run on several threads at once as long as they write different instances
+class InstanceBuffer
+{
+public:
+    // attribute locations used by the *_instanced vertex shaders, a mat4 takes 4 slots and a mat3 takes 3
+    static constexpr unsigned int ModelAttribute = 7;
+    static constexpr unsigned int NormalMatrixAttribute = 11;
+
+    explicit InstanceBuffer(std::size_t count);
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    // translation + uniform/non-uniform scale, written straight into the matrix
+    void setTransform(std::size_t index, const glm::vec3& position, const glm::vec3& scale);
+    void setTransform(std::size_t index, const glm::mat4& model);
+
+    // reallocates the buffer for count instances, every one of them identity and uploaded with the next upload()
+    void resize(std::size_t count);
+
+    // sends the dirty instances to the GPU, returns how many were uploaded
+    std::size_t upload();
+
+    // hooks the instance attributes into a VAO, the normal matrix is optional (unlit shaders don't read it)
+    void attach(unsigned int vao, bool withNormalMatrix) const;
+
+    std::size_t size() const;
+    const InstanceData& get(std::size_t index) const;
+
+private:
+    GlBuffer _vbo;
+
+    std::vector<InstanceData> _instances;
+    // a byte per instance, neighbouring instances are written from different threads
+    std::vector<std::uint8_t> _dirty;
+    std::atomic<std::size_t> _dirtyCount { 0 };
+};
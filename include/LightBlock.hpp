@@ -0,0 +1,89 @@
+#pragma once
+
+#include "DirectionalLight.hpp"
+#include "PointLight.hpp"
+#include "SpotLight.hpp"
+#include "Std140Layout.hpp"
+
+#include <string>
+#include <vector>
+
+// CPU mirror of the "LightBlock" std140 uniform block in frag_lit.glsl, without any GL.
+// setters compare against the mirrored light and only mark it dirty when something changed,
+// takeDirtyRanges() hands out what has to be uploaded (LightUniformBuffer does the glBufferSubData).
+class LightBlock
+{
+public:
+    struct Range
+    {
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    struct Member
+    {
+        std::string name;
+        std::size_t offset;
+    };
+
+    // every light starts out dirty, so the first takeDirtyRanges() covers the whole block
+    explicit LightBlock(std::size_t pointLightCount);
+
+    void setDirectionalLight(const DirectionalLight& light);
+    void setSpotLight(const SpotLight& light);
+    void setPointLight(std::size_t index, const PointLight& light);
+
+    // replaces ranges with the dirty byte ranges in block order (adjacent lights merged) and marks everything clean
+    void takeDirtyRanges(std::vector<Range>& ranges);
+
+    // offset of every member under its GLSL name ("pointLights[2].linear"), in block order
+    std::vector<Member> getMembers() const;
+
+    const std::vector<unsigned char>& getData() const;
+    std::size_t getPointLightCount() const;
+
+private:
+    struct DirectionalLightOffsets
+    {
+        std::size_t direction, ambient, diffuse, specular;
+    };
+
+    struct SpotLightOffsets
+    {
+        std::size_t position, direction, cutOff, outerCutOff, constant, linear, quadratic, ambient, diffuse, specular;
+    };
+
+    struct PointLightOffsets
+    {
+        std::size_t position, constant, linear, quadratic, ambient, diffuse, specular;
+    };
+
+    // a slot is one light inside the block, it's the unit of dirty tracking
+    struct Slot
+    {
+        std::size_t offset;
+        std::size_t size;
+        bool dirty;
+    };
+
+    DirectionalLightOffsets _directionalOffsets {};
+    SpotLightOffsets _spotOffsets {};
+    PointLightOffsets _pointOffsets {};
+
+    std::vector<unsigned char> _data;
+
+    Slot _directionalSlot {};
+    Slot _spotSlot {};
+    std::vector<Slot> _pointSlots;
+
+    DirectionalLight _directionalLight {};
+    SpotLight _spotLight {};
+    std::vector<PointLight> _pointLights;
+
+private:
+    void buildLayout(std::size_t pointLightCount);
+
+    void writeDirectionalLight();
+    void writeSpotLight();
+    void writePointLight(std::size_t index);
+};
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "PointLight.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// CPU side of clustered forward shading.
+// the view frustum is cut into tilesX * tilesY screen tiles and depthSlices exponential depth slices, every point
+// light is assigned to the clusters its attenuation sphere touches. the fragment shader then looks up its own
+// cluster and only loops over that list (see ClusteredLightBuffer and frag_lit.glsl).
+// nothing in here touches GL, binning runs on the thread pool one depth slice per task.
+class LightClusters
+{
+public:
+    struct Config
+    {
+        int tilesX { 16 };
+        int tilesY { 9 };
+        int depthSlices { 24 };
+    };
+
+    struct Stats
+    {
+        double binningMs { 0.0 };
+        std::size_t lights { 0 };
+
+        // entries in the light index list, i.e. light/cluster pairs
+        std::size_t lightIndices { 0 };
+        std::size_t occupiedClusters { 0 };
+        std::size_t maxLightsPerCluster { 0 };
+    };
+
+    // attenuation below this counts as unlit, 5/256 is close to one step of an 8-bit framebuffer
+    static constexpr float AttenuationThreshold = 5.0f / 256.0f;
+
+    // rgba32f texels per light in getLightData()
+    static constexpr std::size_t LightTexels = 3;
+
+    LightClusters();
+    explicit LightClusters(const Config& config);
+
+    // rebuilds the cluster bounds, cheap to call every frame (does nothing if the parameters didn't change)
+    void setProjection(float fovY, float aspect, float nearPlane, float farPlane);
+
+    // null bins on the calling thread only, the default is ThreadPool::shared()
+    void setThreadPool(ThreadPool* pool);
+
+    void bin(const std::vector<PointLight>& lights, const glm::mat4& view);
+
+    // distance where the light's brightest channel falls below AttenuationThreshold, infinite without any falloff
+    static float lightRadius(const PointLight& light);
+
+    const Config& getConfig() const;
+    std::size_t getClusterCount() const;
+
+    // log(depth) * scale - bias gives the depth slice, same formula as in the shader
+    float getDepthScale() const;
+    float getDepthBias() const;
+    float getNearPlane() const;
+    float getFarPlane() const;
+
+    // per light: (position, constant), (color, linear), (quadratic, radius, 0, 0)
+    const std::vector<float>& getLightData() const;
+
+    // per cluster: offset into the light index list, light count
+    const std::vector<std::uint32_t>& getClusterRanges() const;
+    const std::vector<std::uint32_t>& getLightIndices() const;
+
+    const Stats& getStats() const;
+
+private:
+    // view space bounds of one depth slice, x/y per tile. depth is positive into the screen
+    struct Slice
+    {
+        float nearDepth;
+        float farDepth;
+
+        // padded to a multiple of 4 so the SIMD loops never need a tail
+        std::vector<float> tileMinX, tileMaxX;
+        std::vector<float> tileMinY, tileMaxY;
+    };
+
+    struct ClusterLight
+    {
+        std::uint32_t cluster;
+        std::uint32_t light;
+    };
+
+    // per slice output and scratch, reused between frames so binning doesn't allocate once warmed up
+    struct SliceBin
+    {
+        std::vector<ClusterLight> pairs;
+        std::vector<std::uint32_t> counts;
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> indices;
+        std::size_t base { 0 };
+
+        // squared distance from the current light to each tile column / row
+        std::vector<float> distanceX, distanceY;
+    };
+
+    Config _config;
+    ThreadPool* _pool { nullptr };
+
+    float _fovY { 0.0f };
+    float _aspect { 0.0f };
+    float _nearPlane { 0.0f };
+    float _farPlane { 0.0f };
+    float _depthScale { 0.0f };
+    float _depthBias { 0.0f };
+
+    // distance from the eye to the far corners of the frustum, a sphere reaching further than that covers every cluster
+    float _frustumReach { 0.0f };
+
+    std::vector<Slice> _slices;
+    std::vector<SliceBin> _bins;
+
+    // view space lights, structure of arrays for the SIMD depth test
+    std::vector<float> _lightX, _lightY, _lightDepth, _lightRadius;
+
+    std::vector<float> _lightData;
+    std::vector<std::uint32_t> _clusterRanges;
+    std::vector<std::uint32_t> _lightIndices;
+
+    Stats _stats;
+
+private:
+    void prepareLights(const std::vector<PointLight>& lights, const glm::mat4& view);
+    void binSlice(std::size_t sliceIndex);
+    void binLight(std::size_t sliceIndex, std::uint32_t light);
+    void writeSlice(std::size_t sliceIndex);
+
+    void forEachSlice(void (LightClusters::*step)(std::size_t));
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GlHandle.hpp"
+#include "LightBlock.hpp"
+#include "Shader.hpp"
+
+#include <vector>
+#include <string>
+
+// GPU side of the "LightBlock" std140 uniform block in frag_lit.glsl.
+// the packing and dirty tracking live in LightBlock, upload() pushes the dirty byte ranges with glBufferSubData.
+class LightUniformBuffer
+{
+public:
+    static constexpr const char* BlockName = "LightBlock";
+
+    struct UploadStats
+    {
+        unsigned int ranges { 0 };
+        std::size_t bytes { 0 };
+    };
+
+    LightUniformBuffer(std::size_t pointLightCount, unsigned int bindingPoint);
+
+    LightUniformBuffer(const LightUniformBuffer&) = delete;
+    LightUniformBuffer& operator=(const LightUniformBuffer&) = delete;
+
+    void setDirectionalLight(const DirectionalLight& light);
+    void setSpotLight(const SpotLight& light);
+    void setPointLight(std::size_t index, const PointLight& light);
+
+    void upload();
+
+    // checks the C++ layout against the offsets the linker assigned, prints every mismatch
+    bool validateLayout(const Shader& shader) const;
+
+    unsigned int getBindingPoint() const;
+    std::size_t getPointLightCount() const;
+    const UploadStats& getLastUploadStats() const;
+
+private:
+    GlBuffer _ubo;
+    unsigned int _bindingPoint { 0 };
+
+    LightBlock _block;
+    std::vector<LightBlock::Range> _dirtyRanges;
+
+    UploadStats _lastUpload;
+
+private:
+    bool checkOffset(const Shader& shader, const std::string& name, std::size_t expected) const;
+};
\ No newline at end of file
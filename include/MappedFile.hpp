@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// read-only memory mapping of a whole file (mmap / MapViewOfFile)
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const;
+    const unsigned char* data() const;
+    std::size_t size() const;
+
+    // a name next to path that no other thread or process writes to at the same time, for files that are
+    // written completely and then renamed over path
+    static std::string temporaryPath(const std::string& path);
+
+private:
+    const unsigned char* _data { nullptr };
+    std::size_t _size { 0 };
+
+#ifdef _WIN32
+    void* _file { nullptr };
+    void* _mapping { nullptr };
+#else
+    int _fd { -1 };
+#endif
+};
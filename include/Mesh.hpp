@@ -1,26 +1,132 @@
 #pragma once
 
 #include "Vertex.hpp"
+#include "VertexFormat.hpp"
 #include "Texture.hpp"
 #include "Shader.hpp"
+#include "BoundingBox.hpp"
+#include "RenderQueue.hpp"
+#include "GeometryPool.hpp"
+#include "MeshSimplifier.hpp"
 
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
 #include <vector>
 
+// one node of an imported hierarchy (aiNode), a model's nodes are stored parents first
+struct MeshNode
+{
+    static constexpr std::uint32_t NoParent = 0xffffffffu;
+
+    std::string name;
+
+    // relative to the parent
+    glm::mat4 transform { 1.0f };
+
+    std::uint32_t parent { NoParent };
+};
+
+// CPU side geometry of a mesh, what the importer produces before anything is uploaded
+struct MeshData
+{
+    std::vector<Vertex> vertices;
+    // the full resolution triangles followed by the simplified levels, see lods
+    std::vector<unsigned int> indices;
+    std::vector<Texture> textures;
+
+    // level 0 covers the full resolution triangles, empty means that's all there is
+    std::vector<MeshLod> lods;
+
+    // the node the mesh hangs off, its vertices are relative to that node
+    std::uint32_t node { 0 };
+};
+
+// a mesh's vertices and indices are a range in the shared GeometryPool, it owns no buffers of its own.
+// move-only, the range goes back to the pool when the mesh is destroyed (or earlier with release()).
+// the CPU side geometry is dropped after the upload unless keepGeometry asks for it (picking, collision, ...)
 class Mesh
 {
 public:
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures);
-    void render(const Shader& shader) const;
+    // takes the importer's arrays over, with keepGeometry false they're freed as soon as they're uploaded
+    explicit Mesh(MeshData&& data, VertexLayout layout = VertexLayout::Full, bool keepGeometry = false);
+
+    // uploads straight from the given arrays (e.g. a memory mapped cache file), nothing is copied on the CPU
+    // unless keepGeometry is set. the LOD levels are ranges of indices, without any the whole index array is level 0
+    Mesh(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices, std::size_t indexCount, const std::vector<Texture>& textures, VertexLayout layout = VertexLayout::Full,
+        const MeshLod* lods = nullptr, std::size_t lodCount = 0, bool keepGeometry = false);
+
+    // same with indices that are already 16 bit, only valid when VertexFormat::fitsShortIndices(vertexCount)
+    Mesh(const Vertex* vertices, std::size_t vertexCount, const std::uint16_t* indices, std::size_t indexCount, const std::vector<Texture>& textures, VertexLayout layout = VertexLayout::Full,
+        const MeshLod* lods = nullptr, std::size_t lodCount = 0, bool keepGeometry = false);
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&&) noexcept = default;
+    Mesh& operator=(Mesh&&) noexcept = default;
+
+    // frees the geometry range in the pool, has to happen before the pool is released
+    void release();
+
+    // the arrays the mesh was built from, empty unless it was asked to keep them
+    const std::vector<Vertex>& getVertices() const;
+    const std::vector<unsigned int>& getIndices() const;
+    bool hasCpuGeometry() const;
+    void dropCpuGeometry();
+
+    // draws right away with the bound program, see setSamplerUnits() for its samplers
+    void render() const;
+
+    // queues the draw instead of issuing it, depth is the distance to the camera
+    void submit(RenderQueue& queue, const Shader& shader, RenderPass pass, float depth) const;
+
+    // every sampler (texture_diffuseN, texture_specularN, ...) has a fixed texture unit,
+    // so the uniforms are set once per shader instead of once per mesh
+    static void setSamplerUnits(const Shader& shader);
+
+    // where the geometry of a LOD level currently is in the pool, may change whenever the pool compacts
+    GeometryRange getRange(std::size_t lod = 0) const;
+
+    const std::vector<MeshLod>& getLods() const;
+    const RenderMaterial& getMaterial() const;
+
+    VertexLayout getVertexLayout() const;
+    bool isSkinned() const;
+
+    // bytes taken by the vertex, skin and index ranges on the GPU
+    std::size_t getGpuMemoryUsage() const;
+
+    // model space bounds of the vertex positions, computed once when the mesh is created
+    const BoundingBox& getBounds() const;
 
 private:
+    // geometry only lives on the GPU once uploaded, the CPU arrays are only kept on request
     std::vector<Vertex> _vertices;
     std::vector<unsigned int> _indices;
+    std::size_t _vertexCount { 0 };
+    std::size_t _indexCount { 0 };
+    std::vector<MeshLod> _lods;
     std::vector<Texture> _textures;
+    RenderMaterial _material;
+    BoundingBox _bounds;
 
-    unsigned int _vao;
-    unsigned int _vbo;
-    unsigned int _ebo;
+    VertexLayout _layout;
+    bool _skinned { false };
+
+    // GL_UNSIGNED_SHORT when the mesh has less than 65536 vertices, GL_UNSIGNED_INT otherwise
+    unsigned int _indexType { 0 };
+    std::size_t _gpuMemoryUsage { 0 };
+
+    GeometryAllocation _geometry;
 
 private:
-    void initialize();
-};
\ No newline at end of file
+    // narrows the indices to 16 bit when the mesh is small enough
+    void initialize(const Vertex* vertices, const unsigned int* indices);
+    void initialize(const Vertex* vertices, const void* indices, unsigned int indexType);
+    void initializeMaterial();
+
+    // converts to the compact streams, the skin stream is only filled for skinned meshes
+    void initializeCompact(const Vertex* vertices, std::vector<CompactVertex>& compactVertices, std::vector<SkinVertex>& skinVertices);
+};
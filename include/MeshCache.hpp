@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TextureReference
+{
+    std::string type;
+    std::string path;
+};
+
+// a mesh as stored in the cache, vertices/indices point into the mapped file
+struct CachedMesh
+{
+    const Vertex* vertices;
+    std::size_t vertexCount;
+
+    // stored in the type Mesh uploads them as, exactly one of the two is set:
+    // 16 bit when VertexFormat::fitsShortIndices(vertexCount), 32 bit otherwise
+    const unsigned int* indices;
+    const std::uint16_t* shortIndices;
+    std::size_t indexCount;
+
+    const MeshLod* lods;
+    std::size_t lodCount;
+
+    std::vector<TextureReference> textures;
+
+    std::uint32_t node;
+};
+
+// binary cache of what Model::processMesh produces, stored next to the source file as "<file>.meshcache".
+// it's keyed by a hash of the source file, the assimp import flags and the LOD settings; a cache built from
+// a different source, different flags or settings, an older format version or a different Vertex layout
+// is ignored and rebuilt.
+//
+// file layout (all offsets from the start of the file, data blocks aligned to 16 bytes):
+//   Header | Entry[meshCount] | per mesh: Vertex[vertexCount], uint16 or uint32[indexCount], MeshLod[lodCount], texture strings
+//   | NodeEntry[nodeCount], node names
+class MeshCache
+{
+public:
+    static constexpr std::uint32_t Version = 4;
+
+    MeshCache(const std::string& sourcePath, unsigned int importFlags, std::uint32_t settingsHash = 0);
+
+    // maps the cache file and validates it against the source, false means the cache has to be rebuilt
+    bool open();
+    void close();
+
+    std::size_t getMeshCount() const;
+    CachedMesh getMesh(std::size_t index) const;
+
+    // the node hierarchy the meshes hang off, in the order it was written
+    std::size_t getNodeCount() const;
+    MeshNode getNode(std::size_t index) const;
+
+    bool write(const std::vector<MeshData>& meshes, const std::vector<MeshNode>& nodes) const;
+
+    const std::string& getCachePath() const;
+
+private:
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t sourceHash;
+        std::uint32_t importFlags;
+        std::uint32_t vertexSize;
+        std::uint32_t meshCount;
+        std::uint32_t settingsHash;
+        std::uint32_t nodeCount;
+        std::uint32_t padding;
+        std::uint64_t nodeOffset;
+    };
+
+    struct Entry
+    {
+        std::uint64_t vertexOffset;
+        std::uint64_t indexOffset;
+        std::uint64_t textureOffset;
+        std::uint64_t lodOffset;
+        std::uint32_t vertexCount;
+        std::uint32_t indexCount;
+        std::uint32_t textureCount;
+        std::uint32_t lodCount;
+        std::uint32_t node;
+        // bytes per index, 2 or 4
+        std::uint32_t indexSize;
+    };
+
+    struct NodeEntry
+    {
+        float transform[16];
+        std::uint32_t parent;
+        std::uint32_t padding[3];
+    };
+
+    std::string _sourcePath;
+    std::string _cachePath;
+    unsigned int _importFlags;
+    std::uint32_t _settingsHash;
+
+    MappedFile _file;
+    const Entry* _entries { nullptr };
+    std::size_t _meshCount { 0 };
+
+    const NodeEntry* _nodes { nullptr };
+    std::size_t _nodeCount { 0 };
+    std::vector<std::string> _nodeNames;
+
+private:
+    bool validateEntries() const;
+
+    // the node table and names, false if anything points outside the file or a parent comes after its child
+    bool readNodes(const Header& header);
+};
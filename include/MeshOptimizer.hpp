@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Vertex.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// post-transform vertex cache behaviour of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats
+{
+    std::size_t triangles { 0 };
+
+    // vertices that missed the cache and went through the vertex shader
+    std::size_t transforms { 0 };
+
+    // distinct vertices the triangles reference
+    std::size_t vertices { 0 };
+
+    // average cache miss ratio, transformed vertices per triangle: 3 is no reuse at all, ~0.5 the best a regular grid gets
+    float getAcmr() const;
+
+    // average transform to vertex ratio, 1 means every vertex went through the vertex shader exactly once
+    float getAtvr() const;
+
+    void add(const VertexCacheStats& other);
+};
+
+// pixels covered by the mesh against pixels the fragment shader ran for, with early depth testing in submission order
+struct OverdrawStats
+{
+    std::size_t covered { 0 };
+    std::size_t shaded { 0 };
+
+    // 1 means every covered pixel was shaded once
+    float getOverdraw() const;
+};
+
+// import side reordering of the index and vertex buffers, the triangles themselves never change
+struct MeshOptimizeSettings
+{
+    // reorder the triangles for post-transform vertex cache reuse (Tipsify)
+    bool vertexCache { true };
+
+    // reorder clusters of the cache optimized triangles so outward facing ones go first and occlude the rest
+    bool overdraw { true };
+
+    // reorder the vertices by first use so vertex fetch reads memory front to back
+    bool vertexFetch { true };
+
+    // entries of the simulated cache, 16 to 32 on current hardware
+    std::uint32_t cacheSize { 16 };
+
+    // how much ACMR the overdraw pass may give up to get more (smaller) clusters to sort, 1.05 allows 5%
+    float overdrawThreshold { 1.05f };
+
+    // folded into the mesh cache key, so changing the settings rebuilds the cache
+    std::uint32_t hash() const;
+};
+
+// vertex cache statistics of a mesh's full resolution triangles around optimize()
+struct MeshOptimizeStats
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+
+    void add(const MeshOptimizeStats& other);
+};
+
+namespace MeshOptimizer
+{
+    VertexCacheStats analyzeVertexCache(const unsigned int* indices, std::size_t indexCount, std::size_t vertexCount, std::uint32_t cacheSize);
+
+    // rasterizes the mesh from the six axis directions at a fixed resolution
+    OverdrawStats analyzeOverdraw(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices, std::size_t indexCount);
+
+    // Tipsify (Sander et al. 2007), linear in the triangle count
+    void optimizeVertexCache(unsigned int* indices, std::size_t indexCount, std::size_t vertexCount, std::uint32_t cacheSize);
+
+    // expects vertex cache optimized input: splits it where the cache restarts (and where threshold allows), then sorts
+    // the clusters by how much they face away from the mesh's center (Sander et al., also Nehab et al. 2006)
+    void optimizeOverdraw(const Vertex* vertices, std::size_t vertexCount, unsigned int* indices, std::size_t indexCount, std::uint32_t cacheSize, float threshold);
+
+    // vertices in order of first use, unreferenced ones are dropped. the indices are remapped in place
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, unsigned int* indices, std::size_t indexCount);
+
+    // all of the enabled passes, the triangle passes run on every LOD level's range on its own.
+    // empty lods means the whole index array is one level
+    MeshOptimizeStats optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const std::vector<MeshLod>& lods, const MeshOptimizeSettings& settings);
+}
\ No newline at end of file
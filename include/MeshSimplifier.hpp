@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// one level of a mesh's LOD chain, a range of the mesh's index buffer. level 0 is the full resolution mesh
+struct MeshLod
+{
+    std::uint32_t indexOffset;
+    std::uint32_t indexCount;
+
+    // largest distance the simplified surface strays from the original, in model units (0 for level 0)
+    float error;
+};
+
+// import side of the LOD chain
+struct LodSettings
+{
+    // levels after the full resolution one, 0 turns generation off
+    std::uint32_t maxLevels { 4 };
+
+    // each level aims for this fraction of the previous level's triangles
+    float reduction { 0.5f };
+
+    // error budget of the coarsest level, relative to the mesh's bounding radius
+    float maxError { 0.05f };
+
+    // meshes (and levels) below this many triangles aren't simplified any further
+    std::uint32_t minTriangles { 64 };
+
+    // folded into the mesh cache key, so changing the settings rebuilds the cache
+    std::uint32_t hash() const;
+};
+
+// runtime side: which level to draw
+struct LodSelection
+{
+    // a level is used while its error projects to at most this many pixels
+    float pixelError { 1.0f };
+
+    // a mesh only goes coarser once the error is below (1 - hysteresis) * pixelError and back finer once it
+    // exceeds (1 + hysteresis) * pixelError, so it doesn't flip between two levels at the threshold
+    float hysteresis { 0.25f };
+
+    // -1 picks by screen size, anything else forces that level (clamped to the chain)
+    int forcedLevel { -1 };
+};
+
+// quadric error metric edge collapse (Garland-Heckbert). vertices are never moved or created, a collapse
+// folds a vertex into one of its neighbours, so every level indexes the original vertex buffer.
+// vertices on open borders and on attribute seams (several vertices at one position) stay put, which keeps
+// meshes that share a border and uv/normal discontinuities intact.
+namespace MeshSimplifier
+{
+    // triangle list with at most targetIndexCount indices, or as close as maxError allows.
+    // error receives the largest collapse error that was accepted
+    std::vector<unsigned int> simplify(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices, std::size_t indexCount,
+        std::size_t targetIndexCount, float maxError, float& error);
+
+    // appends the levels to indices (after the full resolution triangles) and returns the chain, level 0 included
+    std::vector<MeshLod> buildLodChain(const Vertex* vertices, std::size_t vertexCount, std::vector<unsigned int>& indices, const LodSettings& settings);
+
+    // pixels per model unit at distance 1: viewport height / (2 * tan(fovY / 2))
+    float getProjectionScale(float fovY, float viewportHeight);
+
+    // the level to draw this frame given the one drawn last frame. projectionScale of 0 means full resolution
+    std::size_t selectLod(const MeshLod* lods, std::size_t lodCount, std::size_t current, float distance, float projectionScale, const LodSelection& selection);
+}
\ No newline at end of file
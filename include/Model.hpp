@@ -12,30 +12,176 @@
 #include <assimp/postprocess.h>
 
 #include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
 #include "Shader.hpp"
+#include "Bvh.hpp"
+#include "SceneGraph.hpp"
 
 #include <iostream>
 #include <vector>
 #include <string>
+#include <unordered_map>
+
+class ThreadPool;
+
+// triangles of the last submit() against what the full resolution meshes would have cost
+struct LodStats
+{
+    std::size_t trianglesFull { 0 };
+    std::size_t trianglesDrawn { 0 };
+
+    // visible meshes drawn at each level
+    std::vector<std::size_t> meshesPerLevel;
+};
 
 class Model
 {
 public:
-    Model(const std::string& filePath);
+    // compact layouts need vert_lit_compact.glsl, the full layout goes with vert_lit.glsl.
+    // the LOD chains are generated on import and stored in the mesh cache along with the meshes.
+    // keepCpuGeometry leaves each mesh's vertex/index arrays in memory after the upload, see Mesh::getVertices
+    Model(const std::string& filePath, VertexLayout layout = VertexLayout::Full, const LodSettings& lodSettings = LodSettings{}, bool keepCpuGeometry = false);
+    ~Model();
+
+    // holds references on the shared texture cache, released exactly once in the destructor
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // meshes sharing a node and a material (and vertex format) go out as one multi-draw call,
+    // the shader's model and normalMatrix uniforms are set to each node's world matrix
     void render(const Shader& shader);
 
+    // draws only the meshes inside the frustum, which has to be in world space (projection * view)
+    void render(const Shader& shader, const Frustum& frustum);
+
+    // queues one multi-draw per node and material for the meshes inside the frustum, ordered front to back by their
+    // nearest mesh from viewPosition (both in world space). the commands point into the model, so it has to
+    // outlive the queue's execute(). the sampler units still have to be set on the shader once, see Mesh::setSamplerUnits.
+    // projectionScale (MeshSimplifier::getProjectionScale, divided by the model's scale) picks each mesh's LOD level,
+    // 0 draws everything at full resolution
+    void submit(RenderQueue& queue, const Shader& shader, RenderPass pass, const Frustum& frustum, const glm::vec3& viewPosition,
+        float projectionScale = 0.0f);
+
+    // places the whole model, it's the local transform of the node above the imported root
+    void setTransform(const glm::mat4& transform);
+
+    // the imported aiNode hierarchy under one root node of the model's own. moving a node moves every mesh below it,
+    // the world matrices and mesh bounds catch up in the next render()/submit() or update()
+    SceneGraph& getSceneGraph();
+    SceneNode getRootNode() const;
+
+    // recomputes the nodes that moved and the bounds of the meshes below them
+    void update();
+
+    // statistics of the last frustum culled render()
+    const CullStats& getCullStats() const;
+
+    void setLodSelection(const LodSelection& selection);
+    const LodSelection& getLodSelection() const;
+
+    // statistics of the last submit()
+    const LodStats& getLodStats() const;
+
+    // bytes taken by all mesh buffers on the GPU
+    std::size_t getGpuMemoryUsage() const;
+
+    // wall time of the constructor and whether it was served from the mesh cache,
+    // comparing the two between a cold and a warm start shows what the cache saves
+    double getLoadTimeMs() const;
+    bool wasLoadedFromCache() const;
+
+    // vertex cache efficiency of the imported index buffers before and after the import-time reordering,
+    // only known after an actual import (a cache hit leaves it empty)
+    const MeshOptimizeStats& getOptimizeStats() const;
+
 private:
-    std::vector<Texture> _loadedTextures;
+    // material path -> texture, one TextureCache reference each
+    std::unordered_map<std::string, Texture> _loadedTextures;
     std::vector<Mesh> _meshes;
+
+    // node each mesh hangs off and its bounds in world space, as of the last update
+    SceneGraph _nodes;
+    SceneNode _rootNode { SceneGraph::InvalidNode };
+    std::vector<SceneNode> _meshNodes;
+    std::vector<BoundingBox> _meshBounds;
+
+    // meshes sharing a node, pool arena, index type and material, refilled with the visible ones every frame.
+    // every batch only touches its own meshes, so batches can be filled on separate threads
+    struct DrawBatch
+    {
+        SceneNode node { SceneGraph::InvalidNode };
+        RenderMaterial material;
+        MultiDrawBatch draws;
+        std::uint32_t indexCount { 0 };
+        float depth { 0.0f };
+
+        std::vector<std::uint32_t> meshes;
+        LodStats lodStats;
+    };
+
+    std::vector<DrawBatch> _batches;
+    std::vector<std::uint32_t> _meshBatches;
+
+    // 1 for the meshes passed to the last fillBatches()
+    std::vector<std::uint8_t> _meshVisible;
+
+    // level each mesh was drawn at last, selection is relative to it for the hysteresis
+    std::vector<std::uint8_t> _meshLods;
+    LodSettings _lodSettings;
+    LodSelection _lodSelection;
+    LodStats _lodStats;
+
+    // over the world space mesh bounds, rebuilt whenever a node moved
+    Bvh _meshBvh;
+    std::vector<std::uint32_t> _visibleMeshes;
+    CullStats _cullStats;
+
     std::string _directory;
+    VertexLayout _layout;
+    bool _keepCpuGeometry { false };
+
+    double _loadTimeMs { 0.0 };
+    bool _loadedFromCache { false };
+    MeshOptimizeStats _optimizeStats;
 
 private:
     void loadModel(const std::string& path);
 
-    // processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode* node, const aiScene* scene);
+    // one scene graph node per imported node under _rootNode, turns _meshNodes from indices into nodes into graph nodes
+    void buildNodes(const std::vector<MeshNode>& nodes);
+
+    void updateBounds();
+
+    // groups the meshes by what a multi-draw call can't change (model matrix, vao, index type, textures)
+    void initializeBatches();
+
+    // refills the batches with the given meshes, depth is the distance of each batch's nearest mesh.
+    // the LOD selection runs on the pool, a batch per task, when there are enough meshes to make it worth it
+    void fillBatches(const std::vector<std::uint32_t>& meshes, const glm::vec3& viewPosition, float projectionScale, ThreadPool* pool = nullptr);
+    void fillBatch(DrawBatch& batch, const glm::vec3& viewPosition, float projectionScale);
+    void renderBatches(const Shader& shader) const;
+
+    // uploads the meshes straight out of the mapped cache file, false if there's no usable cache
+    bool loadFromCache(MeshCache& cache);
+
+    // collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+    // the node itself goes into nodes, parents before children, meshNodes gets its index once per mesh
+    void processNode(const aiNode* node, std::uint32_t parent, const aiScene* scene, std::vector<const aiMesh*>& meshes,
+        std::vector<std::uint32_t>& meshNodes, std::vector<MeshNode>& nodes);
+
+    // converts the meshes in parallel, the result keeps the order of the input.
+    // runs on worker threads so neither of these may touch GL or the model's state.
+    std::vector<MeshData> processMeshes(const std::vector<const aiMesh*>& meshes, const aiScene* scene, const MeshOptimizeSettings& optimizeSettings,
+        MeshOptimizeStats& optimizeStats) const;
+    MeshData processMesh(const aiMesh* mesh, const aiScene* scene, const MeshOptimizeSettings& optimizeSettings, MeshOptimizeStats& optimizeStats) const;
+
+    // fills the bone ids/weights of the vertices, keeping the strongest MAX_BONE_INFLUENCE influences
+    void processBones(const aiMesh* mesh, std::vector<Vertex>& vertices) const;
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+    // texture references of a material, ids are left at 0 until loadTexture() resolves them
+    std::vector<Texture> getMaterialTextures(const aiMaterial* material, aiTextureType type, const std::string& typeName) const;
 
-    std::vector<Texture> loadMaterialTextures(aiMaterial* material, aiTextureType type, std::string typeName);
+    Texture loadTexture(const std::string& path, const std::string& typeName);
 };
\ No newline at end of file
@@ -10,4 +10,10 @@ struct PointLight
     float constant { 1.0f };
     float linear { 0.14f };
     float quadratic { 0.07f };
-};
\ No newline at end of file
+};
+
+inline bool operator==(const PointLight& lhs, const PointLight& rhs)
+{
+    return lhs.position == rhs.position && lhs.color == rhs.color &&
+        lhs.constant == rhs.constant && lhs.linear == rhs.linear && lhs.quadratic == rhs.quadratic;
+}
\ No newline at end of file
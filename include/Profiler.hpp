@@ -0,0 +1,165 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// zones only exist in builds without NDEBUG, release builds compile every PROFILE_* macro to nothing.
+// define PROFILER_FORCE_ENABLE to keep them in an optimized build
+#if !defined(NDEBUG) || defined(PROFILER_FORCE_ENABLE)
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+
+// frame profiler with nested CPU and GPU zones.
+// CPU zones can be opened from any thread. GPU zones belong to the GL thread and are bracketed by GL_TIMESTAMP
+// queries, which are only read once their results are available a few frames later, so the profiler never waits on the GPU.
+// finished frames are kept in a short history for the ImGui overlay and the Chrome trace export.
+class Profiler
+{
+public:
+    struct Zone
+    {
+        const char* name;
+        std::uint32_t thread;
+        std::uint32_t depth;
+
+        // milliseconds since the profiler was created, GPU zones are shifted onto the same clock
+        double startMs;
+        double durationMs;
+    };
+
+    struct Frame
+    {
+        std::uint64_t index { 0 };
+        double startMs { 0.0 };
+        double cpuMs { 0.0 };
+
+        // first GPU zone start to last GPU zone end, 0 when the frame had no GPU zones
+        double gpuMs { 0.0 };
+
+        // false when the timestamps weren't ready in time and had to be dropped
+        bool gpuValid { true };
+
+        std::vector<Zone> cpuZones;
+        std::vector<Zone> gpuZones;
+    };
+
+    // frames kept for the overlay and the trace export
+    static constexpr std::size_t HistorySize = 300;
+
+    // GPU results older than this many frames are dropped instead of waited for
+    static constexpr std::size_t MaxFrameLatency = 4;
+
+    Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    static Profiler& shared();
+
+    // closes the running frame and opens the next one, call once per frame on the GL thread
+    void newFrame();
+
+    void beginCpuZone(const char* name);
+    void endCpuZone();
+
+    void beginGpuZone(const char* name);
+    void endGpuZone();
+
+    // finished frames, oldest first. the last one is the most recent frame with resolved GPU times
+    const std::deque<Frame>& getHistory() const;
+
+    // writes the history as Chrome trace_event JSON (chrome://tracing, Perfetto), false if the file couldn't be written
+    bool exportChromeTrace(const std::string& filePath) const;
+
+    // frees the query objects, has to happen while the context is still alive
+    void release();
+
+private:
+    struct PendingGpuZone
+    {
+        const char* name;
+        std::uint32_t depth;
+        unsigned int startQuery;
+        unsigned int endQuery;
+    };
+
+    struct PendingFrame
+    {
+        Frame frame;
+        std::vector<PendingGpuZone> gpuZones;
+
+        // cpu clock minus gpu clock in milliseconds, sampled when the frame started
+        double gpuClockOffsetMs { 0.0 };
+
+        // the most recently issued timestamp, the frame is resolvable once it's available
+        unsigned int lastQuery { 0 };
+    };
+
+    std::chrono::steady_clock::time_point _epoch;
+
+    // cpu zones can come from worker threads
+    mutable std::mutex _mutex;
+
+    PendingFrame _current;
+    bool _running { false };
+    std::uint64_t _frameIndex { 0 };
+
+    std::vector<std::size_t> _gpuStack;
+    std::deque<PendingFrame> _pending;
+    std::deque<Frame> _history;
+
+    std::vector<unsigned int> _freeQueries;
+
+private:
+    double now() const;
+
+    unsigned int acquireQuery();
+
+    // moves pending frames whose timestamps arrived into the history, oldest first
+    void resolvePending();
+    bool isResolvable(const PendingFrame& pending) const;
+    void resolve(PendingFrame& pending);
+    void drop(PendingFrame& pending);
+    void pushHistory(Frame&& frame);
+};
+
+// RAII markers, use the macros below so they disappear from release builds
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name) { Profiler::shared().beginCpuZone(name); }
+    ~ProfileZone() { Profiler::shared().endCpuZone(); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+class GpuProfileZone
+{
+public:
+    explicit GpuProfileZone(const char* name) { Profiler::shared().beginGpuZone(name); }
+    ~GpuProfileZone() { Profiler::shared().endGpuZone(); }
+
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+};
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_FRAME() Profiler::shared().newFrame()
+#define PROFILE_ZONE(name) ProfileZone PROFILER_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) GpuProfileZone PROFILER_CONCAT(gpuProfileZone, __LINE__)(name)
+#else
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// startup cost of one shader program
+struct ProgramReport
+{
+    std::string name;
+
+    // loaded with glProgramBinary instead of compiled from source
+    bool fromCache { false };
+
+    // reading the sources and handing them (or the binary) to the driver, in the constructor
+    double submitMs { 0.0 };
+
+    // time the first use of the program had to block until the link was done
+    double waitMs { 0.0 };
+
+    // construction until the program was ready to use, overlaps with the other programs
+    double totalMs { 0.0 };
+};
+
+// on-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary), one file per program in
+// resources/shaders/cache. the key hashes both sources together with GL_VENDOR, GL_RENDERER and GL_VERSION,
+// a binary from another driver is never even looked at. a binary the driver rejects anyway is recompiled.
+// also reports whether linking can run in the background (KHR/ARB_parallel_shader_compile). GL thread only.
+class ProgramCache
+{
+public:
+    ProgramCache() = default;
+
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    static ProgramCache& shared();
+
+    // program binaries need GL 4.1 or ARB_get_program_binary and at least one binary format
+    bool isSupported();
+
+    // GL_COMPLETION_STATUS_KHR can be polled without blocking
+    bool isParallelCompileSupported();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    std::uint64_t getKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+    // false if there's no cached binary or the driver didn't accept it, the program has to be linked from source then
+    bool load(unsigned int program, std::uint64_t key);
+    bool store(unsigned int program, std::uint64_t key);
+
+    void addReport(const ProgramReport& report);
+    const std::vector<ProgramReport>& getReports() const;
+
+    // one line per program plus the sum, to stdout
+    void printReport() const;
+
+private:
+    bool _capabilitiesQueried { false };
+    bool _supported { false };
+    bool _parallelCompile { false };
+    bool _enabled { true };
+
+    // hash of vendor/renderer/version, queried with the capabilities
+    std::uint64_t _driverHash { 0 };
+
+    std::vector<ProgramReport> _reports;
+
+private:
+    void queryCapabilities();
+    std::string getPath(std::uint64_t key) const;
+};
\ No newline at end of file
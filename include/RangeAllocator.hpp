@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <map>
+
+// hands out [offset, offset + size) ranges of a fixed capacity, in whatever unit the caller counts in (bytes, vertices).
+// free ranges are kept sorted by offset and merged with their neighbours, allocation takes the smallest range that fits.
+// it never touches memory itself, GeometryPool moves the data when it grows or compacts a buffer.
+class RangeAllocator
+{
+public:
+    static constexpr std::size_t InvalidOffset = std::numeric_limits<std::size_t>::max();
+
+    RangeAllocator() = default;
+    explicit RangeAllocator(std::size_t capacity);
+
+    // InvalidOffset when no single free range is large enough (even if the total free space is)
+    std::size_t allocate(std::size_t size, std::size_t alignment = 1);
+    void free(std::size_t offset, std::size_t size);
+
+    // adds the new space at the end, merged with a free range touching it
+    void grow(std::size_t capacity);
+
+    std::size_t getCapacity() const;
+    std::size_t getUsed() const;
+    std::size_t getLargestFree() const;
+    std::size_t getFreeRangeCount() const;
+
+private:
+    // offset -> size
+    std::map<std::size_t, std::size_t> _free;
+    std::size_t _capacity { 0 };
+    std::size_t _used { 0 };
+};
\ No newline at end of file
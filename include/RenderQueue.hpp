@@ -0,0 +1,172 @@
+#pragma once
+
+#include "Shader.hpp"
+#include "GeometryPool.hpp"
+#include "CommandBuffer.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+// passes run in this order, a pass is executed as a whole by RenderQueue::execute
+enum class RenderPass : std::uint8_t
+{
+    Geometry,
+    Opaque,
+    Unlit,
+    Count
+};
+
+// textures bound per unit for a draw, 0 leaves the unit alone
+struct RenderMaterial
+{
+    static constexpr std::size_t MaxTextures = 8;
+
+    std::array<unsigned int, MaxTextures> textures {};
+
+    bool operator==(const RenderMaterial& other) const { return textures == other.textures; }
+};
+
+struct DrawCommand
+{
+    const Shader* shader { nullptr };
+    unsigned int vao { 0 };
+
+    // 0 draws the vao with glDrawArrays, otherwise the type of its element buffer
+    unsigned int indexType { 0 };
+
+    std::uint32_t count { 0 };
+    std::uint32_t instanceCount { 1 };
+
+    // where the elements start (in bytes) and the vertex they're relative to, for meshes in a GeometryPool
+    std::size_t indexOffset { 0 };
+    std::int32_t baseVertex { 0 };
+
+    // draws every mesh of the batch with one multi-draw call instead, the fields above except shader/vao are unused.
+    // the batch is read in execute(), it has to stay alive until then
+    const MultiDrawBatch* batch { nullptr };
+
+    // set as the shader's model (and normalMatrix) uniform right before the draw, for objects without instance data.
+    // read in execute() like the batch
+    const glm::mat4* model { nullptr };
+};
+
+// collects the draws of a frame and replays them sorted by a 64 bit key,
+// most significant first: pass (4) | shader (10) | material (16) | vao (14) | depth (20).
+// draws sharing state end up next to each other and binds that wouldn't change anything are skipped.
+// execute() splits the sorted draws into consecutive partitions and records each into its own CommandBuffer,
+// on the thread pool once recording them takes long enough to be worth it (binds, per-draw matrices and uniform
+// values are all worked out there); the calling thread only replays the buffers in order.
+// per-frame uniforms (matrices, time, ...) are set on the shaders by the caller before execute().
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        std::size_t commands { 0 };
+        std::size_t drawCalls { 0 };
+
+        std::size_t programBinds { 0 };
+        std::size_t textureBinds { 0 };
+        std::size_t vaoBinds { 0 };
+
+        std::size_t programBindsSkipped { 0 };
+        std::size_t textureBindsSkipped { 0 };
+        std::size_t vaoBindsSkipped { 0 };
+
+        double sortMs { 0.0 };
+
+        // command buffers recorded and where the time went, recording may be spread over several threads
+        std::size_t commandBuffers { 0 };
+        double recordMs { 0.0 };
+        double replayMs { 0.0 };
+
+        std::size_t getBindsIssued() const { return programBinds + textureBinds + vaoBinds; }
+        std::size_t getBindsSkipped() const { return programBindsSkipped + textureBindsSkipped + vaoBindsSkipped; }
+    };
+
+    RenderQueue();
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // depth is the distance to the camera, smaller draws first within the same state
+    void submit(RenderPass pass, const DrawCommand& command, const RenderMaterial& material, float depth = 0.0f);
+
+    // radix sorts the submitted commands, has to run before execute()
+    void sort();
+
+    // issues the draws of one pass, or of all of them
+    void execute(RenderPass pass);
+    void execute();
+
+    // records all passes into command buffers exactly like execute(), but doesn't replay them. returns how many buffers
+    // were used, they stay valid until the next record() or execute(). exposed for the benchmark, which checks the
+    // parallel recording against the serial one
+    std::size_t record();
+    const CommandBuffer& getCommandBuffer(std::size_t index) const;
+
+    // drops the commands, the material table is kept so ids stay stable between frames
+    void clear();
+
+    std::size_t size() const;
+
+    // null records on the calling thread only, the default is ThreadPool::shared()
+    void setThreadPool(ThreadPool* pool);
+    ThreadPool* getThreadPool() const;
+
+    // statistics since the last sort()
+    const Stats& getStats() const;
+
+    static std::uint64_t makeKey(RenderPass pass, unsigned int program, std::uint32_t material, unsigned int vao, float depth);
+
+    // sorts by key, equal keys keep their submission order. exposed for the benchmark
+    struct SortEntry
+    {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+    static void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+private:
+    struct MaterialHash
+    {
+        std::size_t operator()(const RenderMaterial& material) const;
+    };
+
+    std::vector<DrawCommand> _commands;
+    std::vector<std::uint32_t> _commandMaterials;
+    std::vector<SortEntry> _entries;
+    std::vector<SortEntry> _scratch;
+    bool _sorted { false };
+
+    std::vector<RenderMaterial> _materials;
+    std::unordered_map<RenderMaterial, std::uint32_t, MaterialHash> _materialIds;
+
+    // one per partition, kept between frames so recording doesn't allocate
+    std::vector<CommandBuffer> _commandBuffers;
+    std::vector<double> _partitionMs;
+
+    ThreadPool* _pool { nullptr };
+
+    // time it takes to record one command, measured on every record. a range is split when it's worth waking the pool for
+    double _recordMsPerCommand { 0.0 };
+
+    Stats _stats;
+
+private:
+    std::uint32_t getMaterialId(const RenderMaterial& material);
+
+    void executeRange(std::size_t begin, std::size_t end);
+
+    // splits the range into partitions and records them, returns the number of buffers used
+    std::size_t recordRange(std::size_t begin, std::size_t end);
+
+    // no GL in here, runs on the workers. a buffer starts without any bound state,
+    // the caller may have bound anything since the last execute()
+    void recordPartition(CommandBuffer& buffer, std::size_t begin, std::size_t end) const;
+};
\ No newline at end of file
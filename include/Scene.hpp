@@ -0,0 +1,175 @@
+#pragma once
+
+#include "Camera.hpp"
+#include "Shader.hpp"
+#include "ShaderVariantCache.hpp"
+#include "TextureManager.hpp"
+#include "PointLight.hpp"
+#include "LightUniformBuffer.hpp"
+#include "LightClusters.hpp"
+#include "ClusteredLightBuffer.hpp"
+#include "DeferredRenderer.hpp"
+#include "RenderQueue.hpp"
+#include "InstanceBuffer.hpp"
+#include "GlHandle.hpp"
+#include "Bvh.hpp"
+#include "SceneGraph.hpp"
+#include "ShadowMaps.hpp"
+#include "SpotLight.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// the cube field with its lights, everything a frame needs apart from the window.
+// the windowed app and the headless benchmark both draw through this, so they measure the same thing
+class Scene
+{
+public:
+    struct Settings
+    {
+        bool clusteredLighting { true };
+        bool deferredShading { false };
+        bool frustumCulling { true };
+
+        // spins every cube around its own axis, only its scene graph node is touched
+        bool animateCubes { false };
+
+        // the camera flashlight, off compiles it out of the lit shader
+        bool spotLight { true };
+
+        // forward only: the old lighting model that samples the material once per light, to measure against
+        bool perLightMaterialFetch { false };
+
+        // generated lights on top of the LightBlock ones, only used by the clustered and deferred paths
+        int extraLights { 1000 };
+
+        // forward only: shadow maps for the LightBlock lights, and how many stale ones a frame may redraw
+        bool shadows { true };
+        int shadowRefreshBudget { 4 };
+
+        // generated cubes on top of the ten placed ones, only there to grow the scene the culling has to go through
+        int extraCubes { 0 };
+
+        // culling, instance packing and the render queue's command buffers run on the thread pool once there's enough
+        // of them, off does all of it on the GL thread
+        bool parallelRecording { true };
+    };
+
+    // needs a current GL context, the framebuffer size is the initial G-buffer size
+    Scene(int framebufferWidth, int framebufferHeight);
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // draws one frame into targetFramebuffer (0 for the window), whose size is framebufferWidth x framebufferHeight.
+    // time drives the animation so a scripted run can replay the same frames
+    void render(const Camera& camera, float aspectRatio, float time, unsigned int targetFramebuffer, int framebufferWidth, int framebufferHeight);
+
+    Settings& getSettings();
+    std::vector<PointLight>& getPointLights();
+
+    // draw calls issued by the last render()
+    std::size_t getDrawCalls() const;
+
+    // the lit variant the last frame used
+    const Shader& getLitShader() const;
+    const ShaderVariantCache& getLitShaders() const;
+    const LightUniformBuffer& getLightBuffer() const;
+    const LightClusters& getLightClusters() const;
+    const DeferredRenderer& getDeferredRenderer() const;
+    const RenderQueue& getRenderQueue() const;
+    const CullStats& getCubeCullStats() const;
+    const SceneGraph& getSceneGraph() const;
+    const ShadowMaps& getShadowMaps() const;
+
+private:
+    Settings _settings;
+    TextureManager _textureManager;
+
+    // frag_lit permutations, picked every frame from the settings and the cube material
+    ShaderVariantCache _litShaders;
+    Shader* _litShader { nullptr };
+    Shader _unlitShader;
+
+    // every cube is a child of one root node
+    SceneGraph _sceneGraph;
+    SceneNode _cubeRoot { SceneGraph::InvalidNode };
+    std::vector<SceneNode> _cubeNodes;
+
+    std::vector<PointLight> _pointLights;
+
+    GlBuffer _cubeVbo;
+    GlVertexArray _cubeVao;
+    GlVertexArray _lightCubeVao;
+
+    // rebuilt from the world matrices only in frames where the scene graph moved a cube.
+    // the instance buffer is refilled with the visible cubes every frame
+    Bvh _cubeBvh;
+    CullStats _cubeCullStats;
+
+    // what one culling task went through (a BVH subtree, or a slice of the cubes with culling off), what it found
+    // visible and where those start in the instance buffer
+    struct CubePartition
+    {
+        std::vector<std::uint32_t> visible;
+        CullStats stats;
+        std::size_t offset { 0 };
+    };
+
+    std::vector<CubePartition> _cubePartitions;
+
+    // subtrees of _cubeBvh, one per partition
+    std::vector<std::int32_t> _cubeRoots;
+
+    InstanceBuffer _cubeInstances;
+    InstanceBuffer _lightInstances;
+
+    // every cube, visible or not, they all cast shadows. the previous transforms tell which cubes moved
+    InstanceBuffer _casterInstances;
+    GlVertexArray _casterVao;
+
+    LightUniformBuffer _lightBuffer;
+    LightClusters _lightClusters;
+    ClusteredLightBuffer _clusterBuffer;
+
+    // block lights followed by the generated ones, rebuilt every frame
+    std::vector<PointLight> _generatedLights;
+    std::vector<PointLight> _sceneLights;
+
+    SpotLight _spotLight;
+    ShadowMaps _shadowMaps;
+
+    RenderQueue _renderQueue;
+    DeferredRenderer _deferredRenderer;
+
+    std::size_t _drawCalls { 0 };
+
+private:
+    void createCubes();
+
+    // the placed cubes and the generated ones as nodes under _cubeRoot, resizes their instance buffers to match
+    void createCubeNodes();
+
+    // smallest frag_lit permutation that still covers the current lights and the cube material
+    ShaderDefines getLitDefines();
+    void setupLitShader(Shader& shader);
+
+    void updateLights(const Camera& camera);
+    void updateSceneLights(float time);
+
+    // animates the cube nodes, updates whatever moved and refits the cube BVH to it. recreates the nodes first when
+    // the extra cube count changed
+    void updateCubes(float time);
+
+    // redraws the stale shadow maps the budget allows, returns the depth passes drawn
+    std::size_t updateShadows(const Camera& camera, float aspectRatio);
+
+    // packs the visible cubes to the front of the instance buffer, only those get drawn.
+    // every partition is culled and packed on its own task
+    std::size_t cullCubes(const glm::mat4& viewProjection);
+
+    void submitCubes(RenderPass pass, Shader& shader, std::size_t instanceCount, const Camera& camera, const glm::mat4& projection, const glm::mat4& view, float time);
+    void submitPointLights(const glm::mat4& projection, const glm::mat4& view);
+};
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+using SceneNode = std::uint32_t;
+
+// transform hierarchy with the per-node data split into parallel arrays (structure of arrays), indexed by SceneNode.
+// setting a local transform only marks the node, update() then recomputes the world matrices of the marked nodes
+// and everything below them, nothing else is visited. subtrees that don't contain each other are independent and
+// go to the thread pool. a parent is always created before its children, so every node's index is above its parent's.
+class SceneGraph
+{
+public:
+    static constexpr SceneNode InvalidNode = 0xffffffffu;
+
+    struct Stats
+    {
+        std::size_t nodes { 0 };
+
+        // marked nodes that weren't below another marked node, each one a subtree to recompute
+        std::size_t dirtyRoots { 0 };
+
+        // world matrices recomputed by the last update()
+        std::size_t nodesUpdated { 0 };
+
+        // work items the subtrees were split into, 1 when it ran on the calling thread only
+        std::size_t tasks { 0 };
+
+        double updateMs { 0.0 };
+    };
+
+    SceneGraph();
+
+    SceneGraph(const SceneGraph&) = delete;
+    SceneGraph& operator=(const SceneGraph&) = delete;
+
+    // the parent has to exist already, InvalidNode makes a root. a new node starts with the identity transform
+    SceneNode createNode(SceneNode parent = InvalidNode, const std::string& name = std::string());
+
+    void reserve(std::size_t count);
+    void clear();
+
+    std::size_t size() const;
+
+    void setPosition(SceneNode node, const glm::vec3& position);
+    void setRotation(SceneNode node, const glm::quat& rotation);
+    void setScale(SceneNode node, const glm::vec3& scale);
+
+    // split into position, rotation and scale. a shear (from non-uniform scale under a rotated parent) is lost
+    void setLocalMatrix(SceneNode node, const glm::mat4& local);
+
+    const glm::vec3& getPosition(SceneNode node) const;
+    const glm::quat& getRotation(SceneNode node) const;
+    const glm::vec3& getScale(SceneNode node) const;
+
+    // as of the last update()
+    const glm::mat4& getWorldMatrix(SceneNode node) const;
+
+    SceneNode getParent(SceneNode node) const;
+    SceneNode getFirstChild(SceneNode node) const;
+    SceneNode getNextSibling(SceneNode node) const;
+    const std::string& getName(SceneNode node) const;
+
+    // first node with the name, InvalidNode if there's none. linear, meant for setup code
+    SceneNode findNode(const std::string& name) const;
+
+    // recomputes the world matrices of the nodes changed since the last update and of everything below them.
+    // false if nothing had changed
+    bool update();
+
+    // nodes whose world matrix the last update() recomputed, parents before their children within a subtree
+    const std::vector<SceneNode>& getUpdatedNodes() const;
+
+    // null updates on the calling thread only, the default is ThreadPool::shared()
+    void setThreadPool(ThreadPool* pool);
+
+    // statistics of the last update()
+    const Stats& getStats() const;
+
+private:
+    // hierarchy, the children of a node are a singly linked list through _nextSiblings, newest first
+    std::vector<SceneNode> _parents;
+    std::vector<SceneNode> _firstChildren;
+    std::vector<SceneNode> _nextSiblings;
+
+    // the node itself and everything below it, tells how much work a dirty subtree is before walking it
+    std::vector<std::uint32_t> _subtreeSizes;
+
+    // local transforms, only ever written by the setters
+    std::vector<glm::vec3> _positions;
+    std::vector<glm::quat> _rotations;
+    std::vector<glm::vec3> _scales;
+
+    // only ever written by update()
+    std::vector<glm::mat4> _worldMatrices;
+
+    std::vector<std::uint8_t> _dirty;
+    std::vector<std::string> _names;
+
+    // every node marked since the last update, once each
+    std::vector<SceneNode> _dirtyNodes;
+
+    // subtrees left to recompute and where each task's share of them starts,
+    // one stack / result list per task so the workers never share anything
+    std::vector<SceneNode> _roots;
+    std::vector<std::size_t> _taskBegins;
+    std::vector<std::vector<SceneNode>> _taskStacks;
+    std::vector<std::vector<SceneNode>> _taskUpdated;
+    std::vector<SceneNode> _updatedNodes;
+
+    ThreadPool* _pool { nullptr };
+    Stats _stats;
+
+private:
+    void markDirty(SceneNode node);
+
+    // a marked node below another marked node is recomputed with that one's subtree anyway
+    bool hasDirtyAncestor(SceneNode node) const;
+
+    void updateNode(SceneNode node);
+
+    // the node and everything below it, depth first
+    void updateSubtree(SceneNode root, std::vector<SceneNode>& stack, std::vector<SceneNode>& updated);
+
+    // recomputes roots in place and replaces them by their children, a level at a time,
+    // until there are enough subtrees to keep the pool busy
+    void splitRoots(std::size_t taskCount);
+
+    // hands consecutive roots to each task so every task gets about the same number of nodes
+    void assignTasks(std::size_t taskCount, std::size_t nodeCount);
+};
\ No newline at end of file
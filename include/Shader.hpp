@@ -1,20 +1,78 @@
 #pragma once
 
+#include "GlHandle.hpp"
+#include "ShaderDefines.hpp"
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+
+// location of a uniform resolved once up front, the type parameter only exists
+// so a handle can't be fed a value of the wrong type.
+template <typename T>
+struct UniformHandle
+{
+    int location { -1 };
+
+    bool isValid() const { return location != -1; }
+};
+
+struct UniformCacheStats
+{
+    // lookups served from the location table built after linking
+    unsigned long long hits { 0 };
+
+    // lookups for names the table didn't know about (falls back to glGetUniformLocation)
+    unsigned long long misses { 0 };
+};
 
+// the constructor only hands the program to the driver (or loads its cached binary), compile and link
+// errors are checked the first time the program is needed. programs constructed back to back compile
+// alongside each other that way, and with KHR_parallel_shader_compile isReady() can be polled in between.
 class Shader
 {
 public:
-    Shader(const char* vertexPath, const char* fragmentPath);
-    ~Shader();
+    // defines go into both stages right after the #version line, see ShaderVariantCache for permutations
+    Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines = ShaderDefines{});
+
+    // true once compiling and linking are done, doesn't block
+    bool isReady() const;
+
+    // waits for the link, checks errors and fills the uniform table. called by everything that needs the program
+    void finish() const;
 
     void use() const;
 
     unsigned int getProgramId() const;
 
+    int getUniformLocation(const std::string& name) const;
+
+    // GLSL 330 has no layout(binding = N), blocks get attached to their binding point from here
+    void bindUniformBlock(const std::string& blockName, unsigned int bindingPoint) const;
+
+    template <typename T>
+    UniformHandle<T> getUniform(const std::string& name) const
+    {
+        return UniformHandle<T> { getUniformLocation(name) };
+    }
+
+    const UniformCacheStats& getUniformCacheStats() const;
+    void resetUniformCacheStats();
+
+    void set(UniformHandle<bool> handle, bool value) const;
+    void set(UniformHandle<int> handle, int value) const;
+    void set(UniformHandle<float> handle, float value) const;
+    void set(UniformHandle<glm::vec2> handle, const glm::vec2& value) const;
+    void set(UniformHandle<glm::vec3> handle, const glm::vec3& value) const;
+    void set(UniformHandle<glm::vec4> handle, const glm::vec4& value) const;
+    void set(UniformHandle<glm::mat2> handle, const glm::mat2& mat) const;
+    void set(UniformHandle<glm::mat3> handle, const glm::mat3& mat) const;
+    void set(UniformHandle<glm::mat4> handle, const glm::mat4& mat) const;
+
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
@@ -33,5 +91,25 @@ public:
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
 private:
-    unsigned int _id { 0 };
-};
\ No newline at end of file
+    GlProgram _id;
+
+    // only alive between submitting and finish()
+    mutable GlShader _vertexShader;
+    mutable GlShader _fragmentShader;
+
+    mutable bool _pending { false };
+    bool _fromCache { false };
+    std::uint64_t _cacheKey { 0 };
+
+    std::string _name;
+    std::chrono::steady_clock::time_point _submitTime;
+    double _submitMs { 0.0 };
+
+    // name -> location table filled from glGetActiveUniform once the program is linked.
+    // misses are cached as well so an inactive uniform only costs one driver query.
+    mutable std::unordered_map<std::string, int> _uniformLocations;
+    mutable UniformCacheStats _uniformCacheStats;
+
+private:
+    void cacheActiveUniforms() const;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// the #defines of one shader permutation. kept sorted by name, so the same set always produces
+// the same source and the same hash no matter in which order the features were switched on.
+class ShaderDefines
+{
+public:
+    // features are plain flags, the value only matters for counts like POINT_LIGHTS_COUNT
+    void set(const std::string& name, int value = 1);
+    void remove(const std::string& name);
+
+    bool has(const std::string& name) const;
+    bool empty() const;
+
+    std::uint64_t hash() const;
+
+    // "#define NAME VALUE" lines, inserted by Shader right after #version
+    std::string toSource() const;
+
+    // "NAME NAME=VALUE ..." for logs and the UI
+    std::string toString() const;
+
+    bool operator==(const ShaderDefines& other) const { return _values == other._values; }
+
+private:
+    std::map<std::string, int> _values;
+};
\ No newline at end of file
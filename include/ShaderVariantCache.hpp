@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Shader.hpp"
+#include "ShaderDefines.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the permutations of one vertex/fragment pair. a variant is compiled the first time its define set is asked for
+// and kept from then on, sets are told apart by ShaderDefines::hash(). Shader pointers stay valid for the lifetime
+// of the cache, so they can sit in draw commands.
+class ShaderVariantCache
+{
+public:
+    // setup runs once on every new variant, for sampler units and uniform block bindings
+    using SetupFunction = std::function<void(Shader& shader)>;
+
+    struct Stats
+    {
+        std::size_t lookups { 0 };
+
+        // lookups that had to create the variant
+        std::size_t compiles { 0 };
+    };
+
+    ShaderVariantCache(std::string vertexPath, std::string fragmentPath, SetupFunction setup = nullptr);
+
+    ShaderVariantCache(const ShaderVariantCache&) = delete;
+    ShaderVariantCache& operator=(const ShaderVariantCache&) = delete;
+
+    Shader& get(const ShaderDefines& defines);
+
+    std::size_t getVariantCount() const;
+
+    // define sets of all variants created so far, in creation order
+    std::vector<std::string> getVariantNames() const;
+
+    const Stats& getStats() const;
+
+private:
+    struct Variant
+    {
+        ShaderDefines defines;
+        std::unique_ptr<Shader> shader;
+    };
+
+    std::string _vertexPath;
+    std::string _fragmentPath;
+    SetupFunction _setup;
+
+    std::unordered_map<std::uint64_t, Variant> _variants;
+    std::vector<std::uint64_t> _creationOrder;
+
+    Stats _stats;
+};
\ No newline at end of file
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "GlHandle.hpp"
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+#include "DirectionalLight.hpp"
+#include "SpotLight.hpp"
+#include "PointLight.hpp"
+#include "ShaderVariantCache.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct ShadowSettings
+{
+    int cascadeResolution { 1024 };
+    int spotResolution { 1024 };
+    int pointResolution { 512 };
+
+    // the cascades cover the view up to this distance, split between linear and logarithmic by cascadeSplitBlend
+    float shadowDistance { 40.0f };
+    float cascadeSplitBlend { 0.75f };
+
+    // how far behind a cascade's slice casters are still drawn into it
+    float casterDistance { 50.0f };
+
+    // a cascade only follows the camera in steps of this fraction of its radius, in between it stays cached
+    float cascadeSnap { 0.125f };
+};
+
+// what the camera sees this frame, the cascades are fitted to it
+struct ShadowView
+{
+    glm::vec3 position;
+    glm::vec3 forward;
+    glm::vec3 up;
+
+    // vertical field of view in radians
+    float fieldOfView;
+    float aspectRatio;
+    float nearPlane;
+};
+
+// shadow maps for the LightBlock lights: CascadeCount cascades (one 2D array texture) for the directional light,
+// one perspective map for the spotlight and one depth cube map per point light.
+// every map remembers the light matrix it was drawn with and is only drawn again once it's stale: its light
+// moved (for a cascade: the camera moved far enough for the snapped cascade to move) or invalidate() was called
+// with the bounds of a caster that moved inside its volume. stale maps are refreshed oldest first, at most
+// refreshBudget of them per frame; the others keep their old contents and matrices until their turn.
+// a map that was never drawn reads as fully lit. forward shading only (frag_lit.glsl with HAS_SHADOWS).
+class ShadowMaps
+{
+public:
+    static constexpr std::size_t CascadeCount = 3;
+
+    // texture units taken by bind(): the cascade array, the spot map, then one cube map per point light
+    static std::size_t getTextureUnitCount(std::size_t pointLightCount);
+
+    // draws every shadow caster with the given depth shader, which is already in use with its matrices set
+    using DrawCasters = std::function<void(const Shader& shader)>;
+
+    struct Stats
+    {
+        std::size_t maps { 0 };
+
+        // stale after this frame's changes, and how many of them the budget let through
+        std::size_t stale { 0 };
+        std::size_t refreshed { 0 };
+
+        // depth passes drawn, a cube map takes six
+        std::size_t passes { 0 };
+
+        double refreshMs { 0.0 };
+    };
+
+    ShadowMaps(std::size_t pointLightCount, const ShadowSettings& settings = ShadowSettings{});
+
+    ShadowMaps(const ShadowMaps&) = delete;
+    ShadowMaps& operator=(const ShadowMaps&) = delete;
+
+    // the light volumes for this frame, marks every map whose light matrix changed
+    void setLights(const DirectionalLight& directional, const SpotLight& spot, const std::vector<PointLight>& pointLights, const ShadowView& view);
+
+    // a caster moved, every map whose volume touches the box is redrawn. call it with the old and the new bounds
+    void invalidate(const BoundingBox& bounds);
+    void invalidateAll();
+
+    // redraws up to refreshBudget stale maps. leaves framebuffer 0 bound, the caller restores the viewport
+    void refresh(int refreshBudget, const DrawCasters& drawCasters);
+
+    // binds the maps from firstTextureUnit on and sets the samplers and light matrices on the shader (which has to be in use)
+    void bind(const Shader& shader, unsigned int firstTextureUnit) const;
+
+    const ShadowSettings& getSettings() const;
+
+    // statistics of the last refresh()
+    const Stats& getStats() const;
+
+    std::size_t getGpuMemoryUsage() const;
+
+private:
+    enum class MapType : std::uint8_t
+    {
+        Cascade,
+        Spot,
+        Point
+    };
+
+    struct Map
+    {
+        MapType type;
+
+        // cascade or point light index
+        std::size_t index;
+
+        // light matrix (or position and range for a point light) the map should be drawn with, and the one it was
+        glm::mat4 wanted { 1.0f };
+        glm::mat4 drawn { 1.0f };
+        glm::vec4 wantedSphere { 0.0f };
+        glm::vec4 drawnSphere { 0.0f };
+
+        // frame it went stale, 0 while it's up to date
+        std::uint64_t staleSince { 0 };
+
+        // false until its light first reached anything, such a map is never drawn
+        bool active { false };
+    };
+
+    ShadowSettings _settings;
+
+    GlFramebuffer _fbo;
+    GlTexture _cascadeTexture;
+    GlTexture _spotTexture;
+    std::vector<GlTexture> _pointTextures;
+
+    // cascades first, then the spot light, then the point lights
+    std::vector<Map> _maps;
+
+    // view space far distance of every cascade
+    std::array<float, CascadeCount> _cascadeSplits {};
+
+    ShaderVariantCache _depthShaders;
+
+    // the view of the last setLights(), the cascades are picked by the distance along its forward axis
+    ShadowView _view {};
+
+    std::uint64_t _frame { 1 };
+    std::vector<std::size_t> _refreshOrder;
+    Stats _stats;
+
+private:
+    void createTextures(std::size_t pointLightCount);
+
+    // every map is cleared to the far plane, so a map that was never drawn shadows nothing
+    void clearTextures();
+
+    void updateCascades(const DirectionalLight& light, const ShadowView& view);
+
+    // marks the map when the matrix it wants differs from the one it was drawn with
+    void setWanted(Map& map, const glm::mat4& matrix, const glm::vec4& sphere = glm::vec4(0.0f));
+    void markStale(Map& map);
+
+    bool intersects(const Map& map, const BoundingBox& bounds) const;
+
+    void drawMap(Map& map, const DrawCasters& drawCasters);
+};
\ No newline at end of file
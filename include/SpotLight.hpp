@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+struct SpotLight
+{
+    glm::vec3 position{};
+    glm::vec3 direction{ 0.0f, 0.0f, -1.0f };
+
+    // cosines of the inner and outer cone angles
+    float cutOff{ 0.98481f };
+    float outerCutOff{ 0.96593f };
+
+    float constant{ 1.0f };
+    float linear{ 0.09f };
+    float quadratic{ 0.032f };
+
+    glm::vec3 ambient{ 0.0f };
+    glm::vec3 diffuse{ 1.0f };
+    glm::vec3 specular{ 1.0f };
+};
+
+inline bool operator==(const SpotLight& lhs, const SpotLight& rhs)
+{
+    return lhs.position == rhs.position && lhs.direction == rhs.direction &&
+        lhs.cutOff == rhs.cutOff && lhs.outerCutOff == rhs.outerCutOff &&
+        lhs.constant == rhs.constant && lhs.linear == rhs.linear && lhs.quadratic == rhs.quadratic &&
+        lhs.ambient == rhs.ambient && lhs.diffuse == rhs.diffuse && lhs.specular == rhs.specular;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+enum class Std140Type
+{
+    Float,
+    Int,
+    Vec2,
+    Vec3,
+    Vec4,
+    Mat4
+};
+
+// computes member offsets following the std140 rules of the GLSL spec (section 7.6.2.2).
+// the C++ side of every uniform block is described with this class instead of hand written
+// offsets, so it can be checked against the program (see LightUniformBuffer::validateLayout)
+// and doesn't need a GL context to be exercised.
+class Std140Layout
+{
+public:
+    // appends a member and returns its byte offset
+    std::size_t add(Std140Type type);
+
+    // appends an array, returns the offset of the first element. elements are arrayStride(type) apart.
+    std::size_t addArray(Std140Type type, std::size_t count);
+
+    // appends a nested struct, returns its offset
+    std::size_t addStruct(const Std140Layout& member);
+
+    // appends an array of structs, returns the offset of the first element. elements are member.structSize() apart.
+    std::size_t addStructArray(const Std140Layout& member, std::size_t count);
+
+    // bytes used so far (what GL_UNIFORM_BLOCK_DATA_SIZE reports for a block with these members)
+    std::size_t size() const;
+
+    // size of this layout when it's used as a struct member, rounded up to a vec4
+    std::size_t structSize() const;
+
+    static std::size_t baseAlignment(Std140Type type);
+    static std::size_t byteSize(Std140Type type);
+    static std::size_t arrayStride(Std140Type type);
+
+private:
+    std::size_t _size { 0 };
+
+private:
+    std::size_t reserve(std::size_t alignment, std::size_t bytes);
+};
+
+// writes into a CPU side mirror of a std140 block, the offsets come from a Std140Layout
+inline void std140Write(std::vector<unsigned char>& data, std::size_t offset, float value) { std::memcpy(data.data() + offset, &value, sizeof(float)); }
+inline void std140Write(std::vector<unsigned char>& data, std::size_t offset, int value) { std::memcpy(data.data() + offset, &value, sizeof(int)); }
+inline void std140Write(std::vector<unsigned char>& data, std::size_t offset, const glm::vec2& value) { std::memcpy(data.data() + offset, glm::value_ptr(value), sizeof(float) * 2); }
+inline void std140Write(std::vector<unsigned char>& data, std::size_t offset, const glm::vec3& value) { std::memcpy(data.data() + offset, glm::value_ptr(value), sizeof(float) * 3); }
+inline void std140Write(std::vector<unsigned char>& data, std::size_t offset, const glm::vec4& value) { std::memcpy(data.data() + offset, glm::value_ptr(value), sizeof(float) * 4); }
+inline void std140Write(std::vector<unsigned char>& data, std::size_t offset, const glm::mat4& value) { std::memcpy(data.data() + offset, glm::value_ptr(value), sizeof(float) * 16); }
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "GlHandle.hpp"
+#include "TextureCompressor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// process wide texture table shared by Model and TextureManager.
+// an image is looked up by its normalized path, so the same file reached through different relative paths ends up as
+// a single GL texture. the file content is hashed once, by the streamer's decode task, before anything is decoded:
+// when it's a copy of an image loaded (or loading) under another path, the request is neither decoded nor uploaded
+// and its id becomes an alias of the older texture. ids are handles, draw with resolve(id).
+// textures are reference counted and deleted once the last user released them. GL thread only.
+class TextureCache
+{
+public:
+    struct Stats
+    {
+        // acquire() calls answered by the path table
+        std::size_t pathHits { 0 };
+
+        // requests whose file turned out identical to one already loaded under another path, they share the older
+        // texture and their paths are answered with it from then on
+        std::size_t contentHits { 0 };
+
+        // textures actually handed to the streamer
+        std::size_t misses { 0 };
+
+        // live textures and the references held on them
+        std::size_t textures { 0 };
+        std::size_t references { 0 };
+
+        // source file bytes that didn't have to be decoded and uploaded again thanks to a path or content hit
+        std::size_t bytesSaved { 0 };
+    };
+
+    TextureCache();
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    static TextureCache& shared();
+
+    // texture id of the image, streamed in on the first request. every acquire needs a matching release
+    unsigned int acquire(const std::string& path, TextureUsage usage = TextureUsage::Color);
+    void release(unsigned int id);
+
+    std::size_t getReferenceCount(unsigned int id) const;
+
+    // the GL texture to bind for an id acquire() returned, the id itself unless its content is shared with another
+    unsigned int resolve(unsigned int id) const;
+
+    // deletes every texture regardless of its references, has to happen while the context is still alive
+    void clear();
+
+    const Stats& getStats() const;
+
+    // absolute, lexically normalized, generic separators (and case folded on Windows)
+    static std::string normalizePath(const std::string& path);
+
+private:
+    struct Entry
+    {
+        // a duplicate keeps its placeholder name, it's the handle its users hold
+        GlTexture id;
+        TextureUsage usage { TextureUsage::Color };
+
+        std::size_t sourceBytes { 0 };
+        std::size_t references { 0 };
+
+        // the entry whose texture is drawn instead, it holds a reference on that one
+        unsigned int sharedWith { 0 };
+
+        // every path key pointing at this entry, dropped together with it
+        std::vector<std::string> pathKeys;
+    };
+
+    std::unordered_map<std::string, unsigned int> _byPath;
+    std::unordered_map<unsigned int, Entry> _entries;
+
+    // duplicate -> original, what resolve() looks at
+    std::unordered_map<unsigned int, unsigned int> _aliases;
+
+    Stats _stats;
+
+private:
+    Entry& addReference(unsigned int id);
+
+    // drops one reference, deletes the texture with the last one. counted in the stats unless it's a duplicate's
+    void dropReference(unsigned int id, bool userReference);
+
+    // the streamer found the content of id already requested as original, id shares its texture from now on
+    bool shareContent(unsigned int id, unsigned int original);
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// decides how an image gets block compressed
+enum class TextureUsage
+{
+    // BC1, or BC3 when the image has a non opaque alpha channel
+    Color,
+
+    // BC3 with the luminance in the alpha block (8 interpolated levels instead of BC1's 4 per
+    // channel, exact at black which the emission mask in frag_lit.glsl relies on); swizzled back to rgb.
+    Specular,
+
+    // BC5, x/y in two independent channels, z has to be rebuilt in the shader
+    Normal
+};
+
+struct CompressedTexture
+{
+    struct Level
+    {
+        int width;
+        int height;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    // GL_COMPRESSED_* enum
+    unsigned int format { 0 };
+
+    // sample the alpha channel for rgb (see TextureUsage::Specular)
+    bool alphaToRgb { false };
+
+    std::vector<Level> levels;
+    std::vector<unsigned char> data;
+
+    bool isValid() const { return format != 0 && !levels.empty(); }
+};
+
+// the texture build step: CPU mip generation + BC1/BC3/BC5 encoding, and the ".ctex" cache written next to
+// the source image. the cache is keyed by the source file hash and the usage; TextureStreamer only decodes and
+// compresses an image when its cache is missing or stale, later loads just read the blocks back.
+// OpenGL_Lighting_texcompress (tools/TextureCompress.cpp) writes the caches offline so no run pays for the encode.
+namespace TextureCompressor
+{
+    constexpr std::uint32_t CacheVersion = 1;
+
+    // RGBA8 image, one level of a mip chain
+    struct Image
+    {
+        int width { 0 };
+        int height { 0 };
+        std::vector<unsigned char> pixels;
+    };
+
+    // expands 1/2/3/4 channel pixels to RGBA8
+    Image toRgba(const unsigned char* pixels, int width, int height, int channels);
+
+    // full chain down to 1x1 with a 2x2 box filter (SSE2 when available), level 0 is the input itself
+    std::vector<Image> generateMips(Image base, TextureUsage usage);
+
+    CompressedTexture compress(const unsigned char* pixels, int width, int height, int channels, TextureUsage usage);
+
+    // 8 byte blocks for 4x4 texels
+    void encodeBC1(const unsigned char rgba[64], unsigned char block[8]);
+    void encodeBC4(const unsigned char values[16], unsigned char block[8]);
+
+    std::string getCachePath(const std::string& sourcePath, TextureUsage usage);
+    bool loadCache(const std::string& sourcePath, std::uint64_t sourceHash, TextureUsage usage, CompressedTexture& texture);
+    bool writeCache(const std::string& sourcePath, std::uint64_t sourceHash, TextureUsage usage, const CompressedTexture& texture);
+}
@@ -1,16 +1,21 @@
 #pragma once
 
+#include "TextureCompressor.hpp"
+
 #include <string>
-#include <map>
+#include <unordered_map>
 
 class TextureManager
 {
 public:
-    void load(const std::string& fileName, const std::string& identifier);
+    void load(const std::string& fileName, const std::string& identifier, TextureUsage usage = TextureUsage::Color);
     unsigned int get(const std::string& identifier);
 
+    // drops the reference on the shared texture cache
+    void unload(const std::string& identifier);
+
     void activate(unsigned int level, unsigned int id) const;
 
 private:
-    std::map<std::string, unsigned int> _textures;
+    std::unordered_map<std::string, unsigned int> _textures;
 };
\ No newline at end of file
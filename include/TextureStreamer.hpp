@@ -0,0 +1,171 @@
+#pragma once
+
+#include "GlHandle.hpp"
+#include "TextureCompressor.hpp"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// loads textures without stalling the frame loop.
+// request() hands out a texture id right away that samples as a 1x1 placeholder, the file is decoded on the
+// thread pool and update() (once per frame, on the GL thread) copies decoded images into a pixel buffer object
+// and from there into the texture, never spending more than the upload budget per frame.
+// images are block compressed with a full CPU built mip chain (see TextureCompressor), the compressed result
+// is cached on disk next to the source so warm loads skip stb_image and the encoder entirely.
+class TextureStreamer
+{
+public:
+    struct Stats
+    {
+        std::size_t pendingDecodes { 0 };
+        std::size_t pendingUploads { 0 };
+        std::size_t bytesUploadedLastFrame { 0 };
+        std::size_t texturesCompleted { 0 };
+
+        // requests that found their content already loaded, neither decoded nor uploaded
+        std::size_t duplicatesShared { 0 };
+
+        // of the completed textures, how many went up block compressed and how many were read from the .ctex cache
+        std::size_t texturesCompressed { 0 };
+        std::size_t compressedCacheHits { 0 };
+
+        // estimated video memory of the completed textures, including their mip chains
+        std::size_t textureMemory { 0 };
+
+        // what the same textures would take as uncompressed RGB(A)8 with mipmaps
+        std::size_t uncompressedTextureMemory { 0 };
+    };
+
+    TextureStreamer();
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // process wide streamer used by TextureManager and Model
+    static TextureStreamer& shared();
+
+    unsigned int request(const std::string& path, TextureUsage usage = TextureUsage::Color, const glm::vec4& placeholderColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+    // forgets the request that created the texture, call it before deleting the texture. its decode or upload is dropped
+    // instead of landing in whatever texture gets the name next
+    void cancel(unsigned int texture);
+
+    // called from update() when a request turned out to have the same content (file bytes and usage) as an earlier one
+    // that is still alive. true means the texture now stands in for the earlier one and nothing gets uploaded into it,
+    // false decodes and uploads it after all. without a callback every request is decoded on its own
+    using DuplicateCallback = std::function<bool(unsigned int texture, unsigned int original)>;
+    void setDuplicateCallback(DuplicateCallback callback);
+
+    // advances the uploads, call once per frame with the context current
+    void update();
+
+    // blocks until every requested texture is decoded and uploaded (loading screens, benchmarks)
+    void flush();
+
+    // frees the GL objects owned by the streamer, has to happen while the context is still alive
+    void release();
+
+    // off: upload RGB(A)8 and let the driver build the mipmaps, like before the compressor existed
+    void setCompressionEnabled(bool enabled);
+    bool isCompressionEnabled() const;
+
+    void setUploadBudget(std::size_t bytesPerFrame);
+    std::size_t getUploadBudget() const;
+
+    Stats getStats() const;
+
+private:
+    struct DecodedImage
+    {
+        unsigned int texture { 0 };
+        std::uint64_t generation { 0 };
+        std::string path;
+        TextureUsage usage { TextureUsage::Color };
+
+        // set instead of any pixels when another request had already claimed the same content
+        unsigned int duplicateOf { 0 };
+        std::uint64_t duplicateGeneration { 0 };
+        std::uint64_t contentKey { 0 };
+
+        int width { 0 };
+        int height { 0 };
+        int channels { 0 };
+
+        // either raw stb_image pixels or, when compressed is valid, nothing
+        unsigned char* pixels { nullptr };
+        CompressedTexture compressed;
+        bool fromCache { false };
+    };
+
+    struct ContentOwner
+    {
+        unsigned int texture;
+        std::uint64_t generation;
+    };
+
+    // shared with the decode tasks, so a task finishing late never touches a dead streamer
+    struct DecodeQueue
+    {
+        std::mutex mutex;
+        std::condition_variable decoded;
+        std::deque<DecodedImage> ready;
+        std::size_t pending { 0 };
+
+        // texture -> generation of every request that wasn't cancelled, finished or not. only those claim content
+        std::unordered_map<unsigned int, std::uint64_t> liveRequests;
+
+        // content key (file hash and usage) -> the request that decodes it, claimed by the decode task right after
+        // hashing so identical requests in flight together are caught too. a claim lasts until cancel()
+        std::unordered_map<std::uint64_t, ContentOwner> contentOwners;
+        std::unordered_map<unsigned int, std::uint64_t> ownedContent;
+    };
+
+    std::shared_ptr<DecodeQueue> _queue;
+
+    // texture -> generation of the request still expected to fill it. names are reused once deleted, an image
+    // whose generation doesn't match anymore belongs to a cancelled request
+    std::unordered_map<unsigned int, std::uint64_t> _requests;
+    std::uint64_t _nextGeneration { 0 };
+
+    DuplicateCallback _duplicateCallback;
+
+    // image currently being copied into the pixel buffer
+    DecodedImage _active;
+    std::size_t _activeBytesCopied { 0 };
+
+    GlBuffer _pbo;
+    std::size_t _uploadBudget { 4 * 1024 * 1024 };
+    bool _flipVertically { true };
+
+    bool _compressionEnabled { true };
+
+    // S3TC is an extension on GL 3.3 (RGTC is core), queried lazily on the first request
+    bool _formatsQueried { false };
+    bool _s3tcSupported { false };
+
+    Stats _stats;
+
+private:
+    // queues the decode task of a request, also used to decode a duplicate after all when its original went away
+    void submitDecode(unsigned int texture, std::uint64_t generation, const std::string& path, TextureUsage usage);
+
+    // the active image is a duplicate: hands it to the callback, or decodes it after all when that's not possible
+    void shareActive();
+
+    bool shouldCompress(TextureUsage usage);
+    std::size_t stagingSize(const DecodedImage& image) const;
+    bool isCurrent(const DecodedImage& image) const;
+    void dropActive();
+    bool uploadWithinBudget(std::size_t budget);
+    void finishActiveUpload();
+};
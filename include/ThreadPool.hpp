@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads pulling tasks from one queue.
+// nothing in here touches GL, tasks must not either (the context belongs to the main thread).
+class ThreadPool
+{
+public:
+    // 0 picks one thread per hardware thread, minus the calling one
+    explicit ThreadPool(std::size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // process wide pool, created on first use
+    static ThreadPool& shared();
+
+    template <typename F>
+    std::future<void> submit(F&& task)
+    {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+        std::future<void> result = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    // runs body(i) for every i in [0, count), the calling thread takes part and returns once all are done.
+    // safe to call from inside a task: helpers that never got a thread are simply skipped.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body);
+
+    std::size_t getThreadCount() const;
+
+private:
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stopping { false };
+
+private:
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+};
@@ -10,9 +10,10 @@ struct Vertex
     glm::vec3 Position;
     glm::vec3 Normal;
     glm::vec2 TexCoords;
-    glm::vec3 Tangent;
-    glm::vec3 Bitangent;
+    glm::vec3 Tangent{};
+    glm::vec3 Bitangent{};
 
-    int m_BoneIDs[MAX_BONE_INFLUENCE];
-    float m_Weights[MAX_BONE_INFLUENCE];
+    // -1 marks an unused influence slot
+    int m_BoneIDs[MAX_BONE_INFLUENCE]{ -1, -1, -1, -1 };
+    float m_Weights[MAX_BONE_INFLUENCE]{};
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+enum class VertexLayout
+{
+    // the plain Vertex struct, 88 bytes with tangent frame and bone data as floats/ints (vert_lit.glsl)
+    Full,
+
+    // 24 bytes: float position, octahedral normal/tangent, half-float uvs (vert_lit_compact.glsl)
+    CompactHalfUV,
+
+    // 24 bytes: same as above with 16-bit normalized uvs, falls back to half-floats
+    // for meshes whose uvs leave [0, 1] (tiling) since unorm can't represent them
+    CompactUnormUV
+};
+
+// static part of a compact vertex
+struct CompactVertex
+{
+    glm::vec3 Position;
+
+    // octahedral encoded, snorm16
+    std::int16_t Normal[2];
+
+    // octahedral encoded xy, z holds the bitangent sign, all snorm8
+    std::int8_t Tangent[4];
+
+    // half-floats or unorm16 depending on the layout
+    std::uint16_t TexCoords[2];
+};
+
+// bone stream, only created for meshes that actually have bones
+struct SkinVertex
+{
+    std::uint16_t BoneIDs[MAX_BONE_INFLUENCE];
+
+    // unorm8, renormalized so they still sum up to 1
+    std::uint8_t Weights[MAX_BONE_INFLUENCE];
+};
+
+static_assert(sizeof(CompactVertex) == 24, "CompactVertex is expected to be tightly packed");
+static_assert(sizeof(SkinVertex) == 12, "SkinVertex is expected to be tightly packed");
+
+namespace VertexFormat
+{
+    // maps a unit vector onto the [-1, 1] square (octahedral projection)
+    glm::vec2 octEncode(const glm::vec3& n);
+    glm::vec3 octDecode(const glm::vec2& e);
+
+    bool hasBones(const Vertex& vertex);
+
+    // returns false when a uv is outside of [0, 1] (the unorm layout can't store it)
+    bool texCoordsInUnitRange(const Vertex* vertices, std::size_t count);
+
+    CompactVertex toCompact(const Vertex& vertex, bool unormTexCoords);
+    SkinVertex toSkin(const Vertex& vertex);
+
+    // true when the mesh can use GL_UNSIGNED_SHORT indices
+    bool fitsShortIndices(std::size_t vertexCount);
+}
@@ -0,0 +1,152 @@
+#version 330 core
+
+out vec4 FragColor;
+
+struct DirectionalLight
+{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight
+{
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight
+{
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// material inputs of one pixel, read back from the G-buffer
+struct Surface
+{
+    vec3 position;
+    vec3 normal;
+    vec3 albedo;
+    vec3 specular;
+    float shininess;
+    vec3 emission;
+};
+
+#define POINT_LIGHTS_COUNT 4
+#define MAX_SHININESS 256.0f
+
+// the same block frag_lit.glsl reads, the point lights in it are drawn as light volumes instead
+layout (std140) uniform LightBlock
+{
+    DirectionalLight directionalLight;
+    SpotLight spotLight;
+    PointLight pointLights[POINT_LIGHTS_COUNT];
+};
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gEmission;
+
+uniform vec3 viewPos;
+
+vec3 CalculateDirectionalLight(DirectionalLight light, Surface surface, vec3 viewDirection);
+vec3 CalculateSpotLight(SpotLight light, Surface surface, vec3 viewDirection);
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+    vec4 position = texelFetch(gPosition, pixel, 0);
+    if (position.w == 0.0f)
+    {
+        discard;
+    }
+
+    vec4 specular = texelFetch(gSpecular, pixel, 0);
+
+    Surface surface;
+    surface.position = position.xyz;
+    surface.normal = texelFetch(gNormal, pixel, 0).xyz;
+    surface.albedo = texelFetch(gAlbedo, pixel, 0).rgb;
+    surface.specular = specular.rgb;
+    surface.shininess = specular.a * MAX_SHININESS;
+    surface.emission = texelFetch(gEmission, pixel, 0).rgb;
+
+    vec3 viewDirection = normalize(viewPos - surface.position);
+
+    vec3 result = CalculateDirectionalLight(directionalLight, surface, viewDirection);
+    result += CalculateSpotLight(spotLight, surface, viewDirection);
+
+    // emission is added once here, the fullscreen pass covers every surface, the light volumes don't
+    result += surface.emission;
+
+    FragColor = vec4(result, 1.0f);
+}
+
+vec3 CalculateDirectionalLight(DirectionalLight light, Surface surface, vec3 viewDirection)
+{
+    vec3 lightDir = normalize(-light.direction);
+
+    // ambient
+    vec3 ambient = light.ambient * surface.albedo;
+
+    // diffuse
+    float diff = max(dot(surface.normal, lightDir), 0.0f);
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+
+    // specular
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), surface.shininess);
+    vec3 specular = light.specular * spec * surface.specular;
+
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalculateSpotLight(SpotLight light, Surface surface, vec3 viewDirection)
+{
+    vec3 lightDir = normalize(light.position - surface.position);
+
+    // spotlight soft edges
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0f, 1.0f);
+
+    // calculate attenuation
+    float distance = length(light.position - surface.position);
+    float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    // ambient
+    vec3 ambient = light.ambient * surface.albedo;
+
+    // diffuse
+    float diff = max(dot(surface.normal, lightDir), 0.0f);
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+
+    // specular
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), surface.shininess);
+    vec3 specular = light.specular * spec * surface.specular;
+
+    return (ambient + diffuse + specular) * intensity * attenuation;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#version 330 core
+
+out vec4 FragColor;
+
+flat in vec4 LightPositionRadius;
+flat in vec4 LightColorConstant;
+flat in vec2 LightLinearQuadratic;
+
+struct PointLight
+{
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// material inputs of one pixel, read back from the G-buffer
+struct Surface
+{
+    vec3 position;
+    vec3 normal;
+    vec3 albedo;
+    vec3 specular;
+    float shininess;
+};
+
+#define MAX_SHININESS 256.0f
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+
+uniform vec3 viewPos;
+
+vec3 CalculatePointLight(PointLight light, Surface surface, vec3 viewDirection);
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+    // the volume covers pixels in front of the light as well, only surfaces inside the radius get lit
+    vec4 position = texelFetch(gPosition, pixel, 0);
+    if (position.w == 0.0f || length(position.xyz - LightPositionRadius.xyz) > LightPositionRadius.w)
+    {
+        discard;
+    }
+
+    vec4 specular = texelFetch(gSpecular, pixel, 0);
+
+    Surface surface;
+    surface.position = position.xyz;
+    surface.normal = texelFetch(gNormal, pixel, 0).xyz;
+    surface.albedo = texelFetch(gAlbedo, pixel, 0).rgb;
+    surface.specular = specular.rgb;
+    surface.shininess = specular.a * MAX_SHININESS;
+
+    // same split LightUniformBuffer does for the block lights
+    PointLight light;
+    light.position = LightPositionRadius.xyz;
+    light.constant = LightColorConstant.w;
+    light.linear = LightLinearQuadratic.x;
+    light.quadratic = LightLinearQuadratic.y;
+    light.ambient = LightColorConstant.rgb * 0.1f;
+    light.diffuse = LightColorConstant.rgb;
+    light.specular = LightColorConstant.rgb;
+
+    vec3 viewDirection = normalize(viewPos - surface.position);
+
+    FragColor = vec4(CalculatePointLight(light, surface, viewDirection), 1.0f);
+}
+
+vec3 CalculatePointLight(PointLight light, Surface surface, vec3 viewDirection)
+{
+    vec3 lightDir = normalize(light.position - surface.position);
+
+    // attenuation
+    float distance = length(light.position - surface.position);
+    float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    // ambient
+    vec3 ambient = light.ambient * surface.albedo;
+
+    // diffuse
+    float diff = max(dot(surface.normal, lightDir), 0.0f);
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+
+    // specular
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), surface.shininess);
+    vec3 specular = light.specular * spec * surface.specular;
+
+    return (ambient + diffuse + specular) * attenuation;
+}
\ No newline at end of file
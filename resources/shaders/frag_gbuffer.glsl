@@ -0,0 +1,42 @@
+#version 330 core
+
+// G-buffer layout, see GBuffer::Attachment
+layout (location = 0) out vec4 gPosition;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gAlbedo;
+layout (location = 3) out vec4 gSpecular;
+layout (location = 4) out vec4 gEmission;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoord;
+
+struct Material
+{
+    sampler2D diffuse;
+    sampler2D specular;
+    sampler2D emission;
+    float shininess;
+};
+
+uniform Material material;
+uniform float time;
+
+// shininess is stored in an 8-bit channel
+#define MAX_SHININESS 256.0f
+
+void main()
+{
+    // w = 1 marks pixels covered by geometry, the lighting passes skip the rest
+    gPosition = vec4(FragPos, 1.0f);
+    gNormal = vec4(normalize(Normal), 0.0f);
+
+    gAlbedo = vec4(texture(material.diffuse, TexCoord).rgb, 1.0f);
+
+    vec3 specular = texture(material.specular, TexCoord).rgb;
+    gSpecular = vec4(specular, material.shininess / MAX_SHININESS);
+
+    // same mask as frag_lit.glsl, added once by the directional pass
+    vec3 showEmission = step(vec3(1.0f), vec3(1.0f) - specular);
+    gEmission = vec4(texture(material.emission, TexCoord + vec2(0.0f, time)).rgb * showEmission, 1.0f);
+}
\ No newline at end of file
@@ -1,5 +1,18 @@
 #version 330 core
 
+// permutation defines, injected after #version by Shader (see ShaderDefines). without any of them
+// only the directional light is left
+//   POINT_LIGHTS_COUNT   LightBlock point lights looped over, 0 or undefined skips the loop
+//   CLUSTERED_LIGHTING   point lights come from this fragment's cluster instead of LightBlock
+//   HAS_SPOTLIGHT        the camera spotlight
+//   HAS_EMISSION         material.emission, scrolling with time where the specular map is black
+//   HAS_SPECULAR_MAP     material.specular, otherwise the constant material.specularColor
+//   HAS_NORMAL_MAP       material.normal in tangent space
+//   HAS_SHADOWS          the ShadowMaps: cascades for the directional light, the spotlight's map and a cube map
+//                        for each LightBlock point light (in the clustered path the first lights are those)
+//   PER_LIGHT_MATERIAL_FETCH  the previous lighting model, only kept to benchmark against: every light samples
+//                        the material again and adds its own copy of the emission, scaled by its attenuation
+
 out vec4 FragColor;
 
 in vec3 FragPos;
@@ -9,8 +22,17 @@ in vec2 TexCoord;
 struct Material
 {
     sampler2D diffuse;
+#ifdef HAS_SPECULAR_MAP
     sampler2D specular;
+#else
+    vec3 specularColor;
+#endif
+#ifdef HAS_EMISSION
     sampler2D emission;
+#endif
+#ifdef HAS_NORMAL_MAP
+    sampler2D normal;
+#endif
     float shininess;
 };
 
@@ -52,94 +74,376 @@ struct SpotLight
     vec3 specular;
 };
 
-#define POINT_LIGHTS_COUNT 4
+// everything the lights need from the material, fetched once per fragment
+struct Surface
+{
+    vec3 position;
+    vec3 normal;
+    vec3 albedo;
+    vec3 specular;
+    float shininess;
+    vec3 emission;
+};
+
+#ifdef PER_LIGHT_MATERIAL_FETCH
+#define LIGHT_SURFACE FetchSurface(normal)
+#define LIGHT_EMISSION(surface) surface.emission
+#else
+#define LIGHT_SURFACE surface
+#define LIGHT_EMISSION(surface) vec3(0.0f)
+#endif
+
+// size of the LightBlock array, fixed by LightUniformBuffer no matter how many lights a variant loops over
+#define LIGHT_BLOCK_POINT_LIGHTS 4
+
+#ifndef POINT_LIGHTS_COUNT
+#define POINT_LIGHTS_COUNT 0
+#endif
+
+#if POINT_LIGHTS_COUNT > LIGHT_BLOCK_POINT_LIGHTS
+#error POINT_LIGHTS_COUNT is larger than the LightBlock array
+#endif
+
+// matches ShadowMaps::CascadeCount
+#define SHADOW_CASCADES 3
+
+// screen tiles x exponential depth slices, matches LightClusters on the CPU
+struct ClusterGrid
+{
+    int tilesX;
+    int tilesY;
+    int depthSlices;
+
+    // slice = log(viewDepth) * depthScale - depthBias
+    float depthScale;
+    float depthBias;
+
+    float nearPlane;
+    float farPlane;
+
+    // pixels per tile
+    vec2 tileSize;
+};
 
 uniform Material material;
 
-uniform DirectionalLight directionalLight;
-uniform PointLight pointLights[POINT_LIGHTS_COUNT];
-uniform SpotLight spotLight;
+// std140 so the C++ mirror (LightUniformBuffer) can compute the same offsets
+layout (std140) uniform LightBlock
+{
+    DirectionalLight directionalLight;
+    SpotLight spotLight;
+    PointLight pointLights[LIGHT_BLOCK_POINT_LIGHTS];
+};
 
 uniform vec3 viewPos;
 uniform float time;
 
-vec3 CalculateDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDirection);
-vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDirection);
-vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDirection);
+#ifdef CLUSTERED_LIGHTING
+// the point lights binned into this fragment's cluster (ClusteredLightBuffer)
+uniform ClusterGrid clusterGrid;
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLightIndices;
+#endif
+
+#ifdef HAS_SHADOWS
+// light space matrices of the cascades and the view distance each one reaches to
+uniform sampler2DArrayShadow cascadeShadowMap;
+uniform mat4 cascadeMatrices[SHADOW_CASCADES];
+uniform float cascadeSplits[SHADOW_CASCADES];
+uniform vec3 cameraForward;
+
+#ifdef HAS_SPOTLIGHT
+uniform sampler2DShadow spotShadowMap;
+uniform mat4 spotShadowMatrix;
+#endif
+
+// position and range of the light each cube map was drawn from
+uniform samplerCubeShadow pointShadowMaps[LIGHT_BLOCK_POINT_LIGHTS];
+uniform vec4 pointShadows[LIGHT_BLOCK_POINT_LIGHTS];
+#endif
+
+vec3 CalculateDirectionalLight(DirectionalLight light, Surface surface, vec3 viewDirection, float shadow);
+vec3 CalculatePointLight(PointLight light, Surface surface, vec3 viewDirection, float shadow);
+vec3 CalculateSpotLight(SpotLight light, Surface surface, vec3 viewDirection, float shadow);
+Surface FetchSurface(vec3 normal);
+#ifdef HAS_NORMAL_MAP
+vec3 PerturbNormal(vec3 normal);
+#endif
+#ifdef CLUSTERED_LIGHTING
+int ClusterIndex();
+PointLight FetchClusterLight(int index);
+#endif
+#ifdef HAS_SHADOWS
+float CascadeShadow(vec3 position);
+float PointShadow(int index, vec3 position);
+#ifdef HAS_SPOTLIGHT
+float SpotShadow(vec3 position);
+#endif
+#endif
+
+// 1 lit, 0 fully in shadow. without HAS_SHADOWS every light reaches every fragment
+#ifdef HAS_SHADOWS
+#define DIRECTIONAL_SHADOW CascadeShadow(FragPos)
+#define POINT_LIGHT_SHADOW(index) PointShadow(index, FragPos)
+#define SPOT_SHADOW SpotShadow(FragPos)
+#else
+#define DIRECTIONAL_SHADOW 1.0f
+#define POINT_LIGHT_SHADOW(index) 1.0f
+#define SPOT_SHADOW 1.0f
+#endif
 
 void main()
 {
     vec3 normal = normalize(Normal);
+#ifdef HAS_NORMAL_MAP
+    normal = PerturbNormal(normal);
+#endif
     vec3 viewDirection = normalize(viewPos - FragPos);
 
-    vec3 result = CalculateDirectionalLight(directionalLight, normal, viewDirection);
+    Surface surface = FetchSurface(normal);
+
+    vec3 result = CalculateDirectionalLight(directionalLight, LIGHT_SURFACE, viewDirection, DIRECTIONAL_SHADOW);
+
+#ifdef CLUSTERED_LIGHTING
+    uvec2 range = texelFetch(clusterRanges, ClusterIndex()).xy;
+    for (uint i = 0u; i < range.y; ++i)
+    {
+        int lightIndex = int(texelFetch(clusterLightIndices, int(range.x + i)).r);
+        float shadow = lightIndex < LIGHT_BLOCK_POINT_LIGHTS ? POINT_LIGHT_SHADOW(lightIndex) : 1.0f;
+        result += CalculatePointLight(FetchClusterLight(lightIndex), LIGHT_SURFACE, viewDirection, shadow);
+    }
+#elif POINT_LIGHTS_COUNT > 0
     for (int i = 0; i < POINT_LIGHTS_COUNT; ++i)
     {
-        result += CalculatePointLight(pointLights[i], normal, FragPos, viewDirection);
+        result += CalculatePointLight(pointLights[i], LIGHT_SURFACE, viewDirection, POINT_LIGHT_SHADOW(i));
     }
+#endif
+
+#ifdef HAS_SPOTLIGHT
+    result += CalculateSpotLight(spotLight, LIGHT_SURFACE, viewDirection, SPOT_SHADOW);
+#endif
 
-    result += CalculateSpotLight(spotLight, normal, FragPos, viewDirection);
+#ifndef PER_LIGHT_MATERIAL_FETCH
+    // light the surface gives off itself, it doesn't depend on any light source
+    result += surface.emission;
+#endif
 
     FragColor = vec4(result, 1.0f);
 }
 
-vec3 CalculateDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDirection)
+Surface FetchSurface(vec3 normal)
+{
+    Surface surface;
+    surface.position = FragPos;
+    surface.normal = normal;
+    surface.albedo = texture(material.diffuse, TexCoord).rgb;
+#ifdef HAS_SPECULAR_MAP
+    surface.specular = texture(material.specular, TexCoord).rgb;
+#else
+    surface.specular = material.specularColor;
+#endif
+    surface.shininess = material.shininess;
+
+#ifdef HAS_EMISSION
+    // scrolls with time, only where the specular map is black (the wooden part of the container)
+    vec3 showEmission = step(vec3(1.0f), vec3(1.0f) - surface.specular);
+    surface.emission = texture(material.emission, TexCoord + vec2(0.0f, time)).rgb * showEmission;
+#else
+    surface.emission = vec3(0.0f);
+#endif
+
+    return surface;
+}
+
+#ifdef HAS_NORMAL_MAP
+// the vertex format has no tangents, the tangent frame is rebuilt from the screen space
+// derivatives of position and texture coordinates (cotangent frame)
+vec3 PerturbNormal(vec3 normal)
+{
+    vec3 dp1 = dFdx(FragPos);
+    vec3 dp2 = dFdy(FragPos);
+    vec2 duv1 = dFdx(TexCoord);
+    vec2 duv2 = dFdy(TexCoord);
+
+    vec3 dp2perp = cross(dp2, normal);
+    vec3 dp1perp = cross(normal, dp1);
+    vec3 tangent = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 bitangent = dp2perp * duv1.y + dp1perp * duv2.y;
+
+    float invMax = inversesqrt(max(max(dot(tangent, tangent), dot(bitangent, bitangent)), 1e-12f));
+    mat3 tbn = mat3(tangent * invMax, bitangent * invMax, normal);
+
+    // normal maps are BC5 (RG only, blue reads 0), z is rebuilt from the unit length
+    vec2 xy = texture(material.normal, TexCoord).rg * 2.0f - 1.0f;
+    vec3 tangentNormal = vec3(xy, sqrt(max(0.0f, 1.0f - dot(xy, xy))));
+    return normalize(tbn * tangentNormal);
+}
+#endif
+
+#ifdef CLUSTERED_LIGHTING
+int ClusterIndex()
+{
+    // back from the depth buffer value to the positive view space distance
+    float ndcDepth = gl_FragCoord.z * 2.0f - 1.0f;
+    float nearPlane = clusterGrid.nearPlane;
+    float farPlane = clusterGrid.farPlane;
+    float viewDepth = 2.0f * nearPlane * farPlane / (farPlane + nearPlane - ndcDepth * (farPlane - nearPlane));
+
+    int slice = clamp(int(log(viewDepth) * clusterGrid.depthScale - clusterGrid.depthBias), 0, clusterGrid.depthSlices - 1);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterGrid.tileSize), ivec2(0), ivec2(clusterGrid.tilesX - 1, clusterGrid.tilesY - 1));
+
+    return tile.x + tile.y * clusterGrid.tilesX + slice * clusterGrid.tilesX * clusterGrid.tilesY;
+}
+
+PointLight FetchClusterLight(int index)
+{
+    // (position, constant), (color, linear), (quadratic, radius, -, -), same packing as LightClusters
+    vec4 texel0 = texelFetch(clusterLights, index * 3);
+    vec4 texel1 = texelFetch(clusterLights, index * 3 + 1);
+    vec4 texel2 = texelFetch(clusterLights, index * 3 + 2);
+
+    PointLight light;
+    light.position = texel0.xyz;
+    light.constant = texel0.w;
+    light.linear = texel1.w;
+    light.quadratic = texel2.x;
+
+    // same split LightUniformBuffer does for the block lights
+    light.ambient = texel1.rgb * 0.1f;
+    light.diffuse = texel1.rgb;
+    light.specular = texel1.rgb;
+
+    return light;
+}
+#endif
+
+#ifdef HAS_SHADOWS
+// 2x2 taps, each one a bilinear hardware comparison
+float CascadeShadow(vec3 position)
+{
+    // the first cascade whose slice reaches this far, past the last one nothing is shadowed
+    float viewDepth = dot(position - viewPos, cameraForward);
+    int cascade = SHADOW_CASCADES;
+    for (int i = SHADOW_CASCADES - 1; i >= 0; --i)
+    {
+        if (viewDepth < cascadeSplits[i])
+        {
+            cascade = i;
+        }
+    }
+
+    if (cascade == SHADOW_CASCADES)
+    {
+        return 1.0f;
+    }
+
+    vec3 coords = (cascadeMatrices[cascade] * vec4(position, 1.0f)).xyz * 0.5f + 0.5f;
+    vec2 texel = 1.0f / vec2(textureSize(cascadeShadowMap, 0).xy);
+
+    float lit = 0.0f;
+    lit += texture(cascadeShadowMap, vec4(coords.xy + vec2(-0.5f, -0.5f) * texel, float(cascade), coords.z));
+    lit += texture(cascadeShadowMap, vec4(coords.xy + vec2( 0.5f, -0.5f) * texel, float(cascade), coords.z));
+    lit += texture(cascadeShadowMap, vec4(coords.xy + vec2(-0.5f,  0.5f) * texel, float(cascade), coords.z));
+    lit += texture(cascadeShadowMap, vec4(coords.xy + vec2( 0.5f,  0.5f) * texel, float(cascade), coords.z));
+    return lit * 0.25f;
+}
+
+float PointShadowMap(samplerCubeShadow shadowMap, vec4 shadow, vec3 position)
+{
+    // same measure frag_shadow.glsl stored, a light without a map has no range and shadows nothing
+    vec3 fromLight = position - shadow.xyz;
+    float depth = length(fromLight) / max(shadow.w, 1e-4f);
+    if (depth >= 1.0f)
+    {
+        return 1.0f;
+    }
+
+    return texture(shadowMap, vec4(fromLight, depth - 0.005f));
+}
+
+float PointShadow(int index, vec3 position)
+{
+    // sampler arrays only take constant indices in GLSL 3.30
+    if (index == 0) return PointShadowMap(pointShadowMaps[0], pointShadows[0], position);
+    if (index == 1) return PointShadowMap(pointShadowMaps[1], pointShadows[1], position);
+    if (index == 2) return PointShadowMap(pointShadowMaps[2], pointShadows[2], position);
+    if (index == 3) return PointShadowMap(pointShadowMaps[3], pointShadows[3], position);
+    return 1.0f;
+}
+
+#if LIGHT_BLOCK_POINT_LIGHTS != 4
+#error PointShadow has one branch per LightBlock point light
+#endif
+
+#ifdef HAS_SPOTLIGHT
+float SpotShadow(vec3 position)
+{
+    vec4 lightSpace = spotShadowMatrix * vec4(position, 1.0f);
+    if (lightSpace.w <= 0.0f)
+    {
+        return 1.0f;
+    }
+
+    vec3 coords = lightSpace.xyz / lightSpace.w * 0.5f + 0.5f;
+    vec2 texel = 1.0f / vec2(textureSize(spotShadowMap, 0));
+
+    float lit = 0.0f;
+    lit += texture(spotShadowMap, vec3(coords.xy + vec2(-0.5f, -0.5f) * texel, coords.z));
+    lit += texture(spotShadowMap, vec3(coords.xy + vec2( 0.5f, -0.5f) * texel, coords.z));
+    lit += texture(spotShadowMap, vec3(coords.xy + vec2(-0.5f,  0.5f) * texel, coords.z));
+    lit += texture(spotShadowMap, vec3(coords.xy + vec2( 0.5f,  0.5f) * texel, coords.z));
+    return lit * 0.25f;
+}
+#endif
+#endif
+
+vec3 CalculateDirectionalLight(DirectionalLight light, Surface surface, vec3 viewDirection, float shadow)
 {
     vec3 lightDir = normalize(-light.direction);
 
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoord).rgb;
+    vec3 ambient = light.ambient * surface.albedo;
 
     // diffuse
-    float diff = max(dot(normal, lightDir), 0.0f);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoord).rgb;
+    float diff = max(dot(surface.normal, lightDir), 0.0f);
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
 
     // specular
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoord).rgb;
-
-    // emission
-    vec3 showEmission = step(vec3(1.0f), vec3(1.0f) - texture(material.specular, TexCoord).rgb);
-    vec3 emission = texture(material.emission, TexCoord + vec2(0.0f, time)).rgb * showEmission;
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), surface.shininess);
+    vec3 specular = light.specular * spec * surface.specular;
 
-    return (ambient + diffuse + specular + emission);
+    // the shadow only takes the direct light away
+    return (ambient + (diffuse + specular) * shadow + LIGHT_EMISSION(surface));
 }
 
-vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDirection)
+vec3 CalculatePointLight(PointLight light, Surface surface, vec3 viewDirection, float shadow)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
+    vec3 lightDir = normalize(light.position - surface.position);
 
     // attenuation
-    float distance = length(light.position - fragPos);
+    float distance = length(light.position - surface.position);
     float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
 
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoord).rgb;
-    ambient *= attenuation;
+    vec3 ambient = light.ambient * surface.albedo;
 
     // diffuse
-    float diff = max(dot(normal, lightDir), 0.0f);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoord).rgb;
-    diffuse *= attenuation;
+    float diff = max(dot(surface.normal, lightDir), 0.0f);
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
 
     // specular
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoord).rgb;
-    specular *= attenuation;
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), surface.shininess);
+    vec3 specular = light.specular * spec * surface.specular;
 
-    // emission
-    vec3 showEmission = step(vec3(1.0f), vec3(1.0f) - texture(material.specular, TexCoord).rgb);
-    vec3 emission = texture(material.emission, TexCoord + vec2(0.0f, time)).rgb * showEmission;
-    emission *= attenuation;
-
-    return (ambient + diffuse + specular + emission);
+    return (ambient + (diffuse + specular) * shadow + LIGHT_EMISSION(surface)) * attenuation;
 }
 
-vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDirection)
+vec3 CalculateSpotLight(SpotLight light, Surface surface, vec3 viewDirection, float shadow)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
+    vec3 lightDir = normalize(light.position - surface.position);
 
     // spotlight soft edges
     float theta = dot(lightDir, normalize(-light.direction));
@@ -147,28 +451,20 @@ vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0f, 1.0f);
 
     // calculate attenuation
-    float distance = length(light.position - fragPos);
+    float distance = length(light.position - surface.position);
     float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
 
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoord).rgb;
-    ambient *= intensity * attenuation;
+    vec3 ambient = light.ambient * surface.albedo;
 
     // diffuse
-    float diff = max(dot(normal, lightDir), 0.0f);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoord).rgb;
-    diffuse *= intensity * attenuation;
+    float diff = max(dot(surface.normal, lightDir), 0.0f);
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
 
     // specular
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoord).rgb;
-    specular *= intensity * attenuation;
-
-    // emission
-    vec3 showEmission = step(vec3(1.0f), vec3(1.0f) - texture(material.specular, TexCoord).rgb);
-    vec3 emission = texture(material.emission, TexCoord + vec2(0.0f, time)).rgb * showEmission;
-    emission *= intensity * attenuation;
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDirection, reflectDir), 0.0f), surface.shininess);
+    vec3 specular = light.specular * spec * surface.specular;
 
-    return (ambient + diffuse + specular + emission);
+    return (ambient + (diffuse + specular) * shadow + LIGHT_EMISSION(surface)) * intensity * attenuation;
 }
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 330 core
+
+// depth only, see ShadowMaps. permutation defines:
+//   POINT_SHADOW   writes the distance to the light over its range instead of the projected depth,
+//                  so all six faces of a cube map hold the same measure
+
+in vec3 FragPos;
+
+#ifdef POINT_SHADOW
+uniform vec3 lightPosition;
+uniform float farPlane;
+#endif
+
+void main()
+{
+#ifdef POINT_SHADOW
+    gl_FragDepth = length(FragPos - lightPosition) / farPlane;
+#endif
+}
\ No newline at end of file
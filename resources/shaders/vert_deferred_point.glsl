@@ -0,0 +1,26 @@
+#version 330 core
+
+// unit sphere
+layout (location = 0) in vec3 aPos;
+
+// per-instance light, see DeferredRenderer::LightVolume
+layout (location = 1) in vec4 aPositionRadius;
+layout (location = 2) in vec4 aColorConstant;
+layout (location = 3) in vec2 aLinearQuadratic;
+
+flat out vec4 LightPositionRadius;
+flat out vec4 LightColorConstant;
+flat out vec2 LightLinearQuadratic;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    LightPositionRadius = aPositionRadius;
+    LightColorConstant = aColorConstant;
+    LightLinearQuadratic = aLinearQuadratic;
+
+    // the sphere is scaled to the distance where the light stops contributing
+    gl_Position = projection * view * vec4(aPositionRadius.xyz + aPos * aPositionRadius.w, 1.0f);
+}
\ No newline at end of file
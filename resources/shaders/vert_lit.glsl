@@ -9,6 +9,7 @@ out vec3 Normal;
 out vec2 TexCoord;
 
 uniform mat4 model;
+uniform mat3 normalMatrix;
 uniform mat4 view;
 uniform mat4 projection;
 
@@ -27,7 +28,8 @@ void main()
     // dolayısıyla elimize geçen 3x3 matris'tete orientation bilgimiz mevcut sadece.
     // scale faktörümüz invert edildi, translation atıldı, orientation'ımız baştaki orientation. YEY!
     // --------------------------------------------------------------------
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    // normalMatrix = transpose(inverse(mat3(model))), built on the CPU once per object instead of per vertex.
+    Normal = normalMatrix * aNormal;
 
     TexCoord = aTexCoord;
 
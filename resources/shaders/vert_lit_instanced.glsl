@@ -0,0 +1,28 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+// per-instance, see InstanceBuffer
+layout (location = 7) in mat4 aModel;
+layout (location = 11) in mat3 aNormalMatrix;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoord;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    FragPos = vec3(aModel * vec4(aPos, 1.0f));
+
+    // see vert_lit.glsl, the normal matrix comes precomputed with the instance data
+    Normal = aNormalMatrix * aNormal;
+
+    TexCoord = aTexCoord;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0f);
+}
\ No newline at end of file
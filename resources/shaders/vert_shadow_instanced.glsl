@@ -0,0 +1,18 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+// per-instance, see InstanceBuffer
+layout (location = 7) in mat4 aModel;
+
+// world space position, only the point light maps need it
+out vec3 FragPos;
+
+// light projection * light view of the map (or cube face) being drawn
+uniform mat4 lightSpace;
+
+void main()
+{
+    FragPos = vec3(aModel * vec4(aPos, 1.0f));
+    gl_Position = lightSpace * vec4(FragPos, 1.0f);
+}
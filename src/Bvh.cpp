@@ -0,0 +1,322 @@
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr std::size_t MaxStackDepth = 256;
+
+    // [begin, end) split at the median centroid along the axis where the centroids spread the most
+    std::size_t splitMedian(const std::vector<BoundingBox>& bounds, std::vector<std::uint32_t>& objects, std::size_t begin, std::size_t end)
+    {
+        BoundingBox centroids;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            centroids.expand(bounds[objects[i]].getCenter());
+        }
+
+        glm::vec3 extent = centroids.max - centroids.min;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        std::size_t middle = begin + (end - begin) / 2;
+        std::nth_element(objects.begin() + begin, objects.begin() + middle, objects.begin() + end, [&bounds, axis](std::uint32_t a, std::uint32_t b)
+        {
+            return bounds[a].getCenter()[axis] < bounds[b].getCenter()[axis];
+        });
+
+        return middle;
+    }
+
+    std::int32_t objectChild(std::uint32_t object)
+    {
+        return -1 - static_cast<std::int32_t>(object);
+    }
+}
+
+void Bvh::build(const std::vector<BoundingBox>& bounds)
+{
+    _nodes.clear();
+    _objectCount = bounds.size();
+    _bounds = {};
+
+    if (bounds.empty())
+    {
+        return;
+    }
+
+    std::vector<std::uint32_t> objects(bounds.size());
+    for (std::size_t i = 0; i < bounds.size(); ++i)
+    {
+        objects[i] = static_cast<std::uint32_t>(i);
+        _bounds.expand(bounds[i]);
+    }
+
+    _nodes.reserve(bounds.size() / 2 + 1);
+    buildNode(bounds, objects, 0, objects.size());
+}
+
+CullStats Bvh::cull(const Frustum& frustum, std::vector<std::uint32_t>& visible) const
+{
+    visible.clear();
+
+    if (_nodes.empty())
+    {
+        CullStats stats;
+        stats.objects = _objectCount;
+        return stats;
+    }
+
+    CullStats stats = cull(frustum, 0, visible);
+    stats.objects = _objectCount;
+    return stats;
+}
+
+void Bvh::split(std::size_t count, std::vector<std::int32_t>& roots) const
+{
+    roots.clear();
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    roots.push_back(0);
+
+    // a level at a time, a node with an object among its children stays whole so no object is left without a root
+    std::vector<std::int32_t> next;
+    while (roots.size() < count)
+    {
+        next.clear();
+        bool splitAny = false;
+        for (std::int32_t root : roots)
+        {
+            const Node& node = _nodes[root];
+
+            bool inner = true;
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                if ((node.childMask & (1u << lane)) && node.children[lane] < 0)
+                {
+                    inner = false;
+                }
+            }
+
+            if (!inner)
+            {
+                next.push_back(root);
+                continue;
+            }
+
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                if (node.childMask & (1u << lane))
+                {
+                    next.push_back(node.children[lane]);
+                }
+            }
+            splitAny = true;
+        }
+
+        roots.swap(next);
+        if (!splitAny)
+        {
+            break;
+        }
+    }
+}
+
+CullStats Bvh::cull(const Frustum& frustum, std::int32_t root, std::vector<std::uint32_t>& visible) const
+{
+    auto start = std::chrono::steady_clock::now();
+
+    CullStats stats;
+    std::size_t visibleBefore = visible.size();
+
+    std::int32_t stack[MaxStackDepth];
+    std::size_t stackSize = 0;
+    stack[stackSize++] = root;
+
+    while (stackSize > 0)
+    {
+        const Node& node = _nodes[stack[--stackSize]];
+        ++stats.nodesVisited;
+
+        int outsideMask = 0;
+        int insideMask = 0xF;
+
+#ifdef BVH_SSE2
+        const __m128 minX = _mm_loadu_ps(node.minX);
+        const __m128 minY = _mm_loadu_ps(node.minY);
+        const __m128 minZ = _mm_loadu_ps(node.minZ);
+        const __m128 maxX = _mm_loadu_ps(node.maxX);
+        const __m128 maxY = _mm_loadu_ps(node.maxY);
+        const __m128 maxZ = _mm_loadu_ps(node.maxZ);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            const __m128 nx = _mm_set1_ps(plane.x);
+            const __m128 ny = _mm_set1_ps(plane.y);
+            const __m128 nz = _mm_set1_ps(plane.z);
+            const __m128 d = _mm_set1_ps(plane.w);
+
+            // n * (corner furthest along n) is the larger of the two products per axis, the nearest corner the smaller
+            __m128 productX0 = _mm_mul_ps(nx, minX), productX1 = _mm_mul_ps(nx, maxX);
+            __m128 productY0 = _mm_mul_ps(ny, minY), productY1 = _mm_mul_ps(ny, maxY);
+            __m128 productZ0 = _mm_mul_ps(nz, minZ), productZ1 = _mm_mul_ps(nz, maxZ);
+
+            __m128 furthest = _mm_add_ps(_mm_add_ps(_mm_max_ps(productX0, productX1), _mm_max_ps(productY0, productY1)), _mm_add_ps(_mm_max_ps(productZ0, productZ1), d));
+            __m128 nearest = _mm_add_ps(_mm_add_ps(_mm_min_ps(productX0, productX1), _mm_min_ps(productY0, productY1)), _mm_add_ps(_mm_min_ps(productZ0, productZ1), d));
+
+            outsideMask |= _mm_movemask_ps(_mm_cmplt_ps(furthest, zero));
+            insideMask &= _mm_movemask_ps(_mm_cmpge_ps(nearest, zero));
+        }
+#else
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                float furthest = std::max(plane.x * node.minX[lane], plane.x * node.maxX[lane]) + std::max(plane.y * node.minY[lane], plane.y * node.maxY[lane]) +
+                    std::max(plane.z * node.minZ[lane], plane.z * node.maxZ[lane]) + plane.w;
+                float nearest = std::min(plane.x * node.minX[lane], plane.x * node.maxX[lane]) + std::min(plane.y * node.minY[lane], plane.y * node.maxY[lane]) +
+                    std::min(plane.z * node.minZ[lane], plane.z * node.maxZ[lane]) + plane.w;
+
+                outsideMask |= furthest < 0.0f ? 1 << lane : 0;
+                insideMask &= nearest >= 0.0f ? ~0 : ~(1 << lane);
+            }
+        }
+#endif
+
+        int visibleMask = static_cast<int>(node.childMask) & ~outsideMask;
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            if (node.childMask & (1u << lane))
+            {
+                ++stats.boxesTested;
+            }
+
+            if (!(visibleMask & (1 << lane)))
+            {
+                continue;
+            }
+
+            std::int32_t child = node.children[lane];
+            if (child < 0)
+            {
+                visible.push_back(static_cast<std::uint32_t>(-1 - child));
+            }
+            else if (insideMask & (1 << lane))
+            {
+                collectAll(child, visible);
+            }
+            else if (stackSize < MaxStackDepth)
+            {
+                stack[stackSize++] = child;
+            }
+            else
+            {
+                // deeper than any median split tree gets, but never drop objects because of it
+                collectAll(child, visible);
+            }
+        }
+    }
+
+    stats.visible = visible.size() - visibleBefore;
+    stats.cullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return stats;
+}
+
+std::size_t Bvh::getObjectCount() const
+{
+    return _objectCount;
+}
+
+std::size_t Bvh::getNodeCount() const
+{
+    return _nodes.size();
+}
+
+const BoundingBox& Bvh::getBounds() const
+{
+    return _bounds;
+}
+
+std::int32_t Bvh::buildNode(const std::vector<BoundingBox>& bounds, std::vector<std::uint32_t>& objects, std::size_t begin, std::size_t end)
+{
+    std::int32_t nodeIndex = static_cast<std::int32_t>(_nodes.size());
+    _nodes.push_back({});
+
+    // up to four groups: single objects when they fit, otherwise two median splits
+    std::size_t groups[5];
+    std::size_t groupCount = 0;
+    std::size_t count = end - begin;
+
+    groups[0] = begin;
+    if (count <= 4)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            groups[++groupCount] = i + 1;
+        }
+    }
+    else
+    {
+        std::size_t middle = splitMedian(bounds, objects, begin, end);
+        groups[1] = splitMedian(bounds, objects, begin, middle);
+        groups[2] = middle;
+        groups[3] = splitMedian(bounds, objects, middle, end);
+        groups[4] = end;
+        groupCount = 4;
+    }
+
+    Node node {};
+    for (std::size_t group = 0; group < groupCount; ++group)
+    {
+        std::size_t groupBegin = groups[group];
+        std::size_t groupEnd = groups[group + 1];
+
+        BoundingBox box;
+        for (std::size_t i = groupBegin; i < groupEnd; ++i)
+        {
+            box.expand(bounds[objects[i]]);
+        }
+
+        node.minX[group] = box.min.x;
+        node.minY[group] = box.min.y;
+        node.minZ[group] = box.min.z;
+        node.maxX[group] = box.max.x;
+        node.maxY[group] = box.max.y;
+        node.maxZ[group] = box.max.z;
+        node.childMask |= 1u << group;
+
+        node.children[group] = groupEnd - groupBegin == 1 ? objectChild(objects[groupBegin]) : buildNode(bounds, objects, groupBegin, groupEnd);
+    }
+
+    // _nodes may have grown (and moved) while building the children
+    _nodes[nodeIndex] = node;
+    return nodeIndex;
+}
+
+void Bvh::collectAll(std::int32_t child, std::vector<std::uint32_t>& visible) const
+{
+    if (child < 0)
+    {
+        visible.push_back(static_cast<std::uint32_t>(-1 - child));
+        return;
+    }
+
+    const Node& node = _nodes[child];
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        if (node.childMask & (1u << lane))
+        {
+            collectAll(node.children[lane], visible);
+        }
+    }
+}
@@ -44,6 +44,14 @@ void Camera::ProcessMouseScroll(float yoffset)
     if (Zoom > 45.0f) { Zoom = 45.0f; }
 }
 
+void Camera::SetRotation(float yaw, float pitch)
+{
+    Yaw = yaw;
+    Pitch = pitch;
+
+    updateCameraVectors();
+}
+
 void Camera::updateCameraVectors()
 {
     glm::vec3 front
@@ -0,0 +1,87 @@
+#include "ClusteredLightBuffer.hpp"
+
+#include <glad/glad.h>
+
+ClusteredLightBuffer::ClusteredLightBuffer()
+{
+    create(_lights, GL_RGBA32F);
+    create(_ranges, GL_RG32UI);
+    create(_indices, GL_R32UI);
+}
+
+void ClusteredLightBuffer::upload(const LightClusters& clusters)
+{
+    const std::vector<float>& lights = clusters.getLightData();
+    const std::vector<std::uint32_t>& ranges = clusters.getClusterRanges();
+    const std::vector<std::uint32_t>& indices = clusters.getLightIndices();
+
+    fill(_lights, lights.data(), lights.size() * sizeof(float));
+    fill(_ranges, ranges.data(), ranges.size() * sizeof(std::uint32_t));
+    fill(_indices, indices.data(), indices.size() * sizeof(std::uint32_t));
+
+    _config = clusters.getConfig();
+    _depthScale = clusters.getDepthScale();
+    _depthBias = clusters.getDepthBias();
+    _nearPlane = clusters.getNearPlane();
+    _farPlane = clusters.getFarPlane();
+}
+
+void ClusteredLightBuffer::bind(const Shader& shader, unsigned int firstTextureUnit, int viewportWidth, int viewportHeight) const
+{
+    const BufferTexture* targets[] = { &_lights, &_ranges, &_indices };
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, targets[i]->texture);
+    }
+
+    shader.setInt("clusterLights", static_cast<int>(firstTextureUnit));
+    shader.setInt("clusterRanges", static_cast<int>(firstTextureUnit + 1));
+    shader.setInt("clusterLightIndices", static_cast<int>(firstTextureUnit + 2));
+
+    shader.setInt("clusterGrid.tilesX", _config.tilesX);
+    shader.setInt("clusterGrid.tilesY", _config.tilesY);
+    shader.setInt("clusterGrid.depthSlices", _config.depthSlices);
+    shader.setFloat("clusterGrid.depthScale", _depthScale);
+    shader.setFloat("clusterGrid.depthBias", _depthBias);
+    shader.setFloat("clusterGrid.nearPlane", _nearPlane);
+    shader.setFloat("clusterGrid.farPlane", _farPlane);
+    shader.setVec2("clusterGrid.tileSize", static_cast<float>(viewportWidth) / _config.tilesX, static_cast<float>(viewportHeight) / _config.tilesY);
+}
+
+std::size_t ClusteredLightBuffer::getGpuMemoryUsage() const
+{
+    return _lights.size + _ranges.size + _indices.size;
+}
+
+void ClusteredLightBuffer::create(BufferTexture& target, unsigned int internalFormat)
+{
+    target.buffer = GlBuffer::create();
+    target.texture = GlTexture::create();
+
+    // a buffer texture needs a data store before it can be sampled, start with a single zeroed texel
+    const unsigned char empty[16] = {};
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(empty), empty, GL_STREAM_DRAW);
+    target.size = sizeof(empty);
+
+    glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, target.buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLightBuffer::fill(BufferTexture& target, const void* data, std::size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(size), data, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    target.size = size;
+}
@@ -0,0 +1,297 @@
+#include "CommandBuffer.hpp"
+
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include <glm/gtc/type_ptr.hpp>
+
+void CommandBuffer::clear()
+{
+    _commands.clear();
+    _payload.clear();
+    _draws.clear();
+
+    _boundShader = nullptr;
+    _boundVao = 0;
+    _boundTextures.fill(0);
+
+    _stats = Stats{};
+}
+
+void CommandBuffer::bindProgram(const Shader& shader)
+{
+    // by object, not by program name: asking a Shader for its name may wait for its compile, which is GL
+    if (_boundShader == &shader)
+    {
+        ++_stats.programBindsSkipped;
+        return;
+    }
+
+    Command command { CommandType::BindProgram };
+    command.shader = &shader;
+    _commands.push_back(command);
+
+    _boundShader = &shader;
+    ++_stats.programBinds;
+}
+
+void CommandBuffer::bindVertexArray(unsigned int vao)
+{
+    // 0 is never a real vao, the first bind of a buffer is always recorded
+    if (_boundVao == vao && vao != 0)
+    {
+        ++_stats.vaoBindsSkipped;
+        return;
+    }
+
+    Command command { CommandType::BindVertexArray };
+    command.object = vao;
+    _commands.push_back(command);
+
+    _boundVao = vao;
+    ++_stats.vaoBinds;
+}
+
+void CommandBuffer::bindTexture(unsigned int unit, unsigned int texture)
+{
+    if (unit < TrackedTextureUnits)
+    {
+        if (_boundTextures[unit] == texture && texture != 0)
+        {
+            ++_stats.textureBindsSkipped;
+            return;
+        }
+
+        _boundTextures[unit] = texture;
+    }
+
+    Command command { CommandType::BindTexture };
+    command.argument = unit;
+    command.object = texture;
+    _commands.push_back(command);
+
+    ++_stats.textureBinds;
+}
+
+void CommandBuffer::setUniform(const char* name, int value)
+{
+    float bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    recordUniform(name, UniformType::Int, &bits, 1);
+}
+
+void CommandBuffer::setUniform(const char* name, float value)
+{
+    recordUniform(name, UniformType::Float, &value, 1);
+}
+
+void CommandBuffer::setUniform(const char* name, const glm::vec3& value)
+{
+    recordUniform(name, UniformType::Vec3, glm::value_ptr(value), 3);
+}
+
+void CommandBuffer::setUniform(const char* name, const glm::vec4& value)
+{
+    recordUniform(name, UniformType::Vec4, glm::value_ptr(value), 4);
+}
+
+void CommandBuffer::setUniform(const char* name, const glm::mat3& value)
+{
+    recordUniform(name, UniformType::Mat3, glm::value_ptr(value), 9);
+}
+
+void CommandBuffer::setUniform(const char* name, const glm::mat4& value)
+{
+    recordUniform(name, UniformType::Mat4, glm::value_ptr(value), 16);
+}
+
+void CommandBuffer::draw(const DrawParameters& parameters)
+{
+    Command command { CommandType::Draw };
+    command.argument = static_cast<std::uint32_t>(_draws.size());
+    _commands.push_back(command);
+
+    _draws.push_back(parameters);
+    ++_stats.drawCalls;
+}
+
+void CommandBuffer::replay() const
+{
+    const Shader* shader = nullptr;
+
+    for (const Command& command : _commands)
+    {
+        switch (command.type)
+        {
+        case CommandType::BindProgram:
+            shader = command.shader;
+            shader->use();
+            break;
+        case CommandType::BindVertexArray:
+            glBindVertexArray(command.object);
+            break;
+        case CommandType::BindTexture:
+            glActiveTexture(GL_TEXTURE0 + command.argument);
+            glBindTexture(GL_TEXTURE_2D, command.object);
+            break;
+        case CommandType::SetUniform:
+            replayUniform(*command.shader, command);
+            break;
+        case CommandType::Draw:
+            replayDraw(_draws[command.argument]);
+            break;
+        }
+    }
+
+    // leave things the way the rest of the code expects them
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void CommandBuffer::appendReplayedDraws(std::vector<ReplayedDraw>& draws) const
+{
+    // program and texture bindings carry over from the previous buffer, the vao is reset at its end
+    ReplayedDraw state;
+    if (!draws.empty())
+    {
+        state.shader = draws.back().shader;
+        state.textures = draws.back().textures;
+    }
+
+    for (const Command& command : _commands)
+    {
+        switch (command.type)
+        {
+        case CommandType::BindProgram:
+            state.shader = command.shader;
+            break;
+        case CommandType::BindVertexArray:
+            state.vao = command.object;
+            break;
+        case CommandType::BindTexture:
+            if (command.argument < TrackedTextureUnits)
+            {
+                state.textures[command.argument] = command.object;
+            }
+            break;
+        case CommandType::SetUniform:
+        {
+            const float* values = _payload.data() + command.argument;
+            state.uniformNames.push_back(command.name);
+            state.uniformValues.insert(state.uniformValues.end(), values, values + uniformSize(command.uniformType));
+            break;
+        }
+        case CommandType::Draw:
+            state.parameters = _draws[command.argument];
+            draws.push_back(state);
+            state.uniformNames.clear();
+            state.uniformValues.clear();
+            break;
+        }
+    }
+}
+
+std::size_t CommandBuffer::size() const
+{
+    return _commands.size();
+}
+
+bool CommandBuffer::empty() const
+{
+    return _commands.empty();
+}
+
+const CommandBuffer::Stats& CommandBuffer::getStats() const
+{
+    return _stats;
+}
+
+void CommandBuffer::recordUniform(const char* name, UniformType type, const float* values, std::size_t count)
+{
+    if (_boundShader == nullptr)
+    {
+        return;
+    }
+
+    Command command { CommandType::SetUniform };
+    command.uniformType = type;
+    command.argument = static_cast<std::uint32_t>(_payload.size());
+    command.shader = _boundShader;
+    command.name = name;
+    _commands.push_back(command);
+
+    _payload.insert(_payload.end(), values, values + count);
+    ++_stats.uniforms;
+}
+
+void CommandBuffer::replayUniform(const Shader& shader, const Command& command) const
+{
+    const float* values = _payload.data() + command.argument;
+
+    switch (command.uniformType)
+    {
+    case UniformType::Int:
+    {
+        int value;
+        std::memcpy(&value, values, sizeof(value));
+        shader.setInt(command.name, value);
+        break;
+    }
+    case UniformType::Float:
+        shader.setFloat(command.name, values[0]);
+        break;
+    case UniformType::Vec3:
+        shader.setVec3(command.name, glm::make_vec3(values));
+        break;
+    case UniformType::Vec4:
+        shader.setVec4(command.name, glm::make_vec4(values));
+        break;
+    case UniformType::Mat3:
+        shader.setMat3(command.name, glm::make_mat3(values));
+        break;
+    case UniformType::Mat4:
+        shader.setMat4(command.name, glm::make_mat4(values));
+        break;
+    }
+}
+
+std::size_t CommandBuffer::uniformSize(UniformType type)
+{
+    switch (type)
+    {
+    case UniformType::Int:
+    case UniformType::Float:
+        return 1;
+    case UniformType::Vec3:
+        return 3;
+    case UniformType::Vec4:
+        return 4;
+    case UniformType::Mat3:
+        return 9;
+    case UniformType::Mat4:
+        return 16;
+    }
+
+    return 0;
+}
+
+void CommandBuffer::replayDraw(const DrawParameters& parameters) const
+{
+    if (parameters.batch != nullptr)
+    {
+        GeometryPool::shared().draw(*parameters.batch);
+    }
+    else if (parameters.indexType == 0)
+    {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(parameters.count), static_cast<GLsizei>(parameters.instanceCount));
+    }
+    else if (parameters.instanceCount == 1)
+    {
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(parameters.count), parameters.indexType, reinterpret_cast<const void*>(parameters.indexOffset), parameters.baseVertex);
+    }
+    else
+    {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(parameters.count), parameters.indexType, reinterpret_cast<const void*>(parameters.indexOffset), static_cast<GLsizei>(parameters.instanceCount), parameters.baseVertex);
+    }
+}
\ No newline at end of file
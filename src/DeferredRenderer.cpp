@@ -0,0 +1,217 @@
+#include "DeferredRenderer.hpp"
+#include "LightClusters.hpp"
+#include "LightUniformBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+namespace
+{
+    // lights without falloff get a volume this large, depth clamping keeps it from being cut by the far plane
+    constexpr float MaxVolumeRadius = 1000.0f;
+
+    void setGBufferSamplers(const Shader& shader)
+    {
+        shader.use();
+        shader.setInt("gPosition", GBuffer::Position);
+        shader.setInt("gNormal", GBuffer::Normal);
+        shader.setInt("gAlbedo", GBuffer::Albedo);
+        shader.setInt("gSpecular", GBuffer::Specular);
+        shader.setInt("gEmission", GBuffer::Emission);
+    }
+}
+
+DeferredRenderer::DeferredRenderer(int width, int height, unsigned int lightBlockBinding) :
+    _gBuffer{ width, height },
+    _geometryShader{ "resources/shaders/vert_lit_instanced.glsl", "resources/shaders/frag_gbuffer.glsl" },
+    _directionalShader{ "resources/shaders/vert_deferred_fullscreen.glsl", "resources/shaders/frag_deferred_directional.glsl" },
+    _pointShader{ "resources/shaders/vert_deferred_point.glsl", "resources/shaders/frag_deferred_point.glsl" }
+{
+    setGBufferSamplers(_directionalShader);
+    setGBufferSamplers(_pointShader);
+    _directionalShader.bindUniformBlock(LightUniformBuffer::BlockName, lightBlockBinding);
+
+    // the fullscreen triangle comes from gl_VertexID, but core profile still wants a VAO bound
+    _fullscreenVao = GlVertexArray::create();
+
+    createSphere(8, 12);
+    createVolumeBuffer();
+}
+
+Shader& DeferredRenderer::getGeometryShader()
+{
+    return _geometryShader;
+}
+
+void DeferredRenderer::beginGeometryPass(int width, int height)
+{
+    if (width > 0 && height > 0)
+    {
+        _gBuffer.resize(width, height);
+    }
+
+    _gBuffer.bindForWriting();
+}
+
+void DeferredRenderer::renderLighting(const std::vector<PointLight>& pointLights, const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos, unsigned int targetFramebuffer)
+{
+    _gBuffer.blitDepth(targetFramebuffer);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    _gBuffer.bindTextures(0);
+
+    // directional + spot light, once per covered pixel
+    glDisable(GL_DEPTH_TEST);
+
+    _directionalShader.use();
+    _directionalShader.setVec3("viewPos", viewPos);
+
+    glBindVertexArray(_fullscreenVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // point lights, additively blended light volumes
+    uploadVolumes(pointLights);
+    if (!_volumes.empty())
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        // back faces that are behind the scene surface: the surface is in front of the volume's far side,
+        // which also works with the camera inside the volume. depth clamp stops the far plane from cutting it open
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_GEQUAL);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_DEPTH_CLAMP);
+
+        _pointShader.use();
+        _pointShader.setMat4("projection", projection);
+        _pointShader.setMat4("view", view);
+        _pointShader.setVec3("viewPos", viewPos);
+
+        glBindVertexArray(_sphereVao);
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(_sphereIndexCount), GL_UNSIGNED_SHORT, nullptr, static_cast<GLsizei>(_volumes.size()));
+
+        glDisable(GL_DEPTH_CLAMP);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+        glDisable(GL_BLEND);
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    glBindVertexArray(0);
+
+    _stats.lightVolumes = _volumes.size();
+    _stats.drawCalls = _volumes.empty() ? 1 : 2;
+    _stats.gBufferMemory = _gBuffer.getGpuMemoryUsage();
+}
+
+const DeferredRenderer::Stats& DeferredRenderer::getStats() const
+{
+    return _stats;
+}
+
+void DeferredRenderer::createSphere(int rings, int segments)
+{
+    const float pi = 3.14159265358979f;
+
+    // the flat faces sit inside the unit sphere, push the vertices out until they cover it
+    const float scale = 1.0f / (std::cos(pi / segments) * std::cos(pi / (2.0f * rings)));
+
+    std::vector<glm::vec3> positions;
+    for (int ring = 0; ring <= rings; ++ring)
+    {
+        float theta = pi * ring / rings;
+        for (int segment = 0; segment <= segments; ++segment)
+        {
+            float phi = 2.0f * pi * segment / segments;
+            positions.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) * scale);
+        }
+    }
+
+    // counter clockwise seen from outside
+    std::vector<unsigned short> indices;
+    for (int ring = 0; ring < rings; ++ring)
+    {
+        for (int segment = 0; segment < segments; ++segment)
+        {
+            unsigned short current = static_cast<unsigned short>(ring * (segments + 1) + segment);
+            unsigned short below = static_cast<unsigned short>(current + segments + 1);
+
+            indices.insert(indices.end(), { current, static_cast<unsigned short>(current + 1), below });
+            indices.insert(indices.end(), { static_cast<unsigned short>(current + 1), static_cast<unsigned short>(below + 1), below });
+        }
+    }
+    _sphereIndexCount = static_cast<unsigned int>(indices.size());
+
+    _sphereVao = GlVertexArray::create();
+    _sphereVbo = GlBuffer::create();
+    _sphereEbo = GlBuffer::create();
+
+    glBindVertexArray(_sphereVao);
+        glBindBuffer(GL_ARRAY_BUFFER, _sphereVbo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(positions.size() * sizeof(glm::vec3)), positions.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _sphereEbo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned short)), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DeferredRenderer::createVolumeBuffer()
+{
+    _volumeVbo = GlBuffer::create();
+
+    glBindVertexArray(_sphereVao);
+        glBindBuffer(GL_ARRAY_BUFFER, _volumeVbo);
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(LightVolume), (void*)offsetof(LightVolume, positionRadius));
+        glVertexAttribDivisor(1, 1);
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(LightVolume), (void*)offsetof(LightVolume, colorConstant));
+        glVertexAttribDivisor(2, 1);
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(LightVolume), (void*)offsetof(LightVolume, linearQuadratic));
+        glVertexAttribDivisor(3, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DeferredRenderer::uploadVolumes(const std::vector<PointLight>& pointLights)
+{
+    _volumes.clear();
+    for (const PointLight& light : pointLights)
+    {
+        // same cutoff the clustered forward path bins with
+        float radius = std::min(LightClusters::lightRadius(light), MaxVolumeRadius);
+        if (radius <= 0.0f)
+        {
+            continue;
+        }
+
+        _volumes.push_back({ glm::vec4(light.position, radius), glm::vec4(light.color, light.constant), glm::vec2(light.linear, light.quadratic) });
+    }
+
+    if (_volumes.empty())
+    {
+        return;
+    }
+
+    // orphaned every frame, the lights move
+    glBindBuffer(GL_ARRAY_BUFFER, _volumeVbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_volumes.size() * sizeof(LightVolume)), _volumes.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
\ No newline at end of file
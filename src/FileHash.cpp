@@ -0,0 +1,27 @@
+#include "FileHash.hpp"
+#include "MappedFile.hpp"
+
+std::uint64_t FileHash::hashBytes(const void* data, std::size_t size, std::uint64_t seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+std::uint64_t FileHash::hashFile(const std::string& path)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return 0;
+    }
+
+    return hashBytes(file.data(), file.size());
+}
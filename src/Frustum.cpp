@@ -0,0 +1,43 @@
+#include "Frustum.hpp"
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+{
+    // rows of the matrix (glm is column major), Gribb/Hartmann plane extraction
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; ++row)
+    {
+        rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+    }
+
+    Frustum frustum;
+    frustum.planes[Left] = rows[3] + rows[0];
+    frustum.planes[Right] = rows[3] - rows[0];
+    frustum.planes[Bottom] = rows[3] + rows[1];
+    frustum.planes[Top] = rows[3] - rows[1];
+    frustum.planes[Near] = rows[3] + rows[2];
+    frustum.planes[Far] = rows[3] - rows[2];
+
+    // normalized so plane distances are in world units
+    for (glm::vec4& plane : frustum.planes)
+    {
+        plane = plane / glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+bool Frustum::intersects(const BoundingBox& box) const
+{
+    for (const glm::vec4& plane : planes)
+    {
+        // the corner furthest along the plane normal
+        glm::vec3 positive(plane.x >= 0.0f ? box.max.x : box.min.x, plane.y >= 0.0f ? box.max.y : box.min.y, plane.z >= 0.0f ? box.max.z : box.min.z);
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
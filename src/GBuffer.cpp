@@ -0,0 +1,139 @@
+#include "GBuffer.hpp"
+
+#include <iostream>
+
+#include <glad/glad.h>
+
+namespace
+{
+    struct AttachmentFormat
+    {
+        GLenum internalFormat;
+        GLenum type;
+        std::size_t bytesPerPixel;
+    };
+
+    const AttachmentFormat Formats[GBuffer::AttachmentCount] =
+    {
+        { GL_RGBA32F, GL_FLOAT, 16 },
+        { GL_RGBA16F, GL_HALF_FLOAT, 8 },
+        { GL_RGBA8, GL_UNSIGNED_BYTE, 4 },
+        { GL_RGBA8, GL_UNSIGNED_BYTE, 4 },
+        { GL_RGBA8, GL_UNSIGNED_BYTE, 4 }
+    };
+}
+
+GBuffer::GBuffer(int width, int height) :
+    _width{ width },
+    _height{ height }
+{
+    create();
+}
+
+void GBuffer::resize(int width, int height)
+{
+    if (width == _width && height == _height)
+    {
+        return;
+    }
+
+    destroy();
+
+    _width = width;
+    _height = height;
+    create();
+}
+
+void GBuffer::bindForWriting() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+
+    // all zero, position.w = 0 marks the background
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+void GBuffer::bindTextures(unsigned int firstUnit) const
+{
+    for (unsigned int i = 0; i < AttachmentCount; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_2D, _textures[i]);
+    }
+}
+
+void GBuffer::blitDepth(unsigned int targetFramebuffer) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+    glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+int GBuffer::getWidth() const
+{
+    return _width;
+}
+
+int GBuffer::getHeight() const
+{
+    return _height;
+}
+
+std::size_t GBuffer::getGpuMemoryUsage() const
+{
+    std::size_t bytesPerPixel = 4; // depth24 + stencil8
+    for (const AttachmentFormat& format : Formats)
+    {
+        bytesPerPixel += format.bytesPerPixel;
+    }
+
+    return bytesPerPixel * static_cast<std::size_t>(_width) * static_cast<std::size_t>(_height);
+}
+
+void GBuffer::create()
+{
+    _fbo = GlFramebuffer::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+
+    GLenum drawBuffers[AttachmentCount];
+    for (unsigned int i = 0; i < AttachmentCount; ++i)
+    {
+        _textures[i] = GlTexture::create();
+
+        // read back with texelFetch only, no filtering or mipmaps needed
+        glBindTexture(GL_TEXTURE_2D, _textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, Formats[i].internalFormat, _width, _height, 0, GL_RGBA, Formats[i].type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, _textures[i], 0);
+        drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    glDrawBuffers(AttachmentCount, drawBuffers);
+
+    // same format as the default framebuffer, so the depth can be blitted over
+    _depthStencil = GlRenderbuffer::create();
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _width, _height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthStencil);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::FRAMEBUFFER::GBUFFER_INCOMPLETE" << std::endl;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::destroy()
+{
+    _fbo.reset();
+    for (GlTexture& texture : _textures)
+    {
+        texture.reset();
+    }
+    _depthStencil.reset();
+}
@@ -0,0 +1,523 @@
+#include "GeometryPool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    std::size_t getIndexSize(unsigned int indexType)
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+    }
+
+    // creates a buffer of the given size without touching the vao or element buffer bindings
+    GlBuffer createBuffer(std::size_t size)
+    {
+        GlBuffer buffer = GlBuffer::create();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STATIC_DRAW);
+        return buffer;
+    }
+
+    void copyBuffer(unsigned int source, unsigned int destination, std::size_t sourceOffset, std::size_t destinationOffset, std::size_t size)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, source);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(sourceOffset), static_cast<GLintptr>(destinationOffset), static_cast<GLsizeiptr>(size));
+    }
+
+    void uploadBuffer(unsigned int buffer, std::size_t offset, std::size_t size, const void* data)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+    }
+}
+
+void MultiDrawBatch::add(const GeometryRange& range)
+{
+    counts.push_back(static_cast<GLsizei>(range.indexCount));
+    offsets.push_back(reinterpret_cast<const void*>(range.indexOffset));
+    baseVertices.push_back(static_cast<GLint>(range.baseVertex));
+}
+
+void MultiDrawBatch::clear()
+{
+    counts.clear();
+    offsets.clear();
+    baseVertices.clear();
+}
+
+bool MultiDrawBatch::empty() const
+{
+    return counts.empty();
+}
+
+std::size_t MultiDrawBatch::size() const
+{
+    return counts.size();
+}
+
+GeometryPool& GeometryPool::shared()
+{
+    static GeometryPool pool;
+    return pool;
+}
+
+GeometryPool::Handle GeometryPool::allocate(VertexLayout layout, bool skinned, const void* vertices, const void* skinVertices, std::size_t vertexCount, const void* indices, std::size_t indexCount, unsigned int indexType)
+{
+    // the full layout carries its bones inline, only compact meshes get a separate skin stream
+    skinned = skinned && layout != VertexLayout::Full && skinVertices != nullptr;
+
+    std::uint32_t arenaIndex = static_cast<std::uint32_t>(getArenaIndex(layout, skinned));
+    Arena& arena = _arenas[arenaIndex];
+    if (arena.vao == 0)
+    {
+        createArena(arena, layout, skinned);
+    }
+
+    // rounded up so every range starts 4 byte aligned and packing never needs padding
+    std::size_t indexDataBytes = indexCount * getIndexSize(indexType);
+    std::size_t indexBytes = (indexDataBytes + 3) / 4 * 4;
+
+    std::size_t vertexOffset = arena.vertices.allocate(vertexCount);
+    std::size_t indexOffset = arena.indices.allocate(indexBytes, sizeof(std::uint32_t));
+
+    if (vertexOffset == RangeAllocator::InvalidOffset || indexOffset == RangeAllocator::InvalidOffset)
+    {
+        // give back whichever half succeeded, the rebuild below repacks everything anyway
+        if (vertexOffset != RangeAllocator::InvalidOffset) { arena.vertices.free(vertexOffset, vertexCount); }
+        if (indexOffset != RangeAllocator::InvalidOffset) { arena.indices.free(indexOffset, indexBytes); }
+
+        // holes are closed before anything grows, so unloading and loading models never piles up dead space
+        std::size_t vertexCapacity = arena.vertices.getCapacity();
+        std::size_t indexCapacity = arena.indices.getCapacity();
+        bool growVertices = arena.vertices.getUsed() + vertexCount > vertexCapacity;
+        bool growIndices = arena.indices.getUsed() + indexBytes > indexCapacity;
+
+        if (growVertices)
+        {
+            vertexCapacity = std::max(vertexCapacity * 2, arena.vertices.getUsed() + vertexCount);
+        }
+        if (growIndices)
+        {
+            indexCapacity = std::max(indexCapacity * 2, arena.indices.getUsed() + indexBytes);
+        }
+
+        if (growVertices || growIndices)
+        {
+            ++_stats.grows;
+        }
+        else
+        {
+            ++_stats.compactions;
+        }
+
+        rebuild(arenaIndex, vertexCapacity, indexCapacity);
+
+        vertexOffset = arena.vertices.allocate(vertexCount);
+        indexOffset = arena.indices.allocate(indexBytes, sizeof(std::uint32_t));
+    }
+
+    uploadBuffer(arena.vbo, vertexOffset * arena.vertexStride, vertexCount * arena.vertexStride, vertices);
+    if (arena.skinned)
+    {
+        uploadBuffer(arena.skinVbo, vertexOffset * sizeof(SkinVertex), vertexCount * sizeof(SkinVertex), skinVertices);
+    }
+    uploadBuffer(arena.ebo, indexOffset, indexDataBytes, indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    Allocation allocation;
+    allocation.arena = arenaIndex;
+    allocation.live = true;
+    allocation.vertexOffset = vertexOffset;
+    allocation.vertexCount = vertexCount;
+    allocation.indexOffset = indexOffset;
+    allocation.indexBytes = indexBytes;
+    allocation.indexCount = static_cast<std::uint32_t>(indexCount);
+    allocation.indexType = indexType;
+
+    Handle handle;
+    if (!_freeHandles.empty())
+    {
+        handle = _freeHandles.back();
+        _freeHandles.pop_back();
+        _allocations[handle] = allocation;
+    }
+    else
+    {
+        handle = static_cast<Handle>(_allocations.size());
+        _allocations.push_back(allocation);
+    }
+
+    return handle;
+}
+
+void GeometryPool::free(Handle handle)
+{
+    if (handle >= _allocations.size() || !_allocations[handle].live)
+    {
+        return;
+    }
+
+    Allocation& allocation = _allocations[handle];
+    Arena& arena = _arenas[allocation.arena];
+
+    arena.vertices.free(allocation.vertexOffset, allocation.vertexCount);
+    arena.indices.free(allocation.indexOffset, allocation.indexBytes);
+
+    allocation.live = false;
+    _freeHandles.push_back(handle);
+}
+
+GeometryRange GeometryPool::getRange(Handle handle) const
+{
+    GeometryRange range;
+    if (handle >= _allocations.size() || !_allocations[handle].live)
+    {
+        return range;
+    }
+
+    const Allocation& allocation = _allocations[handle];
+    range.vao = _arenas[allocation.arena].vao;
+    range.indexType = allocation.indexType;
+    range.indexCount = allocation.indexCount;
+    range.indexOffset = allocation.indexOffset;
+    range.baseVertex = static_cast<std::int32_t>(allocation.vertexOffset);
+    return range;
+}
+
+std::size_t GeometryPool::getMemoryUsage(Handle handle) const
+{
+    if (handle >= _allocations.size() || !_allocations[handle].live)
+    {
+        return 0;
+    }
+
+    const Allocation& allocation = _allocations[handle];
+    const Arena& arena = _arenas[allocation.arena];
+    return allocation.vertexCount * (arena.vertexStride + (arena.skinned ? sizeof(SkinVertex) : 0)) + allocation.indexBytes;
+}
+
+void GeometryPool::compact()
+{
+    for (std::uint32_t i = 0; i < ArenaCount; ++i)
+    {
+        Arena& arena = _arenas[i];
+        if (arena.vao == 0)
+        {
+            continue;
+        }
+
+        // halve while less than a quarter is used, never below the initial size
+        std::size_t vertexCapacity = arena.vertices.getCapacity();
+        while (vertexCapacity > InitialVertices && arena.vertices.getUsed() < vertexCapacity / 4)
+        {
+            vertexCapacity /= 2;
+        }
+
+        std::size_t indexCapacity = arena.indices.getCapacity();
+        while (indexCapacity > InitialIndexBytes && arena.indices.getUsed() < indexCapacity / 4)
+        {
+            indexCapacity /= 2;
+        }
+
+        bool fragmented = arena.vertices.getFreeRangeCount() > 1 || arena.indices.getFreeRangeCount() > 1;
+        if (fragmented || vertexCapacity != arena.vertices.getCapacity() || indexCapacity != arena.indices.getCapacity())
+        {
+            rebuild(i, vertexCapacity, indexCapacity);
+            ++_stats.compactions;
+        }
+    }
+}
+
+void GeometryPool::draw(const MultiDrawBatch& batch)
+{
+    if (batch.empty())
+    {
+        return;
+    }
+
+    if (!_capabilitiesQueried)
+    {
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+        _indirectSupported = major > 4 || (major == 4 && minor >= 3);
+        _capabilitiesQueried = true;
+    }
+
+    if (_indirectSupported && _indirectEnabled)
+    {
+        drawIndirect(batch);
+    }
+    else
+    {
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), batch.indexType, batch.offsets.data(), static_cast<GLsizei>(batch.size()), batch.baseVertices.data());
+    }
+
+    ++_stats.multiDraws;
+    _stats.meshesDrawn += batch.size();
+    _stats.indirect = _indirectSupported && _indirectEnabled;
+}
+
+void GeometryPool::setIndirectEnabled(bool enabled)
+{
+    _indirectEnabled = enabled;
+}
+
+bool GeometryPool::isIndirectEnabled() const
+{
+    return _indirectEnabled;
+}
+
+GeometryPool::Stats GeometryPool::getStats() const
+{
+    Stats stats = _stats;
+    stats.allocations = _allocations.size() - _freeHandles.size();
+
+    for (const Arena& arena : _arenas)
+    {
+        if (arena.vao == 0)
+        {
+            continue;
+        }
+
+        std::size_t vertexSize = arena.vertexStride + (arena.skinned ? sizeof(SkinVertex) : 0);
+        stats.vertexBytes += arena.vertices.getCapacity() * vertexSize;
+        stats.vertexBytesUsed += arena.vertices.getUsed() * vertexSize;
+        stats.indexBytes += arena.indices.getCapacity();
+        stats.indexBytesUsed += arena.indices.getUsed();
+        stats.freeRanges += arena.vertices.getFreeRangeCount() + arena.indices.getFreeRangeCount();
+    }
+
+    return stats;
+}
+
+void GeometryPool::resetDrawStats()
+{
+    _stats.multiDraws = 0;
+    _stats.meshesDrawn = 0;
+}
+
+void GeometryPool::release()
+{
+    // the handles delete the vaos and buffers
+    for (Arena& arena : _arenas)
+    {
+        arena = Arena{};
+    }
+
+    _indirectBuffer.reset();
+    _indirectCapacity = 0;
+    _indirectCursor = 0;
+
+    _allocations.clear();
+    _freeHandles.clear();
+    _stats = Stats{};
+}
+
+std::size_t GeometryPool::getArenaIndex(VertexLayout layout, bool skinned)
+{
+    switch (layout)
+    {
+    case VertexLayout::CompactHalfUV:
+        return skinned ? 2 : 1;
+    case VertexLayout::CompactUnormUV:
+        return skinned ? 4 : 3;
+    default:
+        return 0;
+    }
+}
+
+void GeometryPool::createArena(Arena& arena, VertexLayout layout, bool skinned)
+{
+    arena.layout = layout;
+    arena.skinned = skinned;
+    arena.vertexStride = layout == VertexLayout::Full ? sizeof(Vertex) : sizeof(CompactVertex);
+
+    arena.vao = GlVertexArray::create();
+    arena.vbo = createBuffer(InitialVertices * arena.vertexStride);
+    arena.skinVbo = skinned ? createBuffer(InitialVertices * sizeof(SkinVertex)) : GlBuffer{};
+    arena.ebo = createBuffer(InitialIndexBytes);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    arena.vertices = RangeAllocator(InitialVertices);
+    arena.indices = RangeAllocator(InitialIndexBytes);
+
+    setupAttributes(arena);
+}
+
+void GeometryPool::rebuild(std::uint32_t arenaIndex, std::size_t vertexCapacity, std::size_t indexCapacity)
+{
+    Arena& arena = _arenas[arenaIndex];
+    std::size_t skinStride = arena.skinned ? sizeof(SkinVertex) : 0;
+
+    GlBuffer vbo = createBuffer(vertexCapacity * arena.vertexStride);
+    GlBuffer skinVbo = arena.skinned ? createBuffer(vertexCapacity * skinStride) : GlBuffer{};
+    GlBuffer ebo = createBuffer(indexCapacity);
+
+    RangeAllocator vertices(vertexCapacity);
+    RangeAllocator indices(indexCapacity);
+
+    // in the old order, so the packed ranges keep their relative placement
+    std::vector<Allocation*> live;
+    for (Allocation& allocation : _allocations)
+    {
+        if (allocation.live && allocation.arena == arenaIndex)
+        {
+            live.push_back(&allocation);
+        }
+    }
+    std::sort(live.begin(), live.end(), [](const Allocation* a, const Allocation* b) { return a->vertexOffset < b->vertexOffset; });
+
+    for (Allocation* allocation : live)
+    {
+        std::size_t vertexOffset = vertices.allocate(allocation->vertexCount);
+        std::size_t indexOffset = indices.allocate(allocation->indexBytes, sizeof(std::uint32_t));
+
+        copyBuffer(arena.vbo, vbo, allocation->vertexOffset * arena.vertexStride, vertexOffset * arena.vertexStride, allocation->vertexCount * arena.vertexStride);
+        if (arena.skinned)
+        {
+            copyBuffer(arena.skinVbo, skinVbo, allocation->vertexOffset * skinStride, vertexOffset * skinStride, allocation->vertexCount * skinStride);
+        }
+        copyBuffer(arena.ebo, ebo, allocation->indexOffset, indexOffset, allocation->indexBytes);
+
+        allocation->vertexOffset = vertexOffset;
+        allocation->indexOffset = indexOffset;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // the old buffers go away with the handles they're replaced by
+    arena.vbo = std::move(vbo);
+    arena.skinVbo = std::move(skinVbo);
+    arena.ebo = std::move(ebo);
+    arena.vertices = std::move(vertices);
+    arena.indices = std::move(indices);
+
+    // same vao, so ranges handed out before only need their offsets refreshed
+    setupAttributes(arena);
+}
+
+void GeometryPool::setupAttributes(const Arena& arena) const
+{
+    glBindVertexArray(arena.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+
+    if (arena.layout == VertexLayout::Full)
+    {
+        // positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+        // normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+
+        // texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+
+        // tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+
+        // bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+
+        // ids
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+
+        // weights
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+    }
+    else
+    {
+        // positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, Position));
+
+        // octahedral normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, Normal));
+
+        // texture coords
+        glEnableVertexAttribArray(2);
+        if (arena.layout == VertexLayout::CompactUnormUV)
+        {
+            glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, TexCoords));
+        }
+        else
+        {
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, TexCoords));
+        }
+
+        // octahedral tangent + bitangent sign
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_BYTE, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, Tangent));
+
+        if (arena.skinned)
+        {
+            // bone ids and weights live in their own stream so static meshes don't pay for them
+            glBindBuffer(GL_ARRAY_BUFFER, arena.skinVbo);
+
+            // ids
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 4, GL_UNSIGNED_SHORT, sizeof(SkinVertex), (void*)offsetof(SkinVertex, BoneIDs));
+
+            // weights
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, Weights));
+        }
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.ebo);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::drawIndirect(const MultiDrawBatch& batch)
+{
+    std::size_t indexSize = getIndexSize(batch.indexType);
+
+    _indirectCommands.clear();
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+        DrawElementsIndirectCommand command;
+        command.count = static_cast<GLuint>(batch.counts[i]);
+        command.instanceCount = 1;
+        command.firstIndex = static_cast<GLuint>(reinterpret_cast<std::size_t>(batch.offsets[i]) / indexSize);
+        command.baseVertex = batch.baseVertices[i];
+        command.baseInstance = 0;
+        _indirectCommands.push_back(command);
+    }
+
+    std::size_t bytes = _indirectCommands.size() * sizeof(DrawElementsIndirectCommand);
+
+    if (_indirectBuffer == 0)
+    {
+        _indirectBuffer = GlBuffer::create();
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+
+    // written front to back and orphaned when full, so a draw never waits for the GPU to finish reading older commands
+    if (_indirectCursor + bytes > _indirectCapacity)
+    {
+        _indirectCapacity = std::max(_indirectCapacity, std::max<std::size_t>(bytes, 64 * 1024));
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(_indirectCapacity), nullptr, GL_STREAM_DRAW);
+        _indirectCursor = 0;
+    }
+
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLintptr>(_indirectCursor), static_cast<GLsizeiptr>(bytes), _indirectCommands.data());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, batch.indexType, reinterpret_cast<const void*>(_indirectCursor), static_cast<GLsizei>(_indirectCommands.size()), 0);
+    _indirectCursor += bytes;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "InstanceBuffer.hpp"
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+InstanceBuffer::InstanceBuffer(std::size_t count) :
+    _instances(count, InstanceData{ glm::mat4(1.0f), glm::mat3(1.0f) }),
+    _dirty(count, 0)
+{
+    _vbo = GlBuffer::create();
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_instances.size() * sizeof(InstanceData)), _instances.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::setTransform(std::size_t index, const glm::vec3& position, const glm::vec3& scale)
+{
+    glm::mat4 model(1.0f);
+    model[0][0] = scale.x;
+    model[1][1] = scale.y;
+    model[2][2] = scale.z;
+    model[3] = glm::vec4(position, 1.0f);
+
+    setTransform(index, model);
+}
+
+void InstanceBuffer::setTransform(std::size_t index, const glm::mat4& model)
+{
+    InstanceData& instance = _instances[index];
+    if (instance.model == model)
+    {
+        return;
+    }
+
+    instance.model = model;
+
+    // computed once per change instead of once per vertex in the shader
+    instance.normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+    if (!_dirty[index])
+    {
+        _dirty[index] = 1;
+        ++_dirtyCount;
+    }
+}
+
+void InstanceBuffer::resize(std::size_t count)
+{
+    _instances.assign(count, InstanceData{ glm::mat4(1.0f), glm::mat3(1.0f) });
+    _dirty.assign(count, 0);
+    _dirtyCount = 0;
+
+    // the vaos it's attached to keep pointing at the same buffer object
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_instances.size() * sizeof(InstanceData)), _instances.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+std::size_t InstanceBuffer::upload()
+{
+    if (_dirtyCount == 0)
+    {
+        return 0;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+    // upload runs of consecutive dirty instances with one call each
+    std::size_t uploaded = 0;
+    std::size_t i = 0;
+    while (i < _instances.size())
+    {
+        if (!_dirty[i])
+        {
+            ++i;
+            continue;
+        }
+
+        std::size_t first = i;
+        while (i < _instances.size() && _dirty[i])
+        {
+            _dirty[i] = 0;
+            ++i;
+        }
+
+        std::size_t count = i - first;
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first * sizeof(InstanceData)), static_cast<GLsizeiptr>(count * sizeof(InstanceData)), &_instances[first]);
+        uploaded += count;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    _dirtyCount = 0;
+    return uploaded;
+}
+
+void InstanceBuffer::attach(unsigned int vao, bool withNormalMatrix) const
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+    // model matrix, one vec4 column per attribute slot
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        unsigned int location = ModelAttribute + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(location, 1);
+    }
+
+    // normal matrix, one vec3 column per attribute slot
+    if (withNormalMatrix)
+    {
+        for (unsigned int column = 0; column < 3; ++column)
+        {
+            unsigned int location = NormalMatrixAttribute + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, normalMatrix) + sizeof(glm::vec3) * column));
+            glVertexAttribDivisor(location, 1);
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+std::size_t InstanceBuffer::size() const
+{
+    return _instances.size();
+}
+
+const InstanceData& InstanceBuffer::get(std::size_t index) const
+{
+    return _instances[index];
+}
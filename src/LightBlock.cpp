@@ -0,0 +1,224 @@
+#include "LightBlock.hpp"
+
+LightBlock::LightBlock(std::size_t pointLightCount) :
+    _pointLights(pointLightCount)
+{
+    buildLayout(pointLightCount);
+
+    writeDirectionalLight();
+    writeSpotLight();
+    for (std::size_t i = 0; i < pointLightCount; ++i)
+    {
+        writePointLight(i);
+    }
+}
+
+void LightBlock::setDirectionalLight(const DirectionalLight& light)
+{
+    if (light == _directionalLight)
+    {
+        return;
+    }
+
+    _directionalLight = light;
+    writeDirectionalLight();
+}
+
+void LightBlock::setSpotLight(const SpotLight& light)
+{
+    if (light == _spotLight)
+    {
+        return;
+    }
+
+    _spotLight = light;
+    writeSpotLight();
+}
+
+void LightBlock::setPointLight(std::size_t index, const PointLight& light)
+{
+    if (index >= _pointLights.size() || light == _pointLights[index])
+    {
+        return;
+    }
+
+    _pointLights[index] = light;
+    writePointLight(index);
+}
+
+void LightBlock::takeDirtyRanges(std::vector<Range>& ranges)
+{
+    ranges.clear();
+
+    // slots are laid out back to back in block order, so walking them in that order
+    // lets neighbouring dirty lights go out as a single range.
+    auto slotAt = [this](std::size_t i) -> Slot&
+    {
+        return i == 0 ? _directionalSlot : (i == 1 ? _spotSlot : _pointSlots[i - 2]);
+    };
+
+    std::size_t slotCount = _pointSlots.size() + 2;
+    std::size_t i = 0;
+    while (i < slotCount)
+    {
+        Slot& first = slotAt(i);
+        if (!first.dirty)
+        {
+            ++i;
+            continue;
+        }
+
+        std::size_t begin = first.offset;
+        std::size_t end = begin + first.size;
+        first.dirty = false;
+
+        // merge the following dirty slots; the padding between two structs is harmless to resend
+        while (++i < slotCount && slotAt(i).dirty)
+        {
+            end = slotAt(i).offset + slotAt(i).size;
+            slotAt(i).dirty = false;
+        }
+
+        ranges.push_back({ begin, end - begin });
+    }
+}
+
+std::vector<LightBlock::Member> LightBlock::getMembers() const
+{
+    std::vector<Member> members;
+    members.reserve(14 + _pointSlots.size() * 7);
+
+    std::size_t base = _directionalSlot.offset;
+    members.push_back({ "directionalLight.direction", base + _directionalOffsets.direction });
+    members.push_back({ "directionalLight.ambient", base + _directionalOffsets.ambient });
+    members.push_back({ "directionalLight.diffuse", base + _directionalOffsets.diffuse });
+    members.push_back({ "directionalLight.specular", base + _directionalOffsets.specular });
+
+    base = _spotSlot.offset;
+    members.push_back({ "spotLight.position", base + _spotOffsets.position });
+    members.push_back({ "spotLight.direction", base + _spotOffsets.direction });
+    members.push_back({ "spotLight.cutOff", base + _spotOffsets.cutOff });
+    members.push_back({ "spotLight.outerCutOff", base + _spotOffsets.outerCutOff });
+    members.push_back({ "spotLight.constant", base + _spotOffsets.constant });
+    members.push_back({ "spotLight.linear", base + _spotOffsets.linear });
+    members.push_back({ "spotLight.quadratic", base + _spotOffsets.quadratic });
+    members.push_back({ "spotLight.ambient", base + _spotOffsets.ambient });
+    members.push_back({ "spotLight.diffuse", base + _spotOffsets.diffuse });
+    members.push_back({ "spotLight.specular", base + _spotOffsets.specular });
+
+    for (std::size_t i = 0; i < _pointSlots.size(); ++i)
+    {
+        std::string prefix = "pointLights[" + std::to_string(i) + "]";
+        base = _pointSlots[i].offset;
+
+        members.push_back({ prefix + ".position", base + _pointOffsets.position });
+        members.push_back({ prefix + ".constant", base + _pointOffsets.constant });
+        members.push_back({ prefix + ".linear", base + _pointOffsets.linear });
+        members.push_back({ prefix + ".quadratic", base + _pointOffsets.quadratic });
+        members.push_back({ prefix + ".ambient", base + _pointOffsets.ambient });
+        members.push_back({ prefix + ".diffuse", base + _pointOffsets.diffuse });
+        members.push_back({ prefix + ".specular", base + _pointOffsets.specular });
+    }
+
+    return members;
+}
+
+const std::vector<unsigned char>& LightBlock::getData() const
+{
+    return _data;
+}
+
+std::size_t LightBlock::getPointLightCount() const
+{
+    return _pointLights.size();
+}
+
+void LightBlock::buildLayout(std::size_t pointLightCount)
+{
+    // member order has to match the struct declarations in frag_lit.glsl
+    Std140Layout directional;
+    _directionalOffsets.direction = directional.add(Std140Type::Vec3);
+    _directionalOffsets.ambient = directional.add(Std140Type::Vec3);
+    _directionalOffsets.diffuse = directional.add(Std140Type::Vec3);
+    _directionalOffsets.specular = directional.add(Std140Type::Vec3);
+
+    Std140Layout spot;
+    _spotOffsets.position = spot.add(Std140Type::Vec3);
+    _spotOffsets.direction = spot.add(Std140Type::Vec3);
+    _spotOffsets.cutOff = spot.add(Std140Type::Float);
+    _spotOffsets.outerCutOff = spot.add(Std140Type::Float);
+    _spotOffsets.constant = spot.add(Std140Type::Float);
+    _spotOffsets.linear = spot.add(Std140Type::Float);
+    _spotOffsets.quadratic = spot.add(Std140Type::Float);
+    _spotOffsets.ambient = spot.add(Std140Type::Vec3);
+    _spotOffsets.diffuse = spot.add(Std140Type::Vec3);
+    _spotOffsets.specular = spot.add(Std140Type::Vec3);
+
+    Std140Layout point;
+    _pointOffsets.position = point.add(Std140Type::Vec3);
+    _pointOffsets.constant = point.add(Std140Type::Float);
+    _pointOffsets.linear = point.add(Std140Type::Float);
+    _pointOffsets.quadratic = point.add(Std140Type::Float);
+    _pointOffsets.ambient = point.add(Std140Type::Vec3);
+    _pointOffsets.diffuse = point.add(Std140Type::Vec3);
+    _pointOffsets.specular = point.add(Std140Type::Vec3);
+
+    Std140Layout block;
+    _directionalSlot = { block.addStruct(directional), directional.structSize(), true };
+    _spotSlot = { block.addStruct(spot), spot.structSize(), true };
+
+    std::size_t pointLightsOffset = block.addStructArray(point, pointLightCount);
+    _pointSlots.resize(pointLightCount);
+    for (std::size_t i = 0; i < pointLightCount; ++i)
+    {
+        _pointSlots[i] = { pointLightsOffset + i * point.structSize(), point.structSize(), true };
+    }
+
+    _data.assign(block.structSize(), 0);
+}
+
+void LightBlock::writeDirectionalLight()
+{
+    std::size_t base = _directionalSlot.offset;
+
+    std140Write(_data, base + _directionalOffsets.direction, _directionalLight.direction);
+    std140Write(_data, base + _directionalOffsets.ambient, _directionalLight.ambient);
+    std140Write(_data, base + _directionalOffsets.diffuse, _directionalLight.diffuse);
+    std140Write(_data, base + _directionalOffsets.specular, _directionalLight.specular);
+
+    _directionalSlot.dirty = true;
+}
+
+void LightBlock::writeSpotLight()
+{
+    std::size_t base = _spotSlot.offset;
+
+    std140Write(_data, base + _spotOffsets.position, _spotLight.position);
+    std140Write(_data, base + _spotOffsets.direction, _spotLight.direction);
+    std140Write(_data, base + _spotOffsets.cutOff, _spotLight.cutOff);
+    std140Write(_data, base + _spotOffsets.outerCutOff, _spotLight.outerCutOff);
+    std140Write(_data, base + _spotOffsets.constant, _spotLight.constant);
+    std140Write(_data, base + _spotOffsets.linear, _spotLight.linear);
+    std140Write(_data, base + _spotOffsets.quadratic, _spotLight.quadratic);
+    std140Write(_data, base + _spotOffsets.ambient, _spotLight.ambient);
+    std140Write(_data, base + _spotOffsets.diffuse, _spotLight.diffuse);
+    std140Write(_data, base + _spotOffsets.specular, _spotLight.specular);
+
+    _spotSlot.dirty = true;
+}
+
+void LightBlock::writePointLight(std::size_t index)
+{
+    const PointLight& light = _pointLights[index];
+    std::size_t base = _pointSlots[index].offset;
+
+    std140Write(_data, base + _pointOffsets.position, light.position);
+    std140Write(_data, base + _pointOffsets.constant, light.constant);
+    std140Write(_data, base + _pointOffsets.linear, light.linear);
+    std140Write(_data, base + _pointOffsets.quadratic, light.quadratic);
+    std140Write(_data, base + _pointOffsets.ambient, light.color * 0.1f);
+    std140Write(_data, base + _pointOffsets.diffuse, light.color);
+    std140Write(_data, base + _pointOffsets.specular, light.color);
+
+    _pointSlots[index].dirty = true;
+}
\ No newline at end of file
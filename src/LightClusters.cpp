@@ -0,0 +1,427 @@
+#include "LightClusters.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_CLUSTERS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+    std::size_t padToFour(std::size_t count)
+    {
+        return (count + 3) & ~static_cast<std::size_t>(3);
+    }
+
+    // squared distance from value to each [min, max] interval, 4 at a time
+    void squaredDistances(const std::vector<float>& minimum, const std::vector<float>& maximum, float value, std::vector<float>& distances)
+    {
+#ifdef LIGHT_CLUSTERS_SSE2
+        const __m128 v = _mm_set1_ps(value);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (std::size_t i = 0; i < minimum.size(); i += 4)
+        {
+            __m128 below = _mm_sub_ps(_mm_loadu_ps(&minimum[i]), v);
+            __m128 above = _mm_sub_ps(v, _mm_loadu_ps(&maximum[i]));
+            __m128 distance = _mm_max_ps(_mm_max_ps(below, above), zero);
+            _mm_storeu_ps(&distances[i], _mm_mul_ps(distance, distance));
+        }
+#else
+        for (std::size_t i = 0; i < minimum.size(); ++i)
+        {
+            float distance = std::max({ minimum[i] - value, value - maximum[i], 0.0f });
+            distances[i] = distance * distance;
+        }
+#endif
+    }
+}
+
+LightClusters::LightClusters() :
+    LightClusters(Config {})
+{
+}
+
+LightClusters::LightClusters(const Config& config) :
+    _config{ config },
+    _pool{ &ThreadPool::shared() }
+{
+}
+
+void LightClusters::setProjection(float fovY, float aspect, float nearPlane, float farPlane)
+{
+    if (fovY == _fovY && aspect == _aspect && nearPlane == _nearPlane && farPlane == _farPlane)
+    {
+        return;
+    }
+
+    _fovY = fovY;
+    _aspect = aspect;
+    _nearPlane = nearPlane;
+    _farPlane = farPlane;
+
+    // exponential slices keep clusters roughly cube shaped at every distance
+    float logRange = std::log(farPlane / nearPlane);
+    _depthScale = _config.depthSlices / logRange;
+    _depthBias = _config.depthSlices * std::log(nearPlane) / logRange;
+
+    float tanY = std::tan(fovY * 0.5f);
+    float tanX = tanY * aspect;
+    _frustumReach = farPlane * std::sqrt(1.0f + tanX * tanX + tanY * tanY);
+
+    _slices.resize(_config.depthSlices);
+    _bins.resize(_config.depthSlices);
+
+    for (int k = 0; k < _config.depthSlices; ++k)
+    {
+        Slice& slice = _slices[k];
+        slice.nearDepth = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(k) / _config.depthSlices);
+        slice.farDepth = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(k + 1) / _config.depthSlices);
+
+        // bounds of a tile column over the whole slice depth, the frustum widens with depth so the sign decides which end counts
+        auto buildTiles = [&slice](int tiles, float tanHalf, std::vector<float>& minimum, std::vector<float>& maximum)
+        {
+            minimum.assign(padToFour(tiles), Infinity);
+            maximum.assign(padToFour(tiles), -Infinity);
+
+            for (int i = 0; i < tiles; ++i)
+            {
+                float low = (-1.0f + 2.0f * i / tiles) * tanHalf;
+                float high = (-1.0f + 2.0f * (i + 1) / tiles) * tanHalf;
+
+                minimum[i] = std::min(low * slice.nearDepth, low * slice.farDepth);
+                maximum[i] = std::max(high * slice.nearDepth, high * slice.farDepth);
+            }
+        };
+
+        buildTiles(_config.tilesX, tanX, slice.tileMinX, slice.tileMaxX);
+        buildTiles(_config.tilesY, tanY, slice.tileMinY, slice.tileMaxY);
+
+        SliceBin& bin = _bins[k];
+        bin.distanceX.resize(slice.tileMinX.size());
+        bin.distanceY.resize(slice.tileMinY.size());
+    }
+}
+
+void LightClusters::setThreadPool(ThreadPool* pool)
+{
+    _pool = pool;
+}
+
+void LightClusters::bin(const std::vector<PointLight>& lights, const glm::mat4& view)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    prepareLights(lights, view);
+
+    // 1. every slice collects its light/cluster pairs independently
+    forEachSlice(&LightClusters::binSlice);
+
+    // 2. slices get consecutive ranges of the index list
+    std::size_t total = 0;
+    for (SliceBin& bin : _bins)
+    {
+        bin.base = total;
+        total += bin.indices.size();
+    }
+
+    _lightIndices.resize(total);
+    _clusterRanges.resize(getClusterCount() * 2);
+
+    // 3. each slice copies its lists into place
+    forEachSlice(&LightClusters::writeSlice);
+
+    _stats = {};
+    _stats.lights = lights.size();
+    _stats.lightIndices = total;
+    for (std::size_t cluster = 0; cluster < getClusterCount(); ++cluster)
+    {
+        std::size_t count = _clusterRanges[cluster * 2 + 1];
+        _stats.occupiedClusters += count > 0 ? 1 : 0;
+        _stats.maxLightsPerCluster = std::max(_stats.maxLightsPerCluster, count);
+    }
+
+    _stats.binningMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+float LightClusters::lightRadius(const PointLight& light)
+{
+    float brightness = std::max({ light.color.x, light.color.y, light.color.z });
+    if (brightness <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // brightness / (constant + linear * d + quadratic * d^2) = threshold, solved for d
+    float c = light.constant - brightness / AttenuationThreshold;
+
+    if (light.quadratic > 0.0f)
+    {
+        float discriminant = light.linear * light.linear - 4.0f * light.quadratic * c;
+        if (discriminant < 0.0f)
+        {
+            return 0.0f;
+        }
+
+        return std::max((-light.linear + std::sqrt(discriminant)) / (2.0f * light.quadratic), 0.0f);
+    }
+
+    if (light.linear > 0.0f)
+    {
+        return std::max(-c / light.linear, 0.0f);
+    }
+
+    // no falloff at all, the light reaches every cluster
+    return Infinity;
+}
+
+const LightClusters::Config& LightClusters::getConfig() const
+{
+    return _config;
+}
+
+std::size_t LightClusters::getClusterCount() const
+{
+    return static_cast<std::size_t>(_config.tilesX) * _config.tilesY * _slices.size();
+}
+
+float LightClusters::getDepthScale() const
+{
+    return _depthScale;
+}
+
+float LightClusters::getDepthBias() const
+{
+    return _depthBias;
+}
+
+float LightClusters::getNearPlane() const
+{
+    return _nearPlane;
+}
+
+float LightClusters::getFarPlane() const
+{
+    return _farPlane;
+}
+
+const std::vector<float>& LightClusters::getLightData() const
+{
+    return _lightData;
+}
+
+const std::vector<std::uint32_t>& LightClusters::getClusterRanges() const
+{
+    return _clusterRanges;
+}
+
+const std::vector<std::uint32_t>& LightClusters::getLightIndices() const
+{
+    return _lightIndices;
+}
+
+const LightClusters::Stats& LightClusters::getStats() const
+{
+    return _stats;
+}
+
+void LightClusters::prepareLights(const std::vector<PointLight>& lights, const glm::mat4& view)
+{
+    std::size_t count = lights.size();
+
+    _lightX.resize(count);
+    _lightY.resize(count);
+    _lightDepth.resize(count);
+    _lightRadius.resize(count);
+    _lightData.resize(count * LightTexels * 4);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const PointLight& light = lights[i];
+        glm::vec4 position = view * glm::vec4(light.position, 1.0f);
+
+        // an infinite radius (no falloff) would make the infinitely far padding tiles pass the distance test too.
+        // clamped to what still covers the whole frustum, the light lands in the same clusters
+        float radius = std::min(lightRadius(light), glm::length(glm::vec3(position)) + _frustumReach);
+
+        _lightX[i] = position.x;
+        _lightY[i] = position.y;
+        _lightRadius[i] = radius;
+
+        // lights that can't light anything fail every depth test
+        _lightDepth[i] = radius > 0.0f ? -position.z : -Infinity;
+
+        float* data = &_lightData[i * LightTexels * 4];
+        data[0] = light.position.x;
+        data[1] = light.position.y;
+        data[2] = light.position.z;
+        data[3] = light.constant;
+        data[4] = light.color.x;
+        data[5] = light.color.y;
+        data[6] = light.color.z;
+        data[7] = light.linear;
+        data[8] = light.quadratic;
+        data[9] = radius;
+        data[10] = 0.0f;
+        data[11] = 0.0f;
+    }
+}
+
+void LightClusters::binSlice(std::size_t sliceIndex)
+{
+    const Slice& slice = _slices[sliceIndex];
+    SliceBin& bin = _bins[sliceIndex];
+    bin.pairs.clear();
+
+    std::size_t count = _lightX.size();
+    std::size_t i = 0;
+
+#ifdef LIGHT_CLUSTERS_SSE2
+    // depth overlap of 4 spheres with the slice per iteration, only the hits go on to the tile tests
+    const __m128 nearDepth = _mm_set1_ps(slice.nearDepth);
+    const __m128 farDepth = _mm_set1_ps(slice.farDepth);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 depth = _mm_loadu_ps(&_lightDepth[i]);
+        __m128 radius = _mm_loadu_ps(&_lightRadius[i]);
+
+        __m128 overlaps = _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(depth, radius), nearDepth), _mm_cmplt_ps(_mm_sub_ps(depth, radius), farDepth));
+        int mask = _mm_movemask_ps(overlaps);
+
+        for (int lane = 0; mask != 0 && lane < 4; ++lane)
+        {
+            if (mask & (1 << lane))
+            {
+                binLight(sliceIndex, static_cast<std::uint32_t>(i + lane));
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        if (_lightDepth[i] + _lightRadius[i] > slice.nearDepth && _lightDepth[i] - _lightRadius[i] < slice.farDepth)
+        {
+            binLight(sliceIndex, static_cast<std::uint32_t>(i));
+        }
+    }
+
+    // counting sort by cluster, lights stay in their original order within a cluster
+    std::size_t clustersPerSlice = static_cast<std::size_t>(_config.tilesX) * _config.tilesY;
+    bin.counts.assign(clustersPerSlice, 0);
+    for (const ClusterLight& pair : bin.pairs)
+    {
+        ++bin.counts[pair.cluster];
+    }
+
+    bin.offsets.resize(clustersPerSlice);
+    std::uint32_t offset = 0;
+    for (std::size_t cluster = 0; cluster < clustersPerSlice; ++cluster)
+    {
+        bin.offsets[cluster] = offset;
+        offset += bin.counts[cluster];
+    }
+
+    bin.indices.resize(bin.pairs.size());
+    for (const ClusterLight& pair : bin.pairs)
+    {
+        bin.indices[bin.offsets[pair.cluster]++] = pair.light;
+    }
+}
+
+void LightClusters::binLight(std::size_t sliceIndex, std::uint32_t light)
+{
+    const Slice& slice = _slices[sliceIndex];
+    SliceBin& bin = _bins[sliceIndex];
+
+    float depth = _lightDepth[light];
+    float radius = _lightRadius[light];
+
+    // sphere against the cluster boxes, the distance splits into independent x/y/z terms
+    float distanceZ = std::max({ slice.nearDepth - depth, depth - slice.farDepth, 0.0f });
+    float remaining = radius * radius - distanceZ * distanceZ;
+
+    squaredDistances(slice.tileMinX, slice.tileMaxX, _lightX[light], bin.distanceX);
+    squaredDistances(slice.tileMinY, slice.tileMaxY, _lightY[light], bin.distanceY);
+
+    for (int y = 0; y < _config.tilesY; ++y)
+    {
+        float rowRemaining = remaining - bin.distanceY[y];
+        if (rowRemaining < 0.0f)
+        {
+            continue;
+        }
+
+        std::uint32_t rowBase = static_cast<std::uint32_t>(y * _config.tilesX);
+
+#ifdef LIGHT_CLUSTERS_SSE2
+        const __m128 limit = _mm_set1_ps(rowRemaining);
+
+        // the lanes past tilesX are masked off rather than relying on the padding tiles being infinitely far away,
+        // a radius that isn't finite passes them too and they'd land in the next row (or past the last cluster)
+        for (std::size_t x = 0; x < bin.distanceX.size(); x += 4)
+        {
+            int mask = _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(&bin.distanceX[x]), limit));
+            if (x + 4 > static_cast<std::size_t>(_config.tilesX))
+            {
+                mask &= (1 << (_config.tilesX - static_cast<int>(x))) - 1;
+            }
+
+            for (int lane = 0; mask != 0 && lane < 4; ++lane)
+            {
+                if (mask & (1 << lane))
+                {
+                    bin.pairs.push_back({ rowBase + static_cast<std::uint32_t>(x + lane), light });
+                }
+            }
+        }
+#else
+        for (int x = 0; x < _config.tilesX; ++x)
+        {
+            if (bin.distanceX[x] <= rowRemaining)
+            {
+                bin.pairs.push_back({ rowBase + static_cast<std::uint32_t>(x), light });
+            }
+        }
+#endif
+    }
+}
+
+void LightClusters::writeSlice(std::size_t sliceIndex)
+{
+    const SliceBin& bin = _bins[sliceIndex];
+    std::copy(bin.indices.begin(), bin.indices.end(), _lightIndices.begin() + bin.base);
+
+    std::size_t clustersPerSlice = bin.counts.size();
+    std::size_t firstCluster = sliceIndex * clustersPerSlice;
+
+    std::uint32_t offset = static_cast<std::uint32_t>(bin.base);
+    for (std::size_t cluster = 0; cluster < clustersPerSlice; ++cluster)
+    {
+        _clusterRanges[(firstCluster + cluster) * 2] = offset;
+        _clusterRanges[(firstCluster + cluster) * 2 + 1] = bin.counts[cluster];
+        offset += bin.counts[cluster];
+    }
+}
+
+void LightClusters::forEachSlice(void (LightClusters::*step)(std::size_t))
+{
+    if (_pool)
+    {
+        _pool->parallelFor(_slices.size(), [this, step](std::size_t sliceIndex) { (this->*step)(sliceIndex); });
+        return;
+    }
+
+    for (std::size_t sliceIndex = 0; sliceIndex < _slices.size(); ++sliceIndex)
+    {
+        (this->*step)(sliceIndex);
+    }
+}
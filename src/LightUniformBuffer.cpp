@@ -0,0 +1,129 @@
+#include "LightUniformBuffer.hpp"
+
+#include <iostream>
+
+#include <glad/glad.h>
+
+LightUniformBuffer::LightUniformBuffer(std::size_t pointLightCount, unsigned int bindingPoint) :
+    _bindingPoint{ bindingPoint },
+    _block{ pointLightCount }
+{
+    const std::vector<unsigned char>& data = _block.getData();
+
+    _ubo = GlBuffer::create();
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(data.size()), data.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, _bindingPoint, _ubo);
+
+    // the whole block just went up, nothing is dirty anymore
+    _block.takeDirtyRanges(_dirtyRanges);
+}
+
+void LightUniformBuffer::setDirectionalLight(const DirectionalLight& light)
+{
+    _block.setDirectionalLight(light);
+}
+
+void LightUniformBuffer::setSpotLight(const SpotLight& light)
+{
+    _block.setSpotLight(light);
+}
+
+void LightUniformBuffer::setPointLight(std::size_t index, const PointLight& light)
+{
+    _block.setPointLight(index, light);
+}
+
+void LightUniformBuffer::upload()
+{
+    _lastUpload = {};
+
+    _block.takeDirtyRanges(_dirtyRanges);
+    if (_dirtyRanges.empty())
+    {
+        return;
+    }
+
+    const std::vector<unsigned char>& data = _block.getData();
+
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+    for (const LightBlock::Range& range : _dirtyRanges)
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(range.offset), static_cast<GLsizeiptr>(range.size), data.data() + range.offset);
+
+        ++_lastUpload.ranges;
+        _lastUpload.bytes += range.size;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+bool LightUniformBuffer::validateLayout(const Shader& shader) const
+{
+    unsigned int program = shader.getProgramId();
+    unsigned int blockIndex = glGetUniformBlockIndex(program, BlockName);
+    if (blockIndex == GL_INVALID_INDEX)
+    {
+        std::cout << "ERROR::UNIFORM_BLOCK::NOT_FOUND: " << BlockName << std::endl;
+        return false;
+    }
+
+    bool valid = true;
+
+    GLint blockSize = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+    if (static_cast<std::size_t>(blockSize) != _block.getData().size())
+    {
+        std::cout << "ERROR::UNIFORM_BLOCK::SIZE_MISMATCH: " << BlockName << " is " << blockSize << " bytes, expected " << _block.getData().size() << std::endl;
+        valid = false;
+    }
+
+    for (const LightBlock::Member& member : _block.getMembers())
+    {
+        valid &= checkOffset(shader, member.name, member.offset);
+    }
+
+    return valid;
+}
+
+unsigned int LightUniformBuffer::getBindingPoint() const
+{
+    return _bindingPoint;
+}
+
+std::size_t LightUniformBuffer::getPointLightCount() const
+{
+    return _block.getPointLightCount();
+}
+
+const LightUniformBuffer::UploadStats& LightUniformBuffer::getLastUploadStats() const
+{
+    return _lastUpload;
+}
+
+bool LightUniformBuffer::checkOffset(const Shader& shader, const std::string& name, std::size_t expected) const
+{
+    unsigned int program = shader.getProgramId();
+
+    const char* uniformName = name.c_str();
+    GLuint index = GL_INVALID_INDEX;
+    glGetUniformIndices(program, 1, &uniformName, &index);
+
+    // members the compiler optimized away have no offset to compare against
+    if (index == GL_INVALID_INDEX)
+    {
+        return true;
+    }
+
+    GLint offset = -1;
+    glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &offset);
+
+    if (static_cast<std::size_t>(offset) != expected)
+    {
+        std::cout << "ERROR::UNIFORM_BLOCK::OFFSET_MISMATCH: " << name << " is at " << offset << ", expected " << expected << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,149 @@
+#include "MappedFile.hpp"
+
+#include <atomic>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    _file = file;
+    _mapping = mapping;
+    _data = static_cast<const unsigned char*>(view);
+    _size = static_cast<std::size_t>(fileSize.QuadPart);
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr) { UnmapViewOfFile(_data); }
+    if (_mapping != nullptr) { CloseHandle(_mapping); }
+    if (_file != nullptr) { CloseHandle(_file); }
+
+    _data = nullptr;
+    _size = 0;
+    _mapping = nullptr;
+    _file = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // the whole file is consumed right away, start paging it in
+    madvise(view, static_cast<std::size_t>(info.st_size), MADV_WILLNEED);
+
+    _fd = fd;
+    _data = static_cast<const unsigned char*>(view);
+    _size = static_cast<std::size_t>(info.st_size);
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr) { munmap(const_cast<unsigned char*>(_data), _size); }
+    if (_fd != -1) { ::close(_fd); }
+
+    _data = nullptr;
+    _size = 0;
+    _fd = -1;
+}
+
+#endif
+
+bool MappedFile::isOpen() const
+{
+    return _data != nullptr;
+}
+
+const unsigned char* MappedFile::data() const
+{
+    return _data;
+}
+
+std::size_t MappedFile::size() const
+{
+    return _size;
+}
+
+std::string MappedFile::temporaryPath(const std::string& path)
+{
+#ifdef _WIN32
+    unsigned long processId = static_cast<unsigned long>(GetCurrentProcessId());
+#else
+    unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+
+    // the process id keeps other processes apart, the counter the threads of this one
+    static std::atomic<unsigned long> counter { 0 };
+    return path + "." + std::to_string(processId) + "." + std::to_string(counter++) + ".tmp";
+}
\ No newline at end of file
@@ -1,93 +1,308 @@
 #include "Mesh.hpp"
+#include "TextureCache.hpp"
 
 #include <string>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <utility>
 
 #include <glad/glad.h>
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures) :
-    _vertices{ vertices },
-    _indices{ indices },
-    _textures{ textures }
+namespace
 {
-    initialize();
+    struct SamplerSlot
+    {
+        const char* type;
+        unsigned int firstUnit;
+        unsigned int count;
+    };
+
+    // texture units per sampler type, together they fill RenderMaterial::MaxTextures
+    constexpr SamplerSlot SamplerSlots[] =
+    {
+        { "texture_diffuse", 0, 4 },
+        { "texture_specular", 4, 2 },
+        { "texture_normal", 6, 1 },
+        { "texture_height", 7, 1 },
+    };
 }
 
-void Mesh::render(const Shader& shader) const
+Mesh::Mesh(MeshData&& data, VertexLayout layout, bool keepGeometry) :
+    _vertices{ std::move(data.vertices) },
+    _indices{ std::move(data.indices) },
+    _vertexCount{ _vertices.size() },
+    _indexCount{ _indices.size() },
+    _lods{ std::move(data.lods) },
+    _textures{ std::move(data.textures) },
+    _layout{ layout }
 {
-    // bind appropriate textures
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int heightNr = 1;
+    if (_lods.empty())
+    {
+        _lods.push_back({ 0, static_cast<std::uint32_t>(_indexCount), 0.0f });
+    }
+
+    initialize(_vertices.data(), _indices.data());
+    initializeMaterial();
+
+    if (!keepGeometry)
+    {
+        dropCpuGeometry();
+    }
+}
+
+Mesh::Mesh(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices, std::size_t indexCount, const std::vector<Texture>& textures, VertexLayout layout,
+    const MeshLod* lods, std::size_t lodCount, bool keepGeometry) :
+    _vertexCount{ vertexCount },
+    _indexCount{ indexCount },
+    _lods(lods, lods + lodCount),
+    _textures{ textures },
+    _layout{ layout }
+{
+    if (_lods.empty())
+    {
+        _lods.push_back({ 0, static_cast<std::uint32_t>(indexCount), 0.0f });
+    }
 
-    for(unsigned int i = 0; i < _textures.size(); i++)
+    initialize(vertices, indices);
+    initializeMaterial();
+
+    if (keepGeometry)
     {
-        // active proper texture unit before binding
-        glActiveTexture(GL_TEXTURE0 + i);
+        _vertices.assign(vertices, vertices + vertexCount);
+        _indices.assign(indices, indices + indexCount);
+    }
+}
 
-        // retrieve texture number (the N in diffuse_textureN)
-        std::string number;
-        const std::string& name = _textures[i].type;
-        if (name == "texture_diffuse") { number = std::to_string(diffuseNr++); }
-        else if (name == "texture_specular") { number = std::to_string(specularNr++); }
-        else if (name == "texture_normal") { number = std::to_string(normalNr++); }
-        else if (name == "texture_height") { number = std::to_string(heightNr++); }
+Mesh::Mesh(const Vertex* vertices, std::size_t vertexCount, const std::uint16_t* indices, std::size_t indexCount, const std::vector<Texture>& textures, VertexLayout layout,
+    const MeshLod* lods, std::size_t lodCount, bool keepGeometry) :
+    _vertexCount{ vertexCount },
+    _indexCount{ indexCount },
+    _lods(lods, lods + lodCount),
+    _textures{ textures },
+    _layout{ layout }
+{
+    if (_lods.empty())
+    {
+        _lods.push_back({ 0, static_cast<std::uint32_t>(indexCount), 0.0f });
+    }
+
+    initialize(vertices, indices, GL_UNSIGNED_SHORT);
+    initializeMaterial();
 
-        // now set the sampler to the correct texture unit
-        glUniform1i(glGetUniformLocation(shader.getProgramId(), (name + number).c_str()), i);
-        glBindTexture(GL_TEXTURE_2D, _textures[i].id);
+    if (keepGeometry)
+    {
+        _vertices.assign(vertices, vertices + vertexCount);
+        _indices.assign(indices, indices + indexCount);
     }
+}
 
-    // draw mesh
-    glBindVertexArray(_vao);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(_indices.size()), GL_UNSIGNED_INT, 0);
+void Mesh::release()
+{
+    _geometry.reset();
+}
+
+const std::vector<Vertex>& Mesh::getVertices() const
+{
+    return _vertices;
+}
+
+const std::vector<unsigned int>& Mesh::getIndices() const
+{
+    return _indices;
+}
+
+bool Mesh::hasCpuGeometry() const
+{
+    return !_vertices.empty();
+}
+
+void Mesh::dropCpuGeometry()
+{
+    // swapped out rather than cleared, clear() would keep the capacity
+    std::vector<Vertex>().swap(_vertices);
+    std::vector<unsigned int>().swap(_indices);
+}
+
+void Mesh::render() const
+{
+    // bind appropriate textures
+    for (std::size_t unit = 0; unit < RenderMaterial::MaxTextures; ++unit)
+    {
+        if (_material.textures[unit] != 0)
+        {
+            glActiveTexture(GL_TEXTURE0 + static_cast<unsigned int>(unit));
+            glBindTexture(GL_TEXTURE_2D, TextureCache::shared().resolve(_material.textures[unit]));
+        }
+    }
+
+    // draw mesh, always at full resolution
+    GeometryRange range = getRange();
+    glBindVertexArray(range.vao);
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), range.indexType, reinterpret_cast<const void*>(range.indexOffset), range.baseVertex);
     glBindVertexArray(0);
 
     // always good practice to set everything back to defaults once configured.
     glActiveTexture(GL_TEXTURE0);
 }
 
-void Mesh::initialize()
+void Mesh::submit(RenderQueue& queue, const Shader& shader, RenderPass pass, float depth) const
+{
+    GeometryRange range = getRange();
+
+    DrawCommand command;
+    command.shader = &shader;
+    command.vao = range.vao;
+    command.indexType = range.indexType;
+    command.count = range.indexCount;
+    command.indexOffset = range.indexOffset;
+    command.baseVertex = range.baseVertex;
+
+    queue.submit(pass, command, _material, depth);
+}
+
+void Mesh::setSamplerUnits(const Shader& shader)
+{
+    for (const SamplerSlot& slot : SamplerSlots)
+    {
+        for (unsigned int i = 0; i < slot.count; ++i)
+        {
+            // the N in texture_diffuseN starts at 1
+            shader.setInt(std::string(slot.type) + std::to_string(i + 1), static_cast<int>(slot.firstUnit + i));
+        }
+    }
+}
+
+GeometryRange Mesh::getRange(std::size_t lod) const
 {
-    glGenVertexArrays(1, &_vao);
-    glGenBuffers(1, &_vbo);
-    glGenBuffers(1, &_ebo);
+    GeometryRange range = GeometryPool::shared().getRange(_geometry.get());
 
-    glBindVertexArray(_vao);
+    // the levels share the vertices, only the part of the index range differs
+    const MeshLod& level = _lods[std::min(lod, _lods.size() - 1)];
+    range.indexOffset += level.indexOffset * (range.indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t));
+    range.indexCount = level.indexCount;
+    return range;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-    glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(Vertex), _vertices.data(), GL_STATIC_DRAW);
+const std::vector<MeshLod>& Mesh::getLods() const
+{
+    return _lods;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(unsigned int), _indices.data(), GL_STATIC_DRAW);
+const RenderMaterial& Mesh::getMaterial() const
+{
+    return _material;
+}
+
+VertexLayout Mesh::getVertexLayout() const
+{
+    return _layout;
+}
+
+bool Mesh::isSkinned() const
+{
+    return _skinned;
+}
 
-    // positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+std::size_t Mesh::getGpuMemoryUsage() const
+{
+    return _gpuMemoryUsage;
+}
 
-    // normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+const BoundingBox& Mesh::getBounds() const
+{
+    return _bounds;
+}
 
-    // texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+void Mesh::initialize(const Vertex* vertices, const unsigned int* indices)
+{
+    // indices are relative to the mesh's base vertex, so short ones work inside the shared buffer too
+    if (!VertexFormat::fitsShortIndices(_vertexCount))
+    {
+        initialize(vertices, indices, GL_UNSIGNED_INT);
+        return;
+    }
 
-    // tangent
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+    std::vector<std::uint16_t> shortIndices(indices, indices + _indexCount);
+    initialize(vertices, shortIndices.data(), GL_UNSIGNED_SHORT);
+}
 
-    // bitangent
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+void Mesh::initialize(const Vertex* vertices, const void* indices, unsigned int indexType)
+{
+    _skinned = std::any_of(vertices, vertices + _vertexCount, VertexFormat::hasBones);
 
-    // ids
-    glEnableVertexAttribArray(5);
-    glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+    for (std::size_t i = 0; i < _vertexCount; ++i)
+    {
+        _bounds.expand(vertices[i].Position);
+    }
 
-    // weights
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+    // the full layout goes up as is, the compact ones are converted first
+    const void* vertexData = vertices;
+    const void* skinData = nullptr;
 
-    glBindVertexArray(0);
+    std::vector<CompactVertex> compactVertices;
+    std::vector<SkinVertex> skinVertices;
+    if (_layout != VertexLayout::Full)
+    {
+        initializeCompact(vertices, compactVertices, skinVertices);
+        vertexData = compactVertices.data();
+        skinData = _skinned ? skinVertices.data() : nullptr;
+    }
+
+    _indexType = indexType;
+
+    GeometryPool& pool = GeometryPool::shared();
+    _geometry = GeometryAllocation(pool.allocate(_layout, _skinned, vertexData, skinData, _vertexCount, indices, _indexCount, _indexType));
+    _gpuMemoryUsage = pool.getMemoryUsage(_geometry.get());
+}
+
+void Mesh::initializeMaterial()
+{
+    unsigned int used[std::size(SamplerSlots)] {};
+
+    for (const Texture& texture : _textures)
+    {
+        for (std::size_t slot = 0; slot < std::size(SamplerSlots); ++slot)
+        {
+            if (texture.type != SamplerSlots[slot].type)
+            {
+                continue;
+            }
+
+            // textures past the last unit of their type are never sampled by the shaders anyway
+            if (used[slot] < SamplerSlots[slot].count)
+            {
+                _material.textures[SamplerSlots[slot].firstUnit + used[slot]++] = texture.id;
+            }
+            break;
+        }
+    }
+}
+
+void Mesh::initializeCompact(const Vertex* vertices, std::vector<CompactVertex>& compactVertices, std::vector<SkinVertex>& skinVertices)
+{
+    // half-float uvs can't be swapped for unorm ones when the mesh tiles its textures
+    bool unormTexCoords = _layout == VertexLayout::CompactUnormUV && VertexFormat::texCoordsInUnitRange(vertices, _vertexCount);
+    if (_layout == VertexLayout::CompactUnormUV && !unormTexCoords)
+    {
+        _layout = VertexLayout::CompactHalfUV;
+    }
+
+    compactVertices.reserve(_vertexCount);
+    for (std::size_t i = 0; i < _vertexCount; ++i)
+    {
+        compactVertices.push_back(VertexFormat::toCompact(vertices[i], unormTexCoords));
+    }
+
+    if (!_skinned)
+    {
+        return;
+    }
+
+    // bone ids and weights go into a separate stream so static meshes don't pay for them
+    skinVertices.reserve(_vertexCount);
+    for (std::size_t i = 0; i < _vertexCount; ++i)
+    {
+        skinVertices.push_back(VertexFormat::toSkin(vertices[i]));
+    }
 }
\ No newline at end of file
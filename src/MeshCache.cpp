@@ -0,0 +1,411 @@
+#include "MeshCache.hpp"
+#include "FileHash.hpp"
+#include "Profiler.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr char Magic[4] = { 'M', 'S', 'H', 'C' };
+    constexpr std::size_t BlockAlignment = 16;
+
+    std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+    }
+
+    std::uint64_t nodeNamesSize(const std::vector<MeshNode>& nodes)
+    {
+        std::uint64_t size = 0;
+        for (const MeshNode& node : nodes)
+        {
+            size += sizeof(std::uint32_t) + node.name.size();
+        }
+
+        return size;
+    }
+
+    std::uint64_t textureBlockSize(const std::vector<Texture>& textures)
+    {
+        std::uint64_t size = 0;
+        for (const Texture& texture : textures)
+        {
+            size += sizeof(std::uint32_t) + texture.type.size() + sizeof(std::uint32_t) + texture.path.size();
+        }
+
+        return size;
+    }
+
+    // the type Mesh uploads the indices as, so a cached mesh goes to the GPU without converting them
+    std::uint32_t indexSize(std::size_t vertexCount)
+    {
+        return VertexFormat::fitsShortIndices(vertexCount) ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+    }
+
+    void writePadding(std::ofstream& stream, std::uint64_t position)
+    {
+        static const char zeros[BlockAlignment] = {};
+        stream.write(zeros, static_cast<std::streamsize>(alignUp(position) - position));
+    }
+
+    void writeString(std::ofstream& stream, const std::string& value)
+    {
+        std::uint32_t length = static_cast<std::uint32_t>(value.size());
+        stream.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    bool readString(const unsigned char*& cursor, const unsigned char* end, std::string& value)
+    {
+        std::uint32_t length = 0;
+        if (static_cast<std::size_t>(end - cursor) < sizeof(length)) { return false; }
+        std::memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+
+        if (static_cast<std::size_t>(end - cursor) < length) { return false; }
+        value.assign(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+
+        return true;
+    }
+}
+
+MeshCache::MeshCache(const std::string& sourcePath, unsigned int importFlags, std::uint32_t settingsHash) :
+    _sourcePath{ sourcePath },
+    _cachePath{ sourcePath + ".meshcache" },
+    _importFlags{ importFlags },
+    _settingsHash{ settingsHash }
+{
+}
+
+bool MeshCache::open()
+{
+    PROFILE_ZONE("Open mesh cache");
+
+    close();
+
+    if (!_file.open(_cachePath))
+    {
+        return false;
+    }
+
+    if (_file.size() < sizeof(Header))
+    {
+        close();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, _file.data(), sizeof(Header));
+
+    bool valid =
+        std::memcmp(header.magic, Magic, sizeof(Magic)) == 0 &&
+        header.version == Version &&
+        header.importFlags == _importFlags &&
+        header.settingsHash == _settingsHash &&
+        header.vertexSize == sizeof(Vertex) &&
+        header.sourceHash == FileHash::hashFile(_sourcePath);
+
+    std::size_t entriesEnd = sizeof(Header) + static_cast<std::size_t>(header.meshCount) * sizeof(Entry);
+    if (!valid || _file.size() < entriesEnd)
+    {
+        close();
+        return false;
+    }
+
+    _entries = reinterpret_cast<const Entry*>(_file.data() + sizeof(Header));
+    _meshCount = header.meshCount;
+
+    if (!validateEntries() || !readNodes(header))
+    {
+        std::cout << "ERROR::MESH_CACHE::CORRUPT: " << _cachePath << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::close()
+{
+    _file.close();
+    _entries = nullptr;
+    _meshCount = 0;
+    _nodes = nullptr;
+    _nodeCount = 0;
+    _nodeNames.clear();
+}
+
+std::size_t MeshCache::getMeshCount() const
+{
+    return _meshCount;
+}
+
+CachedMesh MeshCache::getMesh(std::size_t index) const
+{
+    const Entry& entry = _entries[index];
+
+    CachedMesh mesh;
+    mesh.vertices = reinterpret_cast<const Vertex*>(_file.data() + entry.vertexOffset);
+    mesh.vertexCount = entry.vertexCount;
+    mesh.indices = nullptr;
+    mesh.shortIndices = nullptr;
+    if (entry.indexSize == sizeof(std::uint16_t))
+    {
+        mesh.shortIndices = reinterpret_cast<const std::uint16_t*>(_file.data() + entry.indexOffset);
+    }
+    else
+    {
+        mesh.indices = reinterpret_cast<const unsigned int*>(_file.data() + entry.indexOffset);
+    }
+    mesh.indexCount = entry.indexCount;
+    mesh.lods = reinterpret_cast<const MeshLod*>(_file.data() + entry.lodOffset);
+    mesh.lodCount = entry.lodCount;
+
+    const unsigned char* cursor = _file.data() + entry.textureOffset;
+    const unsigned char* end = _file.data() + _file.size();
+
+    mesh.textures.resize(entry.textureCount);
+    for (TextureReference& texture : mesh.textures)
+    {
+        readString(cursor, end, texture.type);
+        readString(cursor, end, texture.path);
+    }
+
+    mesh.node = entry.node;
+
+    return mesh;
+}
+
+std::size_t MeshCache::getNodeCount() const
+{
+    return _nodeCount;
+}
+
+MeshNode MeshCache::getNode(std::size_t index) const
+{
+    const NodeEntry& entry = _nodes[index];
+
+    MeshNode node;
+    node.name = _nodeNames[index];
+    node.transform = glm::make_mat4(entry.transform);
+    node.parent = entry.parent;
+
+    return node;
+}
+
+bool MeshCache::write(const std::vector<MeshData>& meshes, const std::vector<MeshNode>& nodes) const
+{
+    PROFILE_ZONE("Write mesh cache");
+
+    Header header {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.sourceHash = FileHash::hashFile(_sourcePath);
+    header.importFlags = _importFlags;
+    header.vertexSize = sizeof(Vertex);
+    header.meshCount = static_cast<std::uint32_t>(meshes.size());
+    header.settingsHash = _settingsHash;
+    header.nodeCount = static_cast<std::uint32_t>(nodes.size());
+
+    // lay the blocks out first so the entry table can be written up front
+    std::vector<Entry> entries(meshes.size());
+    std::uint64_t position = alignUp(sizeof(Header) + meshes.size() * sizeof(Entry));
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        Entry& entry = entries[i];
+        entry.vertexCount = static_cast<std::uint32_t>(meshes[i].vertices.size());
+        entry.indexCount = static_cast<std::uint32_t>(meshes[i].indices.size());
+        entry.textureCount = static_cast<std::uint32_t>(meshes[i].textures.size());
+        entry.lodCount = static_cast<std::uint32_t>(meshes[i].lods.size());
+        entry.node = meshes[i].node;
+        entry.indexSize = indexSize(meshes[i].vertices.size());
+
+        entry.vertexOffset = position;
+        position = alignUp(position + meshes[i].vertices.size() * sizeof(Vertex));
+
+        entry.indexOffset = position;
+        position = alignUp(position + meshes[i].indices.size() * entry.indexSize);
+
+        entry.lodOffset = position;
+        position = alignUp(position + meshes[i].lods.size() * sizeof(MeshLod));
+
+        entry.textureOffset = position;
+        position = alignUp(position + textureBlockSize(meshes[i].textures));
+    }
+
+    // the hierarchy goes last, the names right behind its table
+    header.nodeOffset = position;
+
+    std::vector<NodeEntry> nodeEntries(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        std::memcpy(nodeEntries[i].transform, glm::value_ptr(nodes[i].transform), sizeof(nodeEntries[i].transform));
+        nodeEntries[i].parent = nodes[i].parent;
+    }
+
+    // written next to the final file under a name of its own and renamed, so neither a crash nor another writer
+    // of the same cache ever leaves a half written file behind
+    std::string temporaryPath = MappedFile::temporaryPath(_cachePath);
+    std::error_code error;
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            std::cout << "ERROR::MESH_CACHE::WRITE_FAILED: " << temporaryPath << std::endl;
+            return false;
+        }
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        stream.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+        writePadding(stream, sizeof(Header) + entries.size() * sizeof(Entry));
+
+        std::vector<std::uint16_t> shortIndices;
+        for (std::size_t i = 0; i < meshes.size(); ++i)
+        {
+            const MeshData& mesh = meshes[i];
+
+            stream.write(reinterpret_cast<const char*>(mesh.vertices.data()), static_cast<std::streamsize>(mesh.vertices.size() * sizeof(Vertex)));
+            writePadding(stream, entries[i].vertexOffset + mesh.vertices.size() * sizeof(Vertex));
+
+            // narrowed here once instead of on every load
+            if (entries[i].indexSize == sizeof(std::uint16_t))
+            {
+                shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+                stream.write(reinterpret_cast<const char*>(shortIndices.data()), static_cast<std::streamsize>(shortIndices.size() * sizeof(std::uint16_t)));
+            }
+            else
+            {
+                stream.write(reinterpret_cast<const char*>(mesh.indices.data()), static_cast<std::streamsize>(mesh.indices.size() * sizeof(unsigned int)));
+            }
+            writePadding(stream, entries[i].indexOffset + mesh.indices.size() * entries[i].indexSize);
+
+            stream.write(reinterpret_cast<const char*>(mesh.lods.data()), static_cast<std::streamsize>(mesh.lods.size() * sizeof(MeshLod)));
+            writePadding(stream, entries[i].lodOffset + mesh.lods.size() * sizeof(MeshLod));
+
+            for (const Texture& texture : mesh.textures)
+            {
+                writeString(stream, texture.type);
+                writeString(stream, texture.path);
+            }
+            writePadding(stream, entries[i].textureOffset + textureBlockSize(mesh.textures));
+        }
+
+        stream.write(reinterpret_cast<const char*>(nodeEntries.data()), static_cast<std::streamsize>(nodeEntries.size() * sizeof(NodeEntry)));
+        for (const MeshNode& node : nodes)
+        {
+            writeString(stream, node.name);
+        }
+        writePadding(stream, header.nodeOffset + nodeEntries.size() * sizeof(NodeEntry) + nodeNamesSize(nodes));
+
+        if (!stream)
+        {
+            std::cout << "ERROR::MESH_CACHE::WRITE_FAILED: " << temporaryPath << std::endl;
+            stream.close();
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, _cachePath, error);
+    if (error)
+    {
+        std::cout << "ERROR::MESH_CACHE::WRITE_FAILED: " << _cachePath << " " << error.message() << std::endl;
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+const std::string& MeshCache::getCachePath() const
+{
+    return _cachePath;
+}
+
+bool MeshCache::validateEntries() const
+{
+    const std::uint64_t fileSize = _file.size();
+
+    for (std::size_t i = 0; i < _meshCount; ++i)
+    {
+        const Entry& entry = _entries[i];
+
+        bool inBounds =
+            entry.indexSize == indexSize(entry.vertexCount) &&
+            entry.vertexOffset % BlockAlignment == 0 &&
+            entry.indexOffset % BlockAlignment == 0 &&
+            entry.lodOffset % BlockAlignment == 0 &&
+            entry.vertexOffset + static_cast<std::uint64_t>(entry.vertexCount) * sizeof(Vertex) <= fileSize &&
+            entry.indexOffset + static_cast<std::uint64_t>(entry.indexCount) * entry.indexSize <= fileSize &&
+            entry.lodOffset + static_cast<std::uint64_t>(entry.lodCount) * sizeof(MeshLod) <= fileSize &&
+            entry.textureOffset <= fileSize;
+
+        if (!inBounds)
+        {
+            return false;
+        }
+
+        // the levels are handed to the GPU as index ranges, one pointing past the indices would draw garbage
+        const MeshLod* lods = reinterpret_cast<const MeshLod*>(_file.data() + entry.lodOffset);
+        for (std::uint32_t level = 0; level < entry.lodCount; ++level)
+        {
+            if (static_cast<std::uint64_t>(lods[level].indexOffset) + lods[level].indexCount > entry.indexCount)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool MeshCache::readNodes(const Header& header)
+{
+    const std::uint64_t fileSize = _file.size();
+    const std::uint64_t tableEnd = header.nodeOffset + static_cast<std::uint64_t>(header.nodeCount) * sizeof(NodeEntry);
+
+    if (header.nodeOffset % BlockAlignment != 0 || tableEnd > fileSize)
+    {
+        return false;
+    }
+
+    _nodes = reinterpret_cast<const NodeEntry*>(_file.data() + header.nodeOffset);
+    _nodeCount = header.nodeCount;
+
+    // a parent after its child would be read before it exists
+    for (std::size_t i = 0; i < _nodeCount; ++i)
+    {
+        if (_nodes[i].parent != MeshNode::NoParent && _nodes[i].parent >= i)
+        {
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0; i < _meshCount; ++i)
+    {
+        if (_entries[i].node >= _nodeCount)
+        {
+            return false;
+        }
+    }
+
+    const unsigned char* cursor = _file.data() + tableEnd;
+    const unsigned char* end = _file.data() + fileSize;
+
+    _nodeNames.resize(_nodeCount);
+    for (std::string& name : _nodeNames)
+    {
+        if (!readString(cursor, end, name))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
\ No newline at end of file
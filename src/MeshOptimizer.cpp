@@ -0,0 +1,505 @@
+#include "MeshOptimizer.hpp"
+#include "BoundingBox.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    constexpr std::uint32_t NoVertex = std::numeric_limits<std::uint32_t>::max();
+    constexpr int OverdrawResolution = 256;
+
+    // FIFO cache simulated with insertion timestamps: a vertex is cached while fewer than cacheSize
+    // vertices went in after it. bumping the timestamp by cacheSize + 1 empties the whole cache
+    struct CacheSimulation
+    {
+        std::vector<std::uint32_t> insertedAt;
+        std::uint32_t timestamp;
+        std::uint32_t cacheSize;
+
+        CacheSimulation(std::size_t vertexCount, std::uint32_t size) :
+            insertedAt(vertexCount, 0),
+            timestamp{ size + 1 },
+            cacheSize{ size }
+        {
+        }
+
+        bool isCached(std::uint32_t vertex) const
+        {
+            return timestamp - insertedAt[vertex] <= cacheSize;
+        }
+
+        std::uint32_t transform(const unsigned int* triangle)
+        {
+            std::uint32_t misses = 0;
+            for (int i = 0; i < 3; ++i)
+            {
+                if (!isCached(triangle[i]))
+                {
+                    insertedAt[triangle[i]] = timestamp++;
+                    misses++;
+                }
+            }
+
+            return misses;
+        }
+
+        void flush()
+        {
+            timestamp += cacheSize + 1;
+        }
+    };
+
+    std::uint32_t fnv1a(std::uint32_t hash, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            hash = (hash ^ ((value >> (i * 8)) & 0xFFu)) * 16777619u;
+        }
+
+        return hash;
+    }
+}
+
+float VertexCacheStats::getAcmr() const
+{
+    return triangles > 0 ? static_cast<float>(transforms) / triangles : 0.0f;
+}
+
+float VertexCacheStats::getAtvr() const
+{
+    return vertices > 0 ? static_cast<float>(transforms) / vertices : 0.0f;
+}
+
+void VertexCacheStats::add(const VertexCacheStats& other)
+{
+    triangles += other.triangles;
+    transforms += other.transforms;
+    vertices += other.vertices;
+}
+
+float OverdrawStats::getOverdraw() const
+{
+    return covered > 0 ? static_cast<float>(shaded) / covered : 0.0f;
+}
+
+std::uint32_t MeshOptimizeSettings::hash() const
+{
+    std::uint32_t threshold = 0;
+    std::memcpy(&threshold, &overdrawThreshold, sizeof(float));
+
+    std::uint32_t flags = (vertexCache ? 1u : 0u) | (overdraw ? 2u : 0u) | (vertexFetch ? 4u : 0u);
+
+    return fnv1a(fnv1a(fnv1a(2166136261u, flags), cacheSize), threshold);
+}
+
+void MeshOptimizeStats::add(const MeshOptimizeStats& other)
+{
+    before.add(other.before);
+    after.add(other.after);
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const unsigned int* indices, std::size_t indexCount, std::size_t vertexCount, std::uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangles = indexCount / 3;
+
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+
+    for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        stats.transforms += cache.transform(indices + i);
+
+        for (std::size_t j = i; j < i + 3; ++j)
+        {
+            if (!referenced[indices[j]])
+            {
+                referenced[indices[j]] = true;
+                stats.vertices++;
+            }
+        }
+    }
+
+    return stats;
+}
+
+OverdrawStats MeshOptimizer::analyzeOverdraw(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices, std::size_t indexCount)
+{
+    OverdrawStats stats;
+
+    BoundingBox bounds;
+    for (std::size_t i = 0; i < vertexCount; ++i)
+    {
+        bounds.expand(vertices[i].Position);
+    }
+
+    glm::vec3 size = bounds.max - bounds.min;
+    float extent = std::max(size.x, std::max(size.y, size.z));
+    if (!bounds.isValid() || extent <= 0.0f)
+    {
+        return stats;
+    }
+
+    const float scale = OverdrawResolution / extent;
+    std::vector<float> depth(OverdrawResolution * OverdrawResolution);
+
+    // orthographic views down each axis from both sides, u/v/depth form a right handed frame
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        int uAxis = (axis + 1) % 3;
+        int vAxis = (axis + 2) % 3;
+
+        for (float side : { 1.0f, -1.0f })
+        {
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+
+            for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+            {
+                glm::vec3 p[3];
+                for (int j = 0; j < 3; ++j)
+                {
+                    const glm::vec3& position = vertices[indices[i + j]].Position;
+                    p[j] = glm::vec3((position[uAxis] - bounds.min[uAxis]) * scale, (position[vAxis] - bounds.min[vAxis]) * scale, -side * position[axis]);
+                }
+
+                // counter clockwise seen from the viewer is front facing, back faces are culled like on the GPU
+                float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+                if (area * side <= 0.0f)
+                {
+                    continue;
+                }
+
+                int minX = std::max(0, static_cast<int>(std::min(p[0].x, std::min(p[1].x, p[2].x))));
+                int minY = std::max(0, static_cast<int>(std::min(p[0].y, std::min(p[1].y, p[2].y))));
+                int maxX = std::min(OverdrawResolution - 1, static_cast<int>(std::max(p[0].x, std::max(p[1].x, p[2].x))));
+                int maxY = std::min(OverdrawResolution - 1, static_cast<int>(std::max(p[0].y, std::max(p[1].y, p[2].y))));
+
+                for (int y = minY; y <= maxY; ++y)
+                {
+                    for (int x = minX; x <= maxX; ++x)
+                    {
+                        float px = x + 0.5f;
+                        float py = y + 0.5f;
+
+                        // barycentric weights, all positive inside whichever way the triangle winds
+                        float w0 = ((p[1].x - px) * (p[2].y - py) - (p[2].x - px) * (p[1].y - py)) / area;
+                        float w1 = ((p[2].x - px) * (p[0].y - py) - (p[0].x - px) * (p[2].y - py)) / area;
+                        float w2 = 1.0f - w0 - w1;
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                        {
+                            continue;
+                        }
+
+                        float z = w0 * p[0].z + w1 * p[1].z + w2 * p[2].z;
+                        float& stored = depth[y * OverdrawResolution + x];
+                        if (z < stored)
+                        {
+                            stored = z;
+                            stats.shaded++;
+                        }
+                    }
+                }
+            }
+
+            stats.covered += std::count_if(depth.begin(), depth.end(), [](float value) { return value != std::numeric_limits<float>::max(); });
+        }
+    }
+
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(unsigned int* indices, std::size_t indexCount, std::size_t vertexCount, std::uint32_t cacheSize)
+{
+    std::size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // vertex -> triangles using it, and how many of those are still to be emitted
+    std::vector<std::uint32_t> liveTriangles(vertexCount, 0);
+    for (std::size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        liveTriangles[indices[i]]++;
+    }
+
+    std::vector<std::uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (std::size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+    }
+
+    std::vector<std::uint32_t> adjacency(triangleCount * 3);
+    std::vector<std::uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (std::size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        adjacency[cursor[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+    }
+
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<std::uint32_t> deadEnd;
+    std::vector<std::uint32_t> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    deadEnd.reserve(triangleCount * 3);
+
+    std::size_t scan = 0;
+    std::uint32_t fan = indices[0];
+
+    while (fan != NoVertex)
+    {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (std::uint32_t k = adjacencyOffsets[fan]; k < adjacencyOffsets[fan + 1]; ++k)
+        {
+            std::uint32_t triangle = adjacency[k];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+
+            emitted[triangle] = true;
+            const unsigned int* corners = indices + triangle * 3;
+            cache.transform(corners);
+
+            for (int j = 0; j < 3; ++j)
+            {
+                result.push_back(corners[j]);
+                deadEnd.push_back(corners[j]);
+                candidates.push_back(corners[j]);
+                liveTriangles[corners[j]]--;
+            }
+        }
+
+        // next fan: the oldest vertex of this one that stays cached until all its remaining triangles are emitted
+        std::uint32_t next = NoVertex;
+        int bestPriority = -1;
+        for (std::uint32_t vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+            {
+                continue;
+            }
+
+            int priority = 0;
+            std::uint32_t age = cache.timestamp - cache.insertedAt[vertex];
+            if (age + 2 * liveTriangles[vertex] <= cacheSize)
+            {
+                priority = static_cast<int>(age);
+            }
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        // dead end: the most recently used vertex with triangles left, failing that the next one in index order
+        while (next == NoVertex && !deadEnd.empty())
+        {
+            std::uint32_t vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0)
+            {
+                next = vertex;
+            }
+        }
+
+        while (next == NoVertex && scan < vertexCount)
+        {
+            if (liveTriangles[scan] > 0)
+            {
+                next = static_cast<std::uint32_t>(scan);
+            }
+            ++scan;
+        }
+
+        fan = next;
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(const Vertex* vertices, std::size_t vertexCount, unsigned int* indices, std::size_t indexCount, std::uint32_t cacheSize, float threshold)
+{
+    std::size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    CacheSimulation cache(vertexCount, cacheSize);
+
+    // hard boundaries: where the cache order jumps, all three vertices of the triangle miss
+    std::vector<std::size_t> hardBoundaries;
+    for (std::size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        if (cache.transform(indices + triangle * 3) == 3 || triangle == 0)
+        {
+            hardBoundaries.push_back(triangle);
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+
+    // soft boundaries: cut a hard cluster again whenever the part since the last cut reached the cluster's
+    // own ACMR times the threshold, restarting the cache at each cut costs at most that much
+    std::vector<std::size_t> clusters;
+    for (std::size_t i = 0; i + 1 < hardBoundaries.size(); ++i)
+    {
+        std::size_t start = hardBoundaries[i];
+        std::size_t end = hardBoundaries[i + 1];
+
+        cache.flush();
+        std::uint32_t clusterMisses = 0;
+        for (std::size_t triangle = start; triangle < end; ++triangle)
+        {
+            clusterMisses += cache.transform(indices + triangle * 3);
+        }
+
+        float clusterThreshold = threshold * clusterMisses / (end - start);
+
+        cache.flush();
+        clusters.push_back(start);
+
+        std::uint32_t runningMisses = 0;
+        std::uint32_t runningTriangles = 0;
+        for (std::size_t triangle = start; triangle + 1 < end; ++triangle)
+        {
+            runningMisses += cache.transform(indices + triangle * 3);
+            runningTriangles++;
+
+            if (runningMisses <= runningTriangles * clusterThreshold)
+            {
+                clusters.push_back(triangle + 1);
+                cache.flush();
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // area weighted centroid of the whole mesh and of every cluster
+    auto accumulate = [&](std::size_t start, std::size_t end, glm::vec3& centroid, glm::vec3& normal)
+    {
+        centroid = glm::vec3(0.0f);
+        normal = glm::vec3(0.0f);
+        float area = 0.0f;
+
+        for (std::size_t triangle = start; triangle < end; ++triangle)
+        {
+            const glm::vec3& a = vertices[indices[triangle * 3 + 0]].Position;
+            const glm::vec3& b = vertices[indices[triangle * 3 + 1]].Position;
+            const glm::vec3& c = vertices[indices[triangle * 3 + 2]].Position;
+
+            glm::vec3 cross = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(cross);
+
+            centroid += (a + b + c) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        if (area > 0.0f)
+        {
+            centroid /= area;
+        }
+    };
+
+    glm::vec3 meshCentroid;
+    glm::vec3 meshNormal;
+    accumulate(0, triangleCount, meshCentroid, meshNormal);
+
+    std::size_t clusterCount = clusters.size() - 1;
+    std::vector<float> sortKeys(clusterCount);
+    for (std::size_t i = 0; i < clusterCount; ++i)
+    {
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        accumulate(clusters[i], clusters[i + 1], centroid, normal);
+
+        float length = glm::length(normal);
+        sortKeys[i] = length > 0.0f ? glm::dot(centroid - meshCentroid, normal / length) : 0.0f;
+    }
+
+    // the clusters facing out the most are likely in front of the rest, drawing them first lets early z reject the others
+    std::vector<std::size_t> order(clusterCount);
+    for (std::size_t i = 0; i < clusterCount; ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    for (std::size_t cluster : order)
+    {
+        result.insert(result.end(), indices + clusters[cluster] * 3, indices + clusters[cluster + 1] * 3);
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, unsigned int* indices, std::size_t indexCount)
+{
+    std::vector<std::uint32_t> remap(vertices.size(), NoVertex);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (std::size_t i = 0; i < indexCount; ++i)
+    {
+        std::uint32_t& target = remap[indices[i]];
+        if (target == NoVertex)
+        {
+            target = static_cast<std::uint32_t>(result.size());
+            result.push_back(vertices[indices[i]]);
+        }
+
+        indices[i] = target;
+    }
+
+    vertices.swap(result);
+}
+
+MeshOptimizeStats MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const std::vector<MeshLod>& lods, const MeshOptimizeSettings& settings)
+{
+    std::vector<MeshLod> levels = lods;
+    if (levels.empty())
+    {
+        levels.push_back({ 0, static_cast<std::uint32_t>(indices.size()), 0.0f });
+    }
+
+    MeshOptimizeStats stats;
+    stats.before = analyzeVertexCache(indices.data() + levels[0].indexOffset, levels[0].indexCount, vertices.size(), settings.cacheSize);
+
+    for (const MeshLod& level : levels)
+    {
+        unsigned int* levelIndices = indices.data() + level.indexOffset;
+
+        if (settings.vertexCache)
+        {
+            optimizeVertexCache(levelIndices, level.indexCount, vertices.size(), settings.cacheSize);
+        }
+
+        if (settings.overdraw)
+        {
+            optimizeOverdraw(vertices.data(), vertices.size(), levelIndices, level.indexCount, settings.cacheSize, settings.overdrawThreshold);
+        }
+    }
+
+    // last, it renumbers the vertices the passes above look up. coarser levels only use vertices of level 0,
+    // so the order of first use is the full resolution one
+    if (settings.vertexFetch)
+    {
+        optimizeVertexFetch(vertices, indices.data(), indices.size());
+    }
+
+    stats.after = analyzeVertexCache(indices.data() + levels[0].indexOffset, levels[0].indexCount, vertices.size(), settings.cacheSize);
+    return stats;
+}
\ No newline at end of file
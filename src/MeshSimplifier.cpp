@@ -0,0 +1,456 @@
+#include "MeshSimplifier.hpp"
+#include "BoundingBox.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+    constexpr std::uint32_t NoCollapse = std::numeric_limits<std::uint32_t>::max();
+
+    // symmetric 4x4 matrix of the summed plane equations, weighted by triangle area
+    struct Quadric
+    {
+        double a00, a01, a02, a03;
+        double a11, a12, a13;
+        double a22, a23;
+        double a33;
+        double weight;
+    };
+
+    void addPlane(Quadric& q, const glm::dvec3& normal, double distance, double weight)
+    {
+        q.a00 += weight * normal.x * normal.x;
+        q.a01 += weight * normal.x * normal.y;
+        q.a02 += weight * normal.x * normal.z;
+        q.a03 += weight * normal.x * distance;
+        q.a11 += weight * normal.y * normal.y;
+        q.a12 += weight * normal.y * normal.z;
+        q.a13 += weight * normal.y * distance;
+        q.a22 += weight * normal.z * normal.z;
+        q.a23 += weight * normal.z * distance;
+        q.a33 += weight * distance * distance;
+        q.weight += weight;
+    }
+
+    void addQuadric(Quadric& q, const Quadric& other)
+    {
+        q.a00 += other.a00; q.a01 += other.a01; q.a02 += other.a02; q.a03 += other.a03;
+        q.a11 += other.a11; q.a12 += other.a12; q.a13 += other.a13;
+        q.a22 += other.a22; q.a23 += other.a23;
+        q.a33 += other.a33;
+        q.weight += other.weight;
+    }
+
+    // area weighted mean distance of the point to the planes, in model units
+    double evaluateError(const Quadric& a, const Quadric& b, const glm::dvec3& p)
+    {
+        double weight = a.weight + b.weight;
+        if (weight <= 0.0)
+        {
+            return 0.0;
+        }
+
+        auto evaluate = [&p](const Quadric& q)
+        {
+            return q.a00 * p.x * p.x + 2.0 * q.a01 * p.x * p.y + 2.0 * q.a02 * p.x * p.z + 2.0 * q.a03 * p.x
+                + q.a11 * p.y * p.y + 2.0 * q.a12 * p.y * p.z + 2.0 * q.a13 * p.y
+                + q.a22 * p.z * p.z + 2.0 * q.a23 * p.z
+                + q.a33;
+        };
+
+        return std::sqrt(std::max(0.0, evaluate(a) + evaluate(b)) / weight);
+    }
+
+    struct PositionKey
+    {
+        std::uint32_t bits[3];
+
+        bool operator==(const PositionKey& other) const { return std::memcmp(bits, other.bits, sizeof(bits)) == 0; }
+    };
+
+    struct PositionHash
+    {
+        std::size_t operator()(const PositionKey& key) const
+        {
+            return (key.bits[0] * 73856093u) ^ (key.bits[1] * 19349663u) ^ (key.bits[2] * 83492791u);
+        }
+    };
+
+    struct Collapse
+    {
+        // position ids of both ends, target is the vertex that replaces from in the index buffer
+        std::uint32_t from;
+        std::uint32_t to;
+        std::uint32_t target;
+        double error;
+    };
+
+    std::uint64_t edgeKey(std::uint32_t a, std::uint32_t b)
+    {
+        return (static_cast<std::uint64_t>(a) << 32) | b;
+    }
+}
+
+std::uint32_t LodSettings::hash() const
+{
+    std::uint32_t bits[4] = { maxLevels, 0, 0, minTriangles };
+    std::memcpy(&bits[1], &reduction, sizeof(float));
+    std::memcpy(&bits[2], &maxError, sizeof(float));
+
+    // FNV-1a over the fields
+    std::uint32_t hash = 2166136261u;
+    for (std::uint32_t value : bits)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            hash = (hash ^ ((value >> (i * 8)) & 0xFFu)) * 16777619u;
+        }
+    }
+
+    return hash;
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices, std::size_t indexCount,
+    std::size_t targetIndexCount, float maxError, float& error)
+{
+    std::vector<unsigned int> result(indices, indices + indexCount);
+    error = 0.0f;
+
+    // vertices sharing a position (uv/normal seams) are one vertex as far as the topology goes.
+    // the id of a position is the first referenced vertex at it
+    std::vector<std::uint32_t> positionIds(vertexCount, NoCollapse);
+    std::vector<std::uint8_t> locked(vertexCount, 0);
+    {
+        std::unordered_map<PositionKey, std::uint32_t, PositionHash> positions;
+        positions.reserve(vertexCount);
+
+        for (unsigned int index : result)
+        {
+            if (positionIds[index] != NoCollapse)
+            {
+                continue;
+            }
+
+            PositionKey key;
+            std::memcpy(key.bits, &vertices[index].Position, sizeof(key.bits));
+
+            auto it = positions.emplace(key, index).first;
+            positionIds[index] = it->second;
+
+            // a second vertex at the same position makes it a seam
+            if (it->second != index)
+            {
+                locked[it->second] = 1;
+            }
+        }
+    }
+
+    // an edge without its opposite half lies on an open border
+    {
+        std::unordered_map<std::uint64_t, std::uint32_t> edges;
+        edges.reserve(result.size());
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                ++edges[edgeKey(positionIds[result[i + k]], positionIds[result[i + (k + 1) % 3]])];
+            }
+        }
+
+        for (const auto& edge : edges)
+        {
+            std::uint32_t a = static_cast<std::uint32_t>(edge.first >> 32);
+            std::uint32_t b = static_cast<std::uint32_t>(edge.first & 0xFFFFFFFFu);
+
+            auto opposite = edges.find(edgeKey(b, a));
+            if (edge.second != 1 || opposite == edges.end() || opposite->second != 1)
+            {
+                locked[a] = 1;
+                locked[b] = 1;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (std::size_t i = 0; i < result.size(); i += 3)
+    {
+        glm::dvec3 p0 = vertices[result[i]].Position;
+        glm::dvec3 p1 = vertices[result[i + 1]].Position;
+        glm::dvec3 p2 = vertices[result[i + 2]].Position;
+
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length <= 0.0)
+        {
+            continue;
+        }
+
+        normal /= length;
+        double distance = -glm::dot(normal, p0);
+        for (int k = 0; k < 3; ++k)
+        {
+            addPlane(quadrics[positionIds[result[i + k]]], normal, distance, length * 0.5);
+        }
+    }
+
+    std::vector<std::uint32_t> triangleOffsets;
+    std::vector<std::uint32_t> triangleLists;
+    std::vector<Collapse> collapses;
+    std::vector<std::uint32_t> collapseTargets(vertexCount, NoCollapse);
+    std::vector<std::uint8_t> touched(vertexCount, 0);
+
+    // passes of independent collapses, cheapest first. a collapse locks the one-ring of the collapsed vertex
+    // for the rest of the pass, so the flip checks of later collapses in the same pass see valid geometry
+    while (result.size() > targetIndexCount)
+    {
+        std::size_t triangleCount = result.size() / 3;
+
+        // triangles around every position, in compressed row form
+        triangleOffsets.assign(vertexCount + 1, 0);
+        for (unsigned int index : result)
+        {
+            ++triangleOffsets[positionIds[index] + 1];
+        }
+        for (std::size_t i = 0; i < vertexCount; ++i)
+        {
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        }
+
+        triangleLists.resize(result.size());
+        {
+            std::vector<std::uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (std::size_t i = 0; i < result.size(); ++i)
+            {
+                triangleLists[cursor[positionIds[result[i]]]++] = static_cast<std::uint32_t>(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v0 = result[i + k];
+                unsigned int v1 = result[i + (k + 1) % 3];
+                std::uint32_t a = positionIds[v0];
+                std::uint32_t b = positionIds[v1];
+
+                if (!locked[a])
+                {
+                    collapses.push_back({ a, b, v1, evaluateError(quadrics[a], quadrics[b], vertices[b].Position) });
+                }
+                if (!locked[b])
+                {
+                    collapses.push_back({ b, a, v0, evaluateError(quadrics[b], quadrics[a], vertices[a].Position) });
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        std::size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+        std::size_t trianglesRemoved = 0;
+        std::size_t collapsed = 0;
+
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.error > maxError || trianglesRemoved >= trianglesToRemove)
+            {
+                break;
+            }
+
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            // moving the vertex onto its neighbour must not flip (or squash) any triangle that survives
+            bool valid = true;
+            std::size_t removed = 0;
+            glm::vec3 targetPosition = vertices[collapse.to].Position;
+
+            for (std::uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && valid; ++t)
+            {
+                const unsigned int* triangle = &result[triangleLists[t] * 3];
+
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                bool degenerate = false;
+                for (int k = 0; k < 3; ++k)
+                {
+                    std::uint32_t position = positionIds[triangle[k]];
+                    degenerate = degenerate || position == collapse.to;
+                    before[k] = vertices[position].Position;
+                    after[k] = position == collapse.from ? targetPosition : before[k];
+                }
+
+                if (degenerate)
+                {
+                    ++removed;
+                    continue;
+                }
+
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+                valid = lengths > 0.0f && glm::dot(normalBefore, normalAfter) > 0.25f * lengths;
+            }
+
+            if (!valid)
+            {
+                continue;
+            }
+
+            collapseTargets[collapse.from] = collapse.target;
+            addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            error = std::max(error, static_cast<float>(collapse.error));
+
+            for (std::uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; ++t)
+            {
+                const unsigned int* triangle = &result[triangleLists[t] * 3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    touched[positionIds[triangle[k]]] = 1;
+                }
+            }
+
+            trianglesRemoved += removed;
+            ++collapsed;
+        }
+
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        // rewrite the indices and drop the triangles that collapsed into a line
+        std::size_t write = 0;
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int triangle[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                std::uint32_t position = positionIds[result[i + k]];
+                triangle[k] = collapseTargets[position] != NoCollapse ? collapseTargets[position] : result[i + k];
+            }
+
+            if (positionIds[triangle[0]] == positionIds[triangle[1]] || positionIds[triangle[1]] == positionIds[triangle[2]] || positionIds[triangle[0]] == positionIds[triangle[2]])
+            {
+                continue;
+            }
+
+            result[write++] = triangle[0];
+            result[write++] = triangle[1];
+            result[write++] = triangle[2];
+        }
+        result.resize(write);
+
+        for (std::size_t i = 0; i < vertexCount; ++i)
+        {
+            if (collapseTargets[i] != NoCollapse)
+            {
+                // the collapsed position is gone for good, nothing may pick it as a target again
+                locked[i] = 1;
+                collapseTargets[i] = NoCollapse;
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<MeshLod> MeshSimplifier::buildLodChain(const Vertex* vertices, std::size_t vertexCount, std::vector<unsigned int>& indices, const LodSettings& settings)
+{
+    std::vector<MeshLod> lods;
+    lods.push_back({ 0, static_cast<std::uint32_t>(indices.size()), 0.0f });
+
+    BoundingBox bounds;
+    for (unsigned int index : indices)
+    {
+        bounds.expand(vertices[index].Position);
+    }
+
+    if (!bounds.isValid())
+    {
+        return lods;
+    }
+
+    float errorBudget = settings.maxError * glm::length(bounds.max - bounds.min) * 0.5f;
+
+    // each level is simplified from the previous one, so their errors add up
+    std::vector<unsigned int> previous(indices);
+    float previousError = 0.0f;
+
+    for (std::uint32_t level = 1; level <= settings.maxLevels; ++level)
+    {
+        std::size_t triangles = previous.size() / 3;
+        if (triangles < settings.minTriangles)
+        {
+            break;
+        }
+
+        std::size_t target = static_cast<std::size_t>(triangles * settings.reduction) * 3;
+
+        float error = 0.0f;
+        std::vector<unsigned int> simplified = simplify(vertices, vertexCount, previous.data(), previous.size(), target, errorBudget - previousError, error);
+
+        // not worth a level (and the index memory) when it barely removes anything
+        if (simplified.empty() || simplified.size() > previous.size() * 9 / 10)
+        {
+            break;
+        }
+
+        previousError += error;
+        lods.push_back({ static_cast<std::uint32_t>(indices.size()), static_cast<std::uint32_t>(simplified.size()), previousError });
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        previous = std::move(simplified);
+    }
+
+    return lods;
+}
+
+float MeshSimplifier::getProjectionScale(float fovY, float viewportHeight)
+{
+    return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+}
+
+std::size_t MeshSimplifier::selectLod(const MeshLod* lods, std::size_t lodCount, std::size_t current, float distance, float projectionScale, const LodSelection& selection)
+{
+    if (lodCount == 0)
+    {
+        return 0;
+    }
+
+    if (selection.forcedLevel >= 0)
+    {
+        return std::min(static_cast<std::size_t>(selection.forcedLevel), lodCount - 1);
+    }
+
+    if (projectionScale <= 0.0f)
+    {
+        return 0;
+    }
+
+    // error in pixels of a level at this distance
+    float pixelsPerUnit = projectionScale / std::max(distance, 1e-4f);
+    auto projected = [&](std::size_t level) { return lods[level].error * pixelsPerUnit; };
+
+    std::size_t level = std::min(current, lodCount - 1);
+    while (level + 1 < lodCount && projected(level + 1) <= selection.pixelError * (1.0f - selection.hysteresis))
+    {
+        ++level;
+    }
+    while (level > 0 && projected(level) > selection.pixelError * (1.0f + selection.hysteresis))
+    {
+        --level;
+    }
+
+    return level;
+}
\ No newline at end of file
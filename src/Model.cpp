@@ -1,66 +1,428 @@
 #include "Model.hpp"
 
+#include <algorithm>
 #include <filesystem>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <utility>
 
-unsigned int TextureFromFile(const char *path, const std::string &directory)
+#include <glm/gtc/type_ptr.hpp>
+
+#include "ThreadPool.hpp"
+#include "TextureCache.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+    // picking a level and adding the range takes ~15 ns a mesh, below this many the tasks cost more than waking the pool
+    constexpr std::size_t ParallelMeshCount = 4096;
+
+    // batches differ a lot in size, a few per thread so one big batch doesn't leave the others idle
+    constexpr std::size_t BatchTasksPerThread = 4;
+}
+
+unsigned int TextureFromFile(const char *path, const std::string &directory, TextureUsage usage)
 {
     std::filesystem::path filename = std::filesystem::path(directory) / std::filesystem::path(path);
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every other user of the image, streamed in the background if it's new. the id is valid immediately
+    return TextureCache::shared().acquire(filename.string(), usage);
+}
+
+TextureUsage usageFromTypeName(const std::string& typeName)
+{
+    if (typeName == "texture_specular") { return TextureUsage::Specular; }
+    if (typeName == "texture_normal") { return TextureUsage::Normal; }
+    return TextureUsage::Color;
+}
+
+Model::Model(const std::string& filePath, VertexLayout layout, const LodSettings& lodSettings, bool keepCpuGeometry) :
+    _lodSettings{ lodSettings },
+    _layout{ layout },
+    _keepCpuGeometry{ keepCpuGeometry }
+{
+    auto start = std::chrono::steady_clock::now();
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.string().c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    loadModel(filePath);
+
+    if (_rootNode == SceneGraph::InvalidNode)
     {
-        GLenum format = 0;
-        if (nrComponents == 1) { format = GL_RED; }
-        else if (nrComponents == 3) { format = GL_RGB; }
-        else if (nrComponents == 4) { format = GL_RGBA; }
+        buildNodes({});
+    }
+    _nodes.update();
+    updateBounds();
+
+    initializeBatches();
+    _meshLods.assign(_meshes.size(), 0);
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    _loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Model " << filePath << " loaded in " << _loadTimeMs << " ms (" << (_loadedFromCache ? "mesh cache" : "assimp import") << ")" << std::endl;
+}
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+Model::~Model()
+{
+    // the meshes give their pool ranges back themselves
+    for (const auto& loaded : _loadedTextures)
+    {
+        TextureCache::shared().release(loaded.second.id);
     }
-    else
+}
+
+void Model::render(const Shader& shader)
+{
+    update();
+
+    _visibleMeshes.resize(_meshes.size());
+    std::iota(_visibleMeshes.begin(), _visibleMeshes.end(), 0u);
+
+    Mesh::setSamplerUnits(shader);
+
+    fillBatches(_visibleMeshes, glm::vec3(0.0f), 0.0f);
+    renderBatches(shader);
+}
+
+void Model::render(const Shader& shader, const Frustum& frustum)
+{
+    update();
+
+    // culled meshes never get to bind anything
+    _cullStats = _meshBvh.cull(frustum, _visibleMeshes);
+
+    Mesh::setSamplerUnits(shader);
+
+    fillBatches(_visibleMeshes, glm::vec3(0.0f), 0.0f);
+    renderBatches(shader);
+}
+
+void Model::submit(RenderQueue& queue, const Shader& shader, RenderPass pass, const Frustum& frustum, const glm::vec3& viewPosition,
+    float projectionScale)
+{
+    update();
+
+    _cullStats = _meshBvh.cull(frustum, _visibleMeshes);
+
+    fillBatches(_visibleMeshes, viewPosition, projectionScale, queue.getThreadPool());
+
+    for (const DrawBatch& batch : _batches)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
+        if (batch.draws.empty())
+        {
+            continue;
+        }
+
+        DrawCommand command;
+        command.shader = &shader;
+        command.vao = batch.draws.vao;
+        command.indexType = batch.draws.indexType;
+        command.count = batch.indexCount;
+        command.batch = &batch.draws;
+        command.model = &_nodes.getWorldMatrix(batch.node);
+
+        queue.submit(pass, command, batch.material, batch.depth);
     }
+}
 
-    stbi_image_free(data);
+void Model::setTransform(const glm::mat4& transform)
+{
+    _nodes.setLocalMatrix(_rootNode, transform);
+}
 
-    return textureID;
+SceneGraph& Model::getSceneGraph()
+{
+    return _nodes;
 }
 
-Model::Model(const std::string& filePath)
+SceneNode Model::getRootNode() const
 {
-    loadModel(filePath);
+    return _rootNode;
 }
 
-void Model::render(const Shader& shader)
+void Model::update()
+{
+    // the bounds only change with their nodes, a model that stands still keeps its BVH
+    if (_nodes.update())
+    {
+        updateBounds();
+    }
+}
+
+const CullStats& Model::getCullStats() const
+{
+    return _cullStats;
+}
+
+void Model::setLodSelection(const LodSelection& selection)
+{
+    _lodSelection = selection;
+}
+
+const LodSelection& Model::getLodSelection() const
+{
+    return _lodSelection;
+}
+
+const LodStats& Model::getLodStats() const
+{
+    return _lodStats;
+}
+
+std::size_t Model::getGpuMemoryUsage() const
 {
+    std::size_t bytes = 0;
     for (const Mesh& mesh : _meshes)
     {
-        mesh.render(shader);
+        bytes += mesh.getGpuMemoryUsage();
+    }
+
+    return bytes;
+}
+
+double Model::getLoadTimeMs() const
+{
+    return _loadTimeMs;
+}
+
+bool Model::wasLoadedFromCache() const
+{
+    return _loadedFromCache;
+}
+
+const MeshOptimizeStats& Model::getOptimizeStats() const
+{
+    return _optimizeStats;
+}
+
+void Model::buildNodes(const std::vector<MeshNode>& nodes)
+{
+    _nodes.clear();
+    _nodes.reserve(nodes.size() + 1);
+    _rootNode = _nodes.createNode(SceneGraph::InvalidNode, "model");
+
+    // parents are stored first, so every parent already has its graph node
+    std::vector<SceneNode> graphNodes;
+    graphNodes.reserve(nodes.size());
+    for (const MeshNode& node : nodes)
+    {
+        SceneNode parent = node.parent == MeshNode::NoParent ? _rootNode : graphNodes[node.parent];
+        SceneNode graphNode = _nodes.createNode(parent, node.name);
+        _nodes.setLocalMatrix(graphNode, node.transform);
+        graphNodes.push_back(graphNode);
+    }
+
+    for (SceneNode& meshNode : _meshNodes)
+    {
+        meshNode = graphNodes[meshNode];
+    }
+}
+
+void Model::updateBounds()
+{
+    _meshBounds.resize(_meshes.size());
+    for (std::size_t i = 0; i < _meshes.size(); ++i)
+    {
+        _meshBounds[i] = _meshes[i].getBounds().transformed(_nodes.getWorldMatrix(_meshNodes[i]));
+    }
+
+    _meshBvh.build(_meshBounds);
+}
+
+void Model::initializeBatches()
+{
+    _batches.clear();
+    _meshBatches.clear();
+    _meshBatches.reserve(_meshes.size());
+
+    for (std::size_t i = 0; i < _meshes.size(); ++i)
+    {
+        const Mesh& mesh = _meshes[i];
+        GeometryRange range = mesh.getRange();
+
+        // few distinct materials per model, a linear search is fine at load time
+        auto it = std::find_if(_batches.begin(), _batches.end(), [&](const DrawBatch& batch)
+        {
+            return batch.node == _meshNodes[i] && batch.draws.vao == range.vao && batch.draws.indexType == range.indexType && batch.material == mesh.getMaterial();
+        });
+
+        if (it == _batches.end())
+        {
+            DrawBatch batch;
+            batch.node = _meshNodes[i];
+            batch.material = mesh.getMaterial();
+            batch.draws.vao = range.vao;
+            batch.draws.indexType = range.indexType;
+            it = _batches.insert(_batches.end(), batch);
+        }
+
+        _meshBatches.push_back(static_cast<std::uint32_t>(it - _batches.begin()));
+        it->meshes.push_back(static_cast<std::uint32_t>(i));
     }
+
+    _meshVisible.assign(_meshes.size(), 0);
+}
+
+void Model::fillBatches(const std::vector<std::uint32_t>& meshes, const glm::vec3& viewPosition, float projectionScale, ThreadPool* pool)
+{
+    PROFILE_ZONE("Model::fillBatches");
+
+    // marks instead of the list, every batch goes through its own meshes
+    std::fill(_meshVisible.begin(), _meshVisible.end(), 0);
+    for (std::uint32_t index : meshes)
+    {
+        _meshVisible[index] = 1;
+    }
+
+    std::size_t taskCount = 1;
+    if (pool && pool->getThreadCount() > 0 && meshes.size() >= ParallelMeshCount)
+    {
+        taskCount = std::min(_batches.size(), (pool->getThreadCount() + 1) * BatchTasksPerThread);
+    }
+
+    auto fill = [this, &viewPosition, projectionScale, taskCount](std::size_t task)
+    {
+        std::size_t begin = _batches.size() * task / taskCount;
+        std::size_t end = _batches.size() * (task + 1) / taskCount;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            fillBatch(_batches[i], viewPosition, projectionScale);
+        }
+    };
+
+    if (taskCount <= 1)
+    {
+        fill(0);
+    }
+    else
+    {
+        pool->parallelFor(taskCount, fill);
+    }
+
+    _lodStats.trianglesFull = 0;
+    _lodStats.trianglesDrawn = 0;
+    std::fill(_lodStats.meshesPerLevel.begin(), _lodStats.meshesPerLevel.end(), 0);
+
+    for (const DrawBatch& batch : _batches)
+    {
+        _lodStats.trianglesFull += batch.lodStats.trianglesFull;
+        _lodStats.trianglesDrawn += batch.lodStats.trianglesDrawn;
+
+        if (_lodStats.meshesPerLevel.size() < batch.lodStats.meshesPerLevel.size())
+        {
+            _lodStats.meshesPerLevel.resize(batch.lodStats.meshesPerLevel.size(), 0);
+        }
+        for (std::size_t level = 0; level < batch.lodStats.meshesPerLevel.size(); ++level)
+        {
+            _lodStats.meshesPerLevel[level] += batch.lodStats.meshesPerLevel[level];
+        }
+    }
+}
+
+void Model::fillBatch(DrawBatch& batch, const glm::vec3& viewPosition, float projectionScale)
+{
+    batch.draws.clear();
+    batch.indexCount = 0;
+    batch.depth = std::numeric_limits<float>::max();
+
+    LodStats& stats = batch.lodStats;
+    stats.trianglesFull = 0;
+    stats.trianglesDrawn = 0;
+    std::fill(stats.meshesPerLevel.begin(), stats.meshesPerLevel.end(), 0);
+
+    // ranges are looked up every frame since the pool may have moved them while compacting
+    for (std::uint32_t index : batch.meshes)
+    {
+        if (!_meshVisible[index])
+        {
+            continue;
+        }
+
+        const Mesh& mesh = _meshes[index];
+
+        const BoundingBox& bounds = _meshBounds[index];
+        float centerDistance = glm::length(bounds.getCenter() - viewPosition);
+
+        // distance to the nearest point of the bounding sphere, so a large mesh isn't coarsened while the camera is inside it
+        float distance = std::max(centerDistance - glm::length(bounds.max - bounds.min) * 0.5f, 0.0f);
+
+        const std::vector<MeshLod>& lods = mesh.getLods();
+        std::size_t lod = MeshSimplifier::selectLod(lods.data(), lods.size(), _meshLods[index], distance, projectionScale, _lodSelection);
+        _meshLods[index] = static_cast<std::uint8_t>(lod);
+
+        GeometryRange range = mesh.getRange(lod);
+        batch.draws.add(range);
+        batch.indexCount += range.indexCount;
+        batch.depth = std::min(batch.depth, centerDistance);
+
+        if (stats.meshesPerLevel.size() <= lod)
+        {
+            stats.meshesPerLevel.resize(lod + 1, 0);
+        }
+        stats.meshesPerLevel[lod]++;
+        stats.trianglesFull += lods[0].indexCount / 3;
+        stats.trianglesDrawn += range.indexCount / 3;
+    }
+}
+
+void Model::renderBatches(const Shader& shader) const
+{
+    GeometryPool& pool = GeometryPool::shared();
+
+    for (const DrawBatch& batch : _batches)
+    {
+        if (batch.draws.empty())
+        {
+            continue;
+        }
+
+        const glm::mat4& model = _nodes.getWorldMatrix(batch.node);
+        shader.setMat4("model", model);
+        shader.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+
+        for (std::size_t unit = 0; unit < RenderMaterial::MaxTextures; ++unit)
+        {
+            if (batch.material.textures[unit] != 0)
+            {
+                glActiveTexture(GL_TEXTURE0 + static_cast<unsigned int>(unit));
+                glBindTexture(GL_TEXTURE_2D, TextureCache::shared().resolve(batch.material.textures[unit]));
+            }
+        }
+
+        glBindVertexArray(batch.draws.vao);
+        pool.draw(batch.draws);
+    }
+
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
 }
 
 void Model::loadModel(const std::string& filePath)
 {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(
-        filePath,
+    const unsigned int importFlags =
         aiProcess_Triangulate |
         aiProcess_GenSmoothNormals |
         aiProcess_FlipUVs |
         aiProcess_JoinIdenticalVertices |
-        aiProcess_CalcTangentSpace
-    );
+        aiProcess_CalcTangentSpace;
+
+    // our own post-processing on top of assimp's, run per mesh after the LOD chain is built
+    MeshOptimizeSettings optimizeSettings;
+    optimizeSettings.vertexCache = true;
+    optimizeSettings.overdraw = true;
+    optimizeSettings.vertexFetch = true;
+
+    // retrieve the directory path of the filepath
+    _directory = std::filesystem::path(filePath).parent_path().string();
+
+    // both settings change what ends up in the buffers, so they're part of the cache key like the flags
+    MeshCache cache(filePath, importFlags, _lodSettings.hash() * 16777619u ^ optimizeSettings.hash());
+    if (loadFromCache(cache))
+    {
+        _loadedFromCache = true;
+        return;
+    }
+
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(filePath, importFlags);
 
     if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -68,32 +430,138 @@ void Model::loadModel(const std::string& filePath)
         return;
     }
 
-    // retrieve the directory path of the filepath
-    _directory = std::filesystem::path(filePath).parent_path().string();
+    // process ASSIMP's root node recursively, this gathers the meshes in a fixed order along with the node hierarchy
+    std::vector<const aiMesh*> sceneMeshes;
+    std::vector<std::uint32_t> meshNodes;
+    std::vector<MeshNode> nodes;
+    processNode(scene->mRootNode, MeshNode::NoParent, scene, sceneMeshes, meshNodes, nodes);
+
+    // stage 1: convert every aiMesh into vertex/index arrays on the worker threads
+    std::vector<MeshData> meshes = processMeshes(sceneMeshes, scene, optimizeSettings, _optimizeStats);
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        meshes[i].node = meshNodes[i];
+    }
+
+    std::cout << "Model " << filePath << " index buffers: ACMR " << _optimizeStats.before.getAcmr() << " -> " << _optimizeStats.after.getAcmr()
+        << ", ATVR " << _optimizeStats.before.getAtvr() << " -> " << _optimizeStats.after.getAtvr() << std::endl;
+
+    // stage 2: everything touching GL stays on this (the context) thread
+    for (MeshData& mesh : meshes)
+    {
+        for (Texture& texture : mesh.textures)
+        {
+            texture = loadTexture(texture.path, texture.type);
+        }
+    }
+
+    cache.write(meshes, nodes);
+
+    _meshNodes.assign(meshNodes.begin(), meshNodes.end());
+    buildNodes(nodes);
 
-    // process ASSIMP's root node recursively
-    processNode(scene->mRootNode, scene);
+    // every mesh takes its arrays over and frees them once uploaded, so the import never holds two copies
+    _meshes.reserve(meshes.size());
+    for (MeshData& mesh : meshes)
+    {
+        _meshes.emplace_back(std::move(mesh), _layout, _keepCpuGeometry);
+    }
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+bool Model::loadFromCache(MeshCache& cache)
 {
+    if (!cache.open())
+    {
+        return false;
+    }
+
+    _meshes.reserve(cache.getMeshCount());
+    _meshNodes.reserve(cache.getMeshCount());
+    for (std::size_t i = 0; i < cache.getMeshCount(); i++)
+    {
+        CachedMesh cached = cache.getMesh(i);
+        _meshNodes.push_back(cached.node);
+
+        std::vector<Texture> textures;
+        textures.reserve(cached.textures.size());
+        for (const TextureReference& reference : cached.textures)
+        {
+            textures.push_back(loadTexture(reference.path, reference.type));
+        }
+
+        // vertex and index data go from the mapping straight into glBufferData, the indices are already in their final type
+        if (cached.shortIndices != nullptr)
+        {
+            _meshes.emplace_back(cached.vertices, cached.vertexCount, cached.shortIndices, cached.indexCount, textures, _layout, cached.lods, cached.lodCount, _keepCpuGeometry);
+        }
+        else
+        {
+            _meshes.emplace_back(cached.vertices, cached.vertexCount, cached.indices, cached.indexCount, textures, _layout, cached.lods, cached.lodCount, _keepCpuGeometry);
+        }
+    }
+
+    std::vector<MeshNode> nodes;
+    nodes.reserve(cache.getNodeCount());
+    for (std::size_t i = 0; i < cache.getNodeCount(); i++)
+    {
+        nodes.push_back(cache.getNode(i));
+    }
+    buildNodes(nodes);
+
+    return true;
+}
+
+void Model::processNode(const aiNode* node, std::uint32_t parent, const aiScene* scene, std::vector<const aiMesh*>& meshes,
+    std::vector<std::uint32_t>& meshNodes, std::vector<MeshNode>& nodes)
+{
+    std::uint32_t index = static_cast<std::uint32_t>(nodes.size());
+
+    // aiMatrix4x4 is row major, glm wants columns
+    MeshNode meshNode;
+    meshNode.name = node->mName.C_Str();
+    meshNode.transform = glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+    meshNode.parent = parent;
+    nodes.push_back(meshNode);
+
     // process each mesh located at the current node
     for(unsigned int i = 0; i < node->mNumMeshes; i++)
     {
         // the node object only contains indices to index the actual objects in the scene.
         // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        _meshes.push_back(processMesh(mesh, scene));
+        meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+        meshNodes.push_back(index);
     }
 
     // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
     for(unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], index, scene, meshes, meshNodes, nodes);
+    }
+}
+
+std::vector<MeshData> Model::processMeshes(const std::vector<const aiMesh*>& meshes, const aiScene* scene, const MeshOptimizeSettings& optimizeSettings,
+    MeshOptimizeStats& optimizeStats) const
+{
+    // one task per mesh, every task writes only its own slot so the output order matches the input
+    std::vector<MeshData> results(meshes.size());
+    std::vector<MeshOptimizeStats> stats(meshes.size());
+
+    ThreadPool::shared().parallelFor(meshes.size(), [&](std::size_t i)
+    {
+        PROFILE_ZONE("Process mesh");
+        results[i] = processMesh(meshes[i], scene, optimizeSettings, stats[i]);
+    });
+
+    optimizeStats = MeshOptimizeStats{};
+    for (const MeshOptimizeStats& meshStats : stats)
+    {
+        optimizeStats.add(meshStats);
     }
+
+    return results;
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+MeshData Model::processMesh(const aiMesh* mesh, const aiScene* scene, const MeshOptimizeSettings& optimizeSettings, MeshOptimizeStats& optimizeStats) const
 {
     std::vector<Vertex> vertices;
     vertices.reserve(mesh->mNumVertices);
@@ -145,6 +613,11 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
         vertices.push_back(vertex);
     }
 
+    if (mesh->HasBones())
+    {
+        processBones(mesh, vertices);
+    }
+
     // read faces
     for (unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
@@ -156,8 +629,8 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
         }
     }
 
-    // process materials
-    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    // process materials, only the references are collected here. the textures get loaded on the GL thread.
+    const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
     // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
     // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
@@ -167,55 +640,88 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     // normal: texture_normalN
 
     // 1. diffuse maps
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+    std::vector<Texture> diffuseMaps = getMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
     textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 
     // 2. specular maps
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+    std::vector<Texture> specularMaps = getMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
     textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 
     // 3. normal maps
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+    std::vector<Texture> normalMaps = getMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
     textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 
     // 4. height maps
-    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+    std::vector<Texture> heightMaps = getMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
     textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-    return Mesh(vertices, indices, textures);
+    // the simplified levels go after the full resolution triangles in the same index array
+    std::vector<MeshLod> lods = MeshSimplifier::buildLodChain(vertices.data(), vertices.size(), indices, _lodSettings);
+
+    // reorders triangles within each level and renumbers the vertices, the ranges in lods stay valid
+    optimizeStats = MeshOptimizer::optimize(vertices, indices, lods, optimizeSettings);
+
+    return MeshData{ std::move(vertices), std::move(indices), std::move(textures), std::move(lods) };
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material, aiTextureType type, std::string typeName)
+void Model::processBones(const aiMesh* mesh, std::vector<Vertex>& vertices) const
 {
-    std::vector<Texture> textures;
-
-    for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+    for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; boneIndex++)
     {
-        aiString str;
-        material->GetTexture(type, i, &str);
+        const aiBone* bone = mesh->mBones[boneIndex];
 
-        // check if texture was loaded before
-        bool skip = false;
-        for (unsigned int j = 0; j < _loadedTextures.size(); j++)
+        for (unsigned int i = 0; i < bone->mNumWeights; i++)
         {
-            if (std::strcmp(_loadedTextures[j].path.data(), str.C_Str()) == 0)
+            const aiVertexWeight& weight = bone->mWeights[i];
+            Vertex& vertex = vertices[weight.mVertexId];
+
+            // take a free slot, or replace the weakest influence if this one is stronger
+            int slot = 0;
+            for (int j = 1; j < MAX_BONE_INFLUENCE; j++)
             {
-                textures.push_back(_loadedTextures[j]);
-                skip = true;
-                break;
+                if (vertex.m_BoneIDs[slot] < 0) { break; }
+                if (vertex.m_BoneIDs[j] < 0 || vertex.m_Weights[j] < vertex.m_Weights[slot]) { slot = j; }
             }
-        }
 
-        if (!skip)
-        {
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), _directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            _loadedTextures.push_back(texture);
+            if (vertex.m_BoneIDs[slot] < 0 || vertex.m_Weights[slot] < weight.mWeight)
+            {
+                vertex.m_BoneIDs[slot] = static_cast<int>(boneIndex);
+                vertex.m_Weights[slot] = weight.mWeight;
+            }
         }
     }
+}
+
+std::vector<Texture> Model::getMaterialTextures(const aiMaterial* material, aiTextureType type, const std::string& typeName) const
+{
+    std::vector<Texture> textures;
+
+    for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+    {
+        aiString str;
+        material->GetTexture(type, i, &str);
+
+        textures.push_back(Texture{ 0, typeName, str.C_Str() });
+    }
 
     return textures;
+}
+
+Texture Model::loadTexture(const std::string& path, const std::string& typeName)
+{
+    // one cache reference per distinct path, the meshes sharing it reuse it from here
+    auto it = _loadedTextures.find(path);
+    if (it == _loadedTextures.end())
+    {
+        Texture texture;
+        texture.id = TextureFromFile(path.c_str(), _directory, usageFromTypeName(typeName));
+        texture.type = typeName;
+        texture.path = path;
+
+        it = _loadedTextures.emplace(path, texture).first;
+    }
+
+    Texture texture = it->second;
+    texture.type = typeName;
+    return texture;
 }
\ No newline at end of file
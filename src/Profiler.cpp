@@ -0,0 +1,330 @@
+#include "Profiler.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+namespace
+{
+    constexpr std::uint32_t UnnumberedThread = std::numeric_limits<std::uint32_t>::max();
+
+    struct ThreadState
+    {
+        std::uint32_t index { UnnumberedThread };
+        std::vector<std::pair<const char*, double>> stack;
+    };
+
+    // the GL thread is 0 through newFrame(), the others are numbered from 1 in the order their first zone is recorded.
+    // worker zones can finish before the GL thread ever touched the profiler, so nobody gets a number any earlier
+    std::atomic<std::uint32_t> nextThreadIndex { 1 };
+
+    ThreadState& getThreadState()
+    {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    // marks a GPU zone opened while no frame was running, its end is ignored as well
+    constexpr std::size_t NoZone = std::numeric_limits<std::size_t>::max();
+
+    // chrome trace thread id of the GPU track, far away from the CPU thread indices
+    constexpr std::uint32_t GpuTraceThread = 1000;
+
+    void writeEscaped(std::ostream& out, const char* text)
+    {
+        for (; *text != '\0'; ++text)
+        {
+            if (*text == '"' || *text == '\\') { out << '\\'; }
+            out << *text;
+        }
+    }
+}
+
+Profiler::Profiler() :
+    _epoch{ std::chrono::steady_clock::now() }
+{
+}
+
+Profiler& Profiler::shared()
+{
+    // never destroyed: pool workers open zones too, and the pool only joins them while the statics are torn down
+    static Profiler* profiler = new Profiler();
+    return *profiler;
+}
+
+void Profiler::newFrame()
+{
+    getThreadState().index = 0;
+
+    double time = now();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_running)
+        {
+            _current.frame.cpuMs = time - _current.frame.startMs;
+            _pending.push_back(std::move(_current));
+        }
+
+        _current = PendingFrame{};
+        _current.frame.index = _frameIndex++;
+        _current.frame.startMs = time;
+        _running = true;
+    }
+
+    resolvePending();
+
+    // both clocks read back to back, good enough to line the GPU zones up under the CPU ones
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    _current.gpuClockOffsetMs = now() - static_cast<double>(gpuTime) / 1000000.0;
+}
+
+void Profiler::beginCpuZone(const char* name)
+{
+    getThreadState().stack.emplace_back(name, now());
+}
+
+void Profiler::endCpuZone()
+{
+    ThreadState& state = getThreadState();
+    if (state.stack.empty())
+    {
+        return;
+    }
+
+    std::pair<const char*, double> zone = state.stack.back();
+    state.stack.pop_back();
+
+    double end = now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_running)
+    {
+        if (state.index == UnnumberedThread)
+        {
+            state.index = nextThreadIndex++;
+        }
+
+        _current.frame.cpuZones.push_back({ zone.first, state.index, static_cast<std::uint32_t>(state.stack.size()), zone.second, end - zone.second });
+    }
+}
+
+void Profiler::beginGpuZone(const char* name)
+{
+    if (!_running)
+    {
+        _gpuStack.push_back(NoZone);
+        return;
+    }
+
+    PendingGpuZone zone { name, static_cast<std::uint32_t>(_gpuStack.size()), acquireQuery(), acquireQuery() };
+    glQueryCounter(zone.startQuery, GL_TIMESTAMP);
+
+    _gpuStack.push_back(_current.gpuZones.size());
+    _current.gpuZones.push_back(zone);
+}
+
+void Profiler::endGpuZone()
+{
+    if (_gpuStack.empty())
+    {
+        return;
+    }
+
+    std::size_t index = _gpuStack.back();
+    _gpuStack.pop_back();
+
+    // the frame it was opened in is already closed (or there was none), its end query would never be issued
+    if (index == NoZone || index >= _current.gpuZones.size())
+    {
+        return;
+    }
+
+    glQueryCounter(_current.gpuZones[index].endQuery, GL_TIMESTAMP);
+    _current.lastQuery = _current.gpuZones[index].endQuery;
+}
+
+const std::deque<Profiler::Frame>& Profiler::getHistory() const
+{
+    return _history;
+}
+
+bool Profiler::exportChromeTrace(const std::string& filePath) const
+{
+    std::ofstream out(filePath);
+    if (!out)
+    {
+        std::cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN: " << filePath << std::endl;
+        return false;
+    }
+
+    out.setf(std::ios::fixed);
+    out.precision(3);
+
+    std::uint32_t threads = 0;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    auto writeZone = [&](const Zone& zone, std::uint32_t thread, const char* category)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"";
+        writeEscaped(out, zone.name);
+        out << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+            << ",\"ts\":" << zone.startMs * 1000.0 << ",\"dur\":" << zone.durationMs * 1000.0 << "}";
+        first = false;
+    };
+
+    for (const Frame& frame : _history)
+    {
+        for (const Zone& zone : frame.cpuZones)
+        {
+            writeZone(zone, zone.thread, "cpu");
+            threads = std::max(threads, zone.thread + 1);
+        }
+
+        for (const Zone& zone : frame.gpuZones)
+        {
+            writeZone(zone, GpuTraceThread, "gpu");
+        }
+    }
+
+    for (std::uint32_t thread = 0; thread < threads; ++thread)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+            << ",\"args\":{\"name\":\"" << (thread == 0 ? "GL thread" : "Worker ") << (thread == 0 ? "" : std::to_string(thread)) << "\"}}";
+        first = false;
+    }
+    out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GpuTraceThread << ",\"args\":{\"name\":\"GPU\"}}\n";
+
+    out << "]}\n";
+    return static_cast<bool>(out);
+}
+
+void Profiler::release()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (PendingFrame& pending : _pending)
+    {
+        drop(pending);
+    }
+    _pending.clear();
+    drop(_current);
+
+    if (!_freeQueries.empty())
+    {
+        glDeleteQueries(static_cast<GLsizei>(_freeQueries.size()), _freeQueries.data());
+        _freeQueries.clear();
+    }
+
+    _gpuStack.clear();
+    _running = false;
+}
+
+double Profiler::now() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _epoch).count();
+}
+
+unsigned int Profiler::acquireQuery()
+{
+    if (_freeQueries.empty())
+    {
+        _freeQueries.resize(64);
+        glGenQueries(static_cast<GLsizei>(_freeQueries.size()), _freeQueries.data());
+    }
+
+    unsigned int query = _freeQueries.back();
+    _freeQueries.pop_back();
+    return query;
+}
+
+void Profiler::resolvePending()
+{
+    while (!_pending.empty())
+    {
+        PendingFrame& pending = _pending.front();
+        if (isResolvable(pending))
+        {
+            resolve(pending);
+        }
+        else if (_pending.size() > MaxFrameLatency)
+        {
+            drop(pending);
+        }
+        else
+        {
+            break;
+        }
+
+        pushHistory(std::move(pending.frame));
+        _pending.pop_front();
+    }
+}
+
+bool Profiler::isResolvable(const PendingFrame& pending) const
+{
+    if (pending.gpuZones.empty())
+    {
+        return true;
+    }
+
+    // timestamps land in submission order, once the last one is there all of them are
+    GLint available = 0;
+    glGetQueryObjectiv(pending.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available != 0;
+}
+
+void Profiler::resolve(PendingFrame& pending)
+{
+    double first = std::numeric_limits<double>::max();
+    double last = std::numeric_limits<double>::lowest();
+
+    for (const PendingGpuZone& zone : pending.gpuZones)
+    {
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(zone.startQuery, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(zone.endQuery, GL_QUERY_RESULT, &end);
+
+        double startMs = static_cast<double>(start) / 1000000.0 + pending.gpuClockOffsetMs;
+        double durationMs = end > start ? static_cast<double>(end - start) / 1000000.0 : 0.0;
+        pending.frame.gpuZones.push_back({ zone.name, 0, zone.depth, startMs, durationMs });
+
+        first = std::min(first, startMs);
+        last = std::max(last, startMs + durationMs);
+
+        _freeQueries.push_back(zone.startQuery);
+        _freeQueries.push_back(zone.endQuery);
+    }
+
+    pending.frame.gpuMs = pending.gpuZones.empty() ? 0.0 : last - first;
+    pending.gpuZones.clear();
+}
+
+void Profiler::drop(PendingFrame& pending)
+{
+    // a query whose result never got read can simply be issued again
+    for (const PendingGpuZone& zone : pending.gpuZones)
+    {
+        _freeQueries.push_back(zone.startQuery);
+        _freeQueries.push_back(zone.endQuery);
+    }
+
+    pending.frame.gpuValid = pending.gpuZones.empty();
+    pending.gpuZones.clear();
+}
+
+void Profiler::pushHistory(Frame&& frame)
+{
+    _history.push_back(std::move(frame));
+    if (_history.size() > HistorySize)
+    {
+        _history.pop_front();
+    }
+}
\ No newline at end of file
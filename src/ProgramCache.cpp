@@ -0,0 +1,247 @@
+#include "ProgramCache.hpp"
+#include "FileHash.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <glad/glad.h>
+
+namespace
+{
+    constexpr char Magic[4] = { 'P', 'R', 'G', 'B' };
+    constexpr std::uint32_t Version = 1;
+    constexpr const char* CacheDirectory = "resources/shaders/cache";
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t format;
+        std::uint32_t size;
+    };
+
+    bool hasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+        for (GLint i = 0; i < count; ++i)
+        {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (extension && std::strcmp(extension, name) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::uint64_t hashString(const GLubyte* value, std::uint64_t seed)
+    {
+        // the terminator goes in as well, so "ab" + "c" and "a" + "bc" don't collide
+        const char* text = reinterpret_cast<const char*>(value);
+        return text ? FileHash::hashBytes(text, std::strlen(text) + 1, seed) : seed;
+    }
+}
+
+ProgramCache& ProgramCache::shared()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+bool ProgramCache::isSupported()
+{
+    queryCapabilities();
+    return _supported;
+}
+
+bool ProgramCache::isParallelCompileSupported()
+{
+    queryCapabilities();
+    return _parallelCompile;
+}
+
+void ProgramCache::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+bool ProgramCache::isEnabled() const
+{
+    return _enabled;
+}
+
+std::uint64_t ProgramCache::getKey(const std::string& vertexSource, const std::string& fragmentSource)
+{
+    queryCapabilities();
+
+    std::uint64_t key = FileHash::hashBytes(vertexSource.data(), vertexSource.size(), _driverHash);
+    return FileHash::hashBytes(fragmentSource.data(), fragmentSource.size(), key);
+}
+
+bool ProgramCache::load(unsigned int program, std::uint64_t key)
+{
+    if (!_enabled || !isSupported())
+    {
+        return false;
+    }
+
+    std::ifstream stream(getPath(key), std::ios::binary);
+    if (!stream)
+    {
+        return false;
+    }
+
+    Header header {};
+    stream.read(reinterpret_cast<char*>(&header), sizeof(Header));
+
+    bool valid =
+        stream &&
+        std::memcmp(header.magic, Magic, sizeof(Magic)) == 0 &&
+        header.version == Version &&
+        header.key == key;
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    std::vector<char> binary(header.size);
+    stream.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!stream)
+    {
+        return false;
+    }
+
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    // the driver may still refuse it (an update that kept the version string, a different GPU with the same driver)
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+bool ProgramCache::store(unsigned int program, std::uint64_t key)
+{
+    if (!_enabled || !isSupported())
+    {
+        return false;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return false;
+    }
+
+    std::vector<char> binary(static_cast<std::size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    Header header {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.key = key;
+    header.format = format;
+    header.size = static_cast<std::uint32_t>(binary.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(CacheDirectory, error);
+
+    // written next to the final file and renamed, like the mesh cache, so a crash never leaves half a binary behind
+    std::string path = getPath(key);
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        stream.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+
+        if (!stream)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED: " << temporaryPath << std::endl;
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED: " << path << " " << error.message() << std::endl;
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+void ProgramCache::addReport(const ProgramReport& report)
+{
+    _reports.push_back(report);
+}
+
+const std::vector<ProgramReport>& ProgramCache::getReports() const
+{
+    return _reports;
+}
+
+void ProgramCache::printReport() const
+{
+    double submitMs = 0.0;
+    double waitMs = 0.0;
+
+    std::cout << "Shader programs (" << (_parallelCompile ? "parallel compile" : "serial compile") << ", binary cache " << (_supported && _enabled ? "on" : "off") << "):" << std::endl;
+    for (const ProgramReport& report : _reports)
+    {
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-56s %-8s submit %7.2f ms  wait %7.2f ms  ready after %7.2f ms",
+            report.name.c_str(), report.fromCache ? "cached" : "compiled", report.submitMs, report.waitMs, report.totalMs);
+        std::cout << line << std::endl;
+
+        submitMs += report.submitMs;
+        waitMs += report.waitMs;
+    }
+
+    std::cout << "  " << _reports.size() << " programs, " << submitMs + waitMs << " ms on the GL thread" << std::endl;
+}
+
+void ProgramCache::queryCapabilities()
+{
+    if (_capabilitiesQueried)
+    {
+        return;
+    }
+
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    bool binarySupported = major > 4 || (major == 4 && minor >= 1) || hasExtension("GL_ARB_get_program_binary");
+    _supported = binarySupported && formats > 0;
+
+    _parallelCompile = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+
+    // a binary is only valid for the driver that produced it
+    _driverHash = hashString(glGetString(GL_VENDOR), Version);
+    _driverHash = hashString(glGetString(GL_RENDERER), _driverHash);
+    _driverHash = hashString(glGetString(GL_VERSION), _driverHash);
+
+    _capabilitiesQueried = true;
+}
+
+std::string ProgramCache::getPath(std::uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return std::string(CacheDirectory) + "/" + name;
+}
\ No newline at end of file
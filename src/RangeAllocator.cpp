@@ -0,0 +1,150 @@
+#include "RangeAllocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(std::size_t capacity) :
+    _capacity{ capacity }
+{
+    if (capacity > 0)
+    {
+        _free.emplace(0, capacity);
+    }
+}
+
+std::size_t RangeAllocator::allocate(std::size_t size, std::size_t alignment)
+{
+    if (size == 0)
+    {
+        return InvalidOffset;
+    }
+
+    auto best = _free.end();
+    std::size_t bestWaste = InvalidOffset;
+
+    for (auto it = _free.begin(); it != _free.end(); ++it)
+    {
+        std::size_t aligned = (it->first + alignment - 1) / alignment * alignment;
+        std::size_t padding = aligned - it->first;
+        if (it->second < padding + size)
+        {
+            continue;
+        }
+
+        std::size_t waste = it->second - size;
+        if (waste < bestWaste)
+        {
+            best = it;
+            bestWaste = waste;
+
+            if (waste == padding)
+            {
+                break;
+            }
+        }
+    }
+
+    if (best == _free.end())
+    {
+        return InvalidOffset;
+    }
+
+    std::size_t begin = best->first;
+    std::size_t end = best->first + best->second;
+    std::size_t offset = (begin + alignment - 1) / alignment * alignment;
+    _free.erase(best);
+
+    // the alignment padding and the tail stay free
+    if (offset > begin)
+    {
+        _free.emplace(begin, offset - begin);
+    }
+    if (offset + size < end)
+    {
+        _free.emplace(offset + size, end - offset - size);
+    }
+
+    _used += size;
+    return offset;
+}
+
+void RangeAllocator::free(std::size_t offset, std::size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    _used -= size;
+
+    auto next = _free.lower_bound(offset);
+
+    // merge with the range right after it
+    if (next != _free.end() && next->first == offset + size)
+    {
+        size += next->second;
+        next = _free.erase(next);
+    }
+
+    // and with the one right before it
+    if (next != _free.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+
+    _free.emplace_hint(next, offset, size);
+}
+
+void RangeAllocator::grow(std::size_t capacity)
+{
+    if (capacity <= _capacity)
+    {
+        return;
+    }
+
+    std::size_t added = capacity - _capacity;
+    if (!_free.empty())
+    {
+        auto last = std::prev(_free.end());
+        if (last->first + last->second == _capacity)
+        {
+            last->second += added;
+            _capacity = capacity;
+            return;
+        }
+    }
+
+    _free.emplace(_capacity, added);
+    _capacity = capacity;
+}
+
+std::size_t RangeAllocator::getCapacity() const
+{
+    return _capacity;
+}
+
+std::size_t RangeAllocator::getUsed() const
+{
+    return _used;
+}
+
+std::size_t RangeAllocator::getLargestFree() const
+{
+    std::size_t largest = 0;
+    for (const auto& range : _free)
+    {
+        largest = std::max(largest, range.second);
+    }
+
+    return largest;
+}
+
+std::size_t RangeAllocator::getFreeRangeCount() const
+{
+    return _free.size();
+}
\ No newline at end of file
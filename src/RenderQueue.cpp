@@ -0,0 +1,358 @@
+#include "RenderQueue.hpp"
+#include "ThreadPool.hpp"
+#include "TextureCache.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    constexpr int PassShift = 60;
+    constexpr int ProgramShift = 50;
+    constexpr int MaterialShift = 34;
+    constexpr int VaoShift = 20;
+
+    constexpr std::uint64_t ProgramMask = (1ull << 10) - 1;
+    constexpr std::uint64_t MaterialMask = (1ull << 16) - 1;
+    constexpr std::uint64_t VaoMask = (1ull << 14) - 1;
+    constexpr std::uint64_t DepthMask = (1ull << 20) - 1;
+
+    // what splitting a range costs on top of recording it: waking the pool and re-binding each partition's first state.
+    // the bench's render queue case (--queue-commands 1024) on one core, where the extra thread can't take any work,
+    // records 0.01-0.045 ms slower split than serially. a range is only split when recording it serially takes longer
+    constexpr double ParallelRecordMs = 0.05;
+
+    // 50-65 ns a command in the same runs. only a starting point, every record measures it again
+    constexpr double InitialRecordMsPerCommand = 0.00006;
+
+    // weight of the newest measurement, one slow frame shouldn't flip the path back and forth
+    constexpr double RecordCostSmoothing = 0.1;
+
+    // a partition re-binds its first draw's state, too small ones would mostly record binds
+    constexpr std::size_t MinCommandsPerBuffer = 64;
+
+    // a few partitions per thread so an expensive one (long multi-draw batches) doesn't leave the others idle
+    constexpr std::size_t BuffersPerThread = 2;
+
+    RenderPass getPass(std::uint64_t key)
+    {
+        return static_cast<RenderPass>(key >> PassShift);
+    }
+}
+
+RenderQueue::RenderQueue() :
+    _pool{ &ThreadPool::shared() },
+    _recordMsPerCommand{ InitialRecordMsPerCommand }
+{
+}
+
+void RenderQueue::submit(RenderPass pass, const DrawCommand& command, const RenderMaterial& material, float depth)
+{
+    // materials hold texture cache ids, a duplicate image draws (and sorts) as the texture it shares
+    RenderMaterial resolved = material;
+    const TextureCache& textures = TextureCache::shared();
+    for (unsigned int& texture : resolved.textures)
+    {
+        texture = textures.resolve(texture);
+    }
+
+    std::uint32_t materialId = getMaterialId(resolved);
+
+    _entries.push_back({ makeKey(pass, command.shader->getProgramId(), materialId, command.vao, depth), static_cast<std::uint32_t>(_commands.size()) });
+    _commands.push_back(command);
+    _commandMaterials.push_back(materialId);
+    _sorted = false;
+}
+
+void RenderQueue::sort()
+{
+    _stats = Stats{};
+    _stats.commands = _commands.size();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    radixSort(_entries, _scratch);
+    _stats.sortMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    _sorted = true;
+}
+
+void RenderQueue::execute(RenderPass pass)
+{
+    if (!_sorted)
+    {
+        sort();
+    }
+
+    // the pass sits in the top bits, its commands form one contiguous run
+    std::size_t begin = 0;
+    while (begin < _entries.size() && getPass(_entries[begin].key) < pass)
+    {
+        ++begin;
+    }
+
+    std::size_t end = begin;
+    while (end < _entries.size() && getPass(_entries[end].key) == pass)
+    {
+        ++end;
+    }
+
+    executeRange(begin, end);
+}
+
+void RenderQueue::execute()
+{
+    if (!_sorted)
+    {
+        sort();
+    }
+
+    executeRange(0, _entries.size());
+}
+
+std::size_t RenderQueue::record()
+{
+    if (!_sorted)
+    {
+        sort();
+    }
+
+    return recordRange(0, _entries.size());
+}
+
+const CommandBuffer& RenderQueue::getCommandBuffer(std::size_t index) const
+{
+    return _commandBuffers[index];
+}
+
+void RenderQueue::clear()
+{
+    _commands.clear();
+    _commandMaterials.clear();
+    _entries.clear();
+    _sorted = false;
+}
+
+std::size_t RenderQueue::size() const
+{
+    return _commands.size();
+}
+
+void RenderQueue::setThreadPool(ThreadPool* pool)
+{
+    _pool = pool;
+}
+
+ThreadPool* RenderQueue::getThreadPool() const
+{
+    return _pool;
+}
+
+const RenderQueue::Stats& RenderQueue::getStats() const
+{
+    return _stats;
+}
+
+std::uint64_t RenderQueue::makeKey(RenderPass pass, unsigned int program, std::uint32_t material, unsigned int vao, float depth)
+{
+    // GL names are handed out sequentially, their low bits are good enough to group by.
+    // a collision only costs a bind, never a wrong one
+    std::uint64_t key = static_cast<std::uint64_t>(pass) << PassShift;
+    key |= (program & ProgramMask) << ProgramShift;
+    key |= (material & MaterialMask) << MaterialShift;
+    key |= (vao & VaoMask) << VaoShift;
+
+    // the bits of a positive float sort like the float itself, the top 20 keep the exponent and 12 bits of mantissa
+    if (depth > 0.0f)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        key |= (bits >> 11) & DepthMask;
+    }
+
+    return key;
+}
+
+void RenderQueue::radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+    scratch.resize(entries.size());
+
+    // least significant byte first, each pass is stable so the earlier ones are kept
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::size_t counts[256] {};
+        for (const SortEntry& entry : entries)
+        {
+            ++counts[(entry.key >> shift) & 0xFF];
+        }
+
+        // most of the key (the depth of a single pass, high vao bits, ...) is the same for every command
+        if (counts[(entries.empty() ? 0 : entries[0].key >> shift) & 0xFF] == entries.size())
+        {
+            continue;
+        }
+
+        std::size_t offset = 0;
+        for (std::size_t& count : counts)
+        {
+            std::size_t bucket = count;
+            count = offset;
+            offset += bucket;
+        }
+
+        for (const SortEntry& entry : entries)
+        {
+            scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+
+        entries.swap(scratch);
+    }
+}
+
+std::size_t RenderQueue::MaterialHash::operator()(const RenderMaterial& material) const
+{
+    std::size_t hash = 0;
+    for (unsigned int texture : material.textures)
+    {
+        hash = hash * 31 + texture;
+    }
+
+    return hash;
+}
+
+std::uint32_t RenderQueue::getMaterialId(const RenderMaterial& material)
+{
+    auto it = _materialIds.find(material);
+    if (it != _materialIds.end())
+    {
+        return it->second;
+    }
+
+    std::uint32_t id = static_cast<std::uint32_t>(_materials.size());
+    _materials.push_back(material);
+    _materialIds.emplace(material, id);
+    return id;
+}
+
+void RenderQueue::executeRange(std::size_t begin, std::size_t end)
+{
+    std::size_t bufferCount = recordRange(begin, end);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // in submission order, the sort order is kept across partitions
+    for (std::size_t i = 0; i < bufferCount; ++i)
+    {
+        _commandBuffers[i].replay();
+    }
+
+    _stats.replayMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+std::size_t RenderQueue::recordRange(std::size_t begin, std::size_t end)
+{
+    if (begin == end)
+    {
+        return 0;
+    }
+
+    std::size_t count = end - begin;
+    std::size_t bufferCount = 1;
+    if (_pool && _pool->getThreadCount() > 0 && count >= 2 * MinCommandsPerBuffer && static_cast<double>(count) * _recordMsPerCommand >= ParallelRecordMs)
+    {
+        bufferCount = std::min((_pool->getThreadCount() + 1) * BuffersPerThread, count / MinCommandsPerBuffer);
+    }
+
+    if (_commandBuffers.size() < bufferCount)
+    {
+        _commandBuffers.resize(bufferCount);
+        _partitionMs.resize(bufferCount);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    auto record = [this, begin, count, bufferCount](std::size_t buffer)
+    {
+        PROFILE_ZONE("Record commands");
+
+        auto partitionStart = std::chrono::high_resolution_clock::now();
+        recordPartition(_commandBuffers[buffer], begin + count * buffer / bufferCount, begin + count * (buffer + 1) / bufferCount);
+        _partitionMs[buffer] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - partitionStart).count();
+    };
+
+    if (bufferCount == 1)
+    {
+        record(0);
+    }
+    else
+    {
+        // every partition only reads the queue and writes its own buffer
+        _pool->parallelFor(bufferCount, record);
+    }
+
+    _stats.recordMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    _stats.commandBuffers += bufferCount;
+
+    // the time spent in the partitions, not the wall time, so the estimate doesn't depend on how the range was split
+    double recordMs = 0.0;
+    for (std::size_t i = 0; i < bufferCount; ++i)
+    {
+        recordMs += _partitionMs[i];
+    }
+    _recordMsPerCommand += (recordMs / static_cast<double>(count) - _recordMsPerCommand) * RecordCostSmoothing;
+
+    for (std::size_t i = 0; i < bufferCount; ++i)
+    {
+        const CommandBuffer::Stats& stats = _commandBuffers[i].getStats();
+        _stats.drawCalls += stats.drawCalls;
+        _stats.programBinds += stats.programBinds;
+        _stats.textureBinds += stats.textureBinds;
+        _stats.vaoBinds += stats.vaoBinds;
+        _stats.programBindsSkipped += stats.programBindsSkipped;
+        _stats.textureBindsSkipped += stats.textureBindsSkipped;
+        _stats.vaoBindsSkipped += stats.vaoBindsSkipped;
+    }
+
+    return bufferCount;
+}
+
+void RenderQueue::recordPartition(CommandBuffer& buffer, std::size_t begin, std::size_t end) const
+{
+    buffer.clear();
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        std::uint32_t index = _entries[i].index;
+        const DrawCommand& command = _commands[index];
+        const RenderMaterial& material = _materials[_commandMaterials[index]];
+
+        buffer.bindProgram(*command.shader);
+
+        // a 0 leaves the unit alone
+        for (std::size_t unit = 0; unit < RenderMaterial::MaxTextures; ++unit)
+        {
+            if (material.textures[unit] != 0)
+            {
+                buffer.bindTexture(static_cast<unsigned int>(unit), material.textures[unit]);
+            }
+        }
+
+        buffer.bindVertexArray(command.vao);
+
+        if (command.model != nullptr)
+        {
+            buffer.setUniform("model", *command.model);
+            buffer.setUniform("normalMatrix", glm::transpose(glm::inverse(glm::mat3(*command.model))));
+        }
+
+        DrawParameters parameters;
+        parameters.indexType = command.indexType;
+        parameters.count = command.count;
+        parameters.instanceCount = command.instanceCount;
+        parameters.indexOffset = command.indexOffset;
+        parameters.baseVertex = command.baseVertex;
+        parameters.batch = command.batch;
+        buffer.draw(parameters);
+    }
+}
\ No newline at end of file
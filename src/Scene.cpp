@@ -0,0 +1,750 @@
+#include "Scene.hpp"
+#include "Vertex.hpp"
+#include "Frustum.hpp"
+#include "DirectionalLight.hpp"
+#include "SpotLight.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stb_image.h>
+
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+
+namespace
+{
+    const glm::vec3 CubePositions[] =
+    {
+        { 0.0f, -10.0f, 0.0f },
+        { 2.0f, -5.0f, -15.0f },
+        { -1.5f, -12.2f, -2.5f },
+        { -3.8f, -12.0f, -12.3f },
+        { 2.4f, -10.4f, -3.5f },
+        { -1.7f, -7.0f, -7.5f },
+        { 1.3f, -12.0f, -2.5f },
+        { 1.5f, -8.0f, -2.5f },
+        { 1.5f, -12.2f, -1.5f },
+        { -1.3f, -11.0f, -1.5f }
+    };
+
+    // small dynamic lights scattered around the cube field, they only exist to load the clustered and deferred paths
+    std::vector<PointLight> generateSceneLights(std::size_t count)
+    {
+        std::vector<PointLight> lights(count);
+
+        // fixed seed, every run (and every benchmark) sees the same lights
+        unsigned int state = 12345u;
+        auto random = [&state]()
+        {
+            state = state * 1664525u + 1013904223u;
+            return static_cast<float>(state >> 8) / 16777216.0f;
+        };
+
+        for (PointLight& light : lights)
+        {
+            light.position = glm::vec3(-8.0f + random() * 16.0f, -14.0f + random() * 11.0f, -18.0f + random() * 21.0f);
+            light.color = glm::vec3(random(), random(), random()) * 0.15f;
+            light.linear = 0.7f;
+            light.quadratic = 1.8f;
+        }
+
+        return lights;
+    }
+
+    // the generated cubes fill the same volume, a quarter the size of the placed ones
+    std::vector<glm::vec3> generateCubePositions(std::size_t count)
+    {
+        std::vector<glm::vec3> positions(count);
+
+        unsigned int state = 54321u;
+        auto random = [&state]()
+        {
+            state = state * 1664525u + 1013904223u;
+            return static_cast<float>(state >> 8) / 16777216.0f;
+        };
+
+        for (glm::vec3& position : positions)
+        {
+            position = glm::vec3(-8.0f + random() * 16.0f, -14.0f + random() * 11.0f, -18.0f + random() * 21.0f);
+        }
+
+        return positions;
+    }
+
+    constexpr float GeneratedCubeScale = 0.25f;
+
+    // culling and packing a cube takes ~40 ns (bench, --extra-cubes 20000), below this many cubes waking the pool costs more
+    // than the tasks save
+    constexpr std::size_t ParallelCubeCount = 2048;
+
+    // the subtrees aren't the same size, a few per thread keeps the threads busy until the end
+    constexpr std::size_t CullTasksPerThread = 4;
+
+    // after the material (0-3) and the cluster buffers (4-6)
+    constexpr unsigned int ShadowTextureUnit = 8;
+
+    void setMaterialUnits(const Shader& shader)
+    {
+        shader.use();
+        shader.setInt("material.diffuse", 0);
+        shader.setInt("material.specular", 1);
+        shader.setInt("material.emission", 2);
+        shader.setInt("material.normal", 3);
+        shader.setFloat("material.shininess", 64.0f);
+    }
+}
+
+Scene::Scene(int framebufferWidth, int framebufferHeight) :
+    _litShaders{ "resources/shaders/vert_lit_instanced.glsl", "resources/shaders/frag_lit.glsl", [this](Shader& shader) { setupLitShader(shader); } },
+    _unlitShader{ "resources/shaders/vert_unlit_instanced.glsl", "resources/shaders/frag_unlit.glsl" },
+    _pointLights
+    {
+        { { 0.7f, 0.2f, 2.0f }, { 0.1f, 0.1f, 0.1f } },
+        { { 2.3f, -3.3f, -4.0f }, { 0.1f, 0.1f, 0.1f } },
+        { { -4.0f, 2.0f, -12.0f }, { 0.1f, 0.1f, 0.1f } },
+        { { 0.0f, 0.0f, -3.0f }, { 0.3f, 0.1f, 0.1f } }
+    },
+    _cubeInstances{ std::size(CubePositions) },
+    _lightInstances{ _pointLights.size() },
+    _casterInstances{ std::size(CubePositions) },
+    _lightBuffer{ _pointLights.size(), 0 },
+    _shadowMaps{ _pointLights.size() },
+    _deferredRenderer{ framebufferWidth, framebufferHeight, _lightBuffer.getBindingPoint() }
+{
+    stbi_set_flip_vertically_on_load(true);
+
+    setMaterialUnits(_deferredRenderer.getGeometryShader());
+
+    _textureManager.load("resources/textures/container2.png", "diffuse");
+    _textureManager.load("resources/textures/container2_specular.png", "specular", TextureUsage::Specular);
+    _textureManager.load("resources/textures/matrix.jpg", "emission");
+
+    // the variant with every LightBlock member in use, the others can only have fewer active ones
+    ShaderDefines fullDefines;
+    fullDefines.set("POINT_LIGHTS_COUNT", static_cast<int>(_pointLights.size()));
+    fullDefines.set("HAS_SPOTLIGHT");
+    _lightBuffer.validateLayout(_litShaders.get(fullDefines));
+
+    _litShader = &_litShaders.get(getLitDefines());
+
+    createCubes();
+
+    createCubeNodes();
+    updateCubes(0.0f);
+
+    _cubeInstances.attach(_cubeVao, true);
+    _lightInstances.attach(_lightCubeVao, false);
+    _casterInstances.attach(_casterVao, false);
+
+    // the other programs were needed by the setup above, this one compiled alongside them in the meantime
+    _unlitShader.finish();
+
+    glEnable(GL_DEPTH_TEST);
+}
+
+void Scene::render(const Camera& camera, float aspectRatio, float time, unsigned int targetFramebuffer, int framebufferWidth, int framebufferHeight)
+{
+    PROFILE_ZONE("Scene::render");
+
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspectRatio, 0.1f, 100.0f);
+    glm::mat4 view = camera.GetViewMatrix();
+
+    // update light props
+    {
+        PROFILE_ZONE("Update lights");
+        updateLights(camera);
+        _lightBuffer.upload();
+
+        if (_settings.clusteredLighting || _settings.deferredShading)
+        {
+            updateSceneLights(time);
+        }
+    }
+
+    {
+        PROFILE_ZONE("Update scene graph");
+        updateCubes(time);
+    }
+
+    // the maps draw into their own framebuffer, the target is only bound and cleared after them
+    std::size_t shadowPasses = 0;
+    if (_settings.shadows && !_settings.deferredShading)
+    {
+        PROFILE_ZONE("Shadow maps");
+        PROFILE_GPU_ZONE("Shadow maps");
+        shadowPasses = updateShadows(camera, aspectRatio);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    std::size_t visibleCubeCount = 0;
+    {
+        PROFILE_ZONE("Cull cubes");
+        visibleCubeCount = cullCubes(projection * view);
+    }
+
+    if (_settings.deferredShading)
+    {
+        submitCubes(RenderPass::Geometry, _deferredRenderer.getGeometryShader(), visibleCubeCount, camera, projection, view, time);
+    }
+    else
+    {
+        if (_settings.clusteredLighting)
+        {
+            PROFILE_ZONE("Bin lights");
+            _lightClusters.setProjection(glm::radians(camera.Zoom), aspectRatio, 0.1f, 100.0f);
+            _lightClusters.bin(_sceneLights, view);
+            _clusterBuffer.upload(_lightClusters);
+        }
+
+        _litShader = &_litShaders.get(getLitDefines());
+
+        // units 0-3 belong to the material, only the clustered variant has the cluster samplers
+        if (_settings.clusteredLighting)
+        {
+            _litShader->use();
+            _clusterBuffer.bind(*_litShader, 4, framebufferWidth, framebufferHeight);
+        }
+
+        if (_settings.shadows)
+        {
+            _litShader->use();
+            _shadowMaps.bind(*_litShader, ShadowTextureUnit);
+        }
+
+        submitCubes(RenderPass::Opaque, *_litShader, visibleCubeCount, camera, projection, view, time);
+    }
+
+    submitPointLights(projection, view);
+
+    // render scene
+    {
+        PROFILE_ZONE("Sort render queue");
+        _renderQueue.setThreadPool(_settings.parallelRecording ? &ThreadPool::shared() : nullptr);
+        _renderQueue.sort();
+    }
+
+    if (_settings.deferredShading)
+    {
+        {
+            PROFILE_ZONE("Geometry pass");
+            PROFILE_GPU_ZONE("Geometry pass");
+            _deferredRenderer.beginGeometryPass(framebufferWidth, framebufferHeight);
+            _renderQueue.execute(RenderPass::Geometry);
+        }
+
+        PROFILE_ZONE("Lighting pass");
+        PROFILE_GPU_ZONE("Lighting pass");
+        _deferredRenderer.renderLighting(_sceneLights, projection, view, camera.Position, targetFramebuffer);
+    }
+    else
+    {
+        PROFILE_ZONE("Opaque pass");
+        PROFILE_GPU_ZONE("Opaque pass");
+        _renderQueue.execute(RenderPass::Opaque);
+    }
+
+    // forward on top of either path, the deferred one leaves the scene depth in the target framebuffer
+    {
+        PROFILE_ZONE("Unlit pass");
+        PROFILE_GPU_ZONE("Unlit pass");
+        _renderQueue.execute(RenderPass::Unlit);
+    }
+    _renderQueue.clear();
+
+    _drawCalls = _renderQueue.getStats().drawCalls + shadowPasses;
+    if (_settings.deferredShading)
+    {
+        _drawCalls += _deferredRenderer.getStats().drawCalls;
+    }
+}
+
+Scene::Settings& Scene::getSettings()
+{
+    return _settings;
+}
+
+std::vector<PointLight>& Scene::getPointLights()
+{
+    return _pointLights;
+}
+
+std::size_t Scene::getDrawCalls() const
+{
+    return _drawCalls;
+}
+
+const Shader& Scene::getLitShader() const
+{
+    return *_litShader;
+}
+
+const ShaderVariantCache& Scene::getLitShaders() const
+{
+    return _litShaders;
+}
+
+const LightUniformBuffer& Scene::getLightBuffer() const
+{
+    return _lightBuffer;
+}
+
+const LightClusters& Scene::getLightClusters() const
+{
+    return _lightClusters;
+}
+
+const DeferredRenderer& Scene::getDeferredRenderer() const
+{
+    return _deferredRenderer;
+}
+
+const RenderQueue& Scene::getRenderQueue() const
+{
+    return _renderQueue;
+}
+
+const CullStats& Scene::getCubeCullStats() const
+{
+    return _cubeCullStats;
+}
+
+const SceneGraph& Scene::getSceneGraph() const
+{
+    return _sceneGraph;
+}
+
+const ShadowMaps& Scene::getShadowMaps() const
+{
+    return _shadowMaps;
+}
+
+void Scene::createCubes()
+{
+    std::vector<Vertex> cubeVertices
+    {
+        // back face
+        { { -0.5f, -0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 0.0f, 0.0f } },
+        { {  0.5f, -0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 1.0f, 0.0f } },
+        { {  0.5f,  0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 1.0f, 1.0f } },
+        { {  0.5f,  0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 1.0f, 1.0f } },
+        { { -0.5f,  0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 0.0f, 1.0f } },
+        { { -0.5f, -0.5f, -0.5f }, { 0.0f,  0.0f, -1.0f }, { 0.0f, 0.0f } },
+
+        // front face
+        { { -0.5f, -0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 0.0f, 0.0f } },
+        { {  0.5f, -0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 1.0f, 0.0f } },
+        { {  0.5f,  0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 1.0f, 1.0f } },
+        { {  0.5f,  0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 1.0f, 1.0f } },
+        { { -0.5f,  0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 0.0f, 1.0f } },
+        { { -0.5f, -0.5f,  0.5f }, { 0.0f,  0.0f,  1.0f }, { 0.0f, 0.0f } },
+
+        // left face
+        { { -0.5f,  0.5f,  0.5f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
+        { { -0.5f,  0.5f, -0.5f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
+        { { -0.5f, -0.5f, -0.5f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
+        { { -0.5f, -0.5f, -0.5f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
+        { { -0.5f, -0.5f,  0.5f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
+        { { -0.5f,  0.5f,  0.5f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
+
+        // right face
+        { { 0.5f,  0.5f,  0.5f }, { 1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
+        { { 0.5f,  0.5f, -0.5f }, { 1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
+        { { 0.5f, -0.5f, -0.5f }, { 1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
+        { { 0.5f, -0.5f, -0.5f }, { 1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
+        { { 0.5f, -0.5f,  0.5f }, { 1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
+        { { 0.5f,  0.5f,  0.5f }, { 1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
+
+        // bottom face
+        { { -0.5f, -0.5f, -0.5f }, { 0.0f, -1.0f,  0.0f }, { 0.0f, 0.0f } },
+        { {  0.5f, -0.5f, -0.5f }, { 0.0f, -1.0f,  0.0f }, { 1.0f, 0.0f } },
+        { {  0.5f, -0.5f,  0.5f }, { 0.0f, -1.0f,  0.0f }, { 1.0f, 1.0f } },
+        { {  0.5f, -0.5f,  0.5f }, { 0.0f, -1.0f,  0.0f }, { 1.0f, 1.0f } },
+        { { -0.5f, -0.5f,  0.5f }, { 0.0f, -1.0f,  0.0f }, { 0.0f, 1.0f } },
+        { { -0.5f, -0.5f, -0.5f }, { 0.0f, -1.0f,  0.0f }, { 0.0f, 0.0f } },
+
+        // top face
+        { { -0.5f,  0.5f, -0.5f }, { 0.0f,  1.0f,  0.0f }, { 0.0f, 0.0f } },
+        { {  0.5f,  0.5f, -0.5f }, { 0.0f,  1.0f,  0.0f }, { 1.0f, 0.0f } },
+        { {  0.5f,  0.5f,  0.5f }, { 0.0f,  1.0f,  0.0f }, { 1.0f, 1.0f } },
+        { {  0.5f,  0.5f,  0.5f }, { 0.0f,  1.0f,  0.0f }, { 1.0f, 1.0f } },
+        { { -0.5f,  0.5f,  0.5f }, { 0.0f,  1.0f,  0.0f }, { 0.0f, 1.0f } },
+        { { -0.5f,  0.5f, -0.5f }, { 0.0f,  1.0f,  0.0f }, { 0.0f, 0.0f } }
+    };
+
+    _cubeVao = GlVertexArray::create();
+    _cubeVbo = GlBuffer::create();
+        glBindVertexArray(_cubeVao);
+        glBindBuffer(GL_ARRAY_BUFFER, _cubeVbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * cubeVertices.size(), cubeVertices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    _lightCubeVao = GlVertexArray::create();
+        glBindVertexArray(_lightCubeVao);
+        glBindBuffer(GL_ARRAY_BUFFER, _cubeVbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // positions only, the depth passes don't need anything else
+    _casterVao = GlVertexArray::create();
+        glBindVertexArray(_casterVao);
+        glBindBuffer(GL_ARRAY_BUFFER, _cubeVbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+ShaderDefines Scene::getLitDefines()
+{
+    ShaderDefines defines;
+
+    if (_settings.clusteredLighting)
+    {
+        defines.set("CLUSTERED_LIGHTING");
+    }
+    else
+    {
+        defines.set("POINT_LIGHTS_COUNT", static_cast<int>(_pointLights.size()));
+    }
+
+    if (_settings.spotLight)
+    {
+        defines.set("HAS_SPOTLIGHT");
+    }
+
+    if (_settings.perLightMaterialFetch)
+    {
+        defines.set("PER_LIGHT_MATERIAL_FETCH");
+    }
+
+    if (_settings.shadows)
+    {
+        defines.set("HAS_SHADOWS");
+    }
+
+    // the material features follow whatever textures the cubes actually have
+    if (_textureManager.get("specular") != 0)
+    {
+        defines.set("HAS_SPECULAR_MAP");
+    }
+
+    if (_textureManager.get("emission") != 0)
+    {
+        defines.set("HAS_EMISSION");
+    }
+
+    if (_textureManager.get("normal") != 0)
+    {
+        defines.set("HAS_NORMAL_MAP");
+    }
+
+    return defines;
+}
+
+void Scene::setupLitShader(Shader& shader)
+{
+    setMaterialUnits(shader);
+    shader.bindUniformBlock(LightUniformBuffer::BlockName, _lightBuffer.getBindingPoint());
+}
+
+void Scene::updateLights(const Camera& camera)
+{
+    _lightBuffer.setDirectionalLight(DirectionalLight{});
+
+    // unchanged lights are skipped by the buffer, only edited ones get re-uploaded
+    for (std::size_t i = 0; i < _pointLights.size(); ++i)
+    {
+        _lightBuffer.setPointLight(i, _pointLights[i]);
+    }
+
+    _spotLight = SpotLight{};
+    _spotLight.position = camera.Position;
+    _spotLight.direction = camera.Front;
+    _spotLight.cutOff = glm::cos(glm::radians(10.0f));
+    _spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+
+    // forward compiles a disabled spotlight out, the deferred directional pass has no variants and gets a black one
+    if (!_settings.spotLight)
+    {
+        _spotLight.diffuse = glm::vec3(0.0f);
+        _spotLight.specular = glm::vec3(0.0f);
+    }
+
+    _lightBuffer.setSpotLight(_spotLight);
+}
+
+// block lights first, then the generated ones circling around their start position
+void Scene::updateSceneLights(float time)
+{
+    if (_generatedLights.size() != static_cast<std::size_t>(_settings.extraLights))
+    {
+        _generatedLights = generateSceneLights(static_cast<std::size_t>(_settings.extraLights));
+    }
+
+    _sceneLights.assign(_pointLights.begin(), _pointLights.end());
+    _sceneLights.reserve(_pointLights.size() + _generatedLights.size());
+
+    for (std::size_t i = 0; i < _generatedLights.size(); ++i)
+    {
+        PointLight light = _generatedLights[i];
+        float phase = time + static_cast<float>(i) * 0.61f;
+        light.position += glm::vec3(glm::sin(phase), 0.0f, glm::cos(phase)) * 1.5f;
+        _sceneLights.push_back(light);
+    }
+}
+
+void Scene::createCubeNodes()
+{
+    std::vector<glm::vec3> generated = generateCubePositions(static_cast<std::size_t>(_settings.extraCubes));
+
+    // whatever the maps saw of the old cubes goes with them
+    const BoundingBox unitCube { glm::vec3(-0.5f), glm::vec3(0.5f) };
+    for (std::size_t i = 0; i < _casterInstances.size(); ++i)
+    {
+        _shadowMaps.invalidate(unitCube.transformed(_casterInstances.get(i).model));
+    }
+
+    _sceneGraph.clear();
+    _cubeNodes.clear();
+    _cubeNodes.reserve(std::size(CubePositions) + generated.size());
+
+    _cubeRoot = _sceneGraph.createNode(SceneGraph::InvalidNode, "cubes");
+    for (const glm::vec3& position : CubePositions)
+    {
+        SceneNode node = _sceneGraph.createNode(_cubeRoot, "cube");
+        _sceneGraph.setPosition(node, position);
+        _cubeNodes.push_back(node);
+    }
+
+    for (const glm::vec3& position : generated)
+    {
+        SceneNode node = _sceneGraph.createNode(_cubeRoot, "cube");
+        _sceneGraph.setPosition(node, position);
+        _sceneGraph.setScale(node, glm::vec3(GeneratedCubeScale));
+        _cubeNodes.push_back(node);
+    }
+
+    if (_cubeInstances.size() != _cubeNodes.size())
+    {
+        _cubeInstances.resize(_cubeNodes.size());
+        _casterInstances.resize(_cubeNodes.size());
+    }
+}
+
+void Scene::updateCubes(float time)
+{
+    if (_cubeNodes.size() != std::size(CubePositions) + static_cast<std::size_t>(_settings.extraCubes))
+    {
+        createCubeNodes();
+    }
+
+    if (_settings.animateCubes)
+    {
+        const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+        for (std::size_t i = 0; i < _cubeNodes.size(); ++i)
+        {
+            float angle = time * glm::radians(20.0f * static_cast<float>(i + 1));
+            _sceneGraph.setRotation(_cubeNodes[i], glm::angleAxis(angle, axis));
+        }
+    }
+
+    // a still scene recomputes nothing and keeps its BVH
+    if (!_sceneGraph.update())
+    {
+        return;
+    }
+
+    const BoundingBox unitCube { glm::vec3(-0.5f), glm::vec3(0.5f) };
+
+    std::vector<BoundingBox> cubeBounds;
+    cubeBounds.reserve(_cubeNodes.size());
+    for (std::size_t i = 0; i < _cubeNodes.size(); ++i)
+    {
+        const glm::mat4& world = _sceneGraph.getWorldMatrix(_cubeNodes[i]);
+        cubeBounds.push_back(unitCube.transformed(world));
+
+        // the maps that saw the cube where it was and the ones that see it now
+        const glm::mat4& previous = _casterInstances.get(i).model;
+        if (previous != world)
+        {
+            _shadowMaps.invalidate(unitCube.transformed(previous));
+            _shadowMaps.invalidate(cubeBounds.back());
+            _casterInstances.setTransform(i, world);
+        }
+    }
+    _casterInstances.upload();
+    _cubeBvh.build(cubeBounds);
+}
+
+std::size_t Scene::updateShadows(const Camera& camera, float aspectRatio)
+{
+    ShadowView view { camera.Position, camera.Front, camera.Up, glm::radians(camera.Zoom), aspectRatio, 0.1f };
+    _shadowMaps.setLights(DirectionalLight{}, _spotLight, _pointLights, view);
+
+    // every cube in one instanced draw per map, culling them per light volume isn't worth it for ten cubes
+    _shadowMaps.refresh(_settings.shadowRefreshBudget, [this](const Shader&)
+    {
+        glBindVertexArray(_casterVao);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(_casterInstances.size()));
+        glBindVertexArray(0);
+    });
+
+    return _shadowMaps.getStats().passes;
+}
+
+std::size_t Scene::cullCubes(const glm::mat4& viewProjection)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    const std::size_t cubeCount = _cubeNodes.size();
+
+    ThreadPool* pool = _settings.parallelRecording ? &ThreadPool::shared() : nullptr;
+    std::size_t taskCount = 1;
+    if (pool && pool->getThreadCount() > 0 && cubeCount >= ParallelCubeCount)
+    {
+        taskCount = (pool->getThreadCount() + 1) * CullTasksPerThread;
+    }
+
+    // a single task runs inline, the ten cubes of the shipped scene never wake the pool
+    auto run = [pool](std::size_t count, const std::function<void(std::size_t)>& task)
+    {
+        if (count > 1)
+        {
+            pool->parallelFor(count, task);
+        }
+        else if (count == 1)
+        {
+            task(0);
+        }
+    };
+
+    std::size_t partitionCount = taskCount;
+    if (_settings.frustumCulling)
+    {
+        _cubeBvh.split(taskCount, _cubeRoots);
+        partitionCount = _cubeRoots.size();
+    }
+    _cubePartitions.resize(partitionCount);
+
+    const Frustum frustum = Frustum::fromMatrix(viewProjection);
+
+    // every task reads the BVH and the scene graph and writes its own partition
+    run(partitionCount, [this, &frustum, cubeCount, partitionCount](std::size_t index)
+    {
+        PROFILE_ZONE("Cull cube partition");
+
+        CubePartition& partition = _cubePartitions[index];
+        partition.visible.clear();
+
+        if (_settings.frustumCulling)
+        {
+            partition.stats = _cubeBvh.cull(frustum, _cubeRoots[index], partition.visible);
+        }
+        else
+        {
+            for (std::size_t i = cubeCount * index / partitionCount; i < cubeCount * (index + 1) / partitionCount; ++i)
+            {
+                partition.visible.push_back(static_cast<std::uint32_t>(i));
+            }
+
+            partition.stats = {};
+            partition.stats.visible = partition.visible.size();
+        }
+    });
+
+    _cubeCullStats = {};
+    _cubeCullStats.objects = cubeCount;
+    for (CubePartition& partition : _cubePartitions)
+    {
+        partition.offset = _cubeCullStats.visible;
+        _cubeCullStats.visible += partition.stats.visible;
+        _cubeCullStats.nodesVisited += partition.stats.nodesVisited;
+        _cubeCullStats.boxesTested += partition.stats.boxesTested;
+    }
+    _cubeCullStats.cullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // each partition packs its cubes right behind the previous one's, unchanged slots are skipped by the buffer so a
+    // static camera uploads nothing
+    run(partitionCount, [this](std::size_t index)
+    {
+        PROFILE_ZONE("Pack cube instances");
+
+        const CubePartition& partition = _cubePartitions[index];
+        for (std::size_t i = 0; i < partition.visible.size(); ++i)
+        {
+            _cubeInstances.setTransform(partition.offset + i, _sceneGraph.getWorldMatrix(_cubeNodes[partition.visible[i]]));
+        }
+    });
+    _cubeInstances.upload();
+
+    return _cubeCullStats.visible;
+}
+
+// the visible cubes are one instanced draw, the per-frame uniforms go straight to the shader
+void Scene::submitCubes(RenderPass pass, Shader& shader, std::size_t instanceCount, const Camera& camera, const glm::mat4& projection, const glm::mat4& view, float time)
+{
+    shader.use();
+    shader.setFloat("time", time);
+    shader.setVec3("viewPos", camera.Position);
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+
+    if (instanceCount == 0)
+    {
+        return;
+    }
+
+    RenderMaterial material;
+    material.textures[0] = _textureManager.get("diffuse");
+    material.textures[1] = _textureManager.get("specular");
+    material.textures[2] = _textureManager.get("emission");
+    material.textures[3] = _textureManager.get("normal");
+
+    DrawCommand command;
+    command.shader = &shader;
+    command.vao = _cubeVao;
+    command.count = 36;
+    command.instanceCount = static_cast<std::uint32_t>(instanceCount);
+
+    _renderQueue.submit(pass, command, material);
+}
+
+void Scene::submitPointLights(const glm::mat4& projection, const glm::mat4& view)
+{
+    // only lights that were moved since the last frame get a new matrix uploaded
+    for (std::size_t i = 0; i < _pointLights.size() && i < _lightInstances.size(); ++i)
+    {
+        _lightInstances.setTransform(i, _pointLights[i].position, glm::vec3(0.2f));
+    }
+    _lightInstances.upload();
+
+    _unlitShader.use();
+    _unlitShader.setMat4("projection", projection);
+    _unlitShader.setMat4("view", view);
+
+    DrawCommand command;
+    command.shader = &_unlitShader;
+    command.vao = _lightCubeVao;
+    command.count = 36;
+    command.instanceCount = static_cast<std::uint32_t>(_lightInstances.size());
+
+    _renderQueue.submit(RenderPass::Unlit, command, RenderMaterial{});
+}
\ No newline at end of file
@@ -0,0 +1,388 @@
+#include "SceneGraph.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    // recomputing fewer nodes than this costs less than waking the pool
+    constexpr std::size_t ParallelNodeCount = 2048;
+
+    // a few subtrees per thread so one deep subtree doesn't leave the others idle
+    constexpr std::size_t TasksPerThread = 4;
+
+    // splitting recomputes nodes on the calling thread, a handful of levels is enough for any real hierarchy
+    constexpr int MaxSplitLevels = 4;
+
+    glm::vec3 normalizeColumn(const glm::vec4& column, float length, const glm::vec3& fallback)
+    {
+        return length > 0.0f ? glm::vec3(column) / length : fallback;
+    }
+}
+
+SceneGraph::SceneGraph() :
+    _taskStacks(1),
+    _taskUpdated(1),
+    _pool{ &ThreadPool::shared() }
+{
+}
+
+SceneNode SceneGraph::createNode(SceneNode parent, const std::string& name)
+{
+    SceneNode node = static_cast<SceneNode>(_parents.size());
+
+    _parents.push_back(parent);
+    _firstChildren.push_back(InvalidNode);
+    _nextSiblings.push_back(InvalidNode);
+    _subtreeSizes.push_back(1);
+
+    _positions.push_back(glm::vec3(0.0f));
+    _rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    _scales.push_back(glm::vec3(1.0f));
+    _worldMatrices.push_back(glm::mat4(1.0f));
+
+    _dirty.push_back(0);
+    _names.push_back(name);
+
+    // prepended, finding the last child would make building a wide level quadratic
+    if (parent != InvalidNode)
+    {
+        _nextSiblings[node] = _firstChildren[parent];
+        _firstChildren[parent] = node;
+    }
+
+    for (SceneNode ancestor = parent; ancestor != InvalidNode; ancestor = _parents[ancestor])
+    {
+        ++_subtreeSizes[ancestor];
+    }
+
+    // the world matrix still has to take the parent's in
+    markDirty(node);
+
+    return node;
+}
+
+void SceneGraph::reserve(std::size_t count)
+{
+    _parents.reserve(count);
+    _firstChildren.reserve(count);
+    _nextSiblings.reserve(count);
+    _subtreeSizes.reserve(count);
+    _positions.reserve(count);
+    _rotations.reserve(count);
+    _scales.reserve(count);
+    _worldMatrices.reserve(count);
+    _dirty.reserve(count);
+    _names.reserve(count);
+}
+
+void SceneGraph::clear()
+{
+    _parents.clear();
+    _firstChildren.clear();
+    _nextSiblings.clear();
+    _subtreeSizes.clear();
+    _positions.clear();
+    _rotations.clear();
+    _scales.clear();
+    _worldMatrices.clear();
+    _dirty.clear();
+    _names.clear();
+    _dirtyNodes.clear();
+    _updatedNodes.clear();
+    _stats = Stats{};
+}
+
+std::size_t SceneGraph::size() const
+{
+    return _parents.size();
+}
+
+void SceneGraph::setPosition(SceneNode node, const glm::vec3& position)
+{
+    _positions[node] = position;
+    markDirty(node);
+}
+
+void SceneGraph::setRotation(SceneNode node, const glm::quat& rotation)
+{
+    _rotations[node] = rotation;
+    markDirty(node);
+}
+
+void SceneGraph::setScale(SceneNode node, const glm::vec3& scale)
+{
+    _scales[node] = scale;
+    markDirty(node);
+}
+
+void SceneGraph::setLocalMatrix(SceneNode node, const glm::mat4& local)
+{
+    glm::vec3 scale(glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])));
+
+    glm::mat3 rotation(
+        normalizeColumn(local[0], scale.x, glm::vec3(1.0f, 0.0f, 0.0f)),
+        normalizeColumn(local[1], scale.y, glm::vec3(0.0f, 1.0f, 0.0f)),
+        normalizeColumn(local[2], scale.z, glm::vec3(0.0f, 0.0f, 1.0f)));
+
+    // a rotation can't mirror, a mirrored matrix keeps it in the scale instead
+    if (glm::determinant(rotation) < 0.0f)
+    {
+        scale.x = -scale.x;
+        rotation[0] = -rotation[0];
+    }
+
+    _positions[node] = glm::vec3(local[3]);
+    _rotations[node] = glm::normalize(glm::quat_cast(rotation));
+    _scales[node] = scale;
+    markDirty(node);
+}
+
+const glm::vec3& SceneGraph::getPosition(SceneNode node) const
+{
+    return _positions[node];
+}
+
+const glm::quat& SceneGraph::getRotation(SceneNode node) const
+{
+    return _rotations[node];
+}
+
+const glm::vec3& SceneGraph::getScale(SceneNode node) const
+{
+    return _scales[node];
+}
+
+const glm::mat4& SceneGraph::getWorldMatrix(SceneNode node) const
+{
+    return _worldMatrices[node];
+}
+
+SceneNode SceneGraph::getParent(SceneNode node) const
+{
+    return _parents[node];
+}
+
+SceneNode SceneGraph::getFirstChild(SceneNode node) const
+{
+    return _firstChildren[node];
+}
+
+SceneNode SceneGraph::getNextSibling(SceneNode node) const
+{
+    return _nextSiblings[node];
+}
+
+const std::string& SceneGraph::getName(SceneNode node) const
+{
+    return _names[node];
+}
+
+SceneNode SceneGraph::findNode(const std::string& name) const
+{
+    auto it = std::find(_names.begin(), _names.end(), name);
+    return it != _names.end() ? static_cast<SceneNode>(it - _names.begin()) : InvalidNode;
+}
+
+bool SceneGraph::update()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    _stats = Stats{};
+    _stats.nodes = _parents.size();
+    _updatedNodes.clear();
+
+    if (_dirtyNodes.empty())
+    {
+        return false;
+    }
+
+    _roots.clear();
+    std::size_t nodeCount = 0;
+    for (SceneNode node : _dirtyNodes)
+    {
+        if (!hasDirtyAncestor(node))
+        {
+            _roots.push_back(node);
+            nodeCount += _subtreeSizes[node];
+        }
+    }
+    _stats.dirtyRoots = _roots.size();
+
+    // the flags were only needed to find the roots
+    for (SceneNode node : _dirtyNodes)
+    {
+        _dirty[node] = 0;
+    }
+    _dirtyNodes.clear();
+
+    std::size_t taskCount = 1;
+    if (_pool && _pool->getThreadCount() > 0 && nodeCount >= ParallelNodeCount)
+    {
+        taskCount = (_pool->getThreadCount() + 1) * TasksPerThread;
+        splitRoots(taskCount);
+        taskCount = std::min(taskCount, _roots.size());
+    }
+
+    if (taskCount <= 1)
+    {
+        for (SceneNode root : _roots)
+        {
+            updateSubtree(root, _taskStacks[0], _updatedNodes);
+        }
+        taskCount = 1;
+    }
+    else
+    {
+        _taskStacks.resize(std::max(_taskStacks.size(), taskCount));
+        _taskUpdated.resize(std::max(_taskUpdated.size(), taskCount));
+        assignTasks(taskCount, nodeCount - _updatedNodes.size());
+
+        // no root is below another one, so every task writes a disjoint set of world matrices
+        _pool->parallelFor(taskCount, [this](std::size_t task)
+        {
+            _taskUpdated[task].clear();
+            for (std::size_t i = _taskBegins[task]; i < _taskBegins[task + 1]; ++i)
+            {
+                updateSubtree(_roots[i], _taskStacks[task], _taskUpdated[task]);
+            }
+        });
+
+        for (std::size_t task = 0; task < taskCount; ++task)
+        {
+            _updatedNodes.insert(_updatedNodes.end(), _taskUpdated[task].begin(), _taskUpdated[task].end());
+        }
+    }
+
+    _stats.nodesUpdated = _updatedNodes.size();
+    _stats.tasks = taskCount;
+    _stats.updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return true;
+}
+
+const std::vector<SceneNode>& SceneGraph::getUpdatedNodes() const
+{
+    return _updatedNodes;
+}
+
+void SceneGraph::setThreadPool(ThreadPool* pool)
+{
+    _pool = pool;
+}
+
+const SceneGraph::Stats& SceneGraph::getStats() const
+{
+    return _stats;
+}
+
+void SceneGraph::markDirty(SceneNode node)
+{
+    if (!_dirty[node])
+    {
+        _dirty[node] = 1;
+        _dirtyNodes.push_back(node);
+    }
+}
+
+bool SceneGraph::hasDirtyAncestor(SceneNode node) const
+{
+    for (SceneNode parent = _parents[node]; parent != InvalidNode; parent = _parents[parent])
+    {
+        if (_dirty[parent])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SceneGraph::updateNode(SceneNode node)
+{
+    // translation * rotation * scale, written straight into the columns
+    glm::mat4 local = glm::mat4_cast(_rotations[node]);
+    local[0] = local[0] * _scales[node].x;
+    local[1] = local[1] * _scales[node].y;
+    local[2] = local[2] * _scales[node].z;
+    local[3] = glm::vec4(_positions[node], 1.0f);
+
+    // the parent is either clean or was recomputed before its children
+    SceneNode parent = _parents[node];
+    _worldMatrices[node] = parent == InvalidNode ? local : _worldMatrices[parent] * local;
+}
+
+void SceneGraph::updateSubtree(SceneNode root, std::vector<SceneNode>& stack, std::vector<SceneNode>& updated)
+{
+    stack.clear();
+    stack.push_back(root);
+
+    while (!stack.empty())
+    {
+        SceneNode node = stack.back();
+        stack.pop_back();
+
+        updateNode(node);
+        updated.push_back(node);
+
+        for (SceneNode child = _firstChildren[node]; child != InvalidNode; child = _nextSiblings[child])
+        {
+            stack.push_back(child);
+        }
+    }
+}
+
+void SceneGraph::splitRoots(std::size_t taskCount)
+{
+    std::vector<SceneNode>& next = _taskStacks[0];
+
+    for (int level = 0; level < MaxSplitLevels && _roots.size() < taskCount; ++level)
+    {
+        next.clear();
+        bool split = false;
+
+        for (SceneNode root : _roots)
+        {
+            if (_firstChildren[root] == InvalidNode)
+            {
+                next.push_back(root);
+                continue;
+            }
+
+            updateNode(root);
+            _updatedNodes.push_back(root);
+
+            for (SceneNode child = _firstChildren[root]; child != InvalidNode; child = _nextSiblings[child])
+            {
+                next.push_back(child);
+            }
+            split = true;
+        }
+
+        _roots.swap(next);
+
+        if (!split)
+        {
+            break;
+        }
+    }
+}
+
+void SceneGraph::assignTasks(std::size_t taskCount, std::size_t nodeCount)
+{
+    _taskBegins.assign(taskCount + 1, _roots.size());
+    _taskBegins[0] = 0;
+
+    // a task takes roots until it has its share of the nodes, one large subtree may leave the last tasks empty
+    std::size_t task = 1;
+    std::size_t assigned = 0;
+    for (std::size_t i = 0; i < _roots.size() && task < taskCount; ++i)
+    {
+        assigned += _subtreeSizes[_roots[i]];
+        while (task < taskCount && assigned >= nodeCount * task / taskCount)
+        {
+            _taskBegins[task++] = i + 1;
+        }
+    }
+}
\ No newline at end of file
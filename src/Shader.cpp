@@ -1,11 +1,58 @@
 #include "Shader.hpp"
+#include "ProgramCache.hpp"
 
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <iterator>
 
 #include <glm/gtc/type_ptr.hpp>
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+    // GLSL wants #version before anything else, the defines go on the line after it. the #line directive
+    // afterwards keeps the line numbers in compile errors pointing at the file
+    void injectDefines(std::string& source, const ShaderDefines& defines)
+    {
+        if (defines.empty())
+        {
+            return;
+        }
+
+        std::size_t insertAt = 0;
+        int nextLine = 1;
+
+        std::size_t version = source.find("#version");
+        if (version != std::string::npos)
+        {
+            std::size_t lineEnd = source.find('\n', version);
+            insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+
+            for (std::size_t i = 0; i < insertAt; ++i)
+            {
+                nextLine += source[i] == '\n' ? 1 : 0;
+            }
+        }
+
+        std::string injected = defines.toSource() + "#line " + std::to_string(nextLine) + "\n";
+        if (insertAt == source.size() && (source.empty() || source.back() != '\n'))
+        {
+            injected.insert(0, "\n");
+        }
+
+        source.insert(insertAt, injected);
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
 void checkCompileErrors(GLuint shader, std::string type)
 {
     GLint success;
@@ -31,7 +78,9 @@ void checkCompileErrors(GLuint shader, std::string type)
     }
 }
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines) :
+    _name{ std::filesystem::path(vertexPath).filename().string() + " + " + std::filesystem::path(fragmentPath).filename().string() },
+    _submitTime{ std::chrono::steady_clock::now() }
 {
     std::string vertexCode;
     std::string fragmentCode;
@@ -58,103 +107,317 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
     }
 
+    injectDefines(vertexCode, defines);
+    injectDefines(fragmentCode, defines);
+
+    if (!defines.empty())
+    {
+        _name += " [" + defines.toString() + "]";
+    }
+
+    ProgramCache& programCache = ProgramCache::shared();
+    _cacheKey = programCache.getKey(vertexCode, fragmentCode);
+
+    _id = GlProgram::create();
+    _pending = true;
+
+    if (programCache.load(_id, _cacheKey))
+    {
+        _fromCache = true;
+        _submitMs = millisecondsSince(_submitTime);
+        return;
+    }
+
+    // a rejected binary leaves the program unlinked but otherwise usable, it's simply linked from source below
+
     // vertex shader
     const char* vShaderCode = vertexCode.c_str();
-    unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, nullptr);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    _vertexShader.reset(glCreateShader(GL_VERTEX_SHADER));
+    glShaderSource(_vertexShader, 1, &vShaderCode, nullptr);
+    glCompileShader(_vertexShader);
 
     // fragment Shader
     const char* fShaderCode = fragmentCode.c_str();
-    unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, nullptr);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
-
-    // shader Program
-    _id = glCreateProgram();
-    glAttachShader(_id, vertex);
-    glAttachShader(_id, fragment);
+    _fragmentShader.reset(glCreateShader(GL_FRAGMENT_SHADER));
+    glShaderSource(_fragmentShader, 1, &fShaderCode, nullptr);
+    glCompileShader(_fragmentShader);
+
+    // shader Program, no status query until finish() so the driver isn't forced to wait for the compile here
+    if (programCache.isSupported())
+    {
+        glProgramParameteri(_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    glAttachShader(_id, _vertexShader);
+    glAttachShader(_id, _fragmentShader);
     glLinkProgram(_id);
-    checkCompileErrors(_id, "PROGRAM");
 
-    // they're linked into our program now and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    _submitMs = millisecondsSince(_submitTime);
 }
 
-Shader::~Shader()
+bool Shader::isReady() const
 {
-    glDeleteProgram(_id);
+    if (!_pending)
+    {
+        return true;
+    }
+
+    // without the extension asking for anything would block, so the program is reported as ready and finish() waits
+    if (_fromCache || !ProgramCache::shared().isParallelCompileSupported())
+    {
+        return true;
+    }
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(_id, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+void Shader::finish() const
+{
+    if (!_pending)
+    {
+        return;
+    }
+
+    _pending = false;
+
+    auto waitStart = std::chrono::steady_clock::now();
+
+    if (!_fromCache)
+    {
+        checkCompileErrors(_vertexShader, "VERTEX");
+        checkCompileErrors(_fragmentShader, "FRAGMENT");
+        checkCompileErrors(_id, "PROGRAM");
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(_id, GL_LINK_STATUS, &linked);
+        if (linked == GL_TRUE)
+        {
+            ProgramCache::shared().store(_id, _cacheKey);
+        }
+
+        // they're linked into our program now and no longer necessary
+        glDetachShader(_id, _vertexShader);
+        glDetachShader(_id, _fragmentShader);
+        _vertexShader.reset();
+        _fragmentShader.reset();
+    }
+
+    cacheActiveUniforms();
+
+    ProgramReport report;
+    report.name = _name;
+    report.fromCache = _fromCache;
+    report.submitMs = _submitMs;
+    report.waitMs = millisecondsSince(waitStart);
+    report.totalMs = millisecondsSince(_submitTime);
+    ProgramCache::shared().addReport(report);
 }
 
 void Shader::use() const
 {
+    finish();
     glUseProgram(_id);
 }
 
 unsigned int Shader::getProgramId() const
 {
+    finish();
     return _id;
 }
 
+int Shader::getUniformLocation(const std::string& name) const
+{
+    finish();
+
+    auto it = _uniformLocations.find(name);
+    if (it != _uniformLocations.end())
+    {
+        ++_uniformCacheStats.hits;
+        return it->second;
+    }
+
+    ++_uniformCacheStats.misses;
+
+    int location = glGetUniformLocation(_id, name.c_str());
+    _uniformLocations.emplace(name, location);
+
+    return location;
+}
+
+void Shader::bindUniformBlock(const std::string& blockName, unsigned int bindingPoint) const
+{
+    finish();
+
+    unsigned int blockIndex = glGetUniformBlockIndex(_id, blockName.c_str());
+    if (blockIndex == GL_INVALID_INDEX)
+    {
+        std::cout << "ERROR::UNIFORM_BLOCK::NOT_FOUND: " << blockName << std::endl;
+        return;
+    }
+
+    glUniformBlockBinding(_id, blockIndex, bindingPoint);
+}
+
+const UniformCacheStats& Shader::getUniformCacheStats() const
+{
+    return _uniformCacheStats;
+}
+
+void Shader::resetUniformCacheStats()
+{
+    _uniformCacheStats = {};
+}
+
+void Shader::cacheActiveUniforms() const
+{
+    GLint uniformCount = 0;
+    glGetProgramiv(_id, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+    GLint maxNameLength = 0;
+    glGetProgramiv(_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::string name(static_cast<std::size_t>(maxNameLength), '\0');
+    _uniformLocations.reserve(static_cast<std::size_t>(uniformCount));
+
+    for (GLint i = 0; i < uniformCount; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(_id, static_cast<GLuint>(i), maxNameLength, &length, &size, &type, &name[0]);
+
+        std::string uniformName = name.substr(0, static_cast<std::size_t>(length));
+
+        // uniforms living in a uniform block have no location
+        int location = glGetUniformLocation(_id, uniformName.c_str());
+        if (location == -1)
+        {
+            continue;
+        }
+
+        _uniformLocations[uniformName] = location;
+
+        // arrays of basic types are reported once as "name[0]" with their size,
+        // register "name" and every "name[i]" so lookups for any element hit the table.
+        const std::string arraySuffix = "[0]";
+        if (size > 1 && uniformName.size() > arraySuffix.size() &&
+            uniformName.compare(uniformName.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0)
+        {
+            std::string baseName = uniformName.substr(0, uniformName.size() - arraySuffix.size());
+            _uniformLocations[baseName] = location;
+
+            for (GLint element = 1; element < size; ++element)
+            {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                _uniformLocations[elementName] = glGetUniformLocation(_id, elementName.c_str());
+            }
+        }
+    }
+}
+
+void Shader::set(UniformHandle<bool> handle, bool value) const
+{
+    glUniform1i(handle.location, static_cast<int>(value));
+}
+
+void Shader::set(UniformHandle<int> handle, int value) const
+{
+    glUniform1i(handle.location, value);
+}
+
+void Shader::set(UniformHandle<float> handle, float value) const
+{
+    glUniform1f(handle.location, value);
+}
+
+void Shader::set(UniformHandle<glm::vec2> handle, const glm::vec2& value) const
+{
+    glUniform2fv(handle.location, 1, glm::value_ptr(value));
+}
+
+void Shader::set(UniformHandle<glm::vec3> handle, const glm::vec3& value) const
+{
+    glUniform3fv(handle.location, 1, glm::value_ptr(value));
+}
+
+void Shader::set(UniformHandle<glm::vec4> handle, const glm::vec4& value) const
+{
+    glUniform4fv(handle.location, 1, glm::value_ptr(value));
+}
+
+void Shader::set(UniformHandle<glm::mat2> handle, const glm::mat2& mat) const
+{
+    glUniformMatrix2fv(handle.location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void Shader::set(UniformHandle<glm::mat3> handle, const glm::mat3& mat) const
+{
+    glUniformMatrix3fv(handle.location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void Shader::set(UniformHandle<glm::mat4> handle, const glm::mat4& mat) const
+{
+    glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(_id, name.c_str()), static_cast<int>(value));
+    glUniform1i(getUniformLocation(name), static_cast<int>(value));
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(_id, name.c_str()), value);
+    glUniform1i(getUniformLocation(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(_id, name.c_str()), value);
+    glUniform1f(getUniformLocation(name), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-    glUniform2fv(glGetUniformLocation(_id, name.c_str()), 1, glm::value_ptr(value));
+    glUniform2fv(getUniformLocation(name), 1, glm::value_ptr(value));
 }
 
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(_id, name.c_str()), x, y);
+    glUniform2f(getUniformLocation(name), x, y);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-    glUniform3fv(glGetUniformLocation(_id, name.c_str()), 1, glm::value_ptr(value));
+    glUniform3fv(getUniformLocation(name), 1, glm::value_ptr(value));
 }
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(_id, name.c_str()), x, y, z);
+    glUniform3f(getUniformLocation(name), x, y, z);
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-    glUniform4fv(glGetUniformLocation(_id, name.c_str()), 1, glm::value_ptr(value));
+    glUniform4fv(getUniformLocation(name), 1, glm::value_ptr(value));
 }
 
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 {
-    glUniform4f(glGetUniformLocation(_id, name.c_str()), x, y, z, w);
+    glUniform4f(getUniformLocation(name), x, y, z, w);
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat));
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "ShaderDefines.hpp"
+#include "FileHash.hpp"
+
+void ShaderDefines::set(const std::string& name, int value)
+{
+    _values[name] = value;
+}
+
+void ShaderDefines::remove(const std::string& name)
+{
+    _values.erase(name);
+}
+
+bool ShaderDefines::has(const std::string& name) const
+{
+    return _values.find(name) != _values.end();
+}
+
+bool ShaderDefines::empty() const
+{
+    return _values.empty();
+}
+
+std::uint64_t ShaderDefines::hash() const
+{
+    std::size_t count = _values.size();
+    std::uint64_t hash = FileHash::hashBytes(&count, sizeof(count));
+    for (const auto& [name, value] : _values)
+    {
+        // the terminator separates name and value, "A1" = 2 and "A" = 12 stay apart
+        hash = FileHash::hashBytes(name.c_str(), name.size() + 1, hash);
+        hash = FileHash::hashBytes(&value, sizeof(value), hash);
+    }
+
+    return hash;
+}
+
+std::string ShaderDefines::toSource() const
+{
+    std::string source;
+    for (const auto& [name, value] : _values)
+    {
+        source += "#define " + name + " " + std::to_string(value) + "\n";
+    }
+
+    return source;
+}
+
+std::string ShaderDefines::toString() const
+{
+    std::string text;
+    for (const auto& [name, value] : _values)
+    {
+        if (!text.empty())
+        {
+            text += " ";
+        }
+
+        text += value == 1 ? name : name + "=" + std::to_string(value);
+    }
+
+    return text;
+}
\ No newline at end of file
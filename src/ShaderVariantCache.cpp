@@ -0,0 +1,68 @@
+#include "ShaderVariantCache.hpp"
+
+#include <iostream>
+
+ShaderVariantCache::ShaderVariantCache(std::string vertexPath, std::string fragmentPath, SetupFunction setup) :
+    _vertexPath{ std::move(vertexPath) },
+    _fragmentPath{ std::move(fragmentPath) },
+    _setup{ std::move(setup) }
+{
+}
+
+Shader& ShaderVariantCache::get(const ShaderDefines& defines)
+{
+    ++_stats.lookups;
+
+    std::uint64_t key = defines.hash();
+    auto it = _variants.find(key);
+    if (it != _variants.end())
+    {
+        // 64 bits make this practically impossible, but a wrong program would be a silent rendering bug
+        if (!(it->second.defines == defines))
+        {
+            std::cout << "ERROR::SHADER_VARIANT::HASH_COLLISION: " << defines.toString() << " and " << it->second.defines.toString() << std::endl;
+        }
+
+        return *it->second.shader;
+    }
+
+    ++_stats.compiles;
+
+    Variant variant;
+    variant.defines = defines;
+    variant.shader = std::make_unique<Shader>(_vertexPath.c_str(), _fragmentPath.c_str(), defines);
+
+    Shader& shader = *variant.shader;
+    _variants.emplace(key, std::move(variant));
+    _creationOrder.push_back(key);
+
+    if (_setup)
+    {
+        _setup(shader);
+    }
+
+    return shader;
+}
+
+std::size_t ShaderVariantCache::getVariantCount() const
+{
+    return _variants.size();
+}
+
+std::vector<std::string> ShaderVariantCache::getVariantNames() const
+{
+    std::vector<std::string> names;
+    names.reserve(_creationOrder.size());
+
+    for (std::uint64_t key : _creationOrder)
+    {
+        names.push_back(_variants.at(key).defines.toString());
+    }
+
+    return names;
+}
+
+const ShaderVariantCache::Stats& ShaderVariantCache::getStats() const
+{
+    return _stats;
+}
\ No newline at end of file
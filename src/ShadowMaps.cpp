@@ -0,0 +1,482 @@
+#include "ShadowMaps.hpp"
+#include "LightClusters.hpp"
+#include "Shader.hpp"
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    // depth24, the only depth format GL 3.3 guarantees to be renderable and filterable
+    constexpr std::size_t BytesPerTexel = 4;
+
+    constexpr float SpotNearPlane = 0.1f;
+    constexpr float PointNearPlane = 0.05f;
+
+    // a little wider than the outer cone, so the soft edge isn't cut by the map border
+    constexpr float SpotAngleMargin = 0.1f;
+
+    // slope scaled bias against shadow acne, the point maps write their depth themselves and bias in frag_lit
+    constexpr float PolygonOffsetFactor = 2.0f;
+    constexpr float PolygonOffsetUnits = 4.0f;
+
+    struct CubeFace
+    {
+        glm::vec3 direction;
+        glm::vec3 up;
+    };
+
+    // GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+    const CubeFace CubeFaces[6] =
+    {
+        { {  1.0f,  0.0f,  0.0f }, { 0.0f, -1.0f,  0.0f } },
+        { { -1.0f,  0.0f,  0.0f }, { 0.0f, -1.0f,  0.0f } },
+        { {  0.0f,  1.0f,  0.0f }, { 0.0f,  0.0f,  1.0f } },
+        { {  0.0f, -1.0f,  0.0f }, { 0.0f,  0.0f, -1.0f } },
+        { {  0.0f,  0.0f,  1.0f }, { 0.0f, -1.0f,  0.0f } },
+        { {  0.0f,  0.0f, -1.0f }, { 0.0f, -1.0f,  0.0f } }
+    };
+
+    // lookAt can't take an up vector parallel to the direction
+    glm::vec3 upFor(const glm::vec3& direction)
+    {
+        return std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    // compared against the depth stored in the map, outside of it nothing is shadowed
+    void setDepthParameters(GLenum target)
+    {
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        if (target == GL_TEXTURE_CUBE_MAP)
+        {
+            glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        }
+        else
+        {
+            const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border);
+        }
+    }
+
+    bool sphereIntersects(const glm::vec4& sphere, const BoundingBox& box)
+    {
+        glm::vec3 center(sphere);
+        glm::vec3 closest = glm::clamp(center, box.min, box.max);
+        glm::vec3 offset = closest - center;
+        return glm::dot(offset, offset) <= sphere.w * sphere.w;
+    }
+}
+
+std::size_t ShadowMaps::getTextureUnitCount(std::size_t pointLightCount)
+{
+    return 2 + pointLightCount;
+}
+
+ShadowMaps::ShadowMaps(std::size_t pointLightCount, const ShadowSettings& settings) :
+    _settings{ settings },
+    _depthShaders{ "resources/shaders/vert_shadow_instanced.glsl", "resources/shaders/frag_shadow.glsl" }
+{
+    for (std::size_t i = 0; i < CascadeCount; ++i)
+    {
+        _maps.push_back(Map{ MapType::Cascade, i });
+    }
+    _maps.push_back(Map{ MapType::Spot, 0 });
+    for (std::size_t i = 0; i < pointLightCount; ++i)
+    {
+        _maps.push_back(Map{ MapType::Point, i });
+    }
+
+    createTextures(pointLightCount);
+    clearTextures();
+
+    // both variants up front, so the first refresh doesn't wait for a compile
+    ShaderDefines pointDefines;
+    pointDefines.set("POINT_SHADOW");
+    _depthShaders.get(ShaderDefines{});
+    _depthShaders.get(pointDefines);
+}
+
+void ShadowMaps::setLights(const DirectionalLight& directional, const SpotLight& spot, const std::vector<PointLight>& pointLights, const ShadowView& view)
+{
+    _view = view;
+    updateCascades(directional, view);
+
+    for (Map& map : _maps)
+    {
+        if (map.type == MapType::Spot)
+        {
+            // the spot attenuation as a point light, a disabled spotlight reaches nothing and keeps its old map
+            PointLight reach { spot.position, spot.diffuse, spot.constant, spot.linear, spot.quadratic };
+            float range = LightClusters::lightRadius(reach);
+            if (range <= SpotNearPlane)
+            {
+                continue;
+            }
+
+            float angle = std::min(2.0f * std::acos(spot.outerCutOff) + SpotAngleMargin, glm::radians(170.0f));
+            glm::vec3 direction = glm::normalize(spot.direction);
+            glm::mat4 lightView = glm::lookAt(spot.position, spot.position + direction, upFor(direction));
+            setWanted(map, glm::perspective(angle, 1.0f, SpotNearPlane, range) * lightView);
+        }
+        else if (map.type == MapType::Point && map.index < pointLights.size())
+        {
+            const PointLight& light = pointLights[map.index];
+            float range = LightClusters::lightRadius(light);
+            if (range <= PointNearPlane)
+            {
+                continue;
+            }
+
+            setWanted(map, glm::mat4(1.0f), glm::vec4(light.position, range));
+        }
+    }
+}
+
+void ShadowMaps::invalidate(const BoundingBox& bounds)
+{
+    for (Map& map : _maps)
+    {
+        if (map.staleSince == 0 && intersects(map, bounds))
+        {
+            markStale(map);
+        }
+    }
+}
+
+void ShadowMaps::invalidateAll()
+{
+    for (Map& map : _maps)
+    {
+        markStale(map);
+    }
+}
+
+void ShadowMaps::refresh(int refreshBudget, const DrawCasters& drawCasters)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    _stats = Stats{};
+    _stats.maps = _maps.size();
+
+    _refreshOrder.clear();
+    for (std::size_t i = 0; i < _maps.size(); ++i)
+    {
+        if (_maps[i].staleSince != 0)
+        {
+            _refreshOrder.push_back(i);
+        }
+    }
+    _stats.stale = _refreshOrder.size();
+
+    // oldest first so a busy frame can't starve a map forever, ties go by map order: near cascades first
+    std::stable_sort(_refreshOrder.begin(), _refreshOrder.end(), [this](std::size_t a, std::size_t b)
+    {
+        return _maps[a].staleSince < _maps[b].staleSince;
+    });
+
+    std::size_t count = std::min(_refreshOrder.size(), static_cast<std::size_t>(std::max(refreshBudget, 0)));
+    if (count > 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(PolygonOffsetFactor, PolygonOffsetUnits);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            drawMap(_maps[_refreshOrder[i]], drawCasters);
+        }
+
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    _stats.refreshed = count;
+
+    ++_frame;
+
+    _stats.refreshMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ShadowMaps::bind(const Shader& shader, unsigned int firstTextureUnit) const
+{
+    unsigned int unit = firstTextureUnit;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _cascadeTexture);
+    shader.setInt("cascadeShadowMap", static_cast<int>(unit++));
+    shader.setVec3("cameraForward", _view.forward);
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, _spotTexture);
+    shader.setInt("spotShadowMap", static_cast<int>(unit++));
+
+    // the matrices the maps were drawn with, a map still waiting for its refresh is read the way it was drawn
+    for (const Map& map : _maps)
+    {
+        std::string index = "[" + std::to_string(map.index) + "]";
+
+        switch (map.type)
+        {
+        case MapType::Cascade:
+            shader.setMat4("cascadeMatrices" + index, map.drawn);
+            shader.setFloat("cascadeSplits" + index, _cascadeSplits[map.index]);
+            break;
+        case MapType::Spot:
+            shader.setMat4("spotShadowMatrix", map.drawn);
+            break;
+        case MapType::Point:
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, _pointTextures[map.index]);
+            shader.setInt("pointShadowMaps" + index, static_cast<int>(unit++));
+            shader.setVec4("pointShadows" + index, map.drawnSphere);
+            break;
+        }
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+const ShadowSettings& ShadowMaps::getSettings() const
+{
+    return _settings;
+}
+
+const ShadowMaps::Stats& ShadowMaps::getStats() const
+{
+    return _stats;
+}
+
+std::size_t ShadowMaps::getGpuMemoryUsage() const
+{
+    auto mapSize = [](int resolution)
+    {
+        return static_cast<std::size_t>(resolution) * static_cast<std::size_t>(resolution) * BytesPerTexel;
+    };
+
+    return mapSize(_settings.cascadeResolution) * CascadeCount +
+        mapSize(_settings.spotResolution) +
+        mapSize(_settings.pointResolution) * 6 * _pointTextures.size();
+}
+
+void ShadowMaps::createTextures(std::size_t pointLightCount)
+{
+    _cascadeTexture = GlTexture::create();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _cascadeTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, _settings.cascadeResolution, _settings.cascadeResolution,
+        static_cast<GLsizei>(CascadeCount), 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    setDepthParameters(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    _spotTexture = GlTexture::create();
+    glBindTexture(GL_TEXTURE_2D, _spotTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, _settings.spotResolution, _settings.spotResolution, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    setDepthParameters(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (std::size_t i = 0; i < pointLightCount; ++i)
+    {
+        GlTexture texture = GlTexture::create();
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        for (GLenum face = 0; face < 6; ++face)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, _settings.pointResolution, _settings.pointResolution, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        }
+        setDepthParameters(GL_TEXTURE_CUBE_MAP);
+        _pointTextures.push_back(std::move(texture));
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    // depth only, every map is attached in turn before it's drawn
+    _fbo = GlFramebuffer::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _cascadeTexture, 0, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::FRAMEBUFFER::SHADOW_INCOMPLETE" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowMaps::clearTextures()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glClearDepth(1.0);
+
+    for (std::size_t i = 0; i < CascadeCount; ++i)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _cascadeTexture, 0, static_cast<GLint>(i));
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _spotTexture, 0);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    for (const GlTexture& texture : _pointTextures)
+    {
+        for (GLenum face = 0; face < 6; ++face)
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, texture, 0);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowMaps::updateCascades(const DirectionalLight& light, const ShadowView& view)
+{
+    float nearPlane = view.nearPlane;
+    float farPlane = std::max(_settings.shadowDistance, nearPlane * 2.0f);
+
+    // the light's rotation only, a cascade is placed inside it by its orthographic bounds
+    glm::vec3 lightDirection = glm::normalize(light.direction);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, upFor(lightDirection));
+
+    float tanHalfHeight = std::tan(view.fieldOfView * 0.5f);
+    float tanHalfWidth = tanHalfHeight * view.aspectRatio;
+    float cornerScale = tanHalfWidth * tanHalfWidth + tanHalfHeight * tanHalfHeight;
+
+    float sliceNear = nearPlane;
+    for (std::size_t i = 0; i < CascadeCount; ++i)
+    {
+        // practical split scheme, between a uniform and a logarithmic distribution
+        float fraction = static_cast<float>(i + 1) / static_cast<float>(CascadeCount);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * fraction;
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, fraction);
+        float sliceFar = uniformSplit + (logSplit - uniformSplit) * _settings.cascadeSplitBlend;
+        _cascadeSplits[i] = sliceFar;
+
+        // smallest sphere around the slice, its center on the view axis. only depends on the projection,
+        // so the cascade keeps its size (and its texel size) however the camera turns
+        float nearCorner = cornerScale * sliceNear * sliceNear;
+        float farCorner = cornerScale * sliceFar * sliceFar;
+        float centerDepth = (sliceFar * sliceFar - sliceNear * sliceNear + farCorner - nearCorner) / (2.0f * (sliceFar - sliceNear));
+        centerDepth = glm::clamp(centerDepth, sliceNear, sliceFar);
+        float radius = std::sqrt(std::max((sliceFar - centerDepth) * (sliceFar - centerDepth) + farCorner,
+            (centerDepth - sliceNear) * (centerDepth - sliceNear) + nearCorner));
+
+        // the center moves in whole snap steps of whole texels, between two steps the matrix stays exactly the same.
+        // the bounds grow by one step so the slice is still covered anywhere inside it
+        float texel = 2.0f * radius / static_cast<float>(_settings.cascadeResolution);
+        float step = std::max(texel, std::round(radius * _settings.cascadeSnap / texel) * texel);
+        float extent = radius + step;
+
+        glm::vec3 center = glm::vec3(lightView * glm::vec4(view.position + view.forward * centerDepth, 1.0f));
+        center = glm::floor(center / step) * step;
+
+        // light space looks down -z, casters up to casterDistance towards the light still land in the map
+        glm::mat4 projection = glm::ortho(center.x - extent, center.x + extent, center.y - extent, center.y + extent,
+            -center.z - extent - _settings.casterDistance, -center.z + extent);
+        setWanted(_maps[i], projection * lightView);
+
+        sliceNear = sliceFar;
+    }
+}
+
+void ShadowMaps::setWanted(Map& map, const glm::mat4& matrix, const glm::vec4& sphere)
+{
+    map.wanted = matrix;
+    map.wantedSphere = sphere;
+    map.active = true;
+
+    if (map.wanted != map.drawn || map.wantedSphere != map.drawnSphere)
+    {
+        markStale(map);
+    }
+}
+
+void ShadowMaps::markStale(Map& map)
+{
+    // an already stale map keeps its place in the queue
+    if (map.active && map.staleSince == 0)
+    {
+        map.staleSince = _frame;
+    }
+}
+
+bool ShadowMaps::intersects(const Map& map, const BoundingBox& bounds) const
+{
+    // only the volume the map was drawn with matters, a changed light makes it stale anyway
+    if (map.type == MapType::Point)
+    {
+        return sphereIntersects(map.drawnSphere, bounds);
+    }
+
+    return Frustum::fromMatrix(map.drawn).intersects(bounds);
+}
+
+void ShadowMaps::drawMap(Map& map, const DrawCasters& drawCasters)
+{
+    glClearDepth(1.0);
+
+    if (map.type == MapType::Point)
+    {
+        ShaderDefines pointDefines;
+        pointDefines.set("POINT_SHADOW");
+        Shader& shader = _depthShaders.get(pointDefines);
+
+        // linear distance over the range, so frag_lit compares against the same thing from any face
+        glm::vec3 position(map.wantedSphere);
+        float range = map.wantedSphere.w;
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, PointNearPlane, range);
+
+        shader.use();
+        shader.setVec3("lightPosition", position);
+        shader.setFloat("farPlane", range);
+
+        glViewport(0, 0, _settings.pointResolution, _settings.pointResolution);
+        for (GLenum face = 0; face < 6; ++face)
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, _pointTextures[map.index], 0);
+            glClear(GL_DEPTH_BUFFER_BIT);
+
+            glm::mat4 lightView = glm::lookAt(position, position + CubeFaces[face].direction, CubeFaces[face].up);
+            shader.setMat4("lightSpace", projection * lightView);
+            drawCasters(shader);
+            ++_stats.passes;
+        }
+    }
+    else
+    {
+        Shader& shader = _depthShaders.get(ShaderDefines{});
+        shader.use();
+        shader.setMat4("lightSpace", map.wanted);
+
+        if (map.type == MapType::Cascade)
+        {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _cascadeTexture, 0, static_cast<GLint>(map.index));
+            glViewport(0, 0, _settings.cascadeResolution, _settings.cascadeResolution);
+        }
+        else
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _spotTexture, 0);
+            glViewport(0, 0, _settings.spotResolution, _settings.spotResolution);
+        }
+
+        glClear(GL_DEPTH_BUFFER_BIT);
+        drawCasters(shader);
+        ++_stats.passes;
+    }
+
+    map.drawn = map.wanted;
+    map.drawnSphere = map.wantedSphere;
+    map.staleSince = 0;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "Std140Layout.hpp"
+
+namespace
+{
+    constexpr std::size_t Vec4Alignment = 16;
+
+    std::size_t alignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+std::size_t Std140Layout::add(Std140Type type)
+{
+    return reserve(baseAlignment(type), byteSize(type));
+}
+
+std::size_t Std140Layout::addArray(Std140Type type, std::size_t count)
+{
+    // array elements are aligned and padded to a vec4 no matter how small the element type is
+    return reserve(Vec4Alignment, arrayStride(type) * count);
+}
+
+std::size_t Std140Layout::addStruct(const Std140Layout& member)
+{
+    return reserve(Vec4Alignment, member.structSize());
+}
+
+std::size_t Std140Layout::addStructArray(const Std140Layout& member, std::size_t count)
+{
+    return reserve(Vec4Alignment, member.structSize() * count);
+}
+
+std::size_t Std140Layout::size() const
+{
+    return _size;
+}
+
+std::size_t Std140Layout::structSize() const
+{
+    return alignUp(_size, Vec4Alignment);
+}
+
+std::size_t Std140Layout::baseAlignment(Std140Type type)
+{
+    switch (type)
+    {
+        case Std140Type::Float:
+        case Std140Type::Int: return 4;
+        case Std140Type::Vec2: return 8;
+        case Std140Type::Vec3:
+        case Std140Type::Vec4:
+        case Std140Type::Mat4: return 16;
+    }
+
+    return Vec4Alignment;
+}
+
+std::size_t Std140Layout::byteSize(Std140Type type)
+{
+    switch (type)
+    {
+        case Std140Type::Float:
+        case Std140Type::Int: return 4;
+        case Std140Type::Vec2: return 8;
+        case Std140Type::Vec3: return 12;
+        case Std140Type::Vec4: return 16;
+        case Std140Type::Mat4: return 64;
+    }
+
+    return 0;
+}
+
+std::size_t Std140Layout::arrayStride(Std140Type type)
+{
+    return alignUp(byteSize(type), Vec4Alignment);
+}
+
+std::size_t Std140Layout::reserve(std::size_t alignment, std::size_t bytes)
+{
+    std::size_t offset = alignUp(_size, alignment);
+    _size = offset + bytes;
+    return offset;
+}
@@ -0,0 +1,213 @@
+#include "TextureCache.hpp"
+#include "TextureStreamer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+#include <glad/glad.h>
+
+namespace
+{
+    // the same image compressed for another usage is a different texture
+    std::string pathKey(const std::string& normalizedPath, TextureUsage usage)
+    {
+        return std::to_string(static_cast<int>(usage)) + ':' + normalizedPath;
+    }
+}
+
+TextureCache::TextureCache()
+{
+    TextureStreamer::shared().setDuplicateCallback([this](unsigned int id, unsigned int original) { return shareContent(id, original); });
+}
+
+TextureCache::~TextureCache()
+{
+    TextureStreamer::shared().setDuplicateCallback(nullptr);
+}
+
+TextureCache& TextureCache::shared()
+{
+    // the streamer owns the pending uploads of our textures, it has to outlive the cache
+    TextureStreamer::shared();
+
+    static TextureCache cache;
+    return cache;
+}
+
+unsigned int TextureCache::acquire(const std::string& path, TextureUsage usage)
+{
+    std::string key = pathKey(normalizePath(path), usage);
+
+    auto pathIt = _byPath.find(key);
+    if (pathIt != _byPath.end())
+    {
+        Entry& entry = addReference(pathIt->second);
+        ++_stats.pathHits;
+        _stats.bytesSaved += entry.sourceBytes;
+        return entry.id;
+    }
+
+    // unknown path. its content is only known once the decode task read the file, see shareContent()
+    Entry entry;
+    entry.id = GlTexture(TextureStreamer::shared().request(path, usage));
+    entry.usage = usage;
+    entry.references = 1;
+    entry.pathKeys.push_back(key);
+
+    std::error_code error;
+    std::uintmax_t fileSize = std::filesystem::file_size(path, error);
+    entry.sourceBytes = error ? 0 : static_cast<std::size_t>(fileSize);
+
+    unsigned int id = entry.id;
+
+    _byPath.emplace(key, id);
+    _entries.emplace(id, std::move(entry));
+
+    ++_stats.misses;
+    ++_stats.textures;
+    ++_stats.references;
+
+    return id;
+}
+
+void TextureCache::release(unsigned int id)
+{
+    dropReference(id, true);
+}
+
+std::size_t TextureCache::getReferenceCount(unsigned int id) const
+{
+    auto it = _entries.find(id);
+    return it != _entries.end() ? it->second.references : 0;
+}
+
+unsigned int TextureCache::resolve(unsigned int id) const
+{
+    if (_aliases.empty())
+    {
+        return id;
+    }
+
+    auto it = _aliases.find(id);
+    return it != _aliases.end() ? it->second : id;
+}
+
+void TextureCache::clear()
+{
+    for (const auto& entry : _entries)
+    {
+        TextureStreamer::shared().cancel(entry.first);
+    }
+
+    _entries.clear();
+    _byPath.clear();
+    _aliases.clear();
+
+    _stats.textures = 0;
+    _stats.references = 0;
+}
+
+const TextureCache::Stats& TextureCache::getStats() const
+{
+    return _stats;
+}
+
+std::string TextureCache::normalizePath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    if (error)
+    {
+        absolute = path;
+    }
+
+    std::string normalized = absolute.lexically_normal().generic_string();
+
+#ifdef _WIN32
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+
+    return normalized;
+}
+
+TextureCache::Entry& TextureCache::addReference(unsigned int id)
+{
+    Entry& entry = _entries.at(id);
+    ++entry.references;
+    ++_stats.references;
+    return entry;
+}
+
+void TextureCache::dropReference(unsigned int id, bool userReference)
+{
+    auto it = _entries.find(id);
+    if (it == _entries.end())
+    {
+        return;
+    }
+
+    Entry& entry = it->second;
+    if (userReference)
+    {
+        --_stats.references;
+    }
+
+    if (--entry.references > 0)
+    {
+        return;
+    }
+
+    for (const std::string& key : entry.pathKeys)
+    {
+        _byPath.erase(key);
+    }
+
+    unsigned int original = entry.sharedWith;
+    if (original != 0)
+    {
+        _aliases.erase(id);
+    }
+
+    // erasing deletes the texture, a decode or upload still in flight is cancelled first so it can't land in a texture
+    // that gets the name later
+    TextureStreamer::shared().cancel(id);
+    _entries.erase(it);
+    --_stats.textures;
+
+    if (original != 0)
+    {
+        dropReference(original, false);
+    }
+}
+
+bool TextureCache::shareContent(unsigned int id, unsigned int original)
+{
+    auto it = _entries.find(id);
+    auto originalIt = _entries.find(original);
+    if (it == _entries.end() || originalIt == _entries.end() || originalIt->second.usage != it->second.usage)
+    {
+        return false;
+    }
+
+    // the duplicate's users keep their id, it resolves to the original's texture from now on and keeps that one alive.
+    // its paths move over so every later acquire() of them gets the original directly
+    Entry& entry = it->second;
+    Entry& originalEntry = originalIt->second;
+
+    entry.sharedWith = original;
+    ++originalEntry.references;
+    _aliases[id] = original;
+
+    for (std::string& key : entry.pathKeys)
+    {
+        _byPath[key] = original;
+        originalEntry.pathKeys.push_back(std::move(key));
+    }
+    entry.pathKeys.clear();
+
+    ++_stats.contentHits;
+    _stats.bytesSaved += entry.sourceBytes;
+
+    return true;
+}
\ No newline at end of file
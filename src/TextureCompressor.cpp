@@ -0,0 +1,552 @@
+#include "TextureCompressor.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_COMPRESSOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// S3TC isn't core, the enums may be missing from the loader header
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_COMPRESSED_RG_RGTC2
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+
+namespace
+{
+    constexpr char CacheMagic[4] = { 'C', 'T', 'E', 'X' };
+
+    struct CacheHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t sourceHash;
+        std::uint32_t usage;
+        std::uint32_t format;
+        std::uint32_t alphaToRgb;
+        std::uint32_t levelCount;
+    };
+
+    struct CacheLevel
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    const char* usageName(TextureUsage usage)
+    {
+        switch (usage)
+        {
+            case TextureUsage::Color: return "color";
+            case TextureUsage::Specular: return "specular";
+            case TextureUsage::Normal: return "normal";
+        }
+
+        return "color";
+    }
+
+    std::uint16_t toRgb565(int r, int g, int b)
+    {
+        return static_cast<std::uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+    }
+
+    void fromRgb565(std::uint16_t color, int rgb[3])
+    {
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // one output row of the 2x2 box filter, clamps at the edge for odd sizes
+    void downsampleRowScalar(const unsigned char* row0, const unsigned char* row1, int sourceWidth, unsigned char* output, int firstPixel, int width)
+    {
+        for (int x = firstPixel; x < width; ++x)
+        {
+            int x0 = std::min(x * 2, sourceWidth - 1) * 4;
+            int x1 = std::min(x * 2 + 1, sourceWidth - 1) * 4;
+
+            for (int c = 0; c < 4; ++c)
+            {
+                int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                output[x * 4 + c] = static_cast<unsigned char>((sum + 2) >> 2);
+            }
+        }
+    }
+
+    void downsampleRow(const unsigned char* row0, const unsigned char* row1, int sourceWidth, unsigned char* output, int width)
+    {
+        int x = 0;
+
+#ifdef TEXTURE_COMPRESSOR_SSE2
+        // two output texels (four source texels per row) per iteration
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+
+        for (; x + 2 <= width && (x + 2) * 2 <= sourceWidth; x += 2)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+
+            // vertical sums as 16-bit lanes: texels 0,1 and texels 2,3
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+            // horizontal pair sums end up in the lower 64 bits of each
+            low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+            high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+
+            __m128i sum = _mm_unpacklo_epi64(low, high);
+            __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(output + x * 4), _mm_packus_epi16(average, zero));
+        }
+#endif
+
+        downsampleRowScalar(row0, row1, sourceWidth, output, x, width);
+    }
+
+    // renormalizes the xy of a tangent space normal map after filtering
+    void renormalize(TextureCompressor::Image& image)
+    {
+        for (std::size_t i = 0; i < image.pixels.size(); i += 4)
+        {
+            float x = image.pixels[i] / 127.5f - 1.0f;
+            float y = image.pixels[i + 1] / 127.5f - 1.0f;
+            float z = image.pixels[i + 2] / 127.5f - 1.0f;
+
+            float length = std::sqrt(x * x + y * y + z * z);
+            if (length <= 0.0f)
+            {
+                continue;
+            }
+
+            image.pixels[i] = static_cast<unsigned char>(std::round((x / length + 1.0f) * 127.5f));
+            image.pixels[i + 1] = static_cast<unsigned char>(std::round((y / length + 1.0f) * 127.5f));
+            image.pixels[i + 2] = static_cast<unsigned char>(std::round((z / length + 1.0f) * 127.5f));
+        }
+    }
+
+    // copies the 4x4 block at (blockX, blockY), clamping reads at the image border
+    void fetchBlock(const TextureCompressor::Image& image, int blockX, int blockY, unsigned char rgba[64])
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            int sourceY = std::min(blockY * 4 + y, image.height - 1);
+            for (int x = 0; x < 4; ++x)
+            {
+                int sourceX = std::min(blockX * 4 + x, image.width - 1);
+                std::memcpy(rgba + (y * 4 + x) * 4, image.pixels.data() + (static_cast<std::size_t>(sourceY) * image.width + sourceX) * 4, 4);
+            }
+        }
+    }
+
+    bool hasTranslucency(const TextureCompressor::Image& image)
+    {
+        for (std::size_t i = 3; i < image.pixels.size(); i += 4)
+        {
+            if (image.pixels[i] != 255)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+TextureCompressor::Image TextureCompressor::toRgba(const unsigned char* pixels, int width, int height, int channels)
+{
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<std::size_t>(width) * height * 4);
+
+    for (std::size_t i = 0; i < static_cast<std::size_t>(width) * height; ++i)
+    {
+        const unsigned char* source = pixels + i * channels;
+        unsigned char* destination = image.pixels.data() + i * 4;
+
+        destination[0] = source[0];
+        destination[1] = channels >= 3 ? source[1] : source[0];
+        destination[2] = channels >= 3 ? source[2] : source[0];
+        destination[3] = channels == 4 ? source[3] : (channels == 2 ? source[1] : 255);
+    }
+
+    return image;
+}
+
+std::vector<TextureCompressor::Image> TextureCompressor::generateMips(Image base, TextureUsage usage)
+{
+    std::vector<Image> levels;
+    levels.push_back(std::move(base));
+
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        const Image& source = levels.back();
+
+        Image level;
+        level.width = std::max(source.width / 2, 1);
+        level.height = std::max(source.height / 2, 1);
+        level.pixels.resize(static_cast<std::size_t>(level.width) * level.height * 4);
+
+        for (int y = 0; y < level.height; ++y)
+        {
+            const unsigned char* row0 = source.pixels.data() + static_cast<std::size_t>(std::min(y * 2, source.height - 1)) * source.width * 4;
+            const unsigned char* row1 = source.pixels.data() + static_cast<std::size_t>(std::min(y * 2 + 1, source.height - 1)) * source.width * 4;
+
+            downsampleRow(row0, row1, source.width, level.pixels.data() + static_cast<std::size_t>(y) * level.width * 4, level.width);
+        }
+
+        if (usage == TextureUsage::Normal)
+        {
+            renormalize(level);
+        }
+
+        levels.push_back(std::move(level));
+    }
+
+    return levels;
+}
+
+CompressedTexture TextureCompressor::compress(const unsigned char* pixels, int width, int height, int channels, TextureUsage usage)
+{
+    Image base = toRgba(pixels, width, height, channels);
+
+    CompressedTexture texture;
+    if (usage == TextureUsage::Normal)
+    {
+        texture.format = GL_COMPRESSED_RG_RGTC2;
+    }
+    else if (usage == TextureUsage::Specular || hasTranslucency(base))
+    {
+        texture.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+    else
+    {
+        texture.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+
+    if (usage == TextureUsage::Specular)
+    {
+        // brightest channel goes into alpha, that's the one sampled (see alphaToRgb)
+        for (std::size_t i = 0; i < base.pixels.size(); i += 4)
+        {
+            base.pixels[i + 3] = std::max({ base.pixels[i], base.pixels[i + 1], base.pixels[i + 2] });
+        }
+        texture.alphaToRgb = true;
+    }
+
+    const std::size_t blockSize = texture.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+
+    for (const Image& level : generateMips(std::move(base), usage))
+    {
+        int blocksX = (level.width + 3) / 4;
+        int blocksY = (level.height + 3) / 4;
+
+        CompressedTexture::Level info { level.width, level.height, texture.data.size(), static_cast<std::size_t>(blocksX) * blocksY * blockSize };
+        texture.data.resize(texture.data.size() + info.size);
+
+        unsigned char* output = texture.data.data() + info.offset;
+        unsigned char rgba[64];
+        unsigned char channel[16];
+
+        for (int blockY = 0; blockY < blocksY; ++blockY)
+        {
+            for (int blockX = 0; blockX < blocksX; ++blockX)
+            {
+                fetchBlock(level, blockX, blockY, rgba);
+
+                if (texture.format == GL_COMPRESSED_RG_RGTC2)
+                {
+                    for (int i = 0; i < 16; ++i) { channel[i] = rgba[i * 4]; }
+                    encodeBC4(channel, output);
+
+                    for (int i = 0; i < 16; ++i) { channel[i] = rgba[i * 4 + 1]; }
+                    encodeBC4(channel, output + 8);
+                }
+                else if (texture.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+                {
+                    for (int i = 0; i < 16; ++i) { channel[i] = rgba[i * 4 + 3]; }
+                    encodeBC4(channel, output);
+                    encodeBC1(rgba, output + 8);
+                }
+                else
+                {
+                    encodeBC1(rgba, output);
+                }
+
+                output += blockSize;
+            }
+        }
+
+        texture.levels.push_back(info);
+    }
+
+    return texture;
+}
+
+void TextureCompressor::encodeBC1(const unsigned char rgba[64], unsigned char block[8])
+{
+    // bounding box of the block colors
+    int minColor[3] = { 255, 255, 255 };
+    int maxColor[3] = { 0, 0, 0 };
+    int mean[3] = { 0, 0, 0 };
+
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            minColor[c] = std::min(minColor[c], static_cast<int>(rgba[i * 4 + c]));
+            maxColor[c] = std::max(maxColor[c], static_cast<int>(rgba[i * 4 + c]));
+            mean[c] += rgba[i * 4 + c];
+        }
+    }
+
+    for (int c = 0; c < 3; ++c)
+    {
+        mean[c] /= 16;
+    }
+
+    // pick the box diagonal that follows the colors: flip green/blue when they run against red
+    int covarianceG = 0;
+    int covarianceB = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int r = rgba[i * 4] - mean[0];
+        covarianceG += r * (rgba[i * 4 + 1] - mean[1]);
+        covarianceB += r * (rgba[i * 4 + 2] - mean[2]);
+    }
+
+    if (covarianceG < 0) { std::swap(minColor[1], maxColor[1]); }
+    if (covarianceB < 0) { std::swap(minColor[2], maxColor[2]); }
+
+    // inset the endpoints by 1/16 of the range so outliers don't waste precision
+    for (int c = 0; c < 3; ++c)
+    {
+        int inset = (maxColor[c] - minColor[c]) / 16;
+        maxColor[c] = std::clamp(maxColor[c] - inset, 0, 255);
+        minColor[c] = std::clamp(minColor[c] + inset, 0, 255);
+    }
+
+    std::uint16_t color0 = toRgb565(maxColor[0], maxColor[1], maxColor[2]);
+    std::uint16_t color1 = toRgb565(minColor[0], minColor[1], minColor[2]);
+
+    // color0 > color1 selects the 4 color mode (no punch-through alpha)
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    std::uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        fromRgb565(color0, palette[0]);
+        fromRgb565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0;
+            int bestDistance = 1 << 30;
+            for (int p = 0; p < 4; ++p)
+            {
+                int dr = rgba[i * 4] - palette[p][0];
+                int dg = rgba[i * 4 + 1] - palette[p][1];
+                int db = rgba[i * 4 + 2] - palette[p][2];
+                int distance = dr * dr + dg * dg + db * db;
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+
+            indices |= static_cast<std::uint32_t>(best) << (i * 2);
+        }
+    }
+
+    block[0] = static_cast<unsigned char>(color0 & 0xFF);
+    block[1] = static_cast<unsigned char>(color0 >> 8);
+    block[2] = static_cast<unsigned char>(color1 & 0xFF);
+    block[3] = static_cast<unsigned char>(color1 >> 8);
+    block[4] = static_cast<unsigned char>(indices & 0xFF);
+    block[5] = static_cast<unsigned char>((indices >> 8) & 0xFF);
+    block[6] = static_cast<unsigned char>((indices >> 16) & 0xFF);
+    block[7] = static_cast<unsigned char>(indices >> 24);
+}
+
+void TextureCompressor::encodeBC4(const unsigned char values[16], unsigned char block[8])
+{
+    int minValue = 255;
+    int maxValue = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        minValue = std::min(minValue, static_cast<int>(values[i]));
+        maxValue = std::max(maxValue, static_cast<int>(values[i]));
+    }
+
+    // endpoint0 > endpoint1 selects the 8 value mode, both endpoints are reproduced exactly
+    std::uint64_t indices = 0;
+    if (maxValue != minValue)
+    {
+        int palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int i = 1; i < 7; ++i)
+        {
+            palette[i + 1] = ((7 - i) * maxValue + i * minValue + 3) / 7;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0;
+            int bestDistance = 256;
+            for (int p = 0; p < 8; ++p)
+            {
+                int distance = std::abs(values[i] - palette[p]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+
+            indices |= static_cast<std::uint64_t>(best) << (i * 3);
+        }
+    }
+
+    block[0] = static_cast<unsigned char>(maxValue);
+    block[1] = static_cast<unsigned char>(minValue);
+    for (int i = 0; i < 6; ++i)
+    {
+        block[2 + i] = static_cast<unsigned char>((indices >> (i * 8)) & 0xFF);
+    }
+}
+
+std::string TextureCompressor::getCachePath(const std::string& sourcePath, TextureUsage usage)
+{
+    return sourcePath + "." + usageName(usage) + ".ctex";
+}
+
+bool TextureCompressor::loadCache(const std::string& sourcePath, std::uint64_t sourceHash, TextureUsage usage, CompressedTexture& texture)
+{
+    MappedFile file;
+    if (!file.open(getCachePath(sourcePath, usage)) || file.size() < sizeof(CacheHeader))
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(CacheHeader));
+
+    bool valid =
+        std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) == 0 &&
+        header.version == CacheVersion &&
+        header.sourceHash == sourceHash &&
+        header.usage == static_cast<std::uint32_t>(usage);
+
+    std::size_t dataOffset = sizeof(CacheHeader) + static_cast<std::size_t>(header.levelCount) * sizeof(CacheLevel);
+    if (!valid || header.levelCount == 0 || file.size() < dataOffset)
+    {
+        return false;
+    }
+
+    texture = {};
+    texture.format = header.format;
+    texture.alphaToRgb = header.alphaToRgb != 0;
+    texture.data.assign(file.data() + dataOffset, file.data() + file.size());
+
+    for (std::uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        CacheLevel level;
+        std::memcpy(&level, file.data() + sizeof(CacheHeader) + i * sizeof(CacheLevel), sizeof(CacheLevel));
+
+        if (level.offset + level.size > texture.data.size())
+        {
+            std::cout << "ERROR::TEXTURE_CACHE::CORRUPT: " << getCachePath(sourcePath, usage) << std::endl;
+            texture = {};
+            return false;
+        }
+
+        texture.levels.push_back({ static_cast<int>(level.width), static_cast<int>(level.height), static_cast<std::size_t>(level.offset), static_cast<std::size_t>(level.size) });
+    }
+
+    return true;
+}
+
+bool TextureCompressor::writeCache(const std::string& sourcePath, std::uint64_t sourceHash, TextureUsage usage, const CompressedTexture& texture)
+{
+    CacheHeader header {};
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = CacheVersion;
+    header.sourceHash = sourceHash;
+    header.usage = static_cast<std::uint32_t>(usage);
+    header.format = texture.format;
+    header.alphaToRgb = texture.alphaToRgb ? 1 : 0;
+    header.levelCount = static_cast<std::uint32_t>(texture.levels.size());
+
+    // several decode tasks may build the same cache at once, each writes a file of its own and renames it over the
+    // cache when complete. the rename replaces the cache whole, so readers see one writer's complete file and never a mix
+    std::string cachePath = getCachePath(sourcePath, usage);
+    std::string temporaryPath = MappedFile::temporaryPath(cachePath);
+    std::error_code error;
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            std::cout << "ERROR::TEXTURE_CACHE::WRITE_FAILED: " << temporaryPath << std::endl;
+            return false;
+        }
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+        for (const CompressedTexture::Level& level : texture.levels)
+        {
+            CacheLevel entry { static_cast<std::uint32_t>(level.width), static_cast<std::uint32_t>(level.height), level.offset, level.size };
+            stream.write(reinterpret_cast<const char*>(&entry), sizeof(CacheLevel));
+        }
+        stream.write(reinterpret_cast<const char*>(texture.data.data()), static_cast<std::streamsize>(texture.data.size()));
+
+        if (!stream)
+        {
+            std::cout << "ERROR::TEXTURE_CACHE::WRITE_FAILED: " << temporaryPath << std::endl;
+            stream.close();
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error)
+    {
+        std::cout << "ERROR::TEXTURE_CACHE::WRITE_FAILED: " << cachePath << " " << error.message() << std::endl;
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    return true;
+}
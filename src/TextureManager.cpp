@@ -1,52 +1,45 @@
 #include "TextureManager.hpp"
-
-#include <iostream>
+#include "TextureCache.hpp"
 
 #include <glad/glad.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-void TextureManager::load(const std::string& fileName, const std::string& identifier)
+void TextureManager::load(const std::string& fileName, const std::string& identifier, TextureUsage usage)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // usable right away, shows a placeholder until the streamer finished uploading it.
+    // the same image already loaded by a model (or under another identifier) is shared instead of loaded again
+    unsigned int id = TextureCache::shared().acquire(fileName, usage);
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(fileName.c_str(), &width, &height, &nrComponents, 0);
-    if (!data)
+    auto it = _textures.find(identifier);
+    if (it != _textures.end())
     {
-        std::cout << "Texture failed to load at path: " << fileName << std::endl;
-        stbi_image_free(data);
+        TextureCache::shared().release(it->second);
+        it->second = id;
         return;
     }
 
-    GLenum format = 0;
-    if (nrComponents == 1) { format = GL_RED; }
-    if (nrComponents == 3) { format = GL_RGB; }
-    if (nrComponents == 4) { format = GL_RGBA; }
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
-
-    _textures[identifier] = textureID;
+    _textures.emplace(identifier, id);
 }
 
 unsigned int TextureManager::get(const std::string& identifier)
 {
-    return _textures[identifier];
+    auto it = _textures.find(identifier);
+    return it != _textures.end() ? it->second : 0;
+}
+
+void TextureManager::unload(const std::string& identifier)
+{
+    auto it = _textures.find(identifier);
+    if (it == _textures.end())
+    {
+        return;
+    }
+
+    TextureCache::shared().release(it->second);
+    _textures.erase(it);
 }
 
 void TextureManager::activate(unsigned int level, unsigned int id) const
 {
     glActiveTexture(level);
-    glBindTexture(GL_TEXTURE_2D, id);
+    glBindTexture(GL_TEXTURE_2D, TextureCache::shared().resolve(id));
 }
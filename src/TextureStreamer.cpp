@@ -0,0 +1,493 @@
+#include "TextureStreamer.hpp"
+#include "ThreadPool.hpp"
+#include "FileHash.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include <glad/glad.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace
+{
+    GLenum formatFromChannels(int channels)
+    {
+        if (channels == 1) { return GL_RED; }
+        if (channels == 3) { return GL_RGB; }
+        return GL_RGBA;
+    }
+
+    std::size_t imageSize(int width, int height, int channels)
+    {
+        return static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * static_cast<std::size_t>(channels);
+    }
+
+    // a full mip chain adds roughly a third on top of the base level
+    std::size_t withMipmaps(std::size_t baseSize)
+    {
+        return baseSize + baseSize / 3;
+    }
+
+    bool hasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+        for (GLint i = 0; i < count; ++i)
+        {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (extension && std::strcmp(extension, name) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+TextureStreamer::TextureStreamer() :
+    _queue{ std::make_shared<DecodeQueue>() }
+{
+    // make sure the pool outlives this object when both are function statics
+    ThreadPool::shared();
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // decodes still in flight own their pixels through the queue, only what already arrived is freed here
+    std::lock_guard<std::mutex> lock(_queue->mutex);
+    for (DecodedImage& image : _queue->ready)
+    {
+        stbi_image_free(image.pixels);
+    }
+    _queue->ready.clear();
+
+    stbi_image_free(_active.pixels);
+}
+
+TextureStreamer& TextureStreamer::shared()
+{
+    static TextureStreamer streamer;
+    return streamer;
+}
+
+unsigned int TextureStreamer::request(const std::string& path, TextureUsage usage, const glm::vec4& placeholderColor)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    // a single texel is already mipmap complete, the texture can be sampled right away
+    const unsigned char placeholder[4] =
+    {
+        static_cast<unsigned char>(glm::clamp(placeholderColor.x, 0.0f, 1.0f) * 255.0f),
+        static_cast<unsigned char>(glm::clamp(placeholderColor.y, 0.0f, 1.0f) * 255.0f),
+        static_cast<unsigned char>(glm::clamp(placeholderColor.z, 0.0f, 1.0f) * 255.0f),
+        static_cast<unsigned char>(glm::clamp(placeholderColor.w, 0.0f, 1.0f) * 255.0f)
+    };
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    std::uint64_t generation = ++_nextGeneration;
+    _requests[textureID] = generation;
+
+    {
+        std::lock_guard<std::mutex> lock(_queue->mutex);
+        _queue->liveRequests[textureID] = generation;
+    }
+
+    submitDecode(textureID, generation, path, usage);
+
+    return textureID;
+}
+
+void TextureStreamer::cancel(unsigned int texture)
+{
+    _requests.erase(texture);
+
+    // its content can't be shared anymore, the next request for it decodes it again
+    std::lock_guard<std::mutex> lock(_queue->mutex);
+    _queue->liveRequests.erase(texture);
+
+    auto it = _queue->ownedContent.find(texture);
+    if (it != _queue->ownedContent.end())
+    {
+        _queue->contentOwners.erase(it->second);
+        _queue->ownedContent.erase(it);
+    }
+}
+
+void TextureStreamer::setDuplicateCallback(DuplicateCallback callback)
+{
+    _duplicateCallback = std::move(callback);
+}
+
+void TextureStreamer::update()
+{
+    _stats.bytesUploadedLastFrame = 0;
+    uploadWithinBudget(_uploadBudget);
+}
+
+void TextureStreamer::flush()
+{
+    for (;;)
+    {
+        uploadWithinBudget(std::numeric_limits<std::size_t>::max());
+
+        std::unique_lock<std::mutex> lock(_queue->mutex);
+        if (_queue->pending == 0 && _queue->ready.empty())
+        {
+            break;
+        }
+
+        _queue->decoded.wait(lock, [this]() { return !_queue->ready.empty() || _queue->pending == 0; });
+    }
+}
+
+void TextureStreamer::release()
+{
+    _pbo.reset();
+}
+
+void TextureStreamer::setCompressionEnabled(bool enabled)
+{
+    _compressionEnabled = enabled;
+}
+
+bool TextureStreamer::isCompressionEnabled() const
+{
+    return _compressionEnabled;
+}
+
+void TextureStreamer::setUploadBudget(std::size_t bytesPerFrame)
+{
+    _uploadBudget = bytesPerFrame;
+}
+
+std::size_t TextureStreamer::getUploadBudget() const
+{
+    return _uploadBudget;
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() const
+{
+    Stats stats = _stats;
+
+    std::lock_guard<std::mutex> lock(_queue->mutex);
+    stats.pendingDecodes = _queue->pending;
+    stats.pendingUploads = _queue->ready.size() + (_active.texture != 0 ? 1 : 0);
+
+    return stats;
+}
+
+void TextureStreamer::submitDecode(unsigned int texture, std::uint64_t generation, const std::string& path, TextureUsage usage)
+{
+    {
+        std::lock_guard<std::mutex> lock(_queue->mutex);
+        ++_queue->pending;
+    }
+
+    std::shared_ptr<DecodeQueue> queue = _queue;
+    bool flip = _flipVertically;
+    bool compress = shouldCompress(usage);
+    bool share = static_cast<bool>(_duplicateCallback);
+
+    ThreadPool::shared().submit([queue, texture, generation, path, flip, compress, share, usage]()
+    {
+        PROFILE_ZONE("Decode texture");
+
+        DecodedImage image;
+        image.texture = texture;
+        image.generation = generation;
+        image.path = path;
+        image.usage = usage;
+
+        // the only time the file is hashed: it keys the compressed cache and finds requests for the same content.
+        // the cache is only ever written from flipped images, which is all this streamer produces
+        std::uint64_t sourceHash = FileHash::hashFile(path);
+
+        // unreadable files (hash 0) are never shared, they fail below
+        if (share && sourceHash != 0)
+        {
+            std::uint32_t usageValue = static_cast<std::uint32_t>(usage);
+            image.contentKey = FileHash::hashBytes(&usageValue, sizeof(usageValue), sourceHash);
+
+            // a cancelled request claiming content would leave a claim behind that nothing removes
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            auto live = queue->liveRequests.find(texture);
+            if (live != queue->liveRequests.end() && live->second == generation)
+            {
+                auto claim = queue->contentOwners.emplace(image.contentKey, ContentOwner{ texture, generation });
+                if (claim.second)
+                {
+                    queue->ownedContent[texture] = image.contentKey;
+                }
+                else if (claim.first->second.texture != texture)
+                {
+                    image.duplicateOf = claim.first->second.texture;
+                    image.duplicateGeneration = claim.first->second.generation;
+                }
+            }
+        }
+
+        // a duplicate has nothing to decode, update() hands it to the duplicate callback
+        if (image.duplicateOf == 0)
+        {
+            if (compress && sourceHash != 0 && TextureCompressor::loadCache(path, sourceHash, usage, image.compressed))
+            {
+                image.width = image.compressed.levels[0].width;
+                image.height = image.compressed.levels[0].height;
+                image.fromCache = true;
+            }
+            else
+            {
+                // the non _thread variant is a global and would race with the other decode tasks
+                stbi_set_flip_vertically_on_load_thread(flip);
+                image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+
+                if (compress && image.pixels)
+                {
+                    PROFILE_ZONE("Compress texture");
+
+                    image.compressed = TextureCompressor::compress(image.pixels, image.width, image.height, image.channels, usage);
+                    TextureCompressor::writeCache(path, sourceHash, usage, image.compressed);
+
+                    stbi_image_free(image.pixels);
+                    image.pixels = nullptr;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->ready.push_back(std::move(image));
+        --queue->pending;
+        queue->decoded.notify_all();
+    });
+}
+
+void TextureStreamer::shareActive()
+{
+    // the original has to still be the one decoding that content: cancelled (and maybe its name reused) it can't be shared
+    bool originalAlive = false;
+    {
+        std::lock_guard<std::mutex> lock(_queue->mutex);
+        auto it = _queue->contentOwners.find(_active.contentKey);
+        originalAlive = it != _queue->contentOwners.end() &&
+            it->second.texture == _active.duplicateOf && it->second.generation == _active.duplicateGeneration;
+    }
+
+    if (originalAlive && _duplicateCallback && _duplicateCallback(_active.texture, _active.duplicateOf))
+    {
+        _requests.erase(_active.texture);
+        ++_stats.duplicatesShared;
+        dropActive();
+        return;
+    }
+
+    // decode it after all, the task claims the content itself now or finds whoever did meanwhile
+    submitDecode(_active.texture, _active.generation, _active.path, _active.usage);
+    dropActive();
+}
+
+bool TextureStreamer::shouldCompress(TextureUsage usage)
+{
+    if (!_compressionEnabled)
+    {
+        return false;
+    }
+
+    if (!_formatsQueried)
+    {
+        _s3tcSupported = hasExtension("GL_EXT_texture_compression_s3tc");
+        _formatsQueried = true;
+
+        if (!_s3tcSupported)
+        {
+            std::cout << "GL_EXT_texture_compression_s3tc not supported, color textures are uploaded uncompressed" << std::endl;
+        }
+    }
+
+    return usage == TextureUsage::Normal || _s3tcSupported;
+}
+
+std::size_t TextureStreamer::stagingSize(const DecodedImage& image) const
+{
+    if (image.compressed.isValid())
+    {
+        return image.compressed.data.size();
+    }
+
+    return imageSize(image.width, image.height, image.channels);
+}
+
+bool TextureStreamer::isCurrent(const DecodedImage& image) const
+{
+    auto it = _requests.find(image.texture);
+    return it != _requests.end() && it->second == image.generation;
+}
+
+void TextureStreamer::dropActive()
+{
+    stbi_image_free(_active.pixels);
+    _active = {};
+    _activeBytesCopied = 0;
+}
+
+bool TextureStreamer::uploadWithinBudget(std::size_t budget)
+{
+    std::size_t remaining = budget;
+
+    while (remaining > 0)
+    {
+        if (_active.texture == 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_queue->mutex);
+                if (_queue->ready.empty())
+                {
+                    return false;
+                }
+
+                _active = std::move(_queue->ready.front());
+                _queue->ready.pop_front();
+                _activeBytesCopied = 0;
+            }
+
+            // cancelled while it was decoding
+            if (!isCurrent(_active))
+            {
+                dropActive();
+                continue;
+            }
+
+            // outside the queue's lock, the callback runs into the texture cache
+            if (_active.duplicateOf != 0)
+            {
+                shareActive();
+                continue;
+            }
+
+            if (!_active.pixels && !_active.compressed.isValid())
+            {
+                std::cout << "Texture failed to load at path: " << _active.path << std::endl;
+                _requests.erase(_active.texture);
+                dropActive();
+                continue;
+            }
+
+            if (_pbo == 0)
+            {
+                _pbo = GlBuffer::create();
+            }
+
+            // orphan the previous storage, the driver may still be reading from it for the last upload
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(stagingSize(_active)), nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        // cancelled while it was being staged
+        if (!isCurrent(_active))
+        {
+            dropActive();
+            continue;
+        }
+
+        // copy the next slice of the image into the pixel buffer
+        std::size_t totalBytes = stagingSize(_active);
+        const unsigned char* source = _active.compressed.isValid() ? _active.compressed.data.data() : _active.pixels;
+        std::size_t chunk = std::min(remaining, totalBytes - _activeBytesCopied);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo);
+        void* destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(_activeBytesCopied), static_cast<GLsizeiptr>(chunk),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (destination)
+        {
+            std::memcpy(destination, source + _activeBytesCopied, chunk);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        _activeBytesCopied += chunk;
+        _stats.bytesUploadedLastFrame += chunk;
+        remaining -= chunk;
+
+        if (_activeBytesCopied == totalBytes)
+        {
+            finishActiveUpload();
+        }
+    }
+
+    return true;
+}
+
+void TextureStreamer::finishActiveUpload()
+{
+    if (!isCurrent(_active))
+    {
+        dropActive();
+        return;
+    }
+
+    // the image is fully staged, the actual transfer is sourced from the pixel buffer
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo);
+    glBindTexture(GL_TEXTURE_2D, _active.texture);
+
+    const CompressedTexture& compressed = _active.compressed;
+    if (compressed.isValid())
+    {
+        // every level comes precomputed, the offsets are relative to the start of the pixel buffer
+        for (std::size_t level = 0; level < compressed.levels.size(); ++level)
+        {
+            const CompressedTexture::Level& info = compressed.levels[level];
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), compressed.format, info.width, info.height, 0,
+                static_cast<GLsizei>(info.size), reinterpret_cast<const void*>(info.offset));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(compressed.levels.size() - 1));
+
+        if (compressed.alphaToRgb)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ALPHA);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ALPHA);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ALPHA);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+        }
+
+        ++_stats.texturesCompressed;
+        _stats.compressedCacheHits += _active.fromCache ? 1 : 0;
+        _stats.textureMemory += compressed.data.size();
+        _stats.uncompressedTextureMemory += withMipmaps(imageSize(_active.width, _active.height, 4));
+    }
+    else
+    {
+        GLenum format = formatFromChannels(_active.channels);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, _active.width, _active.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // drivers pad RGB8 to 4 bytes per texel
+        std::size_t size = withMipmaps(imageSize(_active.width, _active.height, _active.channels == 3 ? 4 : _active.channels));
+        _stats.textureMemory += size;
+        _stats.uncompressedTextureMemory += size;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    _requests.erase(_active.texture);
+    dropActive();
+
+    ++_stats.texturesCompleted;
+}
@@ -0,0 +1,133 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(std::size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    _threads.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+        _threads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+
+    for (std::thread& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    struct State
+    {
+        std::atomic<std::size_t> next { 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+        int activeHelpers { 0 };
+        bool closed { false };
+    };
+
+    auto state = std::make_shared<State>();
+    const std::size_t total = count;
+
+    auto work = [state, total, &body]()
+    {
+        for (std::size_t i = state->next++; i < total; i = state->next++)
+        {
+            body(i);
+        }
+    };
+
+    std::size_t helperCount = std::min(_threads.size(), count - 1);
+    for (std::size_t i = 0; i < helperCount; ++i)
+    {
+        enqueue([state, work]()
+        {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->closed)
+                {
+                    return;
+                }
+                ++state->activeHelpers;
+            }
+
+            work();
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            --state->activeHelpers;
+            state->done.notify_all();
+        });
+    }
+
+    work();
+
+    // helpers that haven't started by now find the range closed and return right away,
+    // only the ones already running have to be waited for.
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->closed = true;
+    state->done.wait(lock, [&state]() { return state->activeHelpers == 0; });
+}
+
+std::size_t ThreadPool::getThreadCount() const
+{
+    return _threads.size();
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    _condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+            if (_stopping && _tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,146 @@
+#include "VertexFormat.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    std::int16_t toSnorm16(float value)
+    {
+        return static_cast<std::int16_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    std::int8_t toSnorm8(float value)
+    {
+        return static_cast<std::int8_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * 127.0f));
+    }
+
+    std::uint16_t toUnorm16(float value)
+    {
+        return static_cast<std::uint16_t>(std::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    float signNotZero(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+}
+
+glm::vec2 VertexFormat::octEncode(const glm::vec3& n)
+{
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 == 0.0f)
+    {
+        return glm::vec2(0.0f, 0.0f);
+    }
+
+    glm::vec2 p(n.x / l1, n.y / l1);
+
+    // fold the lower hemisphere over the diagonals
+    if (n.z < 0.0f)
+    {
+        p = glm::vec2((1.0f - std::abs(p.y)) * signNotZero(p.x), (1.0f - std::abs(p.x)) * signNotZero(p.y));
+    }
+
+    return p;
+}
+
+glm::vec3 VertexFormat::octDecode(const glm::vec2& e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+
+    return glm::normalize(n);
+}
+
+bool VertexFormat::hasBones(const Vertex& vertex)
+{
+    for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+    {
+        if (vertex.m_BoneIDs[i] >= 0 && vertex.m_Weights[i] > 0.0f)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VertexFormat::texCoordsInUnitRange(const Vertex* vertices, std::size_t count)
+{
+    return std::all_of(vertices, vertices + count, [](const Vertex& vertex)
+    {
+        return vertex.TexCoords.x >= 0.0f && vertex.TexCoords.x <= 1.0f &&
+            vertex.TexCoords.y >= 0.0f && vertex.TexCoords.y <= 1.0f;
+    });
+}
+
+CompactVertex VertexFormat::toCompact(const Vertex& vertex, bool unormTexCoords)
+{
+    CompactVertex compact;
+    compact.Position = vertex.Position;
+
+    glm::vec2 normal = octEncode(vertex.Normal);
+    compact.Normal[0] = toSnorm16(normal.x);
+    compact.Normal[1] = toSnorm16(normal.y);
+
+    // bitangent is rebuilt in the shader as cross(N, T) * sign
+    glm::vec2 tangent = octEncode(vertex.Tangent);
+    float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+    compact.Tangent[0] = toSnorm8(tangent.x);
+    compact.Tangent[1] = toSnorm8(tangent.y);
+    compact.Tangent[2] = toSnorm8(handedness);
+    compact.Tangent[3] = 0;
+
+    if (unormTexCoords)
+    {
+        compact.TexCoords[0] = toUnorm16(vertex.TexCoords.x);
+        compact.TexCoords[1] = toUnorm16(vertex.TexCoords.y);
+    }
+    else
+    {
+        compact.TexCoords[0] = static_cast<std::uint16_t>(glm::packHalf1x16(vertex.TexCoords.x));
+        compact.TexCoords[1] = static_cast<std::uint16_t>(glm::packHalf1x16(vertex.TexCoords.y));
+    }
+
+    return compact;
+}
+
+SkinVertex VertexFormat::toSkin(const Vertex& vertex)
+{
+    SkinVertex skin {};
+
+    float total = 0.0f;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+    {
+        if (vertex.m_BoneIDs[i] >= 0)
+        {
+            total += vertex.m_Weights[i];
+        }
+    }
+
+    for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+    {
+        if (vertex.m_BoneIDs[i] < 0 || total <= 0.0f)
+        {
+            continue;
+        }
+
+        skin.BoneIDs[i] = static_cast<std::uint16_t>(std::min(vertex.m_BoneIDs[i], static_cast<int>(std::numeric_limits<std::uint16_t>::max())));
+        skin.Weights[i] = static_cast<std::uint8_t>(std::round(vertex.m_Weights[i] / total * 255.0f));
+    }
+
+    return skin;
+}
+
+bool VertexFormat::fitsShortIndices(std::size_t vertexCount)
+{
+    // indices go up to vertexCount - 1, so at most 0xFFFE and 0xFFFF stays free as a primitive restart index
+    return vertexCount <= static_cast<std::size_t>(std::numeric_limits<std::uint16_t>::max());
+}
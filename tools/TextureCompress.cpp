@@ -0,0 +1,136 @@
+#include "TextureCompressor.hpp"
+#include "FileHash.hpp"
+#include "ThreadPool.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Job
+    {
+        std::string path;
+        TextureUsage usage;
+    };
+
+    void printUsage()
+    {
+        std::cout <<
+            "usage: OpenGL_Lighting_texcompress [--force] [--usage color|specular|normal] IMAGE... [--usage ...] IMAGE...\n"
+            "  writes IMAGE.<usage>.ctex next to every image, the cache TextureStreamer loads instead of decoding it.\n"
+            "  --usage applies to the images after it (color by default) and has to match what the app loads them as:\n"
+            "  texture_specular maps are specular, texture_normal maps are normal, everything else is color.\n"
+            "  --force                  rebuild caches that are already up to date" << std::endl;
+    }
+
+    bool parseUsage(const char* name, TextureUsage& usage)
+    {
+        if (std::strcmp(name, "color") == 0) { usage = TextureUsage::Color; return true; }
+        if (std::strcmp(name, "specular") == 0) { usage = TextureUsage::Specular; return true; }
+        if (std::strcmp(name, "normal") == 0) { usage = TextureUsage::Normal; return true; }
+        return false;
+    }
+
+    // same steps as the streamer's decode task on a cache miss
+    bool compressImage(const Job& job, bool force)
+    {
+        std::uint64_t sourceHash = FileHash::hashFile(job.path);
+        if (sourceHash == 0)
+        {
+            std::cout << "ERROR::TEXTURE_COMPRESS::READ_FAILED: " << job.path << std::endl;
+            return false;
+        }
+
+        CompressedTexture existing;
+        if (!force && TextureCompressor::loadCache(job.path, sourceHash, job.usage, existing))
+        {
+            std::cout << "up to date " << TextureCompressor::getCachePath(job.path, job.usage) << std::endl;
+            return true;
+        }
+
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        unsigned char* pixels = stbi_load(job.path.c_str(), &width, &height, &channels, 0);
+        if (!pixels)
+        {
+            std::cout << "ERROR::TEXTURE_COMPRESS::DECODE_FAILED: " << job.path << " " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+
+        CompressedTexture texture = TextureCompressor::compress(pixels, width, height, channels, job.usage);
+        stbi_image_free(pixels);
+
+        if (!TextureCompressor::writeCache(job.path, sourceHash, job.usage, texture))
+        {
+            return false;
+        }
+
+        std::cout << "wrote " << TextureCompressor::getCachePath(job.path, job.usage) << " (" << width << "x" << height << ", "
+            << texture.levels.size() << " levels, " << texture.data.size() << " bytes)" << std::endl;
+        return true;
+    }
+}
+
+// the offline half of the texture build step, see TextureCompressor. without it every image is compressed by
+// the first run that loads it, which costs that run a decode plus a full BC encode per texture
+int main(int argc, char** argv)
+{
+    std::vector<Job> jobs;
+    TextureUsage usage = TextureUsage::Color;
+    bool force = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if (argument == "--help" || argument == "-h")
+        {
+            printUsage();
+            return 0;
+        }
+        else if (argument == "--force")
+        {
+            force = true;
+        }
+        else if (argument == "--usage" && i + 1 < argc && parseUsage(argv[i + 1], usage))
+        {
+            ++i;
+        }
+        else if (argument.rfind("--", 0) == 0)
+        {
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            jobs.push_back({ argument, usage });
+        }
+    }
+
+    if (jobs.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    // the app loads every image flipped and the cache stores what it uploads
+    stbi_set_flip_vertically_on_load(true);
+
+    std::atomic<bool> succeeded { true };
+    ThreadPool::shared().parallelFor(jobs.size(), [&](std::size_t i)
+    {
+        if (!compressImage(jobs[i], force))
+        {
+            succeeded = false;
+        }
+    });
+
+    return succeeded ? 0 : 1;
+}
\ No newline at end of file